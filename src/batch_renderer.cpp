@@ -0,0 +1,386 @@
+#include "batch_renderer.h"
+#include "waveform_polyline.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+#include <qcustomplot.h>
+
+// Worker processes report their view count on stdout behind this tag
+#define RENDER_WORKER_TAG   "rendered "
+#define RENDER_POLL_MS      (50)
+
+bool BatchRenderer::IsRequested(int argc, char* argv[])
+{
+    for (int index = 1; index < argc; index++)
+    {
+        if (std::strcmp(argv[index], "--render") == 0) return true;
+    }
+    return false;
+}
+
+int BatchRenderer::Run(int argc, char* argv[])
+{
+    // No display is needed, the platform has to be chosen before the application exists
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Render standard views of Pulseq files without a display.");
+    parser.addHelpOption();
+    QCommandLineOption renderOption("render", "View specification (JSON).", "spec");
+    QCommandLineOption outputOption("output", "Output directory.", "dir", ".");
+    QCommandLineOption jobsOption("jobs", "Number of worker processes.", "n", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption workerOption("worker", "Render in this process and report the view count.");
+    workerOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOptions({renderOption, outputOption, jobsOption, workerOption});
+    parser.addPositionalArgument("files", "Pulseq files to render.", "files...");
+    parser.process(app);
+
+    const QString sSpecPath = parser.value(renderOption);
+    QFile specFile(sSpecPath);
+    if (!specFile.open(QIODevice::ReadOnly))
+    {
+        qCritical().noquote() << "Cannot open view specification" << sSpecPath;
+        return 1;
+    }
+    QJsonParseError error;
+    const QJsonDocument spec = QJsonDocument::fromJson(specFile.readAll(), &error);
+    if (!spec.isObject())
+    {
+        qCritical().noquote() << "Invalid view specification:" << error.errorString();
+        return 1;
+    }
+
+    const QStringList listFiles = parser.positionalArguments();
+    const QString sOutputDir = parser.value(outputOption);
+    if (listFiles.isEmpty())
+    {
+        parser.showHelp(1);
+    }
+    if (!QDir().mkpath(sOutputDir))
+    {
+        qCritical().noquote() << "Cannot create output directory" << sOutputDir;
+        return 1;
+    }
+
+    const bool bWorker = parser.isSet(workerOption);
+    const int jobs = qBound(1, parser.value(jobsOption).toInt(), static_cast<int>(listFiles.size()));
+
+    QElapsedTimer timer;
+    timer.start();
+    uint64_t views(0);
+    int failed(0);
+    if (bWorker || jobs == 1)
+    {
+        BatchRenderer renderer(spec.object(), sOutputDir);
+        for (const QString& sFilePath : listFiles)
+        {
+            const int count = renderer.RenderFile(sFilePath);
+            if (count < 0) failed++;
+            else views += count;
+        }
+        if (bWorker)
+        {
+            out << RENDER_WORKER_TAG << views << Qt::endl;
+            return failed == 0 ? 0 : 1;
+        }
+    }
+    else
+    {
+        const QStringList listArgs{"--render", sSpecPath, "--output", sOutputDir, "--worker"};
+        views = RunWorkers(listFiles, listArgs, jobs, failed);
+    }
+
+    const double seconds = std::max(timer.elapsed() * 1e-3, 1e-3);
+    out << QString("Rendered %1 views of %2 files in %3 s (%4 views/s, %5 worker processes)")
+               .arg(views).arg(listFiles.size() - failed).arg(seconds, 0, 'f', 2).arg(views / seconds, 0, 'f', 1).arg(bWorker ? 1 : jobs)
+        << Qt::endl;
+    if (failed > 0)
+    {
+        out << QString("%1 files failed").arg(failed) << Qt::endl;
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+uint64_t BatchRenderer::RunWorkers(const QStringList& listFiles, const QStringList& listArgs, const int& jobs, int& failed)
+{
+    uint64_t views(0);
+    int next(0);
+    QList<QProcess*> listRunning;
+    while (next < listFiles.size() || !listRunning.isEmpty())
+    {
+        while (listRunning.size() < jobs && next < listFiles.size())
+        {
+            QProcess* pProcess = new QProcess;
+            pProcess->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+            pProcess->start(QCoreApplication::applicationFilePath(), listArgs + QStringList(listFiles[next++]));
+            listRunning.append(pProcess);
+        }
+
+        for (int index = listRunning.size() - 1; index >= 0; index--)
+        {
+            QProcess* pProcess = listRunning[index];
+            if (!pProcess->waitForFinished(RENDER_POLL_MS) && pProcess->state() != QProcess::NotRunning) continue;
+
+            bool bReported(false);
+            const QStringList listLines = QString::fromLocal8Bit(pProcess->readAllStandardOutput()).split('\n');
+            for (const QString& sLine : listLines)
+            {
+                if (sLine.startsWith(RENDER_WORKER_TAG))
+                {
+                    views += sLine.mid(static_cast<int>(std::strlen(RENDER_WORKER_TAG))).trimmed().toULongLong(&bReported);
+                }
+            }
+            if (!bReported || pProcess->exitStatus() != QProcess::NormalExit || pProcess->exitCode() != 0)
+            {
+                failed++;
+            }
+            delete pProcess;
+            listRunning.removeAt(index);
+        }
+    }
+    return views;
+}
+
+BatchRenderer::BatchRenderer(const QJsonObject& spec, const QString& sOutputDir)
+    : m_stSpec(spec)
+    , m_sOutputDir(sOutputDir)
+    , m_sFormat(spec.value("format").toString("png").toLower())
+    , m_nWidth(spec.value("width").toInt(RENDER_DEFAULT_WIDTH))
+    , m_nHeight(spec.value("height").toInt(RENDER_DEFAULT_HEIGHT))
+    , m_dScale(spec.value("scale").toDouble(1.))
+    , m_pPlot(new QCustomPlot)
+    , m_dGradRasterTime_us(10.)
+{
+    if (m_sFormat != "png" && m_sFormat != "pdf")
+    {
+        qWarning().noquote() << "Unknown format" << m_sFormat << ", using png";
+        m_sFormat = "png";
+    }
+    // Never shown, the plot only needs a size for its layout
+    m_pPlot->resize(m_nWidth, m_nHeight);
+    m_pPlot->setAntialiasedElements(QCP::aeAll);
+    m_pPlot->setPlottingHints(QCP::phFastPolylines | QCP::phCacheLabels);
+}
+
+BatchRenderer::~BatchRenderer()
+{
+    delete m_pPlot;
+}
+
+int BatchRenderer::RenderFile(const QString& sFilePath)
+{
+    std::shared_ptr<ExternalSequence> spSequence = std::make_shared<ExternalSequence>();
+    PulseqLoader loader;
+    loader.SetPulseqFile(sFilePath);
+    loader.SetSequence(spSequence);
+
+    // Loader and receiver live in this thread, so the signals are delivered directly
+    SeqInfo seqInfo;
+    QVector<SeqBlock*> vecBlocks;
+    bool bLoaded(false);
+    QObject::connect(&loader, &PulseqLoader::errorOccurred, [&sFilePath](const QString& error) {
+        qCritical().noquote() << sFilePath << ":" << error;
+    });
+    QObject::connect(&loader, &PulseqLoader::loadingCompleted,
+        [&](const SeqInfo& info,
+            const QVector<SeqBlock*>& blocks,
+            const QMap<int, QVector<float>>&,
+            const QVector<RfInfo>&,
+            const RfTimeWaveShapeMap&,
+            QVector<GradTrapInfo>,
+            QVector<GradTrapInfo>,
+            QVector<GradTrapInfo>,
+            QVector<AdcInfo>,
+            const SequenceFingerprint& fingerprint,
+            const std::shared_ptr<LabelTable>&) {
+            seqInfo = info;
+            vecBlocks = blocks;
+            m_vecBlockStart_us = fingerprint.startTime_us;
+            bLoaded = true;
+        });
+    loader.process();
+    if (!bLoaded || vecBlocks.isEmpty() || m_vecBlockStart_us.size() != static_cast<size_t>(vecBlocks.size()) + 1)
+    {
+        qDeleteAll(vecBlocks);
+        return -1;
+    }
+    m_vecBlocks.assign(vecBlocks.begin(), vecBlocks.end());
+    m_dGradRasterTime_us = spSequence->GetGradientRasterTime_us();
+
+    const QString sBaseName = QFileInfo(sFilePath).completeBaseName();
+    int count(0);
+    for (const RenderView& view : ExpandViews(seqInfo))
+    {
+        const QString sOutputPath = QDir(m_sOutputDir).filePath(sBaseName + "_" + view.sName + "." + m_sFormat);
+        if (SaveView(view, QFileInfo(sFilePath).fileName() + " - " + view.sName, sOutputPath))
+        {
+            count++;
+        }
+        else
+        {
+            qCritical().noquote() << "Writing" << sOutputPath << "failed!";
+        }
+    }
+
+    qDeleteAll(vecBlocks);
+    m_vecBlocks.clear();
+    m_vecBlockStart_us.clear();
+    return count;
+}
+
+QVector<RenderView> BatchRenderer::ExpandViews(const SeqInfo& seqInfo) const
+{
+    QVector<RenderView> vecViews;
+    const double dTotal_us = m_vecBlockStart_us.back();
+    QJsonArray views = m_stSpec.value("views").toArray();
+    if (views.isEmpty())
+    {
+        views.append(QJsonObject{{"name", "full"}});
+    }
+
+    for (int index = 0; index < views.size(); index++)
+    {
+        const QJsonObject object = views[index].toObject();
+        RenderView view;
+        view.sName = object.value("name").toString(QString("view%1").arg(index));
+
+        const QJsonArray lanes = object.value("lanes").toArray();
+        for (const QJsonValue& lane : lanes)
+        {
+            const int laneIndex = WaveformPolyline::LaneFromName(lane.toString().toUpper().toStdString());
+            if (laneIndex < 0) qWarning().noquote() << "Unknown lane" << lane.toString() << "in view" << view.sName;
+            else view.vecLanes.append(laneIndex);
+        }
+        if (view.vecLanes.isEmpty())
+        {
+            for (int lane = 0; lane < kLaneNum; lane++) view.vecLanes.append(lane);
+        }
+
+        if (object.value("eachAdc").toBool())
+        {
+            // One view per readout, numbered in sequence order
+            const double padding_us = object.value("padding_us").toDouble(RENDER_DEFAULT_PADDING_US);
+            const int maxViews = object.value("maxViews").toInt(RENDER_DEFAULT_MAX_VIEWS);
+            int adcIndex(0);
+            for (size_t block = 0; block < m_vecBlocks.size() && adcIndex < maxViews; block++)
+            {
+                if (!m_vecBlocks[block]->isADC()) continue;
+                const ADCEvent& adc = m_vecBlocks[block]->GetADCEvent();
+                RenderView readout(view);
+                readout.sName = QString("%1_%2").arg(view.sName).arg(adcIndex++, 4, 10, QChar('0'));
+                readout.start_us = m_vecBlockStart_us[block] + adc.delay - padding_us;
+                readout.end_us = m_vecBlockStart_us[block] + adc.delay + adc.dwellTime * adc.numSamples * 1e-3 + padding_us;
+                vecViews.append(readout);
+            }
+            continue;
+        }
+
+        if (object.contains("repetition"))
+        {
+            const uint64_t repetition = static_cast<uint64_t>(std::max(0., object.value("repetition").toDouble()));
+            if (seqInfo.periodBlocks == 0 || repetition >= seqInfo.repetitions)
+            {
+                qWarning().noquote() << "View" << view.sName << "skipped, repetition" << repetition << "not found";
+                continue;
+            }
+            const uint64_t firstBlock = seqInfo.periodStartBlock + repetition * seqInfo.periodBlocks;
+            view.start_us = m_vecBlockStart_us[firstBlock];
+            view.end_us = m_vecBlockStart_us[firstBlock + seqInfo.periodBlocks];
+        }
+        else
+        {
+            view.start_us = object.value("start_us").toDouble(0.);
+            view.end_us = object.value("end_us").toDouble(dTotal_us);
+        }
+
+        if (view.end_us <= view.start_us)
+        {
+            qWarning().noquote() << "View" << view.sName << "skipped, empty time window";
+            continue;
+        }
+        vecViews.append(view);
+    }
+    return vecViews;
+}
+
+bool BatchRenderer::SaveView(const RenderView& view, const QString& sTitle, const QString& sFilePath)
+{
+    m_pPlot->clearPlottables();
+    m_pPlot->plotLayout()->clear();
+
+    QCPTextElement* pTitle = new QCPTextElement(m_pPlot, sTitle);
+    m_pPlot->plotLayout()->addElement(0, 0, pTitle);
+    QCPMarginGroup* pMarginGroup = new QCPMarginGroup(m_pPlot);
+
+    // Only blocks overlapping the window contribute, events narrower than a pixel collapse to their envelope
+    const WaveformPolyline polyline(m_dGradRasterTime_us);
+    const double minEventWidth_us = (view.end_us - view.start_us) / std::max(m_nWidth, 1);
+    size_t firstBlock = std::upper_bound(m_vecBlockStart_us.begin(), m_vecBlockStart_us.end() - 1, view.start_us) - m_vecBlockStart_us.begin();
+    firstBlock = firstBlock > 0 ? firstBlock - 1 : 0;
+    const size_t lastBlock = std::lower_bound(m_vecBlockStart_us.begin(), m_vecBlockStart_us.end() - 1, view.end_us) - m_vecBlockStart_us.begin();
+
+    QFont labelFont;
+    labelFont.setWeight(QFont::DemiBold);
+    std::vector<double> vecTime, vecValue;
+    for (int row = 0; row < view.vecLanes.size(); row++)
+    {
+        const int lane = view.vecLanes[row];
+        QCPAxisRect* pRect = new QCPAxisRect(m_pPlot);
+        m_pPlot->plotLayout()->addElement(row + 1, 0, pRect);
+        pRect->setMinimumMargins(QMargins(70, 10, 10, 10));
+        pRect->setMarginGroup(QCP::msLeft | QCP::msRight, pMarginGroup);
+        pRect->setupFullAxesBox(true);
+
+        QCPAxis* pKeyAxis = pRect->axis(QCPAxis::atBottom);
+        QCPAxis* pValueAxis = pRect->axis(QCPAxis::atLeft);
+        pKeyAxis->setRange(view.start_us, view.end_us);
+        if (row + 1 == view.vecLanes.size()) pKeyAxis->setLabel("Time (us)");
+        else pKeyAxis->setTickLabels(false);
+        pValueAxis->setLabel(QString::fromStdString(WaveformPolyline::LaneLabel(lane)));
+        pValueAxis->setLabelFont(labelFont);
+        pValueAxis->setNumberFormat("f");
+        pValueAxis->setNumberPrecision(0);
+
+        vecTime.clear();
+        vecValue.clear();
+        for (size_t block = firstBlock; block <= lastBlock && block < m_vecBlocks.size(); block++)
+        {
+            polyline.AppendBlock(m_vecBlocks[block], m_vecBlockStart_us[block], lane, minEventWidth_us, vecTime, vecValue);
+        }
+        QCPGraph* pGraph = m_pPlot->addGraph(pKeyAxis, pValueAxis);
+        pGraph->setPen(QPen(Qt::blue));
+        pGraph->setData(QVector<double>(vecTime.begin(), vecTime.end()), QVector<double>(vecValue.begin(), vecValue.end()), true);
+
+        if (lane == kLaneAdc)
+        {
+            QSharedPointer<QCPAxisTickerText> ticker(new QCPAxisTickerText);
+            ticker->addTick(0, "0");
+            ticker->addTick(1, "1");
+            pValueAxis->setTicker(ticker);
+            pValueAxis->setRange(0, 1.3);
+            continue;
+        }
+        bool bFound(false);
+        const QCPRange range = pGraph->getValueRange(bFound, QCP::sdBoth, QCPRange(view.start_us, view.end_us));
+        if (bFound && range.size() > 0.) pValueAxis->setRange(range.lower - 0.1 * range.size(), range.upper + 0.1 * range.size());
+        else pValueAxis->setRange(-1., 1.);
+    }
+
+    if (m_sFormat == "pdf")
+    {
+        return m_pPlot->savePdf(sFilePath, m_nWidth, m_nHeight, QCP::epNoCosmetic, "PulseqViewer", sTitle);
+    }
+    return m_pPlot->savePng(sFilePath, m_nWidth, m_nHeight, m_dScale);
+}
@@ -0,0 +1,71 @@
+#ifndef BATCH_RENDERER_H
+#define BATCH_RENDERER_H
+
+#include <QJsonObject>
+#include <QStringList>
+#include <QVector>
+#include <vector>
+#include "pulseq_loader.h"
+
+class QCustomPlot;
+
+#define RENDER_DEFAULT_WIDTH        (1600)
+#define RENDER_DEFAULT_HEIGHT       (900)
+#define RENDER_DEFAULT_PADDING_US   (100.)
+#define RENDER_DEFAULT_MAX_VIEWS    (100)
+
+struct RenderView
+{
+    QString sName;
+    double start_us;
+    double end_us;
+    QVector<int> vecLanes;
+
+    RenderView()
+        : start_us(0.)
+        , end_us(0.)
+    {}
+};
+
+// Headless rendering of standard views, e.g. for protocol documentation:
+//   PulseqViewer --render views.json --output out/ [--jobs N] a.seq b.seq ...
+// The view specification is a JSON object:
+//   {"width": 1600, "height": 900, "scale": 1, "format": "png" | "pdf",
+//    "views": [{"name": "full", "lanes": ["RF", "GZ", "GY", "GX", "ADC"]},
+//              {"name": "window", "start_us": 0, "end_us": 20000},
+//              {"name": "tr", "repetition": 0},
+//              {"name": "readout", "eachAdc": true, "padding_us": 100, "maxViews": 100}]}
+// Files are distributed over worker processes of this executable, each
+// rendering with the offscreen QPA platform.
+class BatchRenderer
+{
+public:
+    static bool IsRequested(int argc, char* argv[]);
+    static int Run(int argc, char* argv[]);
+
+private:
+    BatchRenderer(const QJsonObject& spec, const QString& sOutputDir);
+    ~BatchRenderer();
+
+    // Number of views written, -1 when the file cannot be loaded
+    int RenderFile(const QString& sFilePath);
+    QVector<RenderView> ExpandViews(const SeqInfo& seqInfo) const;
+    bool SaveView(const RenderView& view, const QString& sTitle, const QString& sFilePath);
+
+    static uint64_t RunWorkers(const QStringList& listFiles, const QStringList& listArgs, const int& jobs, int& failed);
+
+    QJsonObject                 m_stSpec;
+    QString                     m_sOutputDir;
+    QString                     m_sFormat;
+    int                         m_nWidth;
+    int                         m_nHeight;
+    double                      m_dScale;
+    QCustomPlot*                m_pPlot;
+
+    // Per file
+    std::vector<SeqBlock*>      m_vecBlocks;
+    std::vector<double>         m_vecBlockStart_us;
+    double                      m_dGradRasterTime_us;
+};
+
+#endif // BATCH_RENDERER_H
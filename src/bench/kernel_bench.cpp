@@ -0,0 +1,768 @@
+#include "event_polyline.h"
+#include "message_log.h"
+#include "repetition_detector.h"
+#include "sequence_checker.h"
+#include "sequence_diff.h"
+#include "sequence_statistics.h"
+#include "sequence_timeline.h"
+#include "task_pool.h"
+
+#include <ExternalSequence.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define BENCH_SAMPLES                (5)
+#define BENCH_DEFAULT_MIN_TIME_MS    (200)
+#define BENCH_DEFAULT_THRESHOLD_PCT  (10.)
+#define BENCH_DEFAULT_REPETITIONS    (2000)
+#define BENCH_RF_SAMPLES             (1000)
+#define BENCH_LONG_RF_SAMPLES        (100000)
+#define BENCH_POOL_TASKS             (1000)
+#define BENCH_EPI_READOUTS           (96)
+#define BENCH_EPI_TRS                (41)
+#define BENCH_RAMP_SAMPLES           (50)
+
+struct BenchResult
+{
+    std::string name;
+    uint64_t    iterations;     // per sample
+    uint64_t    itemsPerOp;     // lines, samples, blocks or events handled by one op
+    double      nsPerOp;        // median over BENCH_SAMPLES
+    double      nsPerItem;
+};
+
+// Times the parser and render-prep kernels of the viewer in isolation. Private
+// parser helpers are reached through load() and decodeBlock() on synthetic input.
+class KernelBench
+{
+public:
+    KernelBench(const int& repetitions, const double& minTime_ms, const std::string& sFilter);
+
+    bool Prepare();
+    void Run();
+    const std::vector<BenchResult>& Results() const { return m_vecResults; }
+
+    // Appends the synthetic blocks until the timeline holds at least the given
+    // number of events and checks its end time against the integer sum of the
+    // block durations. Also loads an RF pulse of more than 65535 samples.
+    bool RunStress(const uint64_t& events);
+
+    static void WriteJson(std::ostream& out, const std::vector<BenchResult>& results);
+    static bool ReadBaseline(const std::string& sPath, std::map<std::string, double>& baseline);
+
+private:
+    static std::string MakeSequence(const int& repetitions);
+    // Periods of an EPI-like sequence, readout trains must not hide the TR
+    static bool CheckRepetitions();
+    static bool CheckSplitGradient();
+    void Measure(const std::string& sName, const uint64_t& itemsPerOp, const std::function<void()>& op);
+
+    void BenchGetline();
+    void BenchLoad();
+    void BenchDecompressShape();
+    void BenchGetBlock();
+    void BenchDecodeBlock();
+    void BenchDecodeBlockLogged();
+    void BenchRfMagnitudes();
+    void BenchTrapezoids();
+    void BenchRfGraphData();
+    void BenchStatistics();
+    void BenchTaskPool();
+
+    int                                  m_nRepetitions;
+    double                               m_dMinTime_ms;
+    std::string                          m_sFilter;
+    std::string                          m_sSequence;
+    ExternalSequence                     m_sequence;
+    std::vector<SeqBlock*>               m_vecBlocks;
+    std::vector<std::unique_ptr<SeqBlock>> m_vecOwnedBlocks;
+    SequenceTimeline                     m_timeline;
+    std::vector<BenchResult>             m_vecResults;
+};
+
+// Keeps the optimizer from dropping the result of a timed kernel
+static volatile double s_dSink = 0.;
+
+KernelBench::KernelBench(const int& repetitions, const double& minTime_ms, const std::string& sFilter)
+    : m_nRepetitions(repetitions)
+    , m_dMinTime_ms(minTime_ms)
+    , m_sFilter(sFilter)
+{
+}
+
+std::string KernelBench::MakeSequence(const int& repetitions)
+{
+    // Repetitions of [RF + slice select, arbitrary phase encode, readout + ADC,
+    // spoiler], the block mix of a gradient echo sequence
+    std::ostringstream seq;
+    seq << "# Pulseq sequence file\n[VERSION]\nmajor 1\nminor 4\nrevision 1\n\n"
+        << "[DEFINITIONS]\nAdcRasterTime 1e-07\nBlockDurationRaster 1e-05\n"
+        << "GradientRasterTime 1e-05\nRadiofrequencyRasterTime 1e-06\nName kernel_bench\n\n";
+
+    seq << "# id dur rf gx gy gz adc ext\n[BLOCKS]\n";
+    int blockID = 1;
+    for (int index = 0; index < repetitions; index++)
+    {
+        seq << blockID++ << " 120 1 0 0 1 0 0\n";
+        seq << blockID++ << " 60 0 0 4 0 0 0\n";
+        seq << blockID++ << " 300 0 2 0 0 1 0\n";
+        seq << blockID++ << " 60 0 0 0 3 0 0\n";
+    }
+
+    seq << "\n[RF]\n1 500 1 2 0 100 0 0\n\n"
+        << "[GRADIENTS]\n4 1e5 3 0 0\n\n"
+        << "[TRAP]\n1 2e5 100 1000 100 0\n2 4e5 100 2800 100 0\n3 -3e5 200 200 200 0\n\n"
+        << "[ADC]\n1 256 10000 200 0 0\n\n";
+
+    // Uncompressed sinc magnitude, compressed constant phase and a compressed
+    // arbitrary gradient of ramp, plateau and ramp
+    seq << "[SHAPES]\n\nshape_id 1\nnum_samples " << BENCH_RF_SAMPLES << "\n" << std::fixed << std::setprecision(6);
+    for (int index = 0; index < BENCH_RF_SAMPLES; index++)
+    {
+        const double x = M_PI * (index - BENCH_RF_SAMPLES / 2) / 100.;
+        seq << (index == BENCH_RF_SAMPLES / 2 ? 1. : std::fabs(std::sin(x) / x)) << "\n";
+    }
+    seq << "\nshape_id 2\nnum_samples " << BENCH_RF_SAMPLES << "\n0\n0\n" << BENCH_RF_SAMPLES - 2 << "\n";
+    seq << "\nshape_id 3\nnum_samples 50\n0.1\n0.1\n8\n0\n0\n28\n-0.1\n-0.1\n8\n\n";
+    return seq.str();
+}
+
+bool KernelBench::Prepare()
+{
+    m_sSequence = MakeSequence(m_nRepetitions);
+    std::istringstream stream(m_sSequence);
+    if (!m_sequence.load(stream))
+    {
+        std::cerr << "Synthetic sequence failed to load" << std::endl;
+        return false;
+    }
+
+    const int blocks = m_sequence.GetNumberOfBlocks();
+    m_vecBlocks.reserve(blocks);
+    for (int index = 0; index < blocks; index++)
+    {
+        m_vecOwnedBlocks.emplace_back(m_sequence.GetBlock(index));
+        if (!m_sequence.decodeBlock(m_vecOwnedBlocks.back().get()))
+        {
+            std::cerr << "Synthetic block " << index << " failed to decode" << std::endl;
+            return false;
+        }
+        m_vecBlocks.push_back(m_vecOwnedBlocks.back().get());
+    }
+    m_timeline.Build(m_vecBlocks, m_sequence.GetBlockDurationRaster_us());
+    return true;
+}
+
+void KernelBench::Measure(const std::string& sName, const uint64_t& itemsPerOp, const std::function<void()>& op)
+{
+    if (!m_sFilter.empty() && sName.find(m_sFilter) == std::string::npos) return;
+
+    typedef std::chrono::steady_clock Clock;
+    // Grow the iteration count until one sample takes its share of the minimum time
+    const double sampleTime_ns = m_dMinTime_ms * 1e6 / BENCH_SAMPLES;
+    uint64_t iterations = 1;
+    while (true)
+    {
+        const Clock::time_point start = Clock::now();
+        for (uint64_t index = 0; index < iterations; index++) op();
+        const double elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (elapsed_ns >= sampleTime_ns) break;
+        const double scale = elapsed_ns > 0. ? 1.5 * sampleTime_ns / elapsed_ns : 10.;
+        iterations = std::max<uint64_t>(iterations + 1, static_cast<uint64_t>(iterations * std::min(scale, 10.)));
+    }
+
+    std::vector<double> samples;
+    for (int sample = 0; sample < BENCH_SAMPLES; sample++)
+    {
+        const Clock::time_point start = Clock::now();
+        for (uint64_t index = 0; index < iterations; index++) op();
+        samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = sName;
+    result.iterations = iterations;
+    result.itemsPerOp = itemsPerOp;
+    result.nsPerOp = samples[BENCH_SAMPLES / 2];
+    result.nsPerItem = itemsPerOp > 0 ? result.nsPerOp / itemsPerOp : result.nsPerOp;
+    m_vecResults.push_back(result);
+    std::cerr << std::left << std::setw(32) << sName << std::right << std::fixed << std::setprecision(2)
+              << std::setw(14) << result.nsPerItem << " ns/item" << std::setw(16) << result.nsPerOp << " ns/op" << std::endl;
+}
+
+void KernelBench::BenchGetline()
+{
+    // loadSequential() reads the lines in front of the first section header with
+    // getline() and a look at their first character only, so a file of the
+    // commented-out sequence times getline()
+    uint64_t lines(0);
+    std::string sComments;
+    {
+        std::istringstream stream(m_sSequence);
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            sComments += "# " + line + "\n";
+            lines++;
+        }
+    }
+
+    // Without sections the load fails, its error is not of interest
+    ExternalSequence sequence;
+    MessageLog log(0);
+    ScopedMessageSink scopedSink(sequence, &log, ERROR_MSG);
+    std::istringstream stream(sComments);
+    Measure("getline", lines, [&]() {
+        stream.clear();
+        stream.seekg(0);
+        s_dSink = sequence.loadSequential(stream);
+    });
+}
+
+void KernelBench::BenchLoad()
+{
+    // The indexed load reads the text twice, once to find the sections and
+    // once to parse them; the sequential load reads it once in file order
+    uint64_t lines(0);
+    for (const char& c : m_sSequence) lines += (c == '\n');
+
+    Measure("load/indexed", lines, [&]() {
+        std::istringstream stream(m_sSequence);
+        ExternalSequence sequence;
+        sequence.load(stream);
+        s_dSink = sequence.GetNumberOfBlocks();
+    });
+    Measure("load/sequential", lines, [&]() {
+        std::istringstream stream(m_sSequence);
+        ExternalSequence sequence;
+        sequence.loadSequential(stream);
+        s_dSink = sequence.GetNumberOfBlocks();
+    });
+}
+
+void KernelBench::BenchDecompressShape()
+{
+    // decodeBlock() of an RF block decompresses its magnitude and phase shape.
+    // Pointing both at one shape times the decompression of that shape twice,
+    // next to a trapezoid whose decoding is negligible.
+    const std::string sRf("\n[RF]\n1 500 1 2 0 100 0 0\n");
+    const struct { const char* name; const char* rf; } cases[] = {
+        {"decompress_shape/uncompressed", "\n[RF]\n1 500 1 1 0 100 0 0\n"},
+        {"decompress_shape/compressed", "\n[RF]\n1 500 2 2 0 100 0 0\n"},
+    };
+    for (const auto& entry : cases)
+    {
+        std::string sSequence = MakeSequence(1);
+        sSequence.replace(sSequence.find(sRf), sRf.size(), entry.rf);
+        std::istringstream stream(sSequence);
+        ExternalSequence sequence;
+        if (!sequence.load(stream))
+        {
+            std::cerr << "Synthetic sequence of " << entry.name << " failed to load" << std::endl;
+            continue;
+        }
+        std::unique_ptr<SeqBlock> spBlock(sequence.GetBlock(0));
+        if (!sequence.decodeBlock(spBlock.get()))
+        {
+            std::cerr << "Synthetic RF block of " << entry.name << " failed to decode" << std::endl;
+            continue;
+        }
+        Measure(entry.name, 2 * spBlock->GetRFLength(), [&]() {
+            sequence.decodeBlock(spBlock.get());
+            s_dSink = spBlock->GetRFAmplitudePtr()[0];
+        });
+    }
+}
+
+void KernelBench::BenchGetBlock()
+{
+    const int blocks = m_sequence.GetNumberOfBlocks();
+    Measure("get_block", blocks, [&]() {
+        for (int index = 0; index < blocks; index++)
+        {
+            std::unique_ptr<SeqBlock> spBlock(m_sequence.GetBlock(index));
+            s_dSink = spBlock->GetDuration_ru();
+        }
+    });
+}
+
+void KernelBench::BenchDecodeBlock()
+{
+    // Blocks keep their waveforms between calls, decodeBlock() resizes them in place
+    Measure("decode_block", m_vecBlocks.size(), [&]() {
+        for (SeqBlock* pBlock : m_vecBlocks)
+        {
+            m_sequence.decodeBlock(pBlock);
+        }
+        s_dSink = m_vecBlocks.back()->GetDuration_ru();
+    });
+}
+
+void KernelBench::BenchDecodeBlockLogged()
+{
+    // Same as decode_block with every debug message formatted, the cost the
+    // gating in ExternalSequence saves at the default level. The log keeps no
+    // text so only formatting and delivery are timed.
+    MessageLog log(0);
+    ScopedMessageSink scopedSink(m_sequence, &log, DEBUG_LOW_LEVEL);
+    Measure("decode_block/debug_log", m_vecBlocks.size(), [&]() {
+        for (SeqBlock* pBlock : m_vecBlocks)
+        {
+            m_sequence.decodeBlock(pBlock);
+        }
+        s_dSink = m_vecBlocks.back()->GetDuration_ru();
+    });
+}
+
+void KernelBench::BenchRfMagnitudes()
+{
+    // The first block of a repetition carries the RF pulse
+    const std::vector<float> amp(m_vecBlocks[0]->GetRFAmplitudePtr(), m_vecBlocks[0]->GetRFAmplitudePtr() + m_vecBlocks[0]->GetRFLength());
+    const std::vector<float> phase(m_vecBlocks[0]->GetRFPhasePtr(), m_vecBlocks[0]->GetRFPhasePtr() + m_vecBlocks[0]->GetRFLength());
+
+    std::vector<double> magnitudes(amp.size() + 2);
+    Measure("rf_magnitudes", amp.size(), [&]() {
+        EventPolyline::RfMagnitudes(amp.data(), phase.data(), amp.size(), magnitudes.data());
+        s_dSink = magnitudes[amp.size() / 2];
+    });
+}
+
+void KernelBench::BenchTrapezoids()
+{
+    // Corner points as built per trapezoid by PulseqLoader::LoadPulseqEvents()
+    uint64_t traps(0);
+    for (int channel = 0; channel < NUM_GRADS; channel++) traps += m_timeline.trap[channel].size();
+
+    std::vector<double> time(4 * traps);
+    std::vector<double> amplitudes(4 * traps);
+    Measure("trapezoid_polyline", traps, [&]() {
+        size_t offset(0);
+        for (int channel = 0; channel < NUM_GRADS; channel++)
+        {
+            for (const TimelineTrap& trap : m_timeline.trap[channel])
+            {
+                EventPolyline::Trapezoid(trap, trap.event->amplitude * 1e-3, &time[offset], &amplitudes[offset]);
+                offset += 4;
+            }
+        }
+        s_dSink = time.back();
+    });
+}
+
+void KernelBench::BenchRfGraphData()
+{
+    // Time points and scaled magnitudes as built per RF event by MainWindow::DrawWaveform()
+    std::vector<double> magnitudes(BENCH_RF_SAMPLES + 2, 0.5);
+    std::vector<double> time(magnitudes.size());
+    std::vector<double> amplitudes(magnitudes.size());
+    Measure("rf_graph_data", m_timeline.rf.size(), [&]() {
+        for (const TimelineRf& rf : m_timeline.rf)
+        {
+            EventPolyline::RfTimes(rf.startAbsTime_us, rf.dwell_us, rf.samples, time.data());
+            EventPolyline::Scale(magnitudes.data(), rf.samples + 2, rf.block->GetRFEvent().amplitude, amplitudes.data());
+        }
+        s_dSink = time.back() + amplitudes.back();
+    });
+}
+
+void KernelBench::BenchStatistics()
+{
+    // Whole-sequence summary as computed by PulseqLoader once the blocks are decoded
+    const double dBlockRaster_us = m_sequence.GetBlockDurationRaster_us();
+    const double dGradRaster_us = m_sequence.GetGradientRasterTime_us();
+    Measure("sequence_statistics", m_vecBlocks.size(), [&]() {
+        const SequenceStatistics stats = SequenceStatistics::Compute(m_vecBlocks, dBlockRaster_us, dGradRaster_us);
+        s_dSink = stats.rfRms_uT + stats.grad[0].rms_Hz_m;
+    });
+}
+
+void KernelBench::BenchTaskPool()
+{
+    // Cost of handing out and waiting for tasks, what ParallelFor() adds per chunk
+    std::atomic<uint64_t> count(0);
+    Measure("task_pool/dispatch", BENCH_POOL_TASKS, [&]() {
+        TaskGroup group;
+        for (int task = 0; task < BENCH_POOL_TASKS; task++)
+        {
+            group.Run([&count]() { count++; });
+        }
+        group.Wait();
+        s_dSink = static_cast<double>(count.load());
+    });
+}
+
+void KernelBench::Run()
+{
+    BenchGetline();
+    BenchLoad();
+    BenchDecompressShape();
+    BenchGetBlock();
+    BenchDecodeBlock();
+    BenchDecodeBlockLogged();
+    BenchRfMagnitudes();
+    BenchTrapezoids();
+    BenchRfGraphData();
+    BenchStatistics();
+    BenchTaskPool();
+}
+
+bool KernelBench::CheckRepetitions()
+{
+    // Per TR excitation, prephaser, a train of readouts of alternating polarity
+    // and a spoiler. An odd TR count puts the middle block into a readout train.
+    std::ostringstream seq;
+    seq << "# Pulseq sequence file\n[VERSION]\nmajor 1\nminor 4\nrevision 1\n\n"
+        << "[DEFINITIONS]\nAdcRasterTime 1e-07\nBlockDurationRaster 1e-05\n"
+        << "GradientRasterTime 1e-05\nRadiofrequencyRasterTime 1e-06\n\n"
+        << "[BLOCKS]\n";
+    int blockID = 1;
+    for (int tr = 0; tr < BENCH_EPI_TRS; tr++)
+    {
+        seq << blockID++ << " 120 1 0 0 1 0 0\n";
+        seq << blockID++ << " 60 0 4 0 0 0 0\n";
+        for (int readout = 0; readout < BENCH_EPI_READOUTS; readout++)
+        {
+            seq << blockID++ << " 60 0 " << (readout % 2 == 0 ? 2 : 3) << " 0 0 1 0\n";
+        }
+        seq << blockID++ << " 60 0 0 0 5 0 0\n";
+    }
+    seq << "\n[RF]\n1 500 1 2 0 100 0 0\n\n"
+        << "[TRAP]\n1 2e5 100 1000 100 0\n2 4e5 50 500 50 0\n3 -4e5 50 500 50 0\n4 -2e5 100 200 100 0\n5 3e5 200 200 200 0\n\n"
+        << "[ADC]\n1 64 7000 50 0 0\n\n"
+        << "[SHAPES]\n\nshape_id 1\nnum_samples 100\n1\n1\n98\n"
+        << "\nshape_id 2\nnum_samples 100\n0\n0\n98\n\n";
+    std::istringstream stream(seq.str());
+    ExternalSequence epi;
+    if (!epi.load(stream))
+    {
+        std::cerr << "repetitions: sequence failed to load" << std::endl;
+        return false;
+    }
+
+    const BlockHasher hasher(epi.GetShapeLibrary());
+    std::vector<uint64_t> vecSignatures;
+    for (int index = 0; index < epi.GetNumberOfBlocks(); index++)
+    {
+        std::unique_ptr<SeqBlock> spBlock(epi.GetBlock(index));
+        if (!epi.decodeBlock(spBlock.get()))
+        {
+            std::cerr << "repetitions: block " << index << " failed to decode" << std::endl;
+            return false;
+        }
+        vecSignatures.push_back(hasher.Signature(spBlock.get()));
+    }
+    const RepetitionInfo info = RepetitionDetector::Detect(vecSignatures);
+    const size_t period = BENCH_EPI_READOUTS + 3;
+    const bool bPassed = info.periodBlocks == period && info.repetitions + 1 >= BENCH_EPI_TRS;
+    std::cerr << "repetitions: " << info.repetitions << " of " << info.periodBlocks << " blocks, expected "
+              << BENCH_EPI_TRS << " of " << period << (bPassed ? "" : "  FAILED") << std::endl;
+    return bPassed;
+}
+
+bool KernelBench::CheckSplitGradient()
+{
+    // A ramp up at 23.5 T/m/s split over two arbitrary gradient blocks and a ramp down
+    // at twice that in a third, then after an empty block a gradient jumping from 0 to
+    // half its amplitude. Only the jump may be reported.
+    std::ostringstream seq;
+    seq << "# Pulseq sequence file\n[VERSION]\nmajor 1\nminor 4\nrevision 1\n\n"
+        << "[DEFINITIONS]\nAdcRasterTime 1e-07\nBlockDurationRaster 1e-05\n"
+        << "GradientRasterTime 1e-05\nRadiofrequencyRasterTime 1e-06\n\n"
+        << "[BLOCKS]\n";
+    const int shapes[] = {1, 2, 3, 0, 4};
+    for (int index = 0; index < 5; index++)
+    {
+        seq << index + 1 << " " << BENCH_RAMP_SAMPLES << " 0 " << shapes[index] << " 0 0 0 0\n";
+    }
+    seq << "\n[GRADIENTS]\n1 1e6 1 0 0\n2 1e6 2 0 0\n3 1e6 3 0 0\n4 1e6 4 0 0\n\n[SHAPES]\n";
+    for (int shape = 1; shape <= 4; shape++)
+    {
+        seq << "\nshape_id " << shape << "\nnum_samples " << BENCH_RAMP_SAMPLES << "\n";
+        for (int index = 0; index < BENCH_RAMP_SAMPLES; index++)
+        {
+            const double rampUp = (index + 0.5) / (2 * BENCH_RAMP_SAMPLES);
+            const double rampDown = (BENCH_RAMP_SAMPLES - index - 0.5) / BENCH_RAMP_SAMPLES;
+            seq << (shape == 1 ? rampUp : shape == 2 ? 0.5 + rampUp : shape == 3 ? rampDown : 0.5) << "\n";
+        }
+    }
+    std::istringstream stream(seq.str());
+    ExternalSequence ramp;
+    if (!ramp.load(stream))
+    {
+        std::cerr << "split gradient: sequence failed to load" << std::endl;
+        return false;
+    }
+
+    std::vector<std::unique_ptr<SeqBlock>> vecOwned;
+    std::vector<SeqBlock*> vecBlocks;
+    std::vector<double> vecStart_us;
+    double dStart_us(0.);
+    for (int index = 0; index < ramp.GetNumberOfBlocks(); index++)
+    {
+        vecOwned.emplace_back(ramp.GetBlock(index));
+        if (!ramp.decodeBlock(vecOwned.back().get()))
+        {
+            std::cerr << "split gradient: block " << index << " failed to decode" << std::endl;
+            return false;
+        }
+        vecBlocks.push_back(vecOwned.back().get());
+        vecStart_us.push_back(dStart_us);
+        dStart_us += vecBlocks.back()->GetDuration();
+    }
+    const std::vector<LimitViolation> violations = SequenceChecker(SystemLimits()).Check(vecBlocks, vecStart_us);
+    const bool bPassed = violations.size() == 1 && violations[0].type == kGradSlewRate && violations[0].blockIndex == 4;
+    std::cerr << "split gradient: " << violations.size() << " violations";
+    for (const LimitViolation& violation : violations)
+    {
+        std::cerr << ", " << SequenceChecker::Describe(violation);
+    }
+    std::cerr << (bPassed ? "" : "  FAILED") << std::endl;
+    return bPassed;
+}
+
+bool KernelBench::RunStress(const uint64_t& events)
+{
+    typedef std::chrono::steady_clock Clock;
+    bool bPassed = CheckRepetitions();
+    bPassed = CheckSplitGradient() && bPassed;
+
+    // A 100 ms pulse at 1 us dwell, magnitude and phase compressed
+    std::ostringstream seq;
+    seq << "# Pulseq sequence file\n[VERSION]\nmajor 1\nminor 4\nrevision 1\n\n"
+        << "[DEFINITIONS]\nAdcRasterTime 1e-07\nBlockDurationRaster 1e-05\n"
+        << "GradientRasterTime 1e-05\nRadiofrequencyRasterTime 1e-06\n\n"
+        << "[BLOCKS]\n1 " << BENCH_LONG_RF_SAMPLES / 10 + 10 << " 1 0 0 0 0 0\n\n"
+        << "[RF]\n1 100 1 2 0 0 0 0\n\n"
+        << "[SHAPES]\n\nshape_id 1\nnum_samples " << BENCH_LONG_RF_SAMPLES << "\n1\n1\n" << BENCH_LONG_RF_SAMPLES - 2 << "\n"
+        << "\nshape_id 2\nnum_samples " << BENCH_LONG_RF_SAMPLES << "\n0\n0\n" << BENCH_LONG_RF_SAMPLES - 2 << "\n\n";
+    std::istringstream stream(seq.str());
+    ExternalSequence longRf;
+    std::unique_ptr<SeqBlock> spBlock;
+    if (longRf.load(stream) && longRf.GetNumberOfBlocks() == 1)
+    {
+        spBlock.reset(longRf.GetBlock(0));
+    }
+    if (nullptr == spBlock || !longRf.decodeBlock(spBlock.get()))
+    {
+        std::cerr << "long_rf: sequence failed to load" << std::endl;
+        return false;
+    }
+    SequenceTimeline rfTimeline;
+    rfTimeline.Append(spBlock.get(), longRf.GetBlockDurationRaster_us());
+    const bool bRfPassed = rfTimeline.rf.size() == 1 && rfTimeline.rf[0].samples == BENCH_LONG_RF_SAMPLES
+                        && rfTimeline.rf[0].duration_us == BENCH_LONG_RF_SAMPLES * rfTimeline.rf[0].dwell_us;
+    std::cerr << "long_rf: " << (rfTimeline.rf.empty() ? 0 : rfTimeline.rf[0].samples) << " samples"
+              << (bRfPassed ? "" : "  FAILED") << std::endl;
+    bPassed &= bRfPassed;
+
+    // Events are only counted, the timeline keeps no per-event data
+    const double dRaster_us = m_sequence.GetBlockDurationRaster_us();
+    SequenceTimeline timeline(false);
+    int64_t expected_ru(0);
+    double summed_us(0.);
+    uint64_t blocks(0);
+    uint64_t timelineEvents(0);
+    const Clock::time_point start = Clock::now();
+    while (timelineEvents < events)
+    {
+        for (SeqBlock* pBlock : m_vecBlocks)
+        {
+            timeline.Append(pBlock, dRaster_us);
+            expected_ru += pBlock->GetDuration_ru();
+            summed_us += pBlock->GetDuration_ru() * dRaster_us;
+        }
+        blocks += m_vecBlocks.size();
+        timelineEvents = timeline.rfCount + timeline.adcCount;
+        for (int channel = 0; channel < NUM_GRADS; channel++) timelineEvents += timeline.gradCount[channel];
+    }
+    const double elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+    const double expected_us = static_cast<double>(expected_ru) * dRaster_us;
+    const bool bTimePassed = timeline.totalDuration_ru == expected_ru && timeline.totalDuration_us == expected_us;
+    std::cerr << std::fixed << std::setprecision(3)
+              << "timeline: " << timelineEvents << " events in " << blocks << " blocks, "
+              << elapsed_ns / blocks << " ns/block\n"
+              << "  end " << timeline.totalDuration_us << " us, raster sum " << expected_us << " us"
+              << (bTimePassed ? "" : "  FAILED") << "\n"
+              << "  summing durations in us would be off by " << (summed_us - expected_us) * 1e3 << " ns" << std::endl;
+    return bPassed && bTimePassed;
+}
+
+void KernelBench::WriteJson(std::ostream& out, const std::vector<BenchResult>& results)
+{
+    out << "{\n  \"benchmarks\": [\n" << std::fixed << std::setprecision(3);
+    for (size_t index = 0; index < results.size(); index++)
+    {
+        const BenchResult& result = results[index];
+        out << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+            << ", \"items_per_op\": " << result.itemsPerOp << ", \"ns_per_op\": " << result.nsPerOp
+            << ", \"ns_per_item\": " << result.nsPerItem << "}" << (index + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+bool KernelBench::ReadBaseline(const std::string& sPath, std::map<std::string, double>& baseline)
+{
+    // Reads back what WriteJson() writes, one benchmark object per line
+    std::ifstream file(sPath);
+    if (!file.good()) return false;
+    const std::string sNameKey = "\"name\": \"";
+    const std::string sValueKey = "\"ns_per_item\": ";
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const size_t namePos = line.find(sNameKey);
+        const size_t valuePos = line.find(sValueKey);
+        if (namePos == std::string::npos || valuePos == std::string::npos) continue;
+        const size_t nameStart = namePos + sNameKey.size();
+        const size_t nameEnd = line.find('"', nameStart);
+        if (nameEnd == std::string::npos) continue;
+        baseline[line.substr(nameStart, nameEnd - nameStart)] = std::atof(line.c_str() + valuePos + sValueKey.size());
+    }
+    return true;
+}
+
+static void PrintUsage(const char* pProgram)
+{
+    std::cerr << "Usage: " << pProgram << " [--out FILE] [--baseline FILE] [--threshold PCT] [--filter TEXT]\n"
+              << "       [--min-time MS] [--repetitions N] [--stress EVENTS]\n"
+              << "Times the parser and render-prep kernels on a synthetic sequence.\n"
+              << "  --out FILE        JSON results, - for stdout\n"
+              << "  --baseline FILE   JSON results of an earlier run to compare against\n"
+              << "  --threshold PCT   slowdown per item that counts as a regression, default " << BENCH_DEFAULT_THRESHOLD_PCT << "\n"
+              << "  --filter TEXT     only benchmarks whose name contains TEXT\n"
+              << "  --min-time MS     measuring time per benchmark, default " << BENCH_DEFAULT_MIN_TIME_MS << "\n"
+              << "  --repetitions N   repetitions of the 4 block pattern, default " << BENCH_DEFAULT_REPETITIONS << "\n"
+              << "  --stress EVENTS   instead of timing kernels, build a timeline of at least EVENTS\n"
+              << "                    events and check it ends exactly on the block raster,\n"
+              << "                    also checks the period found in an EPI-like sequence\n"
+              << "                    and the slew rate of a gradient split over blocks\n"
+              << "Exits with 1 if any benchmark regressed against the baseline or the stress check\n"
+              << "failed, 2 on usage errors.\n";
+}
+
+int main(int argc, char* argv[])
+{
+    std::string sOutPath;
+    std::string sBaselinePath;
+    std::string sFilter;
+    double threshold(BENCH_DEFAULT_THRESHOLD_PCT);
+    double minTime_ms(BENCH_DEFAULT_MIN_TIME_MS);
+    int repetitions(BENCH_DEFAULT_REPETITIONS);
+    uint64_t stressEvents(0);
+    for (int index = 1; index < argc; index++)
+    {
+        const std::string sArg = argv[index];
+        const bool bHasValue = index + 1 < argc;
+        if (sArg == "--help" || sArg == "-h")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        else if (sArg == "--out" && bHasValue)
+        {
+            sOutPath = argv[++index];
+        }
+        else if (sArg == "--baseline" && bHasValue)
+        {
+            sBaselinePath = argv[++index];
+        }
+        else if (sArg == "--threshold" && bHasValue)
+        {
+            threshold = std::atof(argv[++index]);
+        }
+        else if (sArg == "--filter" && bHasValue)
+        {
+            sFilter = argv[++index];
+        }
+        else if (sArg == "--min-time" && bHasValue)
+        {
+            minTime_ms = std::atof(argv[++index]);
+        }
+        else if (sArg == "--repetitions" && bHasValue)
+        {
+            repetitions = std::atoi(argv[++index]);
+        }
+        else if (sArg == "--stress" && bHasValue)
+        {
+            stressEvents = std::strtoull(argv[++index], nullptr, 10);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (repetitions < 1 || minTime_ms <= 0. || threshold < 0.)
+    {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!sBaselinePath.empty() && !KernelBench::ReadBaseline(sBaselinePath, baseline))
+    {
+        std::cerr << "Cannot read " << sBaselinePath << std::endl;
+        return 2;
+    }
+
+    KernelBench bench(repetitions, minTime_ms, sFilter);
+    if (!bench.Prepare()) return 2;
+    if (stressEvents > 0)
+    {
+        return bench.RunStress(stressEvents) ? 0 : 1;
+    }
+    bench.Run();
+
+    if (!sOutPath.empty())
+    {
+        if (sOutPath == "-")
+        {
+            KernelBench::WriteJson(std::cout, bench.Results());
+        }
+        else
+        {
+            std::ofstream file(sOutPath, std::ios::out | std::ios::binary);
+            KernelBench::WriteJson(file, bench.Results());
+            if (!file.good())
+            {
+                std::cerr << "Cannot write " << sOutPath << std::endl;
+                return 2;
+            }
+        }
+    }
+
+    if (sBaselinePath.empty()) return 0;
+
+    bool bRegressed(false);
+    std::cerr << "\nAgainst " << sBaselinePath << " (threshold " << std::setprecision(1) << threshold << "%)\n";
+    for (const BenchResult& result : bench.Results())
+    {
+        auto it = baseline.find(result.name);
+        if (it == baseline.end() || it->second <= 0.)
+        {
+            std::cerr << std::left << std::setw(32) << result.name << " no baseline" << std::endl;
+            continue;
+        }
+        const double change = 100. * (result.nsPerItem - it->second) / it->second;
+        const bool bSlower = change > threshold;
+        bRegressed |= bSlower;
+        std::cerr << std::left << std::setw(32) << result.name << std::right << std::showpos << std::setprecision(1)
+                  << std::setw(10) << change << "%" << std::noshowpos << (bSlower ? "  REGRESSION" : "") << std::endl;
+    }
+    return bRegressed ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+#include "sequence_validator.h"
+#include "task_pool.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static void PrintUsage(const char* pProgram)
+{
+    std::cerr << "Usage: " << pProgram << " [--jobs N] [--csv FILE] [--json FILE] PATH...\n"
+              << "Loads every .seq and .seq.gz file below the given files or directories and writes a report.\n"
+              << "A PATH of - reads one sequence, plain or gzip compressed, from standard input.\n"
+              << "  --jobs N     worker threads, each validates one file at a time, all cores by default\n"
+              << "  --csv FILE   CSV report, - for stdout (default when no report is given)\n"
+              << "  --json FILE  JSON report, - for stdout\n"
+              << "Exits with 1 if any file fails to load, 2 on usage errors.\n";
+}
+
+static bool WriteReport(const std::string& sPath, const std::vector<ValidationResult>& results, const bool& bJson)
+{
+    if (sPath == "-")
+    {
+        bJson ? SequenceValidator::WriteJson(std::cout, results) : SequenceValidator::WriteCsv(std::cout, results);
+        return std::cout.good();
+    }
+    std::ofstream file(sPath, std::ios::out | std::ios::binary);
+    if (!file.good())
+    {
+        std::cerr << "Cannot write " << sPath << std::endl;
+        return false;
+    }
+    bJson ? SequenceValidator::WriteJson(file, results) : SequenceValidator::WriteCsv(file, results);
+    return file.good();
+}
+
+int main(int argc, char* argv[])
+{
+    int jobs(0);
+    std::string sCsvPath;
+    std::string sJsonPath;
+    std::vector<std::string> vecPaths;
+    for (int index = 1; index < argc; index++)
+    {
+        const std::string sArg = argv[index];
+        const bool bHasValue = index + 1 < argc;
+        if (sArg == "--help" || sArg == "-h")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        else if (sArg == "--jobs" && bHasValue)
+        {
+            jobs = std::atoi(argv[++index]);
+        }
+        else if (sArg == "--csv" && bHasValue)
+        {
+            sCsvPath = argv[++index];
+        }
+        else if (sArg == "--json" && bHasValue)
+        {
+            sJsonPath = argv[++index];
+        }
+        else if (sArg.compare(0, 2, "--") == 0)
+        {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+        else
+        {
+            vecPaths.push_back(sArg);
+        }
+    }
+    if (vecPaths.empty())
+    {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+    if (sCsvPath.empty() && sJsonPath.empty()) sCsvPath = "-";
+
+    if (jobs > 0) TaskPool::Configure(static_cast<size_t>(jobs));
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<std::string> vecFiles = SequenceValidator::CollectFiles(vecPaths);
+    const std::vector<ValidationResult> results = SequenceValidator::ValidateAll(vecFiles, jobs);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool bWritten = true;
+    if (!sCsvPath.empty()) bWritten &= WriteReport(sCsvPath, results, false);
+    if (!sJsonPath.empty()) bWritten &= WriteReport(sJsonPath, results, true);
+
+    size_t failed(0);
+    for (const ValidationResult& result : results)
+    {
+        if (!result.loaded)
+        {
+            failed++;
+            std::cerr << "FAILED " << result.path << ": " << result.error << std::endl;
+        }
+    }
+    std::cerr << results.size() << " files validated in " << seconds << " s, " << failed << " failed" << std::endl;
+    if (!bWritten) return 2;
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+#include "bloch_simulator.h"
+#include "parallel_for.h"
+#include "waveform_exporter.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const float kHalfPi = 1.57079632679490f;
+
+// Branch-free sine and cosine for the rotation angle of one step. The libm
+// calls would keep the lanes from being vectorized. The angle is reduced by
+// quarter turns, the quadrant picks and signs the Taylor terms arithmetically
+// so no select is left, accurate to about 1e-6.
+static inline void SinCos(const float& x, float& s, float& c)
+{
+    const float q = x * (1.f / kHalfPi);
+    const int quadrant = static_cast<int>(q + std::copysign(0.5f, q));
+    const float r = x - quadrant * kHalfPi;
+    const float r2 = r * r;
+    const float sr = r * (1.f + r2 * (-1.f / 6.f + r2 * (1.f / 120.f + r2 * (-1.f / 5040.f))));
+    const float cr = 1.f + r2 * (-0.5f + r2 * (1.f / 24.f + r2 * (-1.f / 720.f + r2 * (1.f / 40320.f))));
+    const float swap = static_cast<float>(quadrant & 1);
+    s = static_cast<float>(1 - (quadrant & 2)) * (sr + swap * (cr - sr));
+    c = static_cast<float>(1 - ((quadrant + 1) & 2)) * (cr + swap * (sr - cr));
+}
+
+bool BlochSimulator::SamplePulse(SeqBlock* pBlock, const double& gradRasterTime_us, BlochPulse& pulse)
+{
+    if (nullptr == pBlock || !pBlock->isRF() || pBlock->GetRFLength() <= 0) return false;
+
+    const RFEvent& rf = pBlock->GetRFEvent();
+    const int length = pBlock->GetRFLength();
+    pulse.dwell_us = pBlock->GetRFDwellTime();
+    pulse.freqOffset_Hz = rf.freqOffset;
+
+    // A single block timeline is enough, the sampler only needs the block to
+    // cover the pulse
+    const std::vector<SeqBlock*> blocks{pBlock};
+    const std::vector<double> vecBlockStart_us{0., rf.delay + length * pulse.dwell_us + gradRasterTime_us};
+    const WaveformExporter sampler(blocks, vecBlockStart_us, gradRasterTime_us);
+    std::vector<float> vecSamples(static_cast<size_t>(length) * EXPORT_CHANNEL_NUM);
+    sampler.Sample(rf.delay + 0.5 * pulse.dwell_us, pulse.dwell_us, length, vecSamples.data());
+
+    pulse.b1x_Hz.resize(length);
+    pulse.b1y_Hz.resize(length);
+    pulse.gz_Hz_m.resize(length);
+    for (int index = 0; index < length; index++)
+    {
+        const float* pSample = &vecSamples[static_cast<size_t>(index) * EXPORT_CHANNEL_NUM];
+        pulse.b1x_Hz[index] = pSample[kExportRfMagnitude] * std::cos(pSample[kExportRfPhase]);
+        pulse.b1y_Hz[index] = pSample[kExportRfMagnitude] * std::sin(pSample[kExportRfPhase]);
+        pulse.gz_Hz_m[index] = pSample[kExportGz];
+    }
+    return true;
+}
+
+void BlochSimulator::Simulate(const BlochPulse& pulse, const std::vector<double>& vecPosition_m,
+                              const std::vector<double>& vecOffResonance_Hz, BlochProfile& profile)
+{
+    const size_t isochromats = std::min(vecPosition_m.size(), vecOffResonance_Hz.size());
+    profile.mx.assign(isochromats, 0.f);
+    profile.my.assign(isochromats, 0.f);
+    profile.mz.assign(isochromats, 1.f);
+    const size_t steps = std::min(pulse.b1x_Hz.size(), std::min(pulse.b1y_Hz.size(), pulse.gz_Hz_m.size()));
+    if (isochromats == 0 || steps == 0) return;
+
+    // Rotation rates in rad per dwell step
+    const double stepScale = 2. * M_PI * pulse.dwell_us * 1e-6;
+    std::vector<float> vecB1x(steps), vecB1y(steps), vecGz(steps);
+    for (size_t step = 0; step < steps; step++)
+    {
+        vecB1x[step] = static_cast<float>(pulse.b1x_Hz[step] * stepScale);
+        vecB1y[step] = static_cast<float>(pulse.b1y_Hz[step] * stepScale);
+        vecGz[step] = pulse.gz_Hz_m[step];
+    }
+
+    const size_t batches = (isochromats + BLOCH_LANES - 1) / BLOCH_LANES;
+    ParallelFor(0, batches, BLOCH_MIN_CHUNK / BLOCH_LANES, [&](size_t, size_t begin, size_t end) {
+        for (size_t batch = begin; batch < end; batch++)
+        {
+            const size_t first = batch * BLOCH_LANES;
+            const size_t lanes = std::min<size_t>(BLOCH_LANES, isochromats - first);
+
+            // Padding lanes see no field and stay at rest
+            float mx[BLOCH_LANES], my[BLOCH_LANES], mz[BLOCH_LANES];
+            float offset[BLOCH_LANES], position[BLOCH_LANES];
+            for (size_t lane = 0; lane < BLOCH_LANES; lane++)
+            {
+                const bool bUsed = lane < lanes;
+                mx[lane] = 0.f;
+                my[lane] = 0.f;
+                mz[lane] = 1.f;
+                offset[lane] = bUsed ? static_cast<float>((vecOffResonance_Hz[first + lane] - pulse.freqOffset_Hz) * stepScale) : 0.f;
+                position[lane] = bUsed ? static_cast<float>(vecPosition_m[first + lane] * stepScale) : 0.f;
+            }
+
+            for (size_t step = 0; step < steps; step++)
+            {
+                const float bx = vecB1x[step];
+                const float by = vecB1y[step];
+                const float g = vecGz[step];
+                for (size_t lane = 0; lane < BLOCH_LANES; lane++)
+                {
+                    // Left-handed rotation by |B| about n = B / |B|:
+                    // M' = M c - (n x M) s + n (n . M)(1 - c)
+                    const float bz = offset[lane] + position[lane] * g;
+                    const float phi = std::sqrt(bx * bx + by * by + bz * bz);
+                    // Without any field n is 0 and so is the rotation
+                    const float inv = 1.f / (phi + 1e-30f);
+                    const float nx = bx * inv;
+                    const float ny = by * inv;
+                    const float nz = bz * inv;
+                    float s, c;
+                    SinCos(phi, s, c);
+                    const float x = mx[lane];
+                    const float y = my[lane];
+                    const float z = mz[lane];
+                    const float dot = (nx * x + ny * y + nz * z) * (1.f - c);
+                    mx[lane] = x * c - (ny * z - nz * y) * s + nx * dot;
+                    my[lane] = y * c - (nz * x - nx * z) * s + ny * dot;
+                    mz[lane] = z * c - (nx * y - ny * x) * s + nz * dot;
+                }
+            }
+
+            for (size_t lane = 0; lane < lanes; lane++)
+            {
+                profile.mx[first + lane] = mx[lane];
+                profile.my[first + lane] = my[lane];
+                profile.mz[first + lane] = mz[lane];
+            }
+        }
+    });
+}
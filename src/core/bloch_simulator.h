@@ -0,0 +1,53 @@
+#ifndef BLOCH_SIMULATOR_H
+#define BLOCH_SIMULATOR_H
+
+#include <cstddef>
+#include <vector>
+#include <ExternalSequence.h>
+
+#define BLOCH_LANES                  (8)         // isochromats rotated together
+#define BLOCH_MIN_CHUNK              (256)       // isochromats per thread at least
+
+// RF and slice gradient of one pulse, piecewise constant on the RF dwell time.
+// B1 is given in Hz and already includes amplitude, shape and phase offset.
+struct BlochPulse
+{
+    double dwell_us;
+    double freqOffset_Hz;
+    std::vector<float> b1x_Hz;
+    std::vector<float> b1y_Hz;
+    std::vector<float> gz_Hz_m;
+
+    BlochPulse()
+        : dwell_us(0.)
+        , freqOffset_Hz(0.)
+    {}
+};
+
+// Magnetization per isochromat at the end of the pulse, starting from M = (0, 0, 1)
+struct BlochProfile
+{
+    std::vector<float> mx;
+    std::vector<float> my;
+    std::vector<float> mz;
+};
+
+// Hard-pulse Bloch simulation without relaxation, which is negligible over
+// the few milliseconds of a pulse. Each dwell step rotates the magnetization
+// about the effective field of RF, gradient and off-resonance. The isochromats
+// are kept as separate x/y/z arrays and rotated BLOCH_LANES at a time with
+// branch-free arithmetic, so the compiler can vectorize the lanes, and
+// batches of isochromats run on separate threads.
+class BlochSimulator
+{
+public:
+    // RF of a decoded block with the GZ event of the same block sampled at the
+    // RF sample centers; false if the block has no RF
+    static bool SamplePulse(SeqBlock* pBlock, const double& gradRasterTime_us, BlochPulse& pulse);
+
+    // One isochromat per entry, position along GZ in m plus an off-resonance in Hz
+    static void Simulate(const BlochPulse& pulse, const std::vector<double>& vecPosition_m,
+                         const std::vector<double>& vecOffResonance_Hz, BlochProfile& profile);
+};
+
+#endif // BLOCH_SIMULATOR_H
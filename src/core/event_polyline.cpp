@@ -0,0 +1,47 @@
+#include "event_polyline.h"
+
+#include <complex>
+
+void EventPolyline::RfMagnitudes(const float* pAmp, const float* pPhase, const size_t& count, double* pOut)
+{
+    pOut[0] = 0.;
+    for (size_t index = 0; index < count; index++)
+    {
+        pOut[index + 1] = std::abs(std::polar(pAmp[index], pPhase[index]));
+    }
+    pOut[count + 1] = 0.;
+}
+
+void EventPolyline::RfTimes(const double& dStart_us, const float& fDwell_us, const size_t& count, double* pTime)
+{
+    // Accumulated like the sample clock, so times match the graphs drawn before
+    double sampleTime = dStart_us;
+    pTime[0] = sampleTime;
+    for (size_t index = 1; index <= count; index++)
+    {
+        pTime[index] = sampleTime;
+        sampleTime += fDwell_us;
+    }
+    pTime[count + 1] = sampleTime;
+}
+
+void EventPolyline::Scale(const double* pIn, const size_t& count, const double& factor, double* pOut)
+{
+    for (size_t index = 0; index < count; index++)
+    {
+        pOut[index] = pIn[index] * factor;
+    }
+}
+
+void EventPolyline::Trapezoid(const TimelineTrap& trap, const double& amplitude, double* pTime, double* pValue)
+{
+    const double& start = trap.startAbsTime_us;
+    pTime[0] = start;
+    pTime[1] = start + trap.rampUpTime_us;
+    pTime[2] = start + trap.rampUpTime_us + trap.flatTime_us;
+    pTime[3] = start + trap.rampUpTime_us + trap.flatTime_us + trap.rampDownTime_us;
+    pValue[0] = 0.;
+    pValue[1] = amplitude;
+    pValue[2] = amplitude;
+    pValue[3] = 0.;
+}
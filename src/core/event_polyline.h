@@ -0,0 +1,22 @@
+#ifndef EVENT_POLYLINE_H
+#define EVENT_POLYLINE_H
+
+#include <cstddef>
+#include "sequence_timeline.h"
+
+// Per-event point lists of the viewer graphs: RF magnitudes framed by zero
+// samples, their sample times, and the four corners of a trapezoid. Output
+// arrays are preallocated by the caller.
+class EventPolyline
+{
+public:
+    // count + 2 values: 0, |amp * e^(i phase)| ..., 0
+    static void RfMagnitudes(const float* pAmp, const float* pPhase, const size_t& count, double* pOut);
+    // count + 2 times matching RfMagnitudes(), the first two at the event start
+    static void RfTimes(const double& dStart_us, const float& fDwell_us, const size_t& count, double* pTime);
+    static void Scale(const double* pIn, const size_t& count, const double& factor, double* pOut);
+    // 4 points, amplitude in display units
+    static void Trapezoid(const TimelineTrap& trap, const double& amplitude, double* pTime, double* pValue);
+};
+
+#endif // EVENT_POLYLINE_H
@@ -0,0 +1,585 @@
+#include "event_query.h"
+#include "mr_constants.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+struct QueryField
+{
+    const char* name;
+    EventKind kind;
+    const char* unit;
+};
+
+static const QueryField kFields[] = {
+    {"block.index", kEventBlock, ""},
+    {"block.duration", kEventBlock, "us"},
+    {"rf.amplitude", kEventRf, "Hz"},
+    {"rf.freqOffset", kEventRf, "Hz"},
+    {"rf.phaseOffset", kEventRf, "rad"},
+    {"rf.delay", kEventRf, "us"},
+    {"rf.duration", kEventRf, "us"},
+    {"rf.samples", kEventRf, ""},
+    {"gx.amplitude", kEventGx, "Hz/m"},
+    {"gx.peak", kEventGx, "Hz/m"},
+    {"gx.area", kEventGx, "1/m"},
+    {"gx.delay", kEventGx, "us"},
+    {"gx.duration", kEventGx, "us"},
+    {"gy.amplitude", kEventGy, "Hz/m"},
+    {"gy.peak", kEventGy, "Hz/m"},
+    {"gy.area", kEventGy, "1/m"},
+    {"gy.delay", kEventGy, "us"},
+    {"gy.duration", kEventGy, "us"},
+    {"gz.amplitude", kEventGz, "Hz/m"},
+    {"gz.peak", kEventGz, "Hz/m"},
+    {"gz.area", kEventGz, "1/m"},
+    {"gz.delay", kEventGz, "us"},
+    {"gz.duration", kEventGz, "us"},
+    {"adc.samples", kEventAdc, ""},
+    {"adc.dwell", kEventAdc, "us"},
+    {"adc.delay", kEventAdc, "us"},
+    {"adc.duration", kEventAdc, "us"},
+    {"adc.freqOffset", kEventAdc, "Hz"},
+    {"adc.phaseOffset", kEventAdc, "rad"},
+};
+static const int kFieldNum = sizeof(kFields) / sizeof(kFields[0]);
+
+static const char* kKindNames[EVENT_KIND_NUM] = {"block", "rf", "gx", "gy", "gz", "adc"};
+
+// Units accepted after a value, converted to the unit of the field
+struct QueryUnit
+{
+    const char* name;
+    const char* base;
+    double scale;
+};
+
+static const QueryUnit kUnits[] = {
+    {"Hz", "Hz", 1.},
+    {"kHz", "Hz", 1e3},
+    {"MHz", "Hz", 1e6},
+    {"Hz/m", "Hz/m", 1.},
+    {"kHz/m", "Hz/m", 1e3},
+    {"mT/m", "Hz/m", GAMMA_HZ_T * 1e-3},
+    {"1/m", "1/m", 1.},
+    {"ns", "us", 1e-3},
+    {"us", "us", 1.},
+    {"ms", "us", 1e3},
+    {"s", "us", 1e6},
+    {"rad", "rad", 1.},
+    {"deg", "rad", M_PI / 180.},
+};
+
+static std::string ToLower(const std::string& sText)
+{
+    std::string sLower(sText);
+    std::transform(sLower.begin(), sLower.end(), sLower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return sLower;
+}
+
+// Equality allows for the float precision of the sequence file
+static inline double Tolerance(const double& value)
+{
+    return 1e-6 * std::max(1., std::fabs(value));
+}
+
+static inline bool Matches(const QueryOperator& op, const double& x, const double& value)
+{
+    switch (op)
+    {
+    case kQueryEqual: return std::fabs(x - value) <= Tolerance(value);
+    case kQueryNotEqual: return std::fabs(x - value) > Tolerance(value);
+    case kQueryLess: return x < value;
+    case kQueryLessEqual: return x <= value;
+    case kQueryGreater: return x > value;
+    case kQueryGreaterEqual: return x >= value;
+    default: return true;
+    }
+}
+
+// Peak magnitude and area (sum times step) of a normalized shape
+static void ShapeStats(const float* pShape, const size_t& count, double& peak, double& sum)
+{
+    peak = 0.;
+    sum = 0.;
+    if (nullptr == pShape) return;
+    for (size_t index = 0; index < count; index++)
+    {
+        peak = std::max(peak, static_cast<double>(std::fabs(pShape[index])));
+        sum += pShape[index];
+    }
+}
+
+std::shared_ptr<EventTable> EventTable::Build(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us,
+                                              const double& gradRasterTime_us)
+{
+    static const EventKind gradKinds[NUM_GRADS] = {kEventGx, kEventGy, kEventGz};
+
+    std::shared_ptr<EventTable> spTable = std::make_shared<EventTable>();
+    spTable->m_vecColumns.resize(kFieldNum);
+    spTable->m_vecSortedRows.resize(kFieldNum);
+    spTable->m_pIndexOnce.reset(new std::once_flag[kFieldNum]);
+
+    // Columns are filled field by field in the order of kFields
+    int firstField[EVENT_KIND_NUM];
+    for (int field = kFieldNum - 1; field >= 0; field--)
+    {
+        firstField[kFields[field].kind] = field;
+    }
+    auto append = [&spTable, &firstField](const EventKind& kind, const uint32_t& block, std::initializer_list<double> values) {
+        spTable->m_vecRowBlock[kind].push_back(block);
+        int field = firstField[kind];
+        for (const double& value : values)
+        {
+            spTable->m_vecColumns[field++].push_back(value);
+        }
+    };
+
+    // Rows per kind first, so the columns are allocated once
+    const size_t blockNum = std::min(blocks.size(), vecBlockStart_us.empty() ? 0 : vecBlockStart_us.size() - 1);
+    size_t rows[EVENT_KIND_NUM] = {blockNum, 0, 0, 0, 0, 0};
+    for (size_t index = 0; index < blockNum; index++)
+    {
+        SeqBlock* pBlock = blocks[index];
+        if (pBlock->isRF()) rows[kEventRf]++;
+        if (pBlock->isADC()) rows[kEventAdc]++;
+        for (int channel = 0; channel < NUM_GRADS; channel++)
+        {
+            if (pBlock->isTrapGradient(channel) || pBlock->isArbitraryGradient(channel) || pBlock->isExtTrapGradient(channel)) rows[gradKinds[channel]]++;
+        }
+    }
+    for (int kind = 0; kind < EVENT_KIND_NUM; kind++)
+    {
+        spTable->m_vecRowBlock[kind].reserve(rows[kind]);
+    }
+    for (int field = 0; field < kFieldNum; field++)
+    {
+        spTable->m_vecColumns[field].reserve(rows[kFields[field].kind]);
+    }
+
+    for (size_t index = 0; index < blockNum; index++)
+    {
+        SeqBlock* pBlock = blocks[index];
+        const uint32_t block = static_cast<uint32_t>(index);
+        append(kEventBlock, block, {static_cast<double>(index), vecBlockStart_us[index + 1] - vecBlockStart_us[index]});
+
+        if (pBlock->isRF())
+        {
+            const RFEvent& rf = pBlock->GetRFEvent();
+            append(kEventRf, block, {rf.amplitude, rf.freqOffset, rf.phaseOffset, static_cast<double>(rf.delay),
+                                     pBlock->GetRFLength() * pBlock->GetRFDwellTime(), static_cast<double>(pBlock->GetRFLength())});
+        }
+
+        for (int channel = 0; channel < NUM_GRADS; channel++)
+        {
+            const GradEvent& grad = pBlock->GetGradEvent(channel);
+            double peak(0.), area_us(0.), duration_us(0.), delay_us(grad.delay);
+            if (pBlock->isTrapGradient(channel))
+            {
+                peak = 1.;
+                area_us = 0.5 * grad.rampUpTime + grad.flatTime + 0.5 * grad.rampDownTime;
+                duration_us = static_cast<double>(grad.rampUpTime + grad.flatTime + grad.rampDownTime);
+            }
+            else if (pBlock->isArbitraryGradient(channel))
+            {
+                double sum(0.);
+                ShapeStats(pBlock->GetArbGradShapePtr(channel), pBlock->GetArbGradNumSamples(channel), peak, sum);
+                area_us = sum * gradRasterTime_us;
+                duration_us = pBlock->GetArbGradNumSamples(channel) * gradRasterTime_us;
+            }
+            else if (pBlock->isExtTrapGradient(channel))
+            {
+                const std::vector<long>& vecTimes = pBlock->GetExtTrapGradTimes(channel);
+                const std::vector<float>& vecShape = pBlock->GetExtTrapGradShape(channel);
+                double sum(0.);
+                ShapeStats(vecShape.data(), vecShape.size(), peak, sum);
+                for (size_t point = 1; point < vecTimes.size() && point < vecShape.size(); point++)
+                {
+                    area_us += 0.5 * (vecShape[point - 1] + vecShape[point]) * (vecTimes[point] - vecTimes[point - 1]);
+                }
+                if (!vecTimes.empty())
+                {
+                    delay_us += vecTimes.front();
+                    duration_us = static_cast<double>(vecTimes.back() - vecTimes.front());
+                }
+            }
+            else
+            {
+                continue;
+            }
+            append(gradKinds[channel], block, {grad.amplitude, std::fabs(grad.amplitude) * peak, grad.amplitude * area_us * 1e-6,
+                                               delay_us, duration_us});
+        }
+
+        if (pBlock->isADC())
+        {
+            const ADCEvent& adc = pBlock->GetADCEvent();
+            append(kEventAdc, block, {static_cast<double>(adc.numSamples), adc.dwellTime * 1e-3, static_cast<double>(adc.delay),
+                                      adc.numSamples * adc.dwellTime * 1e-3, adc.freqOffset, adc.phaseOffset});
+        }
+    }
+    return spTable;
+}
+
+int EventTable::FieldCount()
+{
+    return kFieldNum;
+}
+
+std::string EventTable::FieldName(const int& field)
+{
+    return field >= 0 && field < kFieldNum ? kFields[field].name : "";
+}
+
+std::string EventTable::FieldUnit(const int& field)
+{
+    return field >= 0 && field < kFieldNum ? kFields[field].unit : "";
+}
+
+bool EventTable::ParseQuery(const std::string& sQuery, EventQuery& query, std::string& sError)
+{
+    // Terms are "field op value [unit]" or a bare kind ("rf", "adc"), joined by
+    // "and", "&&" or "," and by "or" or "||" with "and" binding tighter
+    query.groups.assign(1, std::vector<EventQueryTerm>());
+    size_t position(0);
+    auto skipSpaces = [&]() {
+        while (position < sQuery.size() && std::isspace(static_cast<unsigned char>(sQuery[position]))) position++;
+    };
+    auto readWord = [&](const std::string& sExtra) {
+        const size_t start = position;
+        while (position < sQuery.size()
+               && (std::isalnum(static_cast<unsigned char>(sQuery[position])) || sExtra.find(sQuery[position]) != std::string::npos))
+        {
+            position++;
+        }
+        return sQuery.substr(start, position - start);
+    };
+
+    while (true)
+    {
+        skipSpaces();
+        const std::string sName = readWord("_.");
+        if (sName.empty())
+        {
+            sError = position < sQuery.size() ? "Unexpected \"" + sQuery.substr(position) + "\"" : "Missing a term at the end";
+            return false;
+        }
+
+        EventQueryTerm term;
+        term.kind = -1;
+        term.field = -1;
+        term.op = kQueryExists;
+        term.value = 0.;
+        const std::string sLower = ToLower(sName);
+        for (int field = 0; field < kFieldNum; field++)
+        {
+            if (sLower == ToLower(kFields[field].name)) term.field = field;
+        }
+        for (int kind = 0; kind < EVENT_KIND_NUM; kind++)
+        {
+            if (sLower == kKindNames[kind]) term.kind = kind;
+        }
+        if (term.field < 0 && term.kind < 0)
+        {
+            sError = "Unknown field: " + sName;
+            return false;
+        }
+
+        // Comparison, "≠" included
+        skipSpaces();
+        static const std::pair<const char*, QueryOperator> operators[] = {
+            {"==", kQueryEqual}, {"!=", kQueryNotEqual}, {"<>", kQueryNotEqual}, {"\xE2\x89\xA0", kQueryNotEqual},
+            {"<=", kQueryLessEqual}, {">=", kQueryGreaterEqual}, {"=", kQueryEqual}, {"<", kQueryLess}, {">", kQueryGreater}};
+        for (const auto& op : operators)
+        {
+            if (sQuery.compare(position, std::string(op.first).size(), op.first) != 0) continue;
+            term.op = op.second;
+            position += std::string(op.first).size();
+            break;
+        }
+
+        if (term.op == kQueryExists)
+        {
+            if (term.kind < 0)
+            {
+                sError = "Missing comparison after " + sName;
+                return false;
+            }
+        }
+        else
+        {
+            if (term.field < 0)
+            {
+                sError = "Compare a field of " + sName + ", e.g. " + sName + ".delay";
+                return false;
+            }
+            term.kind = kFields[term.field].kind;
+
+            skipSpaces();
+            const char* pStart = sQuery.c_str() + position;
+            char* pEnd(nullptr);
+            term.value = std::strtod(pStart, &pEnd);
+            if (pEnd == pStart)
+            {
+                sError = "Missing value after " + sName;
+                return false;
+            }
+            position += pEnd - pStart;
+
+            // Optional unit, which must not swallow a following "and" or "or"
+            skipSpaces();
+            const size_t unitStart = position;
+            const std::string sUnit = readWord("/");
+            const std::string sUnitLower = ToLower(sUnit);
+            if (sUnitLower == "and" || sUnitLower == "or")
+            {
+                position = unitStart;
+            }
+            else if (!sUnit.empty())
+            {
+                const QueryUnit* pUnit(nullptr);
+                for (const QueryUnit& unit : kUnits)
+                {
+                    if (sUnitLower == ToLower(unit.name)) pUnit = &unit;
+                }
+                if (nullptr == pUnit || std::string(pUnit->base) != kFields[term.field].unit)
+                {
+                    const std::string sFieldUnit(kFields[term.field].unit);
+                    sError = "Unit " + sUnit + " does not fit " + kFields[term.field].name
+                           + (sFieldUnit.empty() ? ", which takes a plain number" : ", which is in " + sFieldUnit);
+                    return false;
+                }
+                term.value *= pUnit->scale;
+            }
+        }
+        query.groups.back().push_back(term);
+
+        skipSpaces();
+        if (position >= sQuery.size()) break;
+        const size_t connectorStart = position;
+        std::string sConnector;
+        if (sQuery[position] == ',')
+        {
+            sConnector = "and";
+            position++;
+        }
+        else if (sQuery.compare(position, 2, "&&") == 0 || sQuery.compare(position, 2, "||") == 0)
+        {
+            sConnector = sQuery[position] == '&' ? "and" : "or";
+            position += 2;
+        }
+        else
+        {
+            sConnector = ToLower(readWord(""));
+        }
+        if (sConnector == "or")
+        {
+            query.groups.push_back(std::vector<EventQueryTerm>());
+        }
+        else if (sConnector != "and")
+        {
+            sError = "Expected \"and\" or \"or\" before \"" + sQuery.substr(connectorStart) + "\"";
+            return false;
+        }
+    }
+    return true;
+}
+
+const std::vector<uint32_t>& EventTable::SortedRows(const int& field) const
+{
+    std::call_once(m_pIndexOnce[field], [this, &field]() {
+        const std::vector<double>& vecColumn = m_vecColumns[field];
+        std::vector<std::pair<double, uint32_t>> vecPairs(vecColumn.size());
+        for (size_t row = 0; row < vecColumn.size(); row++)
+        {
+            vecPairs[row] = std::make_pair(vecColumn[row], static_cast<uint32_t>(row));
+        }
+        std::sort(vecPairs.begin(), vecPairs.end());
+        std::vector<uint32_t>& vecRows = m_vecSortedRows[field];
+        vecRows.resize(vecPairs.size());
+        for (size_t position = 0; position < vecPairs.size(); position++)
+        {
+            vecRows[position] = vecPairs[position].second;
+        }
+    });
+    return m_vecSortedRows[field];
+}
+
+std::vector<uint32_t> EventTable::EvaluateTerm(const EventQueryTerm& term) const
+{
+    const std::vector<uint32_t>& vecRowBlock = m_vecRowBlock[term.kind];
+    if (term.op == kQueryExists) return vecRowBlock;
+
+    // Positions in the sorted index of the first value >= / > a bound
+    const std::vector<double>& vecColumn = m_vecColumns[term.field];
+    const std::vector<uint32_t>& vecSorted = SortedRows(term.field);
+    auto lowerPosition = [&](const double& bound) {
+        return std::partition_point(vecSorted.begin(), vecSorted.end(), [&](const uint32_t& row) { return vecColumn[row] < bound; })
+               - vecSorted.begin();
+    };
+    auto upperPosition = [&](const double& bound) {
+        return std::partition_point(vecSorted.begin(), vecSorted.end(), [&](const uint32_t& row) { return vecColumn[row] <= bound; })
+               - vecSorted.begin();
+    };
+
+    // Up to two ranges of the index, != takes everything around the equal run
+    const size_t rows = vecSorted.size();
+    const double tolerance = Tolerance(term.value);
+    std::vector<std::pair<size_t, size_t>> vecRanges;
+    switch (term.op)
+    {
+    case kQueryEqual:
+        vecRanges.push_back({lowerPosition(term.value - tolerance), upperPosition(term.value + tolerance)});
+        break;
+    case kQueryNotEqual:
+        vecRanges.push_back({0, lowerPosition(term.value - tolerance)});
+        vecRanges.push_back({upperPosition(term.value + tolerance), rows});
+        break;
+    case kQueryLess: vecRanges.push_back({0, lowerPosition(term.value)}); break;
+    case kQueryLessEqual: vecRanges.push_back({0, upperPosition(term.value)}); break;
+    case kQueryGreater: vecRanges.push_back({upperPosition(term.value), rows}); break;
+    case kQueryGreaterEqual: vecRanges.push_back({lowerPosition(term.value), rows}); break;
+    default: break;
+    }
+    size_t matches(0);
+    for (const auto& range : vecRanges)
+    {
+        matches += range.second > range.first ? range.second - range.first : 0;
+    }
+
+    std::vector<uint32_t> vecBlocks;
+    if (matches * EVENT_SCAN_FRACTION > rows)
+    {
+        // Most rows match: a scan in row order needs no sorting afterwards
+        const size_t chunks = ParallelChunkCount(0, rows, EVENT_SCAN_MIN_CHUNK);
+        std::vector<std::vector<uint32_t>> vecChunkBlocks(chunks);
+        ParallelFor(0, rows, EVENT_SCAN_MIN_CHUNK, [&](size_t chunk, size_t begin, size_t end) {
+            std::vector<uint32_t>& vecChunk = vecChunkBlocks[chunk];
+            for (size_t row = begin; row < end; row++)
+            {
+                if (Matches(term.op, vecColumn[row], term.value)) vecChunk.push_back(vecRowBlock[row]);
+            }
+        });
+        vecBlocks.reserve(matches);
+        for (const std::vector<uint32_t>& vecChunk : vecChunkBlocks)
+        {
+            vecBlocks.insert(vecBlocks.end(), vecChunk.begin(), vecChunk.end());
+        }
+        return vecBlocks;
+    }
+
+    std::vector<uint32_t> vecRows;
+    vecRows.reserve(matches);
+    for (const auto& range : vecRanges)
+    {
+        if (range.second > range.first) vecRows.insert(vecRows.end(), vecSorted.begin() + range.first, vecSorted.begin() + range.second);
+    }
+    std::sort(vecRows.begin(), vecRows.end());
+    vecBlocks.resize(vecRows.size());
+    for (size_t position = 0; position < vecRows.size(); position++)
+    {
+        vecBlocks[position] = vecRowBlock[vecRows[position]];
+    }
+    return vecBlocks;
+}
+
+std::vector<uint64_t> EventTable::Query(const EventQuery& query) const
+{
+    std::vector<uint32_t> vecMatches;
+    for (const std::vector<EventQueryTerm>& group : query.groups)
+    {
+        if (group.empty()) continue;
+
+        // Intersect starting from the shortest list
+        std::vector<std::vector<uint32_t>> vecLists;
+        vecLists.reserve(group.size());
+        for (const EventQueryTerm& term : group)
+        {
+            vecLists.push_back(EvaluateTerm(term));
+        }
+        std::sort(vecLists.begin(), vecLists.end(), [](const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+            return a.size() < b.size();
+        });
+        std::vector<uint32_t> vecGroup(std::move(vecLists.front()));
+        for (size_t list = 1; list < vecLists.size() && !vecGroup.empty(); list++)
+        {
+            std::vector<uint32_t> vecBoth;
+            std::set_intersection(vecGroup.begin(), vecGroup.end(), vecLists[list].begin(), vecLists[list].end(), std::back_inserter(vecBoth));
+            vecGroup.swap(vecBoth);
+        }
+
+        if (vecMatches.empty())
+        {
+            vecMatches.swap(vecGroup);
+        }
+        else
+        {
+            std::vector<uint32_t> vecEither;
+            std::set_union(vecMatches.begin(), vecMatches.end(), vecGroup.begin(), vecGroup.end(), std::back_inserter(vecEither));
+            vecMatches.swap(vecEither);
+        }
+    }
+    return std::vector<uint64_t>(vecMatches.begin(), vecMatches.end());
+}
+
+int64_t EventTable::FindRow(const int& kind, const uint64_t& block) const
+{
+    const std::vector<uint32_t>& vecRowBlock = m_vecRowBlock[kind];
+    const auto it = std::lower_bound(vecRowBlock.begin(), vecRowBlock.end(), block);
+    if (it == vecRowBlock.end() || *it != block) return -1;
+    return it - vecRowBlock.begin();
+}
+
+bool EventTable::Value(const int& field, const uint64_t& block, double& value) const
+{
+    if (field < 0 || field >= kFieldNum) return false;
+    const int64_t row = FindRow(kFields[field].kind, block);
+    if (row < 0) return false;
+    value = m_vecColumns[field][row];
+    return true;
+}
+
+std::string EventTable::Describe(const EventQuery& query, const uint64_t& block) const
+{
+    std::vector<int> vecFields;
+    for (const std::vector<EventQueryTerm>& group : query.groups)
+    {
+        for (const EventQueryTerm& term : group)
+        {
+            if (term.field >= 0 && std::find(vecFields.begin(), vecFields.end(), term.field) == vecFields.end()) vecFields.push_back(term.field);
+        }
+    }
+
+    std::ostringstream text;
+    for (const int& field : vecFields)
+    {
+        double value(0.);
+        if (!Value(field, block, value)) continue;
+        if (text.tellp() > 0) text << " ";
+        text << kFields[field].name << "=" << value;
+        if (kFields[field].unit[0] != '\0') text << " " << kFields[field].unit;
+    }
+    return text.str();
+}
+
+uint64_t EventTable::MemoryBytes() const
+{
+    uint64_t bytes(0);
+    for (const std::vector<uint32_t>& vecRowBlock : m_vecRowBlock)
+    {
+        bytes += vecRowBlock.capacity() * sizeof(uint32_t);
+    }
+    for (const std::vector<double>& vecColumn : m_vecColumns)
+    {
+        bytes += vecColumn.capacity() * sizeof(double);
+    }
+    for (const std::vector<uint32_t>& vecRows : m_vecSortedRows)
+    {
+        bytes += vecRows.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,93 @@
+#ifndef EVENT_QUERY_H
+#define EVENT_QUERY_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ExternalSequence.h>
+
+#define EVENT_SCAN_MIN_CHUNK         (65536)
+#define EVENT_SCAN_FRACTION          (8)         // scan a column once a term matches more than 1/8 of its rows
+
+// Tables of the event table, one row per event in block order
+enum EventKind
+{
+    kEventBlock = 0,
+    kEventRf,
+    kEventGx,
+    kEventGy,
+    kEventGz,
+    kEventAdc,
+    EVENT_KIND_NUM
+};
+
+enum QueryOperator
+{
+    kQueryExists = 0,   // the block has an event of the kind
+    kQueryEqual,
+    kQueryNotEqual,
+    kQueryLess,
+    kQueryLessEqual,
+    kQueryGreater,
+    kQueryGreaterEqual
+};
+
+struct EventQueryTerm
+{
+    int kind;
+    int field;          // -1 for kQueryExists
+    QueryOperator op;
+    double value;       // in the unit of the field
+};
+
+// Blocks matching any group, a group matches if all of its terms do
+struct EventQuery
+{
+    std::vector<std::vector<EventQueryTerm>> groups;
+};
+
+// Block and event fields of a sequence stored column by column, e.g.
+// "gx.amplitude" or "adc.samples", for queries like
+//     gx.peak > 30 kHz/m and adc.samples = 256 or rf.freqOffset != 0
+// Every kind has at most one event per block, so rows are in block order
+// and a term turns into a sorted block list. A term reads the sorted index
+// of its field with two binary searches; if it matches a large share of the
+// rows the column is scanned instead, which also keeps block order. Indices
+// are sorted the first time a field is queried and kept afterwards.
+class EventTable
+{
+public:
+    static std::shared_ptr<EventTable> Build(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us,
+                                             const double& gradRasterTime_us);
+
+    // Field name, e.g. "rf.freqOffset", and its unit, "" for plain numbers
+    static int FieldCount();
+    static std::string FieldName(const int& field);
+    static std::string FieldUnit(const int& field);
+    static bool ParseQuery(const std::string& sQuery, EventQuery& query, std::string& sError);
+
+    // Blocks matching the query in sequence order
+    std::vector<uint64_t> Query(const EventQuery& query) const;
+    // Value of a field in a block, false if the block has no such event
+    bool Value(const int& field, const uint64_t& block, double& value) const;
+    // Values of the fields a query refers to, e.g. "gx.peak=31250 Hz/m adc.samples=256"
+    std::string Describe(const EventQuery& query, const uint64_t& block) const;
+
+    inline uint64_t BlockCount() const { return m_vecRowBlock[kEventBlock].size(); }
+    inline uint64_t EventCount(const int& kind) const { return m_vecRowBlock[kind].size(); }
+    uint64_t MemoryBytes() const;
+
+private:
+    std::vector<uint32_t> EvaluateTerm(const EventQueryTerm& term) const;
+    const std::vector<uint32_t>& SortedRows(const int& field) const;
+    int64_t FindRow(const int& kind, const uint64_t& block) const;
+
+    std::vector<uint32_t>                       m_vecRowBlock[EVENT_KIND_NUM];
+    std::vector<std::vector<double>>            m_vecColumns;           // one per field
+    mutable std::vector<std::vector<uint32_t>>  m_vecSortedRows;        // one per field, empty until queried
+    mutable std::unique_ptr<std::once_flag[]>   m_pIndexOnce;
+};
+
+#endif // EVENT_QUERY_H
@@ -0,0 +1,273 @@
+#include "gradient_rotation.h"
+#include "hash_mix.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+struct Polyline
+{
+    std::vector<double> time;
+    std::vector<double> amplitude;
+    size_t cursor = 0;
+
+    // Limits from the left and from the right at t, zero outside the polyline.
+    // Calls must come with non-decreasing t.
+    void Evaluate(const double& t, double& left, double& right)
+    {
+        left = right = 0.;
+        const size_t count = time.size();
+        if (count == 0 || t < time.front() || t > time.back()) return;
+        while (cursor < count && time[cursor] < t) cursor++;
+        size_t last = cursor;
+        while (last < count && time[last] == t) last++;
+        if (last > cursor)
+        {
+            left = cursor == 0 ? 0. : amplitude[cursor];
+            right = last == count ? 0. : amplitude[last - 1];
+            return;
+        }
+        const double weight = (t - time[cursor - 1]) / (time[cursor] - time[cursor - 1]);
+        left = right = amplitude[cursor - 1] * (1. - weight) + amplitude[cursor] * weight;
+    }
+};
+}
+
+GradientRotator::GradientRotator(const double& gradRasterTime_us)
+    : m_dGradRasterTime_us(gradRasterTime_us)
+    , m_lCacheHits(0)
+{
+}
+
+size_t GradientRotator::RotationKeyHash::operator()(const RotationKey& key) const
+{
+    uint64_t hash(0);
+    for (const int& id : key.gradients) hash = Mix64(hash ^ static_cast<uint64_t>(static_cast<uint32_t>(id)));
+    for (const uint64_t& bits : key.matrix) hash = Mix64(hash ^ bits);
+    return static_cast<size_t>(hash);
+}
+
+GradientRotator::RotationKey GradientRotator::MakeKey(SeqBlock* pBlock)
+{
+    RotationKey key;
+    key.matrix.fill(0);
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        key.gradients[channel] = std::max(pBlock->GetEventIndex(static_cast<Event>(GX + channel)), 0);
+    }
+    if (pBlock->GetRotationEvent().defined)
+    {
+        for (int index = 0; index < 9; index++)
+        {
+            // -0 and 0 rotate identically
+            const double element = pBlock->GetRotationEvent().rotMatrix[index] + 0.;
+            std::memcpy(&key.matrix[index], &element, sizeof(double));
+        }
+    }
+    return key;
+}
+
+void GradientRotator::ClearCache()
+{
+    m_mapLogical.clear();
+    m_mapRotated.clear();
+    m_lCacheHits = 0;
+}
+
+void GradientRotator::RotateSamples(const double* pMatrix, const double* pX, const double* pY, const double* pZ, const size_t& count,
+                                    double* pOutX, double* pOutY, double* pOutZ)
+{
+    // Structure-of-arrays with the matrix in registers, the loop body vectorizes
+    const double m00 = pMatrix[0], m01 = pMatrix[1], m02 = pMatrix[2];
+    const double m10 = pMatrix[3], m11 = pMatrix[4], m12 = pMatrix[5];
+    const double m20 = pMatrix[6], m21 = pMatrix[7], m22 = pMatrix[8];
+    for (size_t index = 0; index < count; index++)
+    {
+        const double x = pX[index];
+        const double y = pY[index];
+        const double z = pZ[index];
+        pOutX[index] = m00 * x + m01 * y + m02 * z;
+        pOutY[index] = m10 * x + m11 * y + m12 * z;
+        pOutZ[index] = m20 * x + m21 * y + m22 * z;
+    }
+}
+
+std::shared_ptr<const GradientStream> GradientRotator::BuildLogical(SeqBlock* pBlock) const
+{
+    Polyline polylines[NUM_GRADS];
+    std::vector<double> vecGrid;
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        if (pBlock->GetEventIndex(static_cast<Event>(GX + channel)) <= 0) continue;
+        const GradEvent& grad = pBlock->GetGradEvent(channel);
+        Polyline& polyline = polylines[channel];
+        if (pBlock->isTrapGradient(channel))
+        {
+            const double flatStart = grad.delay + grad.rampUpTime;
+            const double flatEnd = flatStart + grad.flatTime;
+            polyline.time = {static_cast<double>(grad.delay), flatStart, flatEnd, flatEnd + grad.rampDownTime};
+            polyline.amplitude = {0., grad.amplitude, grad.amplitude, 0.};
+        }
+        else if (pBlock->isArbitraryGradient(channel))
+        {
+            // Samples sit at the centers of the raster intervals
+            const int length = pBlock->GetArbGradNumSamples(channel);
+            const float* pShape = pBlock->GetArbGradShapePtr(channel);
+            for (int index = 0; index < length; index++)
+            {
+                polyline.time.push_back(grad.delay + (index + 0.5) * m_dGradRasterTime_us);
+                polyline.amplitude.push_back(grad.amplitude * pShape[index]);
+            }
+        }
+        else if (pBlock->isExtTrapGradient(channel))
+        {
+            const std::vector<long>& vecTimes = pBlock->GetExtTrapGradTimes(channel);
+            const std::vector<float>& vecShape = pBlock->GetExtTrapGradShape(channel);
+            for (size_t index = 0; index < vecTimes.size() && index < vecShape.size(); index++)
+            {
+                polyline.time.push_back(static_cast<double>(grad.delay + vecTimes[index]));
+                polyline.amplitude.push_back(grad.amplitude * vecShape[index]);
+            }
+        }
+        vecGrid.insert(vecGrid.end(), polyline.time.begin(), polyline.time.end());
+    }
+    std::sort(vecGrid.begin(), vecGrid.end());
+    vecGrid.erase(std::unique(vecGrid.begin(), vecGrid.end()), vecGrid.end());
+
+    // Every channel evaluated on the merged breakpoints, steps in any channel get two samples
+    std::shared_ptr<GradientStream> spStream = std::make_shared<GradientStream>();
+    double left[NUM_GRADS], right[NUM_GRADS];
+    for (const double& t : vecGrid)
+    {
+        bool bStep(false);
+        for (int channel = 0; channel < NUM_GRADS; channel++)
+        {
+            polylines[channel].Evaluate(t, left[channel], right[channel]);
+            bStep |= left[channel] != right[channel];
+        }
+        spStream->time.push_back(t);
+        for (int channel = 0; channel < NUM_GRADS; channel++) spStream->axis[channel].push_back(left[channel]);
+        if (!bStep) continue;
+        spStream->time.push_back(t);
+        for (int channel = 0; channel < NUM_GRADS; channel++) spStream->axis[channel].push_back(right[channel]);
+    }
+    return spStream;
+}
+
+void GradientRotator::Rotate(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us, const double& scale,
+                             std::vector<double>& time, std::vector<double> (&values)[NUM_GRADS])
+{
+    time.clear();
+    for (auto& vecValues : values) vecValues.clear();
+    const size_t blockNum = std::min(blocks.size(), vecBlockStart_us.size());
+    const GradientKey emptyKey{0, 0, 0};
+
+    // Look up every block, collecting the distinct misses
+    std::vector<RotationKey> vecKeys(blockNum);
+    ParallelFor(0, blockNum, ROTATION_MIN_CHUNK, [&](size_t, size_t begin, size_t end) {
+        for (size_t block = begin; block < end; block++) vecKeys[block] = MakeKey(blocks[block]);
+    });
+
+    std::vector<const GradientStream*> vecBlockStreams(blockNum, nullptr);
+    std::vector<size_t> vecBlockPending(blockNum, SIZE_MAX);
+    std::unordered_map<RotationKey, size_t, RotationKeyHash> mapPending;
+    std::vector<size_t> vecPendingBlocks;
+    for (size_t block = 0; block < blockNum; block++)
+    {
+        if (vecKeys[block].gradients == emptyKey) continue;
+        const auto itCached = m_mapRotated.find(vecKeys[block]);
+        if (itCached != m_mapRotated.end())
+        {
+            vecBlockStreams[block] = itCached->second.get();
+            m_lCacheHits++;
+            continue;
+        }
+        const auto itPending = mapPending.emplace(vecKeys[block], vecPendingBlocks.size());
+        if (itPending.second) vecPendingBlocks.push_back(block);
+        vecBlockPending[block] = itPending.first->second;
+    }
+
+    // Merged logical streams missing from the cache
+    std::vector<size_t> vecLogicalBlocks;
+    std::map<GradientKey, size_t> mapLogicalPending;
+    for (const size_t& block : vecPendingBlocks)
+    {
+        const GradientKey& key = vecKeys[block].gradients;
+        if (m_mapLogical.count(key) == 0 && mapLogicalPending.emplace(key, vecLogicalBlocks.size()).second)
+        {
+            vecLogicalBlocks.push_back(block);
+        }
+    }
+    std::vector<std::shared_ptr<const GradientStream>> vecLogical(vecLogicalBlocks.size());
+    ParallelFor(0, vecLogicalBlocks.size(), ROTATION_MIN_CHUNK, [&](size_t, size_t begin, size_t end) {
+        for (size_t index = begin; index < end; index++) vecLogical[index] = BuildLogical(blocks[vecLogicalBlocks[index]]);
+    });
+    for (const auto& pending : mapLogicalPending)
+    {
+        m_mapLogical[pending.first] = vecLogical[pending.second];
+    }
+
+    // Rotate the misses in parallel, unrotated blocks share the logical stream
+    std::vector<std::shared_ptr<const GradientStream>> vecRotated(vecPendingBlocks.size());
+    ParallelFor(0, vecPendingBlocks.size(), ROTATION_MIN_CHUNK, [&](size_t, size_t begin, size_t end) {
+        for (size_t index = begin; index < end; index++)
+        {
+            SeqBlock* pBlock = blocks[vecPendingBlocks[index]];
+            const std::shared_ptr<const GradientStream>& spLogical = m_mapLogical.at(vecKeys[vecPendingBlocks[index]].gradients);
+            if (!pBlock->GetRotationEvent().defined)
+            {
+                vecRotated[index] = spLogical;
+                continue;
+            }
+            std::shared_ptr<GradientStream> spRotated = std::make_shared<GradientStream>();
+            const size_t count = spLogical->time.size();
+            spRotated->time = spLogical->time;
+            for (auto& vecAxis : spRotated->axis) vecAxis.resize(count);
+            RotateSamples(pBlock->GetRotationEvent().rotMatrix,
+                          spLogical->axis[0].data(), spLogical->axis[1].data(), spLogical->axis[2].data(), count,
+                          spRotated->axis[0].data(), spRotated->axis[1].data(), spRotated->axis[2].data());
+            vecRotated[index] = spRotated;
+        }
+    });
+    for (size_t index = 0; index < vecPendingBlocks.size(); index++)
+    {
+        m_mapRotated[vecKeys[vecPendingBlocks[index]]] = vecRotated[index];
+    }
+
+    // Concatenate with absolute times, one NaN gap after every block
+    std::vector<size_t> vecOffsets(blockNum + 1, 0);
+    for (size_t block = 0; block < blockNum; block++)
+    {
+        if (vecBlockPending[block] != SIZE_MAX) vecBlockStreams[block] = vecRotated[vecBlockPending[block]].get();
+        const GradientStream* pStream = vecBlockStreams[block];
+        vecOffsets[block + 1] = vecOffsets[block] + (pStream && !pStream->time.empty() ? pStream->time.size() + 1 : 0);
+    }
+    time.resize(vecOffsets[blockNum]);
+    for (auto& vecValues : values) vecValues.resize(vecOffsets[blockNum]);
+    ParallelFor(0, blockNum, ROTATION_MIN_CHUNK, [&](size_t, size_t begin, size_t end) {
+        for (size_t block = begin; block < end; block++)
+        {
+            const size_t offset = vecOffsets[block];
+            const size_t count = vecOffsets[block + 1] - offset;
+            if (count == 0) continue;
+            const GradientStream* pStream = vecBlockStreams[block];
+            for (size_t index = 0; index + 1 < count; index++)
+            {
+                time[offset + index] = vecBlockStart_us[block] + pStream->time[index];
+                for (int channel = 0; channel < NUM_GRADS; channel++)
+                {
+                    values[channel][offset + index] = pStream->axis[channel][index] * scale;
+                }
+            }
+            time[offset + count - 1] = time[offset + count - 2];
+            for (int channel = 0; channel < NUM_GRADS; channel++)
+            {
+                values[channel][offset + count - 1] = std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+    });
+}
@@ -0,0 +1,68 @@
+#ifndef GRADIENT_ROTATION_H
+#define GRADIENT_ROTATION_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <ExternalSequence.h>
+
+#define ROTATION_MIN_CHUNK      (256)
+
+// Gradient waveforms of one block on a common time grid, block relative times
+// in us, amplitudes in Hz/m. A step shows up as two samples at the same time.
+struct GradientStream
+{
+    std::vector<double> time;
+    std::vector<double> axis[NUM_GRADS];
+};
+
+// Plays the rotation extension forward: every block's logical GX/GY/GZ
+// waveforms are merged onto one time grid and multiplied by the block's 3x3
+// rotation matrix, giving what the physical gradient axes play out.
+// Merged logical streams are cached per gradient event triple, rotated streams
+// per (rotation matrix, gradient event triple), so identical shapes under a
+// repeated rotation are computed once. Cache misses are filled in parallel.
+class GradientRotator
+{
+public:
+    explicit GradientRotator(const double& gradRasterTime_us);
+
+    // Physical-axis polylines of all blocks with absolute times, blocks separated by NaN gaps.
+    // Amplitudes are multiplied by scale, e.g. 1e-3 for kHz/m.
+    void Rotate(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us, const double& scale,
+                std::vector<double>& time, std::vector<double> (&values)[NUM_GRADS]);
+
+    // out = matrix * (x, y, z) for count samples, matrix in row-major order
+    static void RotateSamples(const double* pMatrix, const double* pX, const double* pY, const double* pZ, const size_t& count,
+                              double* pOutX, double* pOutY, double* pOutZ);
+
+    inline size_t CacheSize() const { return m_mapRotated.size(); }
+    inline uint64_t CacheHits() const { return m_lCacheHits; }
+    void ClearCache();
+
+private:
+    typedef std::array<int, NUM_GRADS> GradientKey;
+    struct RotationKey
+    {
+        GradientKey gradients;
+        std::array<uint64_t, 9> matrix;     // bit patterns, all zero without rotation
+        bool operator==(const RotationKey& other) const { return gradients == other.gradients && matrix == other.matrix; }
+    };
+    struct RotationKeyHash
+    {
+        size_t operator()(const RotationKey& key) const;
+    };
+
+    static RotationKey MakeKey(SeqBlock* pBlock);
+    std::shared_ptr<const GradientStream> BuildLogical(SeqBlock* pBlock) const;
+
+    double                                                                  m_dGradRasterTime_us;
+    std::map<GradientKey, std::shared_ptr<const GradientStream>>            m_mapLogical;
+    std::unordered_map<RotationKey, std::shared_ptr<const GradientStream>, RotationKeyHash> m_mapRotated;
+    uint64_t                                                                m_lCacheHits;
+};
+
+#endif // GRADIENT_ROTATION_H
@@ -0,0 +1,295 @@
+#include "gradient_spectrum.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <sstream>
+
+typedef std::complex<double> Complex;
+
+// In-place iterative radix-2 FFT with precomputed twiddles, shared read-only by the workers
+class RadixTwoFft
+{
+public:
+    explicit RadixTwoFft(const size_t& size)
+        : m_size(size)
+        , m_vecTwiddle(size / 2)
+        , m_vecReversed(size)
+    {
+        for (size_t index = 0; index < size / 2; index++)
+        {
+            m_vecTwiddle[index] = std::polar(1., -2. * M_PI * index / size);
+        }
+        size_t bits(0);
+        while ((size_t(1) << bits) < size) bits++;
+        for (size_t index = 0; index < size; index++)
+        {
+            size_t reversed(0);
+            for (size_t bit = 0; bit < bits; bit++)
+            {
+                if (index & (size_t(1) << bit)) reversed |= size_t(1) << (bits - 1 - bit);
+            }
+            m_vecReversed[index] = reversed;
+        }
+    }
+
+    void Transform(Complex* pData) const
+    {
+        for (size_t index = 0; index < m_size; index++)
+        {
+            if (index < m_vecReversed[index]) std::swap(pData[index], pData[m_vecReversed[index]]);
+        }
+        for (size_t length = 2; length <= m_size; length <<= 1)
+        {
+            const size_t half = length / 2;
+            const size_t stride = m_size / length;
+            for (size_t start = 0; start < m_size; start += length)
+            {
+                for (size_t index = 0; index < half; index++)
+                {
+                    // Spelled out, std::complex multiplication checks for NaN and infinity
+                    const Complex& w = m_vecTwiddle[index * stride];
+                    const Complex& v = pData[start + index + half];
+                    const Complex odd(v.real() * w.real() - v.imag() * w.imag(), v.real() * w.imag() + v.imag() * w.real());
+                    pData[start + index + half] = pData[start + index] - odd;
+                    pData[start + index] += odd;
+                }
+            }
+        }
+    }
+
+private:
+    size_t                  m_size;
+    std::vector<Complex>    m_vecTwiddle;
+    std::vector<size_t>     m_vecReversed;
+};
+
+GradientSpectrumAnalyzer::GradientSpectrumAnalyzer(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us, const double& gradRasterTime_us)
+    : m_sampler(blocks, vecBlockStart_us, gradRasterTime_us)
+    , m_vecBlockStart_us(vecBlockStart_us)
+{
+}
+
+bool GradientSpectrumAnalyzer::ParseBands(const std::string& sText, std::vector<ForbiddenBand>& bands, std::string& sError)
+{
+    bands.clear();
+    std::stringstream stream(sText);
+    std::string sBand;
+    while (std::getline(stream, sBand, ','))
+    {
+        if (sBand.find_first_not_of(" \t") == std::string::npos) continue;
+        const size_t separator = sBand.find('-', sBand.find_first_not_of(" \t") + 1);
+        char* pEnd(nullptr);
+        ForbiddenBand band;
+        band.low_Hz = std::strtod(sBand.c_str(), &pEnd);
+        const bool bLowValid = pEnd != sBand.c_str() && static_cast<size_t>(pEnd - sBand.c_str()) <= separator;
+        band.high_Hz = separator == std::string::npos ? 0. : std::strtod(sBand.c_str() + separator + 1, &pEnd);
+        if (!bLowValid || separator == std::string::npos || band.low_Hz < 0. || band.high_Hz <= band.low_Hz)
+        {
+            sError = "Invalid band \"" + sBand + "\", expected low-high in Hz";
+            return false;
+        }
+        bands.push_back(band);
+    }
+    if (bands.empty())
+    {
+        sError = "No forbidden band given";
+        return false;
+    }
+    return true;
+}
+
+bool GradientSpectrumAnalyzer::Analyze(const SpectrumOptions& options, GradientSpectrum& result, std::string& sError) const
+{
+    const size_t N = options.segmentSamples;
+    if (N < 16 || (N & (N - 1)) != 0)
+    {
+        sError = "Segment length has to be a power of two of at least 16 samples";
+        return false;
+    }
+    ExportOptions window;
+    window.start_us = options.start_us;
+    window.end_us = options.end_us;
+    window.raster_us = options.raster_us;
+    const uint64_t samples = WaveformExporter::SampleCount(window);
+    if (samples == 0)
+    {
+        sError = "Nothing to analyze, check the time range and raster!";
+        return false;
+    }
+
+    // A window shorter than one segment is zero padded, the last segment ends with the window
+    const size_t hop = std::max<size_t>(1, static_cast<size_t>(N * (1. - std::min(std::max(options.overlap, 0.), 0.95))));
+    const size_t segments = samples <= N ? 1 : static_cast<size_t>((samples - N + hop - 1) / hop) + 1;
+    auto segmentFirst = [&](const size_t& segment) {
+        return samples <= N ? uint64_t(0) : std::min<uint64_t>(static_cast<uint64_t>(segment) * hop, samples - N);
+    };
+    const size_t bins = N / 2 + 1;
+    const size_t bandNum = options.bands.size();
+    const double fs_Hz = 1e6 / options.raster_us;
+    const double df_Hz = fs_Hz / N;
+
+    std::vector<double> vecWindow(N);
+    double windowPower(0.);
+    for (size_t index = 0; index < N; index++)
+    {
+        vecWindow[index] = 0.5 - 0.5 * std::cos(2. * M_PI * index / N);
+        windowPower += vecWindow[index] * vecWindow[index];
+    }
+    const double scale = 1. / (fs_Hz * windowPower);
+
+    // Bin ranges of the bands, [first, last)
+    std::vector<std::pair<size_t, size_t>> vecBandBins(bandNum);
+    for (size_t band = 0; band < bandNum; band++)
+    {
+        const size_t first = static_cast<size_t>(std::ceil(options.bands[band].low_Hz / df_Hz));
+        const size_t last = static_cast<size_t>(std::floor(options.bands[band].high_Hz / df_Hz)) + 1;
+        vecBandBins[band] = std::make_pair(std::min(first, bins), std::min(std::max(last, first), bins));
+    }
+
+    const RadixTwoFft fft(N);
+    const size_t chunks = ParallelChunkCount(0, segments, 4);
+    std::vector<std::vector<double>> vecChunkPsd(chunks, std::vector<double>(NUM_GRADS * bins, 0.));
+    // Band power and its fraction of the AC power, per segment, channel and band
+    std::vector<float> vecSegmentPower(segments * NUM_GRADS * bandNum, 0.f);
+    std::vector<float> vecSegmentFraction(segments * NUM_GRADS * bandNum, 0.f);
+
+    ParallelFor(0, segments, 4, [&](size_t chunk, size_t begin, size_t end) {
+        std::vector<float> vecSamples(N * EXPORT_CHANNEL_NUM);
+        std::vector<Complex> vecXY(N);
+        std::vector<Complex> vecZ(N);
+        std::vector<double> vecPower(NUM_GRADS * bins);
+        std::vector<double>& vecPsd = vecChunkPsd[chunk];
+        for (size_t segment = begin; segment < end; segment++)
+        {
+            const uint64_t first = segmentFirst(segment);
+            const uint64_t count = std::min<uint64_t>(N, samples - first);
+            m_sampler.Sample(options.start_us + first * options.raster_us, options.raster_us, count, vecSamples.data());
+            std::fill(vecSamples.begin() + count * EXPORT_CHANNEL_NUM, vecSamples.end(), 0.f);
+
+            // Constant detrend, then the Hann window
+            double mean[NUM_GRADS] = {0., 0., 0.};
+            for (size_t index = 0; index < N; index++)
+            {
+                for (int channel = 0; channel < NUM_GRADS; channel++)
+                {
+                    mean[channel] += vecSamples[index * EXPORT_CHANNEL_NUM + kExportGx + channel];
+                }
+            }
+            for (int channel = 0; channel < NUM_GRADS; channel++) mean[channel] /= N;
+            for (size_t index = 0; index < N; index++)
+            {
+                const float* pSample = &vecSamples[index * EXPORT_CHANNEL_NUM + kExportGx];
+                const double& w = vecWindow[index];
+                vecXY[index] = Complex((pSample[0] - mean[0]) * w, (pSample[1] - mean[1]) * w);
+                vecZ[index] = Complex((pSample[2] - mean[2]) * w, 0.);
+            }
+            fft.Transform(vecXY.data());
+            fft.Transform(vecZ.data());
+
+            // Split the packed transform: X = (Z_k + conj(Z_N-k)) / 2, Y = (Z_k - conj(Z_N-k)) / 2i
+            for (size_t k = 0; k < bins; k++)
+            {
+                const Complex& a = vecXY[k];
+                const Complex b = std::conj(vecXY[(N - k) % N]);
+                const double oneSided = (k == 0 || k == N / 2) ? scale : 2. * scale;
+                vecPower[0 * bins + k] = std::norm((a + b) * 0.5) * oneSided;
+                vecPower[1 * bins + k] = std::norm((a - b) * 0.5) * oneSided;
+                vecPower[2 * bins + k] = std::norm(vecZ[k]) * oneSided;
+            }
+
+            for (int channel = 0; channel < NUM_GRADS; channel++)
+            {
+                const double* pPower = &vecPower[channel * bins];
+                double acPower(0.);
+                for (size_t k = 1; k < bins; k++)
+                {
+                    acPower += pPower[k];
+                    vecPsd[channel * bins + k] += pPower[k];
+                }
+                vecPsd[channel * bins] += pPower[0];
+                // Rounding noise of an idle axis has no meaningful spectrum
+                const bool bSilent = acPower * df_Hz < SPECTRUM_SILENT_RMS_HZ_M * SPECTRUM_SILENT_RMS_HZ_M;
+                for (size_t band = 0; band < bandNum; band++)
+                {
+                    double bandPower(0.);
+                    for (size_t k = vecBandBins[band].first; k < vecBandBins[band].second; k++) bandPower += pPower[k];
+                    const size_t slot = (segment * NUM_GRADS + channel) * bandNum + band;
+                    vecSegmentPower[slot] = static_cast<float>(bandPower * df_Hz);
+                    vecSegmentFraction[slot] = bSilent ? 0.f : static_cast<float>(bandPower / acPower);
+                }
+            }
+        }
+    });
+
+    result = GradientSpectrum();
+    result.frequencyStep_Hz = df_Hz;
+    result.segments = segments;
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        result.psd[channel].assign(bins, 0.);
+        for (const std::vector<double>& vecPsd : vecChunkPsd)
+        {
+            for (size_t k = 0; k < bins; k++) result.psd[channel][k] += vecPsd[channel * bins + k];
+        }
+        for (double& value : result.psd[channel]) value /= segments;
+
+        result.bandRms_Hz_m[channel].assign(bandNum, 0.);
+        for (size_t band = 0; band < bandNum; band++)
+        {
+            double bandPower(0.);
+            for (size_t k = vecBandBins[band].first; k < vecBandBins[band].second; k++) bandPower += result.psd[channel][k];
+            result.bandRms_Hz_m[channel][band] = std::sqrt(bandPower * df_Hz);
+        }
+    }
+
+    // Merge runs of offending segments and map them to the blocks they cover
+    auto blockAt = [this](const double& t_us) {
+        const size_t index = std::upper_bound(m_vecBlockStart_us.begin(), m_vecBlockStart_us.end(), t_us) - m_vecBlockStart_us.begin();
+        const size_t blocks = m_vecBlockStart_us.size() > 1 ? m_vecBlockStart_us.size() - 1 : 1;
+        return std::min(index > 0 ? index - 1 : 0, blocks - 1);
+    };
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        for (size_t band = 0; band < bandNum; band++)
+        {
+            BandViolation* pOpen(nullptr);
+            for (size_t segment = 0; segment < segments; segment++)
+            {
+                const size_t slot = (segment * NUM_GRADS + channel) * bandNum + band;
+                if (vecSegmentFraction[slot] <= options.minBandFraction) continue;
+
+                const double start_us = options.start_us + segmentFirst(segment) * options.raster_us;
+                const double end_us = std::min(options.end_us, start_us + N * options.raster_us);
+                const double bandRms = std::sqrt(static_cast<double>(vecSegmentPower[slot]));
+                // Overlapping segments belong to the same violation
+                if (nullptr == pOpen || start_us > pOpen->end_us)
+                {
+                    BandViolation violation;
+                    violation.channel = channel;
+                    violation.band = band;
+                    violation.start_us = start_us;
+                    violation.end_us = end_us;
+                    violation.peakFraction = 0.;
+                    violation.peakBandRms_Hz_m = 0.;
+                    result.violations.push_back(violation);
+                    pOpen = &result.violations.back();
+                }
+                pOpen->end_us = end_us;
+                pOpen->peakFraction = std::max(pOpen->peakFraction, static_cast<double>(vecSegmentFraction[slot]));
+                pOpen->peakBandRms_Hz_m = std::max(pOpen->peakBandRms_Hz_m, bandRms);
+            }
+        }
+    }
+    for (BandViolation& violation : result.violations)
+    {
+        violation.firstBlock = blockAt(violation.start_us);
+        violation.lastBlock = blockAt(std::max(violation.start_us, violation.end_us - 1e-6));
+    }
+    std::stable_sort(result.violations.begin(), result.violations.end(), [](const BandViolation& a, const BandViolation& b) {
+        return a.start_us < b.start_us;
+    });
+    return true;
+}
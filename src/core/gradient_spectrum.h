@@ -0,0 +1,88 @@
+#ifndef GRADIENT_SPECTRUM_H
+#define GRADIENT_SPECTRUM_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "waveform_exporter.h"
+
+#define SPECTRUM_DEFAULT_SEGMENT     (4096)
+#define SPECTRUM_DEFAULT_OVERLAP     (0.5)
+#define SPECTRUM_DEFAULT_FRACTION    (0.1)
+#define SPECTRUM_SILENT_RMS_HZ_M     (1.)        // AC rms below which a segment is not judged
+
+struct ForbiddenBand
+{
+    double low_Hz;
+    double high_Hz;
+};
+
+struct SpectrumOptions
+{
+    double start_us;
+    double end_us;
+    double raster_us;
+    size_t segmentSamples;      // power of two
+    double overlap;             // fraction of a segment shared with the next one
+    double minBandFraction;     // a segment offends when a band holds more of its AC power
+    std::vector<ForbiddenBand> bands;
+
+    SpectrumOptions()
+        : start_us(0.)
+        , end_us(0.)
+        , raster_us(10.)
+        , segmentSamples(SPECTRUM_DEFAULT_SEGMENT)
+        , overlap(SPECTRUM_DEFAULT_OVERLAP)
+        , minBandFraction(SPECTRUM_DEFAULT_FRACTION)
+    {}
+};
+
+// Consecutive offending segments of one axis and band
+struct BandViolation
+{
+    int channel;                // GX, GY or GZ index
+    size_t band;
+    double start_us;
+    double end_us;
+    size_t firstBlock;
+    size_t lastBlock;
+    double peakFraction;
+    double peakBandRms_Hz_m;
+};
+
+struct GradientSpectrum
+{
+    double frequencyStep_Hz;
+    size_t segments;
+    std::vector<double> psd[NUM_GRADS];             // one-sided, (Hz/m)^2/Hz, segmentSamples / 2 + 1 bins
+    std::vector<double> bandRms_Hz_m[NUM_GRADS];    // per band over the whole window
+    std::vector<BandViolation> violations;          // in time order
+
+    GradientSpectrum()
+        : frequencyStep_Hz(0.)
+        , segments(0)
+    {}
+};
+
+// Welch power spectra of the gradient axes. The window is cut into
+// overlapping Hann segments on the gradient raster; every segment is sampled
+// straight from the decoded blocks, so memory does not grow with the window.
+// Segments are transformed in parallel, GX and GY packed into one complex
+// FFT. Segments whose forbidden band power exceeds minBandFraction of their
+// AC power are merged into violations with the blocks they cover.
+class GradientSpectrumAnalyzer
+{
+public:
+    GradientSpectrumAnalyzer(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us, const double& gradRasterTime_us);
+
+    // "1000-1200, 1900-2100" in Hz
+    static bool ParseBands(const std::string& sText, std::vector<ForbiddenBand>& bands, std::string& sError);
+
+    bool Analyze(const SpectrumOptions& options, GradientSpectrum& result, std::string& sError) const;
+
+private:
+    WaveformExporter            m_sampler;
+    std::vector<double>         m_vecBlockStart_us;     // blocks + 1 entries
+};
+
+#endif // GRADIENT_SPECTRUM_H
@@ -0,0 +1,22 @@
+#ifndef HASH_MIX_H
+#define HASH_MIX_H
+
+#include <cstdint>
+
+// Finalizer of MurmurHash3, spreads every input bit over the whole word
+inline uint64_t Mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+inline void HashCombine(uint64_t& seed, const uint64_t& value)
+{
+    seed = Mix64(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+#endif // HASH_MIX_H
@@ -0,0 +1,230 @@
+#include "incremental_reload.h"
+#include "hash_mix.h"
+
+#include <algorithm>
+#include <cstring>
+
+static bool SameShape(const CompressedShape& a, const CompressedShape& b)
+{
+    return a.numUncompressedSamples == b.numUncompressedSamples && a.isCompressed == b.isCompressed && a.samples == b.samples;
+}
+
+static bool SameRf(const RFEvent& a, const RFEvent& b)
+{
+    return a.amplitude == b.amplitude && a.magShape == b.magShape && a.phaseShape == b.phaseShape && a.timeShape == b.timeShape
+        && a.freqOffset == b.freqOffset && a.phaseOffset == b.phaseOffset && a.delay == b.delay;
+}
+
+// Ramp times are only read for trapezoids and shape IDs only for arbitrary gradients
+static bool SameGrad(const GradEvent& a, const GradEvent& b)
+{
+    if (a.amplitude != b.amplitude || a.delay != b.delay || a.waveShape != b.waveShape || a.timeShape != b.timeShape) return false;
+    if (a.waveShape != 0) return true;
+    return a.rampUpTime == b.rampUpTime && a.flatTime == b.flatTime && a.rampDownTime == b.rampDownTime;
+}
+
+static bool SameAdc(const ADCEvent& a, const ADCEvent& b)
+{
+    return a.numSamples == b.numSamples && a.dwellTime == b.dwellTime && a.delay == b.delay
+        && a.freqOffset == b.freqOffset && a.phaseOffset == b.phaseOffset;
+}
+
+// Flags every ID that was added, removed or redefined, returns the number of flagged IDs
+template <typename T, typename Equal>
+static uint64_t FlagChangedIDs(const std::map<int, T>& before, const std::map<int, T>& after, Equal equal, std::vector<char>& changed)
+{
+    int maxID(0);
+    if (!before.empty()) maxID = std::max(maxID, before.rbegin()->first);
+    if (!after.empty()) maxID = std::max(maxID, after.rbegin()->first);
+    changed.assign(maxID + 1, 0);
+
+    uint64_t count(0);
+    for (const auto& entry : after)
+    {
+        const auto it = before.find(entry.first);
+        if (entry.first >= 0 && (it == before.end() || !equal(it->second, entry.second)))
+        {
+            changed[entry.first] = 1;
+            count++;
+        }
+    }
+    for (const auto& entry : before)
+    {
+        if (entry.first >= 0 && after.find(entry.first) == after.end())
+        {
+            changed[entry.first] = 1;
+            count++;
+        }
+    }
+    return count;
+}
+
+SectionIndex::SectionIndex()
+    : m_lFileSize(0)
+{
+}
+
+bool SectionIndex::Build(std::istream& stream, const std::map<std::string, int>& fileIndex, const std::set<int>& fileSections)
+{
+    m_mapHashes.clear();
+    stream.clear();
+    stream.seekg(0, std::ios::end);
+    const std::streamoff fileSize = stream.tellg();
+    if (fileSize < 0) return false;
+    m_lFileSize = fileSize;
+
+    std::vector<char> vecBuffer(SECTION_HASH_BUFFER_SIZE);
+    for (const auto& section : fileIndex)
+    {
+        const std::streamoff begin = section.second;
+        const auto itNext = fileSections.upper_bound(section.second);
+        const std::streamoff end = (itNext == fileSections.end() || *itNext < 0) ? fileSize : std::min<std::streamoff>(*itNext, fileSize);
+        if (begin < 0 || begin > end) return false;
+
+        stream.seekg(begin, std::ios::beg);
+        uint64_t hash = Mix64(end - begin);
+        std::streamoff remaining = end - begin;
+        while (remaining > 0)
+        {
+            // Chunks are multiples of 8 bytes, so words are hashed the same way however the section is split
+            const std::streamoff chunk = std::min<std::streamoff>(remaining, vecBuffer.size());
+            if (!stream.read(vecBuffer.data(), chunk)) return false;
+            const size_t words = chunk / sizeof(uint64_t);
+            uint64_t word;
+            for (size_t index = 0; index < words; index++)
+            {
+                std::memcpy(&word, vecBuffer.data() + index * sizeof(uint64_t), sizeof(word));
+                hash = Mix64(hash ^ word) + 0x9e3779b97f4a7c15ULL;
+            }
+            const size_t tail = chunk - words * sizeof(uint64_t);
+            if (tail > 0)
+            {
+                word = 0;
+                std::memcpy(&word, vecBuffer.data() + words * sizeof(uint64_t), tail);
+                hash = Mix64(hash ^ word ^ (uint64_t(tail) << 56));
+            }
+            remaining -= chunk;
+        }
+        m_mapHashes[section.first] = hash;
+    }
+    stream.clear();
+    stream.seekg(0, std::ios::beg);
+    return true;
+}
+
+bool SectionIndex::ChangedSections(const SectionIndex& previous, std::set<std::string>& changed) const
+{
+    changed.clear();
+    if (m_mapHashes.size() != previous.m_mapHashes.size()) return false;
+    for (const auto& section : m_mapHashes)
+    {
+        const auto it = previous.m_mapHashes.find(section.first);
+        if (it == previous.m_mapHashes.end()) return false;
+        if (it->second != section.second)
+        {
+            changed.insert(section.first);
+        }
+    }
+    return true;
+}
+
+EventChangeSet::EventChangeSet()
+    : m_bShapes(false)
+    , m_bRf(false)
+    , m_bGradients(false)
+    , m_bAdc(false)
+    , m_bExtensions(false)
+    , m_bBlocks(false)
+    , m_lChangedEvents(0)
+{
+}
+
+void EventChangeSet::Snapshot(ExternalSequence& seq, const std::set<std::string>& sections)
+{
+    m_bShapes = sections.count("[SHAPES]") > 0;
+    m_bRf = sections.count("[RF]") > 0;
+    m_bGradients = sections.count("[GRADIENTS]") > 0 || sections.count("[TRAP]") > 0;
+    m_bAdc = sections.count("[ADC]") > 0;
+    m_bExtensions = sections.count("[EXTENSIONS]") > 0;
+    // reload() reads the blocks of files older than 1.4.0 again, their durations depend on the events
+    m_bBlocks = sections.count("[BLOCKS]") > 0 || seq.GetVersion() < 1004000;
+
+    // Events are re-checked against changed shapes, so their libraries are needed as well
+    if (m_bShapes) m_mapShapes = seq.GetShapeLibrary();
+    if (m_bShapes || m_bRf) m_mapRf = seq.GetRFLibrary();
+    if (m_bShapes || m_bGradients) m_mapGrad = seq.GetGradLibrary();
+    if (m_bAdc) m_mapAdc = seq.GetADCLibrary();
+}
+
+void EventChangeSet::Compare(ExternalSequence& seq)
+{
+    m_lChangedEvents = 0;
+    m_vecRfChanged.clear();
+    m_vecGradChanged.clear();
+    m_vecAdcChanged.clear();
+
+    std::vector<char> vecShapeChanged;
+    if (m_bShapes)
+    {
+        FlagChangedIDs(m_mapShapes, seq.GetShapeLibrary(), SameShape, vecShapeChanged);
+    }
+    if (m_bShapes || m_bRf)
+    {
+        m_lChangedEvents += FlagChangedIDs(m_mapRf, seq.GetRFLibrary(), SameRf, m_vecRfChanged);
+        for (const auto& rf : seq.GetRFLibrary())
+        {
+            if (m_vecRfChanged[rf.first]) continue;
+            if (IsFlagged(vecShapeChanged, rf.second.magShape) || IsFlagged(vecShapeChanged, rf.second.phaseShape)
+                || IsFlagged(vecShapeChanged, rf.second.timeShape))
+            {
+                m_vecRfChanged[rf.first] = 1;
+                m_lChangedEvents++;
+            }
+        }
+    }
+    if (m_bShapes || m_bGradients)
+    {
+        m_lChangedEvents += FlagChangedIDs(m_mapGrad, seq.GetGradLibrary(), SameGrad, m_vecGradChanged);
+        for (const auto& grad : seq.GetGradLibrary())
+        {
+            if (m_vecGradChanged[grad.first]) continue;
+            if (IsFlagged(vecShapeChanged, grad.second.waveShape) || IsFlagged(vecShapeChanged, grad.second.timeShape))
+            {
+                m_vecGradChanged[grad.first] = 1;
+                m_lChangedEvents++;
+            }
+        }
+    }
+    if (m_bAdc)
+    {
+        m_lChangedEvents += FlagChangedIDs(m_mapAdc, seq.GetADCLibrary(), SameAdc, m_vecAdcChanged);
+    }
+
+    m_mapShapes.clear();
+    m_mapRf.clear();
+    m_mapGrad.clear();
+    m_mapAdc.clear();
+}
+
+bool EventChangeSet::IsBlockChanged(ExternalSequence& seq, const int& index, SeqBlock* pPrevious) const
+{
+    if (nullptr == pPrevious) return true;
+
+    const EventIDs& events = seq.GetBlockEvents(index);
+    if (m_bBlocks)
+    {
+        for (int event = 0; event < NUM_EVENTS; event++)
+        {
+            if (events.id[event] != pPrevious->GetEventIndex(static_cast<Event>(event))) return true;
+        }
+        if (seq.GetBlockDuration_ru(index) != pPrevious->GetDuration_ru()) return true;
+    }
+
+    if (IsFlagged(m_vecRfChanged, events.id[RF])) return true;
+    for (int channel = GX; channel <= GZ; channel++)
+    {
+        if (IsFlagged(m_vecGradChanged, events.id[channel])) return true;
+    }
+    if (IsFlagged(m_vecAdcChanged, events.id[ADC])) return true;
+    return m_bExtensions && events.id[EXT] > 0;
+}
@@ -0,0 +1,74 @@
+#ifndef INCREMENTAL_RELOAD_H
+#define INCREMENTAL_RELOAD_H
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <ExternalSequence.h>
+
+#define SECTION_HASH_BUFFER_SIZE    (1 << 20)
+
+// Content hash of every section of a sequence file. Sections are located by
+// ExternalSequence::indexFile(), a section spans from the end of its header
+// line to the end of the next header line, or to the end of the file.
+class SectionIndex
+{
+public:
+    SectionIndex();
+
+    bool Build(std::istream& stream, const std::map<std::string, int>& fileIndex, const std::set<int>& fileSections);
+
+    // Sections whose contents differ from previous. Returns false if the two
+    // files do not have the same sections, which calls for a complete load.
+    bool ChangedSections(const SectionIndex& previous, std::set<std::string>& changed) const;
+
+    inline uint64_t FileSize() const { return m_lFileSize; }
+    inline const std::map<std::string, uint64_t>& Hashes() const { return m_mapHashes; }
+
+private:
+    std::map<std::string, uint64_t>     m_mapHashes;
+    uint64_t                            m_lFileSize;
+};
+
+// Decides which blocks of a reloaded sequence have to be decoded again. The
+// libraries of the sections about to be re-parsed are saved before
+// ExternalSequence::reload() and compared afterwards. A block is decoded again
+// if its event table entry changed, if it refers to an event whose definition
+// or shapes changed, or if it has extensions and [EXTENSIONS] changed.
+class EventChangeSet
+{
+public:
+    EventChangeSet();
+
+    void Snapshot(ExternalSequence& seq, const std::set<std::string>& sections);
+    void Compare(ExternalSequence& seq);
+
+    // pPrevious is the decoded block at the same index of the previous load, nullptr if there was none
+    bool IsBlockChanged(ExternalSequence& seq, const int& index, SeqBlock* pPrevious) const;
+
+    inline uint64_t ChangedEventCount() const { return m_lChangedEvents; }
+
+private:
+    static inline bool IsFlagged(const std::vector<char>& flags, const int& id) { return id > 0 && id < (int)flags.size() && flags[id]; }
+
+    bool                                m_bShapes;
+    bool                                m_bRf;
+    bool                                m_bGradients;
+    bool                                m_bAdc;
+    bool                                m_bExtensions;
+    bool                                m_bBlocks;
+    std::map<int, CompressedShape>      m_mapShapes;
+    std::map<int, RFEvent>              m_mapRf;
+    std::map<int, GradEvent>            m_mapGrad;
+    std::map<int, ADCEvent>             m_mapAdc;
+    // Indexed by event ID
+    std::vector<char>                   m_vecRfChanged;
+    std::vector<char>                   m_vecGradChanged;
+    std::vector<char>                   m_vecAdcChanged;
+    uint64_t                            m_lChangedEvents;
+};
+
+#endif // INCREMENTAL_RELOAD_H
@@ -0,0 +1,229 @@
+#include "inflate_stream.h"
+
+#include <cstring>
+#include <iostream>
+
+#ifdef PULSEQ_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+struct InflateStreamBuf::State
+{
+#ifdef PULSEQ_HAVE_ZLIB
+    z_stream stream;
+    bool     bStreamEnd;    // the current gzip member is complete
+#endif
+};
+
+InflateStreamBuf::InflateStreamBuf(std::streambuf* pSource)
+    : m_pSource(pSource)
+    , m_spState(new State())
+    , m_vecInput(INFLATE_INPUT_SIZE)
+    , m_lInputBegin(0)
+    , m_lInputEnd(0)
+    , m_lConsumed(0)
+    , m_lProduced(0)
+    , m_bDetected(false)
+    , m_bCompressed(false)
+    , m_bSourceEnd(nullptr == pSource)
+{
+}
+
+InflateStreamBuf::~InflateStreamBuf()
+{
+#ifdef PULSEQ_HAVE_ZLIB
+    if (m_bCompressed) inflateEnd(&m_spState->stream);
+#endif
+}
+
+bool InflateStreamBuf::IsAvailable()
+{
+#ifdef PULSEQ_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool InflateStreamBuf::FillInput()
+{
+    if (m_bSourceEnd) return false;
+    // Keep what has not been consumed yet at the front
+    if (m_lInputBegin > 0)
+    {
+        std::memmove(m_vecInput.data(), m_vecInput.data() + m_lInputBegin, m_lInputEnd - m_lInputBegin);
+        m_lInputEnd -= m_lInputBegin;
+        m_lInputBegin = 0;
+    }
+    const std::streamsize count = m_pSource->sgetn(m_vecInput.data() + m_lInputEnd, m_vecInput.size() - m_lInputEnd);
+    if (count <= 0)
+    {
+        m_bSourceEnd = true;
+        return false;
+    }
+    m_lInputEnd += static_cast<size_t>(count);
+    m_lConsumed += static_cast<uint64_t>(count);
+    return true;
+}
+
+bool InflateStreamBuf::Detect()
+{
+    m_bDetected = true;
+    while (m_lInputEnd - m_lInputBegin < 2 && FillInput()) {}
+    m_bCompressed = m_lInputEnd - m_lInputBegin >= 2 &&
+                    static_cast<unsigned char>(m_vecInput[m_lInputBegin]) == 0x1f &&
+                    static_cast<unsigned char>(m_vecInput[m_lInputBegin + 1]) == 0x8b;
+    if (!m_bCompressed) return true;
+
+#ifdef PULSEQ_HAVE_ZLIB
+    m_vecOutput.resize(INFLATE_OUTPUT_SIZE);
+    std::memset(&m_spState->stream, 0, sizeof(z_stream));
+    m_spState->bStreamEnd = false;
+    // 16 selects the gzip wrapper
+    if (inflateInit2(&m_spState->stream, 15 + 16) != Z_OK)
+    {
+        m_bCompressed = false;
+        m_sError = "Failed to initialize zlib";
+        return false;
+    }
+    return true;
+#else
+    m_bCompressed = false;
+    m_sError = "gzip input is not supported, built without zlib";
+    return false;
+#endif
+}
+
+void InflateStreamBuf::SkipTrailing()
+{
+    uint64_t trailing(0);
+    bool bPadding(true);
+    do
+    {
+        for (size_t index = m_lInputBegin; index < m_lInputEnd && bPadding; index++)
+        {
+            bPadding = m_vecInput[index] == 0;
+        }
+        trailing += m_lInputEnd - m_lInputBegin;
+        m_lInputBegin = m_lInputEnd;
+    } while (FillInput());
+    if (!bPadding)
+    {
+        m_sWarning = "Ignored " + std::to_string(trailing) + " bytes after the last gzip member";
+    }
+}
+
+std::streamsize InflateStreamBuf::Inflate()
+{
+#ifdef PULSEQ_HAVE_ZLIB
+    z_stream& stream = m_spState->stream;
+    while (true)
+    {
+        if (m_spState->bStreamEnd)
+        {
+            // Another gzip member may follow. Zero padding of tape and archive tools is
+            // skipped like gzip does, other trailing bytes are skipped with a warning.
+            while (m_lInputEnd - m_lInputBegin < 2 && FillInput()) {}
+            if (m_lInputEnd - m_lInputBegin < 2 ||
+                static_cast<unsigned char>(m_vecInput[m_lInputBegin]) != 0x1f ||
+                static_cast<unsigned char>(m_vecInput[m_lInputBegin + 1]) != 0x8b)
+            {
+                SkipTrailing();
+                return 0;
+            }
+            inflateReset(&stream);
+            m_spState->bStreamEnd = false;
+        }
+        // zlib may still hold output of earlier input, so an empty input is passed on as well
+        if (m_lInputBegin == m_lInputEnd) FillInput();
+
+        stream.next_in = reinterpret_cast<Bytef*>(m_vecInput.data() + m_lInputBegin);
+        stream.avail_in = static_cast<uInt>(m_lInputEnd - m_lInputBegin);
+        stream.next_out = reinterpret_cast<Bytef*>(m_vecOutput.data());
+        stream.avail_out = static_cast<uInt>(m_vecOutput.size());
+        const int ret = inflate(&stream, Z_NO_FLUSH);
+        m_lInputBegin = m_lInputEnd - stream.avail_in;
+        const std::streamsize produced = static_cast<std::streamsize>(m_vecOutput.size() - stream.avail_out);
+
+        if (ret == Z_STREAM_END)
+        {
+            m_spState->bStreamEnd = true;
+        }
+        else if (ret != Z_OK && ret != Z_BUF_ERROR)
+        {
+            m_sError = std::string("Corrupt compressed data: ") + (nullptr != stream.msg ? stream.msg : "unknown error");
+            return 0;
+        }
+        if (produced > 0) return produced;
+        if (ret == Z_BUF_ERROR && m_bSourceEnd)
+        {
+            m_sError = "Compressed data is truncated";
+            return 0;
+        }
+    }
+#else
+    return 0;
+#endif
+}
+
+InflateStreamBuf::int_type InflateStreamBuf::underflow()
+{
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    if (!m_bDetected && !Detect()) return traits_type::eof();
+
+    if (!m_bCompressed)
+    {
+        // Plain text is handed out straight from the input buffer
+        if (m_lInputBegin == m_lInputEnd)
+        {
+            m_lInputBegin = m_lInputEnd = 0;
+            if (!FillInput()) return traits_type::eof();
+        }
+        char* pBegin = m_vecInput.data() + m_lInputBegin;
+        char* pEnd = m_vecInput.data() + m_lInputEnd;
+        m_lProduced += static_cast<uint64_t>(pEnd - pBegin);
+        m_lInputBegin = m_lInputEnd;
+        setg(pBegin, pBegin, pEnd);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    const std::streamsize produced = Inflate();
+    if (produced <= 0) return traits_type::eof();
+    m_lProduced += static_cast<uint64_t>(produced);
+    setg(m_vecOutput.data(), m_vecOutput.data(), m_vecOutput.data() + produced);
+    return traits_type::to_int_type(*gptr());
+}
+
+SequenceInput::SequenceInput()
+    : m_stream(nullptr)
+{
+}
+
+bool SequenceInput::Open(const std::string& sFilePath)
+{
+    std::streambuf* pSource = nullptr;
+    if (sFilePath == "-")
+    {
+        pSource = std::cin.rdbuf();
+    }
+    else
+    {
+        if (nullptr == m_file.open(sFilePath.c_str(), std::ios::in | std::ios::binary)) return false;
+        pSource = &m_file;
+    }
+    m_spInflate.reset(new InflateStreamBuf(pSource));
+    m_stream.rdbuf(m_spInflate.get());
+    return m_stream.good();
+}
+
+bool SequenceInput::Load(ExternalSequence& sequence, const std::string& sFilePath)
+{
+    return Open(sFilePath) && sequence.loadSequential(m_stream) && Error().empty();
+}
+
+bool SequenceInput::IsSequentialPath(const std::string& sFilePath)
+{
+    static const std::string sSuffix(".seq.gz");
+    return sFilePath == "-" ||
+           (sFilePath.size() >= sSuffix.size() && sFilePath.compare(sFilePath.size() - sSuffix.size(), sSuffix.size(), sSuffix) == 0);
+}
@@ -0,0 +1,96 @@
+#ifndef INFLATE_STREAM_H
+#define INFLATE_STREAM_H
+
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <ExternalSequence.h>
+
+#define INFLATE_INPUT_SIZE          (1 << 16)
+#define INFLATE_OUTPUT_SIZE         (1 << 18)
+
+// Forward-only reader that decompresses gzip on the fly. Whether the source
+// is compressed is decided from its first two bytes, plain text is passed
+// through unchanged. Concatenated gzip members are read one after another,
+// zero padding after the last member is skipped and other bytes are skipped
+// with a warning.
+// Seeking is not supported, the stream is meant for
+// ExternalSequence::loadSequential().
+class InflateStreamBuf : public std::streambuf
+{
+public:
+    explicit InflateStreamBuf(std::streambuf* pSource);
+    ~InflateStreamBuf() override;
+
+    InflateStreamBuf(const InflateStreamBuf&) = delete;
+    InflateStreamBuf& operator=(const InflateStreamBuf&) = delete;
+
+    inline bool IsCompressed() const { return m_bCompressed; }
+    // Empty unless the compressed data is corrupt or truncated
+    inline const std::string& Error() const { return m_sError; }
+    // Empty unless bytes other than zero padding followed the last gzip member
+    inline const std::string& Warning() const { return m_sWarning; }
+    // Bytes read from the source and handed to the parser so far
+    inline uint64_t CompressedBytes() const { return m_lConsumed; }
+    inline uint64_t DecompressedBytes() const { return m_lProduced; }
+
+    static bool IsAvailable();
+
+protected:
+    int_type underflow() override;
+
+private:
+    bool Detect();
+    bool FillInput();
+    std::streamsize Inflate();
+    // Consumes the source after the last gzip member
+    void SkipTrailing();
+
+    struct State;
+    std::streambuf*                     m_pSource;
+    std::unique_ptr<State>              m_spState;
+    std::vector<char>                   m_vecInput;
+    std::vector<char>                   m_vecOutput;
+    size_t                              m_lInputBegin;
+    size_t                              m_lInputEnd;
+    uint64_t                            m_lConsumed;
+    uint64_t                            m_lProduced;
+    bool                                m_bDetected;
+    bool                                m_bCompressed;
+    bool                                m_bSourceEnd;
+    std::string                         m_sError;
+    std::string                         m_sWarning;
+};
+
+// A sequence file, possibly gzip compressed, or standard input for "-",
+// opened for ExternalSequence::loadSequential()
+class SequenceInput
+{
+public:
+    SequenceInput();
+
+    bool Open(const std::string& sFilePath);
+    // Opens the file and parses it sequentially, a corrupt stream fails the load
+    // even if the parser stopped at a section boundary
+    bool Load(ExternalSequence& sequence, const std::string& sFilePath);
+    inline std::istream& Stream() { return m_stream; }
+    // Why the stream ended early, empty if it did not
+    inline std::string Error() const { return nullptr != m_spInflate ? m_spInflate->Error() : std::string(); }
+    inline std::string Warning() const { return nullptr != m_spInflate ? m_spInflate->Warning() : std::string(); }
+    inline bool IsCompressed() const { return nullptr != m_spInflate && m_spInflate->IsCompressed(); }
+
+    // .seq.gz, or "-" for standard input
+    static bool IsSequentialPath(const std::string& sFilePath);
+
+private:
+    std::filebuf                        m_file;
+    std::unique_ptr<InflateStreamBuf>   m_spInflate;
+    std::istream                        m_stream;
+};
+
+#endif // INFLATE_STREAM_H
@@ -0,0 +1,340 @@
+#include "label_table.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <sstream>
+
+static const char* kColumnNames[LABEL_COLUMN_NUM] = {
+    "SLC", "SEG", "REP", "AVG", "ECO", "PHS", "SET", "ACQ", "LIN", "PAR", "ONCE",
+    "NAV", "REV", "SMS", "REF", "IMA", "NOISE", "PMC", "NOPOS", "NOROT", "NOSCL"
+};
+
+// Per column either "set to value" or "add value"; composes associatively
+struct LabelTransform
+{
+    int32_t value[LABEL_COLUMN_NUM];
+    bool bSet[LABEL_COLUMN_NUM];
+
+    LabelTransform()
+    {
+        std::fill(value, value + LABEL_COLUMN_NUM, 0);
+        std::fill(bSet, bSet + LABEL_COLUMN_NUM, false);
+    }
+};
+
+// Column of a label event, -1 if it targets nothing known
+static int EventColumn(const LabelEvent& label, bool& bFlag)
+{
+    bFlag = label.flagVal.first >= 0 && label.flagVal.first < NUM_FLAGS;
+    if (bFlag) return NUM_LABELS + label.flagVal.first;
+    if (label.numVal.first >= 0 && label.numVal.first < NUM_LABELS) return label.numVal.first;
+    return -1;
+}
+
+// Applies the label events of one block to a transform or a plain state (bSet ignored)
+static void ApplyBlock(SeqBlock* pBlock, int32_t* pValue, bool* pSet, uint32_t& usedMask)
+{
+    bool bFlag(false);
+    for (const LabelEvent& label : pBlock->GetLabelSetEvents())
+    {
+        const int column = EventColumn(label, bFlag);
+        if (column < 0) continue;
+        pValue[column] = bFlag ? static_cast<int32_t>(label.flagVal.second) : label.numVal.second;
+        if (pSet) pSet[column] = true;
+        usedMask |= 1u << column;
+    }
+    for (const LabelEvent& label : pBlock->GetLabelIncEvents())
+    {
+        const int column = EventColumn(label, bFlag);
+        if (column < 0 || bFlag) continue;
+        pValue[column] += label.numVal.second;
+        usedMask |= 1u << column;
+    }
+}
+
+std::shared_ptr<LabelTable> LabelTable::Evaluate(const std::vector<SeqBlock*>& blocks)
+{
+    std::shared_ptr<LabelTable> spTable = std::make_shared<LabelTable>();
+    spTable->m_vecColumns.resize(LABEL_COLUMN_NUM);
+    spTable->m_vecIndex.resize(LABEL_COLUMN_NUM);
+
+    // Reduce every chunk to its transform and ADC count
+    const size_t chunks = ParallelChunkCount(0, blocks.size(), LABEL_SCAN_MIN_CHUNK);
+    std::vector<LabelTransform> vecTransforms(chunks);
+    std::vector<uint64_t> vecAdcOffsets(chunks + 1, 0);
+    std::vector<uint32_t> vecUsedMasks(chunks, 0);
+    ParallelFor(0, blocks.size(), LABEL_SCAN_MIN_CHUNK, [&](size_t chunk, size_t begin, size_t end) {
+        LabelTransform& transform = vecTransforms[chunk];
+        uint64_t adcs(0);
+        for (size_t block = begin; block < end; block++)
+        {
+            if (blocks[block]->isLabel()) ApplyBlock(blocks[block], transform.value, transform.bSet, vecUsedMasks[chunk]);
+            if (blocks[block]->isADC()) adcs++;
+        }
+        vecAdcOffsets[chunk + 1] = adcs;
+    });
+
+    // Sequential prefix over the chunks, starting from all labels zero
+    std::vector<LabelTransform> vecStartStates(chunks);
+    uint32_t usedMask(0);
+    for (size_t chunk = 0; chunk < chunks; chunk++)
+    {
+        usedMask |= vecUsedMasks[chunk];
+        vecAdcOffsets[chunk + 1] += vecAdcOffsets[chunk];
+        if (chunk + 1 == chunks) break;
+        for (int column = 0; column < LABEL_COLUMN_NUM; column++)
+        {
+            const LabelTransform& transform = vecTransforms[chunk];
+            vecStartStates[chunk + 1].value[column] = transform.bSet[column]
+                ? transform.value[column]
+                : vecStartStates[chunk].value[column] + transform.value[column];
+        }
+    }
+
+    const uint64_t adcNum = chunks > 0 ? vecAdcOffsets[chunks] : 0;
+    spTable->m_vecAdcBlock.resize(adcNum);
+    std::vector<int> vecUsedColumns;
+    for (int column = 0; column < LABEL_COLUMN_NUM; column++)
+    {
+        if (usedMask & (1u << column))
+        {
+            spTable->m_vecColumns[column].resize(adcNum);
+            vecUsedColumns.push_back(column);
+        }
+    }
+
+    // Replay every chunk from its start state and record the state of each ADC
+    ParallelFor(0, blocks.size(), LABEL_SCAN_MIN_CHUNK, [&](size_t chunk, size_t begin, size_t end) {
+        int32_t state[LABEL_COLUMN_NUM];
+        std::copy(vecStartStates[chunk].value, vecStartStates[chunk].value + LABEL_COLUMN_NUM, state);
+        uint32_t mask(0);
+        uint64_t adc = vecAdcOffsets[chunk];
+        for (size_t block = begin; block < end; block++)
+        {
+            if (blocks[block]->isLabel()) ApplyBlock(blocks[block], state, nullptr, mask);
+            if (!blocks[block]->isADC()) continue;
+            spTable->m_vecAdcBlock[adc] = block;
+            for (const int& column : vecUsedColumns)
+            {
+                spTable->m_vecColumns[column][adc] = state[column];
+            }
+            adc++;
+        }
+    });
+
+    spTable->BuildIndex();
+    return spTable;
+}
+
+void LabelTable::BuildIndex()
+{
+    const uint64_t adcNum = AdcCount();
+    if (adcNum == 0 || adcNum > std::numeric_limits<uint32_t>::max()) return;
+
+    // One column per task, counting sort keeps the ADCs of a value in sequence order
+    ParallelFor(0, LABEL_COLUMN_NUM, 1, [&](size_t, size_t begin, size_t end) {
+        for (size_t column = begin; column < end; column++)
+        {
+            if (!IsColumnUsed(static_cast<int>(column))) continue;
+            const std::vector<int32_t>& vecValues = m_vecColumns[column];
+            ColumnIndex& index = m_vecIndex[column];
+            const auto range = std::minmax_element(vecValues.begin(), vecValues.end());
+            const int64_t minValue = *range.first;
+            const uint64_t span = static_cast<uint64_t>(static_cast<int64_t>(*range.second) - minValue) + 1;
+
+            index.adcs.resize(adcNum);
+            if (span <= 4 * adcNum + 1024)
+            {
+                std::vector<uint64_t> vecCounts(span + 1, 0);
+                for (const int32_t& value : vecValues) vecCounts[value - minValue + 1]++;
+                for (uint64_t value = 0; value < span; value++)
+                {
+                    const uint64_t count = vecCounts[value + 1];
+                    vecCounts[value + 1] += vecCounts[value];
+                    if (count == 0) continue;
+                    index.values.push_back(static_cast<int32_t>(minValue + value));
+                    index.offsets.push_back(vecCounts[value]);
+                }
+                std::vector<uint64_t> vecNext(vecCounts.begin(), vecCounts.end() - 1);
+                for (uint64_t adc = 0; adc < adcNum; adc++)
+                {
+                    index.adcs[vecNext[vecValues[adc] - minValue]++] = static_cast<uint32_t>(adc);
+                }
+            }
+            else
+            {
+                for (uint64_t adc = 0; adc < adcNum; adc++) index.adcs[adc] = static_cast<uint32_t>(adc);
+                std::stable_sort(index.adcs.begin(), index.adcs.end(), [&vecValues](const uint32_t& a, const uint32_t& b) {
+                    return vecValues[a] < vecValues[b];
+                });
+                for (uint64_t position = 0; position < adcNum; position++)
+                {
+                    const int32_t value = vecValues[index.adcs[position]];
+                    if (index.values.empty() || index.values.back() != value)
+                    {
+                        index.values.push_back(value);
+                        index.offsets.push_back(position);
+                    }
+                }
+            }
+            index.offsets.push_back(adcNum);
+        }
+    });
+}
+
+std::string LabelTable::ColumnName(const int& column)
+{
+    return column >= 0 && column < LABEL_COLUMN_NUM ? kColumnNames[column] : "";
+}
+
+int LabelTable::ColumnFromName(const std::string& sName)
+{
+    std::string sUpper(sName);
+    std::transform(sUpper.begin(), sUpper.end(), sUpper.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    for (int column = 0; column < LABEL_COLUMN_NUM; column++)
+    {
+        if (sUpper == kColumnNames[column]) return column;
+    }
+    return -1;
+}
+
+bool LabelTable::ParseQuery(const std::string& sQuery, std::vector<LabelQueryTerm>& terms, std::string& sError)
+{
+    // Terms are "NAME=VALUE" or a bare flag name, separated by commas or spaces
+    terms.clear();
+    std::string sNormalized(sQuery);
+    std::replace(sNormalized.begin(), sNormalized.end(), ',', ' ');
+    std::istringstream stream(sNormalized);
+    std::string sTerm;
+    while (stream >> sTerm)
+    {
+        const size_t separator = sTerm.find('=');
+        LabelQueryTerm term;
+        term.column = ColumnFromName(sTerm.substr(0, separator));
+        if (term.column < 0)
+        {
+            sError = "Unknown label: " + sTerm.substr(0, separator);
+            return false;
+        }
+        if (separator == std::string::npos)
+        {
+            if (term.column < NUM_LABELS)
+            {
+                sError = "Missing value for label " + sTerm;
+                return false;
+            }
+            term.value = 1;
+        }
+        else
+        {
+            const std::string sValue = sTerm.substr(separator + 1);
+            size_t parsed(0);
+            try
+            {
+                term.value = std::stoi(sValue, &parsed);
+            }
+            catch (...)
+            {
+                parsed = 0;
+            }
+            if (sValue.empty() || parsed != sValue.size())
+            {
+                sError = "Invalid value in " + sTerm;
+                return false;
+            }
+        }
+        terms.push_back(term);
+    }
+    if (terms.empty())
+    {
+        sError = "No labels given";
+        return false;
+    }
+    return true;
+}
+
+int64_t LabelTable::FindAdcInBlock(const uint64_t& block) const
+{
+    const auto it = std::lower_bound(m_vecAdcBlock.begin(), m_vecAdcBlock.end(), block);
+    if (it == m_vecAdcBlock.end() || *it != block) return -1;
+    return it - m_vecAdcBlock.begin();
+}
+
+std::string LabelTable::Describe(const uint64_t& adc) const
+{
+    std::ostringstream text;
+    for (int column = 0; column < LABEL_COLUMN_NUM; column++)
+    {
+        if (!IsColumnUsed(column)) continue;
+        const int32_t value = m_vecColumns[column][adc];
+        if (column >= NUM_LABELS && value == 0) continue;
+        if (text.tellp() > 0) text << " ";
+        text << kColumnNames[column];
+        if (column < NUM_LABELS) text << "=" << value;
+    }
+    return text.str();
+}
+
+std::vector<uint64_t> LabelTable::Query(const std::vector<LabelQueryTerm>& terms) const
+{
+    std::vector<uint64_t> vecResult;
+    const uint64_t adcNum = AdcCount();
+    if (adcNum == 0) return vecResult;
+
+    // Columns never touched are zero everywhere
+    std::vector<LabelQueryTerm> vecTerms;
+    for (const LabelQueryTerm& term : terms)
+    {
+        if (IsColumnUsed(term.column)) vecTerms.push_back(term);
+        else if (term.value != 0) return vecResult;
+    }
+    if (vecTerms.empty())
+    {
+        vecResult.resize(adcNum);
+        for (uint64_t adc = 0; adc < adcNum; adc++) vecResult[adc] = adc;
+        return vecResult;
+    }
+
+    auto matchesAll = [&](const uint64_t& adc) {
+        for (const LabelQueryTerm& term : vecTerms)
+        {
+            if (m_vecColumns[term.column][adc] != term.value) return false;
+        }
+        return true;
+    };
+
+    if (m_vecIndex[vecTerms.front().column].offsets.empty())
+    {
+        // No index (more ADCs than it can address), scan
+        for (uint64_t adc = 0; adc < adcNum; adc++)
+        {
+            if (matchesAll(adc)) vecResult.push_back(adc);
+        }
+        return vecResult;
+    }
+
+    // Walk the shortest posting list and check the remaining terms directly
+    const uint32_t* pBegin(nullptr);
+    const uint32_t* pEnd(nullptr);
+    for (const LabelQueryTerm& term : vecTerms)
+    {
+        const ColumnIndex& index = m_vecIndex[term.column];
+        const auto it = std::lower_bound(index.values.begin(), index.values.end(), term.value);
+        if (it == index.values.end() || *it != term.value) return vecResult;
+        const size_t position = it - index.values.begin();
+        const uint32_t* pFirst = index.adcs.data() + index.offsets[position];
+        const uint32_t* pLast = index.adcs.data() + index.offsets[position + 1];
+        if (pBegin == nullptr || pLast - pFirst < pEnd - pBegin)
+        {
+            pBegin = pFirst;
+            pEnd = pLast;
+        }
+    }
+    for (const uint32_t* pAdc = pBegin; pAdc != pEnd; pAdc++)
+    {
+        if (matchesAll(*pAdc)) vecResult.push_back(*pAdc);
+    }
+    return vecResult;
+}
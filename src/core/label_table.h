@@ -0,0 +1,64 @@
+#ifndef LABEL_TABLE_H
+#define LABEL_TABLE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ExternalSequence.h>
+
+// Numeric labels (SLC ... ONCE) come first, followed by the flags (NAV ... NOSCL)
+#define LABEL_COLUMN_NUM        (NUM_LABELS + NUM_FLAGS)
+#define LABEL_SCAN_MIN_CHUNK    (4096)
+
+struct LabelQueryTerm
+{
+    int column;
+    int32_t value;
+};
+
+// Label state seen by every ADC of a sequence. Within a block labelset events
+// are applied before labelinc events, and an ADC sees the labels of its own
+// block. As set and inc compose associatively, the state is evaluated as a
+// chunked parallel scan: every chunk first reduces its blocks to one
+// set/inc transform, the chunk start states follow from a short sequential
+// prefix, then all chunks replay their blocks in parallel. Only columns that
+// are ever touched are stored, one value per ADC.
+class LabelTable
+{
+public:
+    static std::shared_ptr<LabelTable> Evaluate(const std::vector<SeqBlock*>& blocks);
+
+    static std::string ColumnName(const int& column);
+    static int ColumnFromName(const std::string& sName);
+    static bool ParseQuery(const std::string& sQuery, std::vector<LabelQueryTerm>& terms, std::string& sError);
+
+    inline uint64_t AdcCount() const { return m_vecAdcBlock.size(); }
+    inline uint64_t AdcBlock(const uint64_t& adc) const { return m_vecAdcBlock[adc]; }
+    inline bool IsColumnUsed(const int& column) const { return !m_vecColumns[column].empty(); }
+    inline int32_t Value(const uint64_t& adc, const int& column) const { return IsColumnUsed(column) ? m_vecColumns[column][adc] : 0; }
+
+    // ADC index of the given block, -1 if the block has no ADC
+    int64_t FindAdcInBlock(const uint64_t& block) const;
+    // Used numeric labels and the flags that are set, e.g. "SLC=3 LIN=64 REV"
+    std::string Describe(const uint64_t& adc) const;
+    // ADCs matching all terms, in sequence order
+    std::vector<uint64_t> Query(const std::vector<LabelQueryTerm>& terms) const;
+
+private:
+    // ADCs of one column sorted by (value, ADC), grouped by distinct value
+    struct ColumnIndex
+    {
+        std::vector<int32_t>    values;
+        std::vector<uint64_t>   offsets;    // values + 1 entries
+        std::vector<uint32_t>   adcs;
+    };
+
+    void BuildIndex();
+
+    std::vector<uint64_t>               m_vecAdcBlock;
+    std::vector<std::vector<int32_t>>   m_vecColumns;   // LABEL_COLUMN_NUM entries, empty if never touched
+    std::vector<ColumnIndex>            m_vecIndex;     // LABEL_COLUMN_NUM entries
+};
+
+#endif // LABEL_TABLE_H
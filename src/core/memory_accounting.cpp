@@ -0,0 +1,133 @@
+#include "memory_accounting.h"
+
+#include <algorithm>
+#include <cstdio>
+
+MemoryLedger::MemoryLedger()
+    : m_lPeakTotal(0)
+{
+}
+
+void MemoryLedger::Report(const std::string& sComponent, const uint64_t& bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find_if(m_vecEntries.begin(), m_vecEntries.end(), [&sComponent](const MemoryEntry& entry) { return entry.component == sComponent; });
+    if (it == m_vecEntries.end())
+    {
+        m_vecEntries.push_back({sComponent, bytes, bytes});
+    }
+    else
+    {
+        it->bytes = bytes;
+        it->peak = std::max(it->peak, bytes);
+    }
+
+    uint64_t total(0);
+    for (const MemoryEntry& entry : m_vecEntries)
+    {
+        total += entry.bytes;
+    }
+    m_lPeakTotal = std::max(m_lPeakTotal, total);
+}
+
+void MemoryLedger::ResetPeaks()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lPeakTotal = 0;
+    for (MemoryEntry& entry : m_vecEntries)
+    {
+        entry.peak = entry.bytes;
+        m_lPeakTotal += entry.bytes;
+    }
+}
+
+std::vector<MemoryEntry> MemoryLedger::Entries() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_vecEntries;
+}
+
+uint64_t MemoryLedger::Total() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t total(0);
+    for (const MemoryEntry& entry : m_vecEntries)
+    {
+        total += entry.bytes;
+    }
+    return total;
+}
+
+uint64_t MemoryLedger::PeakTotal() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lPeakTotal;
+}
+
+std::string MemoryLedger::FormatBytes(const uint64_t& bytes)
+{
+    static const char* units[] = {"B", "kB", "MB", "GB", "TB"};
+    double value = static_cast<double>(bytes);
+    int unit = 0;
+    while (value >= 1024. && unit < 4)
+    {
+        value /= 1024.;
+        unit++;
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), unit == 0 ? "%.0f %s" : "%.1f %s", value, units[unit]);
+    return buffer;
+}
+
+uint64_t MemoryEstimator::ShapeLibrary(ExternalSequence& seq)
+{
+    const std::map<int, CompressedShape>& shapes = seq.GetShapeLibrary();
+    uint64_t bytes = MapBytes(shapes);
+    for (const auto& shape : shapes)
+    {
+        bytes += shape.second.samples.capacity() * sizeof(float);
+    }
+    return bytes;
+}
+
+uint64_t MemoryEstimator::EventLibraries(ExternalSequence& seq)
+{
+    return MapBytes(seq.GetRFLibrary()) + MapBytes(seq.GetGradLibrary()) + MapBytes(seq.GetADCLibrary());
+}
+
+uint64_t MemoryEstimator::BlockTable(ExternalSequence& seq)
+{
+    return static_cast<uint64_t>(seq.GetNumberOfBlocks()) * (sizeof(EventIDs) + sizeof(long));
+}
+
+uint64_t MemoryEstimator::DecodedBlock(SeqBlock* pBlock)
+{
+    if (nullptr == pBlock) return 0;
+    uint64_t bytes = sizeof(SeqBlock);
+    if (pBlock->isRF())
+    {
+        // Amplitude and phase
+        bytes += 2 * static_cast<uint64_t>(pBlock->GetRFLength()) * sizeof(float);
+    }
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        bytes += static_cast<uint64_t>(pBlock->GetArbGradNumSamples(channel)) * sizeof(float);
+        if (pBlock->isExtTrapGradient(channel))
+        {
+            bytes += pBlock->GetExtTrapGradTimes(channel).capacity() * sizeof(long);
+            bytes += pBlock->GetExtTrapGradShape(channel).capacity() * sizeof(float);
+        }
+    }
+    bytes += (pBlock->GetLabelSetEvents().capacity() + pBlock->GetLabelIncEvents().capacity()) * sizeof(LabelEvent);
+    return bytes;
+}
+
+uint64_t MemoryEstimator::DecodedBlocks(const std::vector<SeqBlock*>& blocks)
+{
+    uint64_t bytes = blocks.capacity() * sizeof(SeqBlock*);
+    for (SeqBlock* pBlock : blocks)
+    {
+        bytes += DecodedBlock(pBlock);
+    }
+    return bytes;
+}
@@ -0,0 +1,64 @@
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ExternalSequence.h>
+
+// Bytes a std::map node needs besides its value: colour, parent and two children
+#define MAP_NODE_OVERHEAD       (4 * sizeof(void*))
+
+struct MemoryEntry
+{
+    std::string component;
+    uint64_t bytes;
+    uint64_t peak;
+};
+
+// Current and peak bytes per component, as reported by its owner. Components
+// keep the order in which they were first reported. Thread-safe.
+class MemoryLedger
+{
+public:
+    MemoryLedger();
+
+    void Report(const std::string& sComponent, const uint64_t& bytes);
+    void ResetPeaks();
+
+    std::vector<MemoryEntry> Entries() const;
+    uint64_t Total() const;
+    uint64_t PeakTotal() const;
+
+    // e.g. "12.3 MB"
+    static std::string FormatBytes(const uint64_t& bytes);
+
+private:
+    mutable std::mutex                  m_mutex;
+    std::vector<MemoryEntry>            m_vecEntries;
+    uint64_t                            m_lPeakTotal;
+};
+
+// Size reports of the parser and decoder containers. Containers are counted by
+// their elements and node overheads, allocator headers are not included.
+class MemoryEstimator
+{
+public:
+    static uint64_t ShapeLibrary(ExternalSequence& seq);
+    // RF, gradient and ADC definitions
+    static uint64_t EventLibraries(ExternalSequence& seq);
+    // Event IDs and durations of every block
+    static uint64_t BlockTable(ExternalSequence& seq);
+    static uint64_t DecodedBlock(SeqBlock* pBlock);
+    static uint64_t DecodedBlocks(const std::vector<SeqBlock*>& blocks);
+
+    template <typename K, typename V>
+    static uint64_t MapBytes(const std::map<K, V>& map)
+    {
+        return map.size() * (sizeof(typename std::map<K, V>::value_type) + MAP_NODE_OVERHEAD);
+    }
+};
+
+#endif // MEMORY_ACCOUNTING_H
@@ -0,0 +1,55 @@
+#include "message_log.h"
+
+#include <algorithm>
+
+MessageLog::MessageLog(const size_t& capacity)
+    : m_lCapacity(capacity)
+    , m_lCount{}
+    , m_lDropped(0)
+{
+}
+
+void MessageLog::Write(MessageType level, const std::string& str)
+{
+    const int index = std::min(std::max(static_cast<int>(level), static_cast<int>(ERROR_MSG)), static_cast<int>(DEBUG_LOW_LEVEL)) - ERROR_MSG;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lCount[index]++;
+    if (m_vecMessages.size() >= m_lCapacity)
+    {
+        m_lDropped++;
+        return;
+    }
+    m_vecMessages.push_back(LoggedMessage{level, str});
+}
+
+std::vector<LoggedMessage> MessageLog::Take()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<LoggedMessage> vecMessages;
+    vecMessages.swap(m_vecMessages);
+    return vecMessages;
+}
+
+uint64_t MessageLog::Count(const MessageType& level) const
+{
+    if (level < ERROR_MSG || level > DEBUG_LOW_LEVEL) return 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lCount[level - ERROR_MSG];
+}
+
+uint64_t MessageLog::Dropped() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lDropped;
+}
+
+ScopedMessageSink::ScopedMessageSink(ExternalSequence& seq, MessageSink* pSink, const MessageType& level)
+    : m_seq(seq)
+{
+    m_seq.SetMessageSink(pSink, level);
+}
+
+ScopedMessageSink::~ScopedMessageSink()
+{
+    m_seq.SetMessageSink(nullptr, MSG_LEVEL);
+}
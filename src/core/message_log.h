@@ -0,0 +1,55 @@
+#ifndef MESSAGE_LOG_H
+#define MESSAGE_LOG_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ExternalSequence.h>
+
+#define MESSAGE_LOG_CAPACITY         (1000)      // messages kept per log, later ones are only counted
+
+struct LoggedMessage
+{
+    MessageType level;
+    std::string text;
+};
+
+// Parser messages of one sequence. Every loader owns its own log, so loads
+// running side by side neither share a print function nor interleave their
+// output. Write() may be called from the decoding threads.
+class MessageLog : public MessageSink
+{
+public:
+    explicit MessageLog(const size_t& capacity = MESSAGE_LOG_CAPACITY);
+
+    void Write(MessageType level, const std::string& str) override;
+
+    // Messages in arrival order, the log is empty afterwards
+    std::vector<LoggedMessage> Take();
+    uint64_t Count(const MessageType& level) const;
+    uint64_t Dropped() const;
+
+private:
+    mutable std::mutex          m_mutex;
+    size_t                      m_lCapacity;
+    std::vector<LoggedMessage>  m_vecMessages;
+    uint64_t                    m_lCount[DEBUG_LOW_LEVEL - ERROR_MSG + 1];
+    uint64_t                    m_lDropped;
+};
+
+// Routes the messages of a sequence to a sink for the lifetime of the guard
+class ScopedMessageSink
+{
+public:
+    ScopedMessageSink(ExternalSequence& seq, MessageSink* pSink, const MessageType& level = MSG_LEVEL);
+    ~ScopedMessageSink();
+
+    ScopedMessageSink(const ScopedMessageSink&) = delete;
+    ScopedMessageSink& operator=(const ScopedMessageSink&) = delete;
+
+private:
+    ExternalSequence& m_seq;
+};
+
+#endif // MESSAGE_LOG_H
@@ -0,0 +1,8 @@
+#ifndef MR_CONSTANTS_H
+#define MR_CONSTANTS_H
+
+// Gyromagnetic ratio of 1H, used to convert between Pulseq units (Hz, Hz/m)
+// and physical units (T, T/m)
+#define GAMMA_HZ_T                   (42.576e6)
+
+#endif // MR_CONSTANTS_H
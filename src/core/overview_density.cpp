@@ -0,0 +1,118 @@
+#include "overview_density.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+// Adds value * overlap to every column overlapping [start_us, end_us)
+static void AddSpan(std::vector<float>& vecLevel, const double& column_us, const double& start_us, const double& end_us, const double& value)
+{
+    if (end_us <= start_us || value <= 0.) return;
+    const size_t last = vecLevel.size() - 1;
+    const size_t first = std::min(last, static_cast<size_t>(std::max(0., start_us / column_us)));
+    const size_t final = std::min(last, static_cast<size_t>(std::max(0., end_us / column_us)));
+    for (size_t column = first; column <= final; column++)
+    {
+        const double overlap_us = std::min(end_us, (column + 1) * column_us) - std::max(start_us, column * column_us);
+        if (overlap_us > 0.) vecLevel[column] += static_cast<float>(overlap_us * value);
+    }
+}
+
+static double PeakOf(const float* pShape, const size_t& count)
+{
+    double peak(0.);
+    for (size_t index = 0; index < count; index++)
+    {
+        peak = std::max(peak, static_cast<double>(std::fabs(pShape[index])));
+    }
+    return peak;
+}
+
+// Scaled peak of a shaped event, searched once per event ID as blocks reuse their events
+static double EventPeak(std::unordered_map<int, double>& mapPeaks, const int& eventID, const double& amplitude,
+                        const float* pShape, const size_t& count)
+{
+    if (eventID <= 0) return std::fabs(amplitude) * PeakOf(pShape, count);
+    std::unordered_map<int, double>::const_iterator it = mapPeaks.find(eventID);
+    if (it == mapPeaks.end()) it = mapPeaks.emplace(eventID, std::fabs(amplitude) * PeakOf(pShape, count)).first;
+    return it->second;
+}
+
+void OverviewDensity::Build(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us,
+                            const double& gradRasterTime_us, const size_t& columns, OverviewImage& image)
+{
+    static const OverviewChannel gradRows[NUM_GRADS] = {kOverviewGx, kOverviewGy, kOverviewGz};
+
+    image = OverviewImage();
+    if (blocks.empty() || columns == 0 || vecBlockStart_us.size() <= blocks.size()) return;
+    image.duration_us = vecBlockStart_us[blocks.size()];
+    if (image.duration_us <= 0.) return;
+    image.columns = columns;
+    for (std::vector<float>& vecLevel : image.level)
+    {
+        vecLevel.assign(columns, 0.f);
+    }
+    const double column_us = image.duration_us / columns;
+    // Gradient events of all channels share one library
+    std::unordered_map<int, double> mapRfPeaks;
+    std::unordered_map<int, double> mapGradPeaks;
+
+    for (size_t index = 0; index < blocks.size(); index++)
+    {
+        SeqBlock* pBlock = blocks[index];
+        const double blockStart_us = vecBlockStart_us[index];
+        if (pBlock->isRF() && pBlock->GetRFLength() > 0)
+        {
+            const RFEvent& rf = pBlock->GetRFEvent();
+            const double start_us = blockStart_us + rf.delay;
+            const double peak = EventPeak(mapRfPeaks, pBlock->GetEventIndex(RF), rf.amplitude, pBlock->GetRFAmplitudePtr(), pBlock->GetRFLength());
+            AddSpan(image.level[kOverviewRf], column_us, start_us, start_us + pBlock->GetRFLength() * pBlock->GetRFDwellTime(), peak);
+        }
+
+        for (int channel = 0; channel < NUM_GRADS; channel++)
+        {
+            const GradEvent& grad = pBlock->GetGradEvent(channel);
+            double start_us = blockStart_us + grad.delay;
+            double duration_us(0.);
+            double peak(0.);
+            if (pBlock->isTrapGradient(channel))
+            {
+                duration_us = static_cast<double>(grad.rampUpTime + grad.flatTime + grad.rampDownTime);
+                peak = std::fabs(grad.amplitude);
+            }
+            else if (pBlock->isArbitraryGradient(channel))
+            {
+                duration_us = pBlock->GetArbGradNumSamples(channel) * gradRasterTime_us;
+                peak = EventPeak(mapGradPeaks, pBlock->GetEventIndex(static_cast<Event>(GX + channel)), grad.amplitude,
+                                 pBlock->GetArbGradShapePtr(channel), pBlock->GetArbGradNumSamples(channel));
+            }
+            else if (pBlock->isExtTrapGradient(channel))
+            {
+                const std::vector<long>& times = pBlock->GetExtTrapGradTimes(channel);
+                const std::vector<float>& shape = pBlock->GetExtTrapGradShape(channel);
+                if (times.empty()) continue;
+                start_us += times.front();
+                duration_us = static_cast<double>(times.back() - times.front());
+                peak = EventPeak(mapGradPeaks, pBlock->GetEventIndex(static_cast<Event>(GX + channel)), grad.amplitude, shape.data(), shape.size());
+            }
+            AddSpan(image.level[gradRows[channel]], column_us, start_us, start_us + duration_us, peak);
+        }
+
+        if (pBlock->isADC())
+        {
+            const ADCEvent& adc = pBlock->GetADCEvent();
+            const double start_us = blockStart_us + adc.delay;
+            AddSpan(image.level[kOverviewAdc], column_us, start_us, start_us + adc.numSamples * adc.dwellTime * 1e-3, 1.);
+        }
+    }
+
+    for (std::vector<float>& vecLevel : image.level)
+    {
+        const float maxLevel = *std::max_element(vecLevel.begin(), vecLevel.end());
+        if (maxLevel <= 0.f) continue;
+        for (float& level : vecLevel)
+        {
+            level /= maxLevel;
+        }
+    }
+}
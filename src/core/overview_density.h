@@ -0,0 +1,50 @@
+#ifndef OVERVIEW_DENSITY_H
+#define OVERVIEW_DENSITY_H
+
+#include <cstddef>
+#include <vector>
+#include <ExternalSequence.h>
+
+#define OVERVIEW_COLUMNS             (4096)
+
+// Rows of the overview, in lane order
+enum OverviewChannel
+{
+    kOverviewRf = 0,
+    kOverviewGz,
+    kOverviewGy,
+    kOverviewGx,
+    kOverviewAdc,
+    OVERVIEW_CHANNEL_NUM
+};
+
+// Activity of every channel over the whole sequence, one value in [0, 1]
+// per column: the time-weighted peak amplitude of the events inside the
+// column, relative to the busiest column of the channel
+struct OverviewImage
+{
+    double duration_us;
+    size_t columns;
+    std::vector<float> level[OVERVIEW_CHANNEL_NUM];
+
+    OverviewImage()
+        : duration_us(0.)
+        , columns(0)
+    {}
+
+    bool IsEmpty() const { return columns == 0 || duration_us <= 0.; }
+};
+
+// Density image for the overview strip, built once per load. Each event
+// adds its peak amplitude over its time span to the columns it overlaps, so
+// the cost is one pass over the blocks plus the columns the events cover.
+// The samples of a shaped event are only scanned the first time its event
+// ID occurs.
+class OverviewDensity
+{
+public:
+    static void Build(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us,
+                      const double& gradRasterTime_us, const size_t& columns, OverviewImage& image);
+};
+
+#endif // OVERVIEW_DENSITY_H
@@ -0,0 +1,53 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include "task_pool.h"
+
+// Number of worker threads used by the analysis kernels, those of the shared TaskPool
+inline size_t ParallelWorkerCount()
+{
+    return TaskPool::Instance().WorkerCount();
+}
+
+// Number of chunks ParallelFor() splits [begin, end) into. Callers collecting
+// per-chunk results size their buffers with the same arguments.
+inline size_t ParallelChunkCount(size_t begin, size_t end, size_t minChunk)
+{
+    if (end <= begin) return 0;
+    const size_t count = end - begin;
+    const size_t maxChunks = (count + std::max<size_t>(minChunk, 1) - 1) / std::max<size_t>(minChunk, 1);
+    return std::max<size_t>(1, std::min(ParallelWorkerCount(), maxChunks));
+}
+
+// Split [begin, end) into contiguous chunks of at least minChunk items and call
+// fn(chunkIndex, chunkBegin, chunkEnd) for each chunk. The first chunk runs on
+// the calling thread, the others are tasks of the shared TaskPool at the
+// priority of the calling task.
+template <typename Fn>
+size_t ParallelFor(size_t begin, size_t end, size_t minChunk, Fn fn)
+{
+    const size_t chunks = ParallelChunkCount(begin, end, minChunk);
+    if (chunks == 0) return 0;
+
+    const size_t count = end - begin;
+    auto chunkBegin = [&](size_t chunk) { return begin + count * chunk / chunks; };
+
+    if (chunks == 1)
+    {
+        fn(size_t(0), begin, end);
+        return 1;
+    }
+
+    TaskGroup group;
+    for (size_t chunk = 1; chunk < chunks; chunk++)
+    {
+        group.Run([&fn, chunk, b = chunkBegin(chunk), e = chunkBegin(chunk + 1)]() { fn(chunk, b, e); });
+    }
+    fn(size_t(0), chunkBegin(0), chunkBegin(1));
+    group.Wait();
+    return chunks;
+}
+
+#endif // PARALLEL_FOR_H
@@ -0,0 +1,193 @@
+#include "parse_cache.h"
+#include "inflate_stream.h"
+#include "memory_accounting.h"
+#include "message_log.h"
+
+#include <filesystem>
+
+ParsedSequence::ParsedSequence()
+    : fileSize(0)
+    , modified(0)
+    , signature(kSignatureUnsigned)
+    , parserBytes(0)
+    , blockBytes(0)
+{
+}
+
+ParsedSequence::~ParsedSequence()
+{
+    for (SeqBlock* pBlock : blocks)
+    {
+        delete pBlock;
+    }
+}
+
+ParseCache::ParseCache(const uint64_t& budget)
+    : m_lBudget(budget)
+    , m_lBytes(0)
+{
+}
+
+bool ParseCache::FileStamp(const std::string& sFilePath, uint64_t& fileSize, int64_t& modified)
+{
+    std::error_code ec;
+    fileSize = std::filesystem::file_size(sFilePath, ec);
+    if (ec) return false;
+    modified = static_cast<int64_t>(std::filesystem::last_write_time(sFilePath, ec).time_since_epoch().count());
+    return !ec;
+}
+
+std::shared_ptr<ParsedSequence> ParseCache::Parse(const std::string& sFilePath, const uint64_t& maxBytes, const std::atomic<bool>* pCancel)
+{
+    auto cancelled = [pCancel]() { return nullptr != pCancel && pCancel->load(); };
+
+    std::shared_ptr<ParsedSequence> spEntry = std::make_shared<ParsedSequence>();
+    spEntry->path = sFilePath;
+    if (!FileStamp(sFilePath, spEntry->fileSize, spEntry->modified)) return nullptr;
+    spEntry->sequence = std::make_shared<ExternalSequence>();
+    ExternalSequence& seq = *spEntry->sequence;
+
+    // Messages of a file nobody asked for yet are of no interest
+    MessageLog log(0);
+    ScopedMessageSink scopedSink(seq, &log, ERROR_MSG);
+    if (SequenceInput::IsSequentialPath(sFilePath))
+    {
+        SequenceInput input;
+        if (!input.Load(seq, sFilePath)) return nullptr;
+        spEntry->signature = seq.isSigned() ? kSignatureUnverifiable : kSignatureUnsigned;
+        spEntry->signatureType = seq.getSignatureType();
+    }
+    else
+    {
+        SignatureVerifier verifier;
+        if (!verifier.Open(sFilePath) || !seq.load(verifier.Stream())) return nullptr;
+        std::shared_ptr<SectionIndex> spSections = std::make_shared<SectionIndex>();
+        if (verifier.Stream().good() && spSections->Build(verifier.Stream(), seq.GetFileIndex(), seq.GetFileSections()))
+        {
+            spEntry->sections = spSections;
+        }
+        spEntry->signature = verifier.Verify(seq.isSigned(), seq.getSignature(), seq.getSignatureType());
+        spEntry->signatureType = seq.getSignatureType().empty() ? verifier.Type() : seq.getSignatureType();
+        spEntry->computedHash = verifier.Computed();
+    }
+    spEntry->parserBytes = MemoryEstimator::ShapeLibrary(seq) + MemoryEstimator::EventLibraries(seq) + MemoryEstimator::BlockTable(seq);
+    if (spEntry->parserBytes > maxBytes || cancelled()) return nullptr;
+
+    // Decoded blocks are the larger part, they are given up once they do not fit
+    const int blockNum = seq.GetNumberOfBlocks();
+    spEntry->blocks.reserve(blockNum);
+    spEntry->blockBytes = static_cast<uint64_t>(blockNum) * sizeof(SeqBlock*);
+    for (int index = 0; index < blockNum; index++)
+    {
+        SeqBlock* pBlock = seq.GetBlock(index);
+        spEntry->blocks.push_back(pBlock);
+        if (!seq.decodeBlock(pBlock)) return nullptr;
+        spEntry->blockBytes += MemoryEstimator::DecodedBlock(pBlock);
+        if (spEntry->Bytes() > maxBytes || ((index & 0x3ff) == 0 && cancelled()))
+        {
+            for (SeqBlock* pDecoded : spEntry->blocks)
+            {
+                delete pDecoded;
+            }
+            std::vector<SeqBlock*>().swap(spEntry->blocks);
+            spEntry->blockBytes = 0;
+            break;
+        }
+    }
+    if (cancelled()) return nullptr;
+    return spEntry;
+}
+
+std::shared_ptr<ParsedSequence> ParseCache::Take(const std::string& sFilePath)
+{
+    uint64_t fileSize(0);
+    int64_t modified(0);
+    const bool bStamped = FileStamp(sFilePath, fileSize, modified);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_listEntries.begin(); it != m_listEntries.end(); ++it)
+    {
+        if ((*it)->path != sFilePath) continue;
+        std::shared_ptr<ParsedSequence> spEntry = *it;
+        m_lBytes -= spEntry->Bytes();
+        m_listEntries.erase(it);
+        if (!bStamped || spEntry->fileSize != fileSize || spEntry->modified != modified) return nullptr;
+        return spEntry;
+    }
+    return nullptr;
+}
+
+bool ParseCache::Contains(const std::string& sFilePath) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const std::shared_ptr<ParsedSequence>& spEntry : m_listEntries)
+    {
+        if (spEntry->path == sFilePath) return true;
+    }
+    return false;
+}
+
+bool ParseCache::Insert(const std::shared_ptr<ParsedSequence>& spEntry)
+{
+    if (nullptr == spEntry) return false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const std::shared_ptr<ParsedSequence>& spOther : m_listEntries)
+    {
+        if (spOther->path == spEntry->path) return false;
+    }
+    if (m_lBytes + spEntry->Bytes() > m_lBudget) return false;
+    m_listEntries.push_back(spEntry);
+    m_lBytes += spEntry->Bytes();
+    return true;
+}
+
+void ParseCache::TrimLocked(const uint64_t& bytes)
+{
+    while (!m_listEntries.empty() && m_lBytes > bytes)
+    {
+        m_lBytes -= m_listEntries.back()->Bytes();
+        m_listEntries.pop_back();
+    }
+}
+
+void ParseCache::Trim(const uint64_t& bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    TrimLocked(bytes);
+}
+
+void ParseCache::Clear()
+{
+    Trim(0);
+}
+
+void ParseCache::SetBudget(const uint64_t& budget)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lBudget = budget;
+    TrimLocked(budget);
+}
+
+uint64_t ParseCache::Budget() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lBudget;
+}
+
+uint64_t ParseCache::Free() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lBudget > m_lBytes ? m_lBudget - m_lBytes : 0;
+}
+
+uint64_t ParseCache::Bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lBytes;
+}
+
+size_t ParseCache::Count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_listEntries.size();
+}
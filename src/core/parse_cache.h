@@ -0,0 +1,81 @@
+#ifndef PARSE_CACHE_H
+#define PARSE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ExternalSequence.h>
+#include "incremental_reload.h"
+#include "signature_verifier.h"
+
+#define PARSE_CACHE_DEFAULT_BUDGET   (512ull << 20)
+
+// A sequence file parsed ahead of time, with everything PulseqLoader would
+// get from parsing it. Blocks are owned by the entry until they are taken.
+struct ParsedSequence
+{
+    std::string path;
+    uint64_t fileSize;
+    int64_t modified;                               // last write time in ticks of the file clock
+    std::shared_ptr<ExternalSequence> sequence;
+    std::vector<SeqBlock*> blocks;                  // decoded, empty if they did not fit the budget
+    SignatureStatus signature;
+    std::string signatureType;
+    std::string computedHash;
+    std::shared_ptr<SectionIndex> sections;         // nullptr for compressed files
+    uint64_t parserBytes;
+    uint64_t blockBytes;
+
+    ParsedSequence();
+    ~ParsedSequence();
+    ParsedSequence(const ParsedSequence&) = delete;
+    ParsedSequence& operator=(const ParsedSequence&) = delete;
+
+    inline uint64_t Bytes() const { return parserBytes + blockBytes; }
+};
+
+// Parsed sequences kept in memory within a byte budget, e.g. the recent files
+// parsed while the viewer is idle. Entries keep the order they were inserted
+// in, which is their priority; trimming drops the last ones first. An entry is
+// only handed out while its file has the size and write time it was parsed
+// with. Thread-safe.
+class ParseCache
+{
+public:
+    explicit ParseCache(const uint64_t& budget = PARSE_CACHE_DEFAULT_BUDGET);
+
+    // Parses and decodes a file the way PulseqLoader does. Blocks are only kept
+    // if the whole entry fits into maxBytes, the parse alone has to fit as well.
+    // Returns nullptr if the file does not load, does not fit or pCancel is set.
+    static std::shared_ptr<ParsedSequence> Parse(const std::string& sFilePath, const uint64_t& maxBytes, const std::atomic<bool>* pCancel = nullptr);
+    static bool FileStamp(const std::string& sFilePath, uint64_t& fileSize, int64_t& modified);
+
+    // Entry of an unchanged file, which leaves the cache, nullptr otherwise
+    std::shared_ptr<ParsedSequence> Take(const std::string& sFilePath);
+    bool Contains(const std::string& sFilePath) const;
+    // Adds the entry behind the others if it fits into what is left of the budget
+    bool Insert(const std::shared_ptr<ParsedSequence>& spEntry);
+    // Drops entries from the back until at most the given bytes are held
+    void Trim(const uint64_t& bytes);
+    void Clear();
+
+    void SetBudget(const uint64_t& budget);
+    uint64_t Budget() const;
+    uint64_t Free() const;
+    uint64_t Bytes() const;
+    size_t Count() const;
+
+private:
+    void TrimLocked(const uint64_t& bytes);
+
+    mutable std::mutex                              m_mutex;
+    std::list<std::shared_ptr<ParsedSequence>>      m_listEntries;
+    uint64_t                                        m_lBudget;
+    uint64_t                                        m_lBytes;
+};
+
+#endif // PARSE_CACHE_H
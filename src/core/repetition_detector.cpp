@@ -0,0 +1,68 @@
+#include "repetition_detector.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+
+// Periods covering at least this share of the best coverage count as equally good
+#define REPETITION_COVERAGE_RATIO   (0.95)
+// Longer distances are only tested while no candidate covers this share of the sequence
+#define REPETITION_MIN_COVERAGE     (0.5)
+
+RepetitionInfo RepetitionDetector::Detect(const std::vector<uint64_t>& signatures)
+{
+    RepetitionInfo info;
+    const size_t n = signatures.size();
+    if (n < 2) return info;
+
+    const size_t mid = n / 2;
+    const uint64_t& key = signatures[mid];
+    std::vector<size_t> vecCandidates;
+    // Periodic region [begin, end) of every candidate
+    std::vector<std::pair<size_t, size_t>> vecRegions;
+    size_t bestCoverage(0);
+    size_t distance(1);
+    while (distance <= REPETITION_MAX_PERIOD_BLOCKS && bestCoverage < n * REPETITION_MIN_COVERAGE)
+    {
+        const size_t first = vecCandidates.size();
+        for (; distance <= REPETITION_MAX_PERIOD_BLOCKS && vecCandidates.size() - first < REPETITION_CANDIDATE_BATCH; distance++)
+        {
+            if (mid + distance >= n && distance > mid) break;
+            const bool bAfter = mid + distance < n && signatures[mid + distance] == key;
+            const bool bBefore = distance <= mid && signatures[mid - distance] == key;
+            if (bAfter || bBefore) vecCandidates.push_back(distance);
+        }
+        if (vecCandidates.size() == first) break;
+
+        vecRegions.resize(vecCandidates.size(), std::make_pair(size_t(0), size_t(0)));
+        ParallelFor(first, vecCandidates.size(), 1,
+                    [&](size_t, size_t begin, size_t end) {
+                        for (size_t index = begin; index < end; index++)
+                        {
+                            const size_t period = vecCandidates[index];
+                            const size_t anchor = (mid + period < n && signatures[mid + period] == key) ? mid : mid - period;
+                            size_t lo(anchor), hi(anchor);
+                            while (lo > 0 && signatures[lo - 1] == signatures[lo - 1 + period]) lo--;
+                            while (hi + period < n && signatures[hi] == signatures[hi + period]) hi++;
+                            vecRegions[index] = std::make_pair(lo, hi + period);
+                        }
+                    });
+        for (size_t index = first; index < vecRegions.size(); index++)
+        {
+            bestCoverage = std::max(bestCoverage, vecRegions[index].second - vecRegions[index].first);
+        }
+    }
+    if (vecCandidates.empty()) return info;
+
+    // Candidates are sorted, so the first good enough one is the fundamental period
+    for (size_t index = 0; index < vecCandidates.size(); index++)
+    {
+        const size_t coverage = vecRegions[index].second - vecRegions[index].first;
+        if (coverage < bestCoverage * REPETITION_COVERAGE_RATIO) continue;
+        info.periodBlocks = vecCandidates[index];
+        info.repetitions = coverage / info.periodBlocks;
+        info.firstBlock = vecRegions[index].first;
+        break;
+    }
+    if (!info.IsPeriodic()) info = RepetitionInfo();
+    return info;
+}
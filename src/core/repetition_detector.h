@@ -0,0 +1,40 @@
+#ifndef REPETITION_DETECTOR_H
+#define REPETITION_DETECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define REPETITION_MAX_PERIOD_BLOCKS   (4096)
+#define REPETITION_CANDIDATE_BATCH     (64)
+
+struct RepetitionInfo
+{
+    size_t periodBlocks;    // 0 if no periodic structure was found
+    size_t repetitions;
+    size_t firstBlock;      // first block of the first full repetition
+
+    RepetitionInfo()
+        : periodBlocks(0)
+        , repetitions(0)
+        , firstBlock(0)
+    {}
+
+    bool IsPeriodic() const { return periodBlocks > 0 && repetitions >= 2; }
+};
+
+// Finds the dominant block period from normalized block signatures (see
+// BlockHasher::Signature). Candidate periods are the distances between
+// occurrences of the signature in the middle of the sequence; each one is
+// grown into the longest run with s[i] == s[i + period] around that point,
+// and the shortest period covering (nearly) the most blocks wins. Distances
+// are tested in growing batches until one covers most of the sequence, so a
+// train of identical readouts around the middle cannot hide the real period.
+// Preparation blocks before and after the periodic part are left out.
+class RepetitionDetector
+{
+public:
+    static RepetitionInfo Detect(const std::vector<uint64_t>& signatures);
+};
+
+#endif // REPETITION_DETECTOR_H
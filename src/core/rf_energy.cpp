@@ -0,0 +1,92 @@
+#include "rf_energy.h"
+
+#include <algorithm>
+#include <cmath>
+
+RfEnergyEstimator::RfEnergyEstimator(const std::vector<double>& vecWindows_s)
+    : m_dTotalEnergy_Hz2s(0.)
+{
+    for (const double& window_s : vecWindows_s)
+    {
+        if (window_s <= 0.) continue;
+        RfEnergyWindowResult result;
+        result.window_us = window_s * 1e6;
+        m_vecResults.push_back(result);
+
+        WindowState state;
+        state.sum = 0.;
+        state.sampleInterval_us = result.window_us / RF_ENERGY_TRACE_POINTS_PER_WINDOW;
+        state.nextSample = 0;
+        m_vecStates.push_back(state);
+    }
+}
+
+double RfEnergyEstimator::ShapeEnergy(const double* pMagnitude, const size_t& size)
+{
+    double sum(0.);
+    for (size_t index = 0; index < size; index++)
+    {
+        sum += pMagnitude[index] * pMagnitude[index];
+    }
+    return sum;
+}
+
+void RfEnergyEstimator::Evict(WindowState& state, const double& window_us, const double& dTime_us)
+{
+    while (!state.pulses.empty() && state.pulses.front().first <= dTime_us - window_us)
+    {
+        state.sum -= state.pulses.front().second;
+        state.pulses.pop_front();
+    }
+    // Avoid drifting below zero through accumulated rounding
+    if (state.pulses.empty()) state.sum = 0.;
+}
+
+void RfEnergyEstimator::SampleUntil(const size_t& index, const double& dTime_us)
+{
+    WindowState& state = m_vecStates[index];
+    RfEnergyWindowResult& result = m_vecResults[index];
+    double dSample_us = state.nextSample * state.sampleInterval_us;
+    while (dSample_us <= dTime_us)
+    {
+        Evict(state, result.window_us, dSample_us);
+        result.trace.emplace_back(dSample_us, std::sqrt(state.sum / (result.window_us * 1e-6)));
+        dSample_us = ++state.nextSample * state.sampleInterval_us;
+    }
+}
+
+void RfEnergyEstimator::AddPulse(const double& dStart_us, const double& dDuration_us, const double& energy_Hz2s)
+{
+    const double dCenter_us = dStart_us + dDuration_us * 0.5;
+    m_dTotalEnergy_Hz2s += energy_Hz2s;
+
+    for (size_t index = 0; index < m_vecStates.size(); index++)
+    {
+        SampleUntil(index, dCenter_us);
+
+        WindowState& state = m_vecStates[index];
+        RfEnergyWindowResult& result = m_vecResults[index];
+        Evict(state, result.window_us, dCenter_us);
+        state.pulses.emplace_back(dCenter_us, energy_Hz2s);
+        state.sum += energy_Hz2s;
+
+        if (state.sum > result.peakEnergy_Hz2s)
+        {
+            result.peakEnergy_Hz2s = state.sum;
+            result.peakEnd_us = dCenter_us;
+            result.peakStart_us = std::max(0., dCenter_us - result.window_us);
+        }
+    }
+}
+
+void RfEnergyEstimator::Finish(const double& dTotalDuration_us)
+{
+    for (size_t index = 0; index < m_vecStates.size(); index++)
+    {
+        SampleUntil(index, dTotalDuration_us);
+        RfEnergyWindowResult& result = m_vecResults[index];
+        result.peakB1rms_Hz = std::sqrt(result.peakEnergy_Hz2s / (result.window_us * 1e-6));
+        // Peak windows clamped at the sequence start still span a full window
+        result.peakEnd_us = std::max(result.peakEnd_us, std::min(result.peakStart_us + result.window_us, dTotalDuration_us));
+    }
+}
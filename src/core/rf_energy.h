@@ -0,0 +1,68 @@
+#ifndef RF_ENERGY_H
+#define RF_ENERGY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#define RF_ENERGY_TRACE_POINTS_PER_WINDOW  (50)
+
+struct RfEnergyWindowResult
+{
+    double window_us;
+    double peakEnergy_Hz2s;     // integral of B1^2 over the peak window
+    double peakStart_us;
+    double peakEnd_us;
+    double peakB1rms_Hz;        // sqrt(peakEnergy / window)
+    std::vector<std::pair<double, double>> trace;   // (time_us, windowed B1rms in Hz)
+
+    RfEnergyWindowResult()
+        : window_us(0.)
+        , peakEnergy_Hz2s(0.)
+        , peakStart_us(0.)
+        , peakEnd_us(0.)
+        , peakB1rms_Hz(0.)
+    {}
+};
+
+// Sliding-window RF energy (B1^2 integral) estimator.
+//
+// Pulses have to be added in time order. Every pulse is short compared with the
+// regulatory averaging windows, so its energy is accounted at its center time.
+// Each window keeps only the pulses inside it, so memory is O(window) and the
+// whole sequence is processed in a single pass. The windowed B1rms is sampled
+// on a coarse grid for display.
+class RfEnergyEstimator
+{
+public:
+    explicit RfEnergyEstimator(const std::vector<double>& vecWindows_s);
+
+    // Sum of squared normalized magnitude samples of an RF shape
+    static double ShapeEnergy(const double* pMagnitude, const size_t& size);
+
+    void AddPulse(const double& dStart_us, const double& dDuration_us, const double& energy_Hz2s);
+    void Finish(const double& dTotalDuration_us);
+
+    double GetTotalEnergy() const { return m_dTotalEnergy_Hz2s; }
+    const std::vector<RfEnergyWindowResult>& GetResults() const { return m_vecResults; }
+
+private:
+    struct WindowState
+    {
+        std::deque<std::pair<double, double>> pulses;  // (center_us, energy)
+        double sum;
+        uint64_t nextSample;                            // trace samples are counted, not their times summed
+        double sampleInterval_us;
+    };
+
+    void Evict(WindowState& state, const double& window_us, const double& dTime_us);
+    void SampleUntil(const size_t& index, const double& dTime_us);
+
+    std::vector<WindowState>             m_vecStates;
+    std::vector<RfEnergyWindowResult>    m_vecResults;
+    double                               m_dTotalEnergy_Hz2s;
+};
+
+#endif // RF_ENERGY_H
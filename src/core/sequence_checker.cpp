@@ -0,0 +1,343 @@
+#include "sequence_checker.h"
+#include "parallel_for.h"
+
+#include <cmath>
+#include <sstream>
+
+#define CHECK_LANES                  (8)
+#define CHECK_MIN_BLOCKS_PER_THREAD  (4096)
+
+// Lane-split reductions: the inner loops carry no dependency between lanes,
+// which lets the compiler map them onto SIMD registers.
+static float MaxAbs(const float* pData, const size_t& size)
+{
+    float acc[CHECK_LANES] = {0.f};
+    size_t index(0);
+    for (; index + CHECK_LANES <= size; index += CHECK_LANES)
+    {
+        for (int lane = 0; lane < CHECK_LANES; lane++)
+        {
+            acc[lane] = std::max(acc[lane], std::fabs(pData[index + lane]));
+        }
+    }
+    for (; index < size; index++)
+    {
+        acc[0] = std::max(acc[0], std::fabs(pData[index]));
+    }
+    return *std::max_element(acc, acc + CHECK_LANES);
+}
+
+static float MaxAbsDiff(const float* pData, const size_t& size)
+{
+    if (size < 2) return 0.f;
+    float acc[CHECK_LANES] = {0.f};
+    size_t index(1);
+    for (; index + CHECK_LANES <= size; index += CHECK_LANES)
+    {
+        for (int lane = 0; lane < CHECK_LANES; lane++)
+        {
+            acc[lane] = std::max(acc[lane], std::fabs(pData[index + lane] - pData[index + lane - 1]));
+        }
+    }
+    for (; index < size; index++)
+    {
+        acc[0] = std::max(acc[0], std::fabs(pData[index] - pData[index - 1]));
+    }
+    return *std::max_element(acc, acc + CHECK_LANES);
+}
+
+// Gradient sample of a block nearest to its start or end on a channel, and how far it
+// lies from that edge. False with 0 if the gradient does not reach the edge.
+static bool EdgeSample(SeqBlock* pBlock, const int& channel, const bool& bEnd, const double& dRaster_us,
+                       double& value_Hz_m, double& dOffset_us)
+{
+    value_Hz_m = 0.;
+    dOffset_us = 0.;
+    if (nullptr == pBlock) return false;
+    const GradEvent& gradEvent = pBlock->GetGradEvent(channel);
+    const double dDuration_us = pBlock->GetDuration();
+    if (pBlock->isTrapGradient(channel))
+    {
+        const double dEnd_us = gradEvent.delay + gradEvent.rampUpTime + gradEvent.flatTime + gradEvent.rampDownTime;
+        const bool bReached = bEnd ? dEnd_us >= dDuration_us - 1e-6 && gradEvent.rampDownTime == 0
+                                   : gradEvent.delay == 0 && gradEvent.rampUpTime == 0;
+        if (!bReached) return false;
+        value_Hz_m = gradEvent.amplitude;
+        return true;
+    }
+    if (pBlock->isArbitraryGradient(channel))
+    {
+        const float* pShape = pBlock->GetArbGradShapePtr(channel);
+        const size_t samples = pBlock->GetArbGradNumSamples(channel);
+        if (nullptr == pShape) return false;
+        const bool bReached = bEnd ? gradEvent.delay + samples * dRaster_us >= dDuration_us - 1e-6 : gradEvent.delay == 0;
+        if (!bReached) return false;
+        value_Hz_m = gradEvent.amplitude * (bEnd ? pShape[samples - 1] : pShape[0]);
+        dOffset_us = 0.5 * dRaster_us;
+        return true;
+    }
+    if (pBlock->isExtTrapGradient(channel))
+    {
+        const std::vector<long>& vecTimes = pBlock->GetExtTrapGradTimes(channel);
+        const std::vector<float>& vecShape = pBlock->GetExtTrapGradShape(channel);
+        if (vecShape.empty() || vecTimes.size() != vecShape.size()) return false;
+        const bool bReached = bEnd ? gradEvent.delay + vecTimes.back() >= dDuration_us - 1e-6 : gradEvent.delay == 0;
+        if (!bReached) return false;
+        value_Hz_m = gradEvent.amplitude * (bEnd ? vecShape.back() : vecShape.front());
+        dOffset_us = bEnd ? 0. : vecTimes.front();
+        return true;
+    }
+    return false;
+}
+
+SequenceChecker::SequenceChecker(const SystemLimits& limits)
+    : m_stLimits(limits)
+{
+}
+
+std::vector<LimitViolation> SequenceChecker::Check(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us) const
+{
+    std::vector<LimitViolation> violations;
+    if (blocks.empty() || vecBlockStart_us.size() < blocks.size()) return violations;
+
+    const size_t chunks = ParallelChunkCount(0, blocks.size(), CHECK_MIN_BLOCKS_PER_THREAD);
+    std::vector<std::vector<LimitViolation>> vecChunkViolations(chunks);
+    ParallelFor(0, blocks.size(), CHECK_MIN_BLOCKS_PER_THREAD,
+                [&](size_t chunk, size_t begin, size_t end) {
+                    for (size_t index = begin; index < end; index++)
+                    {
+                        SeqBlock* pPrevious = index > 0 ? blocks[index - 1] : nullptr;
+                        SeqBlock* pNext = index + 1 < blocks.size() ? blocks[index + 1] : nullptr;
+                        CheckBlock(blocks[index], pPrevious, pNext, vecBlockStart_us[index], vecChunkViolations[chunk]);
+                    }
+                });
+
+    size_t total(0);
+    for (const auto& chunkViolations : vecChunkViolations)
+    {
+        total += chunkViolations.size();
+    }
+    violations.reserve(total);
+    for (const auto& chunkViolations : vecChunkViolations)
+    {
+        violations.insert(violations.end(), chunkViolations.begin(), chunkViolations.end());
+    }
+    return violations;
+}
+
+bool SequenceChecker::IsOnRaster(const double& value_us, const double& raster_us) const
+{
+    if (raster_us <= 0.) return true;
+    const double ratio = value_us / raster_us;
+    return std::fabs(ratio - std::round(ratio)) < 1e-6;
+}
+
+void SequenceChecker::CheckBlock(SeqBlock* pBlock, SeqBlock* pPrevious, SeqBlock* pNext, const double& dBlockStart_us, std::vector<LimitViolation>& violations) const
+{
+    const int blockIndex = pBlock->GetIndex();
+    const double dBlockDuration_us = pBlock->GetDuration();
+
+    if (!IsOnRaster(dBlockDuration_us, m_stLimits.blockDurationRaster_us))
+    {
+        violations.emplace_back(kBlockRaster, blockIndex, -1, dBlockStart_us, dBlockDuration_us, m_stLimits.blockDurationRaster_us);
+    }
+
+    if (pBlock->isRF())
+    {
+        const RFEvent& rfEvent = pBlock->GetRFEvent();
+        const double dStart_us = dBlockStart_us + rfEvent.delay;
+        const int samples = pBlock->GetRFLength();
+        const float fDwell_us = pBlock->GetRFDwellTime();
+
+        const double peakB1_Hz = std::fabs(rfEvent.amplitude) * MaxAbs(pBlock->GetRFAmplitudePtr(), samples);
+        if (peakB1_Hz > m_stLimits.maxB1_Hz)
+        {
+            violations.emplace_back(kRfPeakB1, blockIndex, -1, dStart_us, peakB1_Hz, m_stLimits.maxB1_Hz);
+        }
+        if (!IsOnRaster(rfEvent.delay, m_stLimits.rfRasterTime_us))
+        {
+            violations.emplace_back(kRfRaster, blockIndex, -1, dStart_us, rfEvent.delay, m_stLimits.rfRasterTime_us);
+        }
+        if (!IsOnRaster(fDwell_us, m_stLimits.rfRasterTime_us))
+        {
+            violations.emplace_back(kRfRaster, blockIndex, -1, dStart_us, fDwell_us, m_stLimits.rfRasterTime_us);
+        }
+        const double dEnd_us = rfEvent.delay + samples * fDwell_us;
+        if (dEnd_us > dBlockDuration_us + 1e-6)
+        {
+            violations.emplace_back(kEventTiming, blockIndex, -1, dStart_us, dEnd_us, dBlockDuration_us);
+        }
+    }
+
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        CheckGradient(pBlock, pPrevious, pNext, channel, dBlockStart_us, violations);
+    }
+
+    if (pBlock->isADC())
+    {
+        const ADCEvent& adcEvent = pBlock->GetADCEvent();
+        const double dStart_us = dBlockStart_us + adcEvent.delay;
+        if (!IsOnRaster(adcEvent.dwellTime * 1e-3, m_stLimits.adcRasterTime_us))
+        {
+            violations.emplace_back(kAdcRaster, blockIndex, -1, dStart_us, adcEvent.dwellTime * 1e-3, m_stLimits.adcRasterTime_us);
+        }
+        if (!IsOnRaster(adcEvent.delay, m_stLimits.rfRasterTime_us))
+        {
+            violations.emplace_back(kAdcRaster, blockIndex, -1, dStart_us, adcEvent.delay, m_stLimits.rfRasterTime_us);
+        }
+        const double dEnd_us = adcEvent.delay + adcEvent.numSamples * adcEvent.dwellTime * 1e-3;
+        if (dEnd_us > dBlockDuration_us + 1e-6)
+        {
+            violations.emplace_back(kEventTiming, blockIndex, -1, dStart_us, dEnd_us, dBlockDuration_us);
+        }
+    }
+}
+
+void SequenceChecker::CheckGradient(SeqBlock* pBlock, SeqBlock* pPrevious, SeqBlock* pNext, const int& channel, const double& dBlockStart_us,
+                                    std::vector<LimitViolation>& violations) const
+{
+    const int blockIndex = pBlock->GetIndex();
+    const GradEvent& gradEvent = pBlock->GetGradEvent(channel);
+    const double dStart_us = dBlockStart_us + gradEvent.delay;
+    const double dRaster_us = m_stLimits.gradRasterTime_us;
+    const double amp = std::fabs(gradEvent.amplitude);
+
+    double peak_Hz_m(0.);
+    double slew_Hz_m_s(0.);
+    double dEnd_us(0.);
+    // first timing value found off the gradient raster, if any
+    double dOffRaster_us(-1.);
+    auto checkRaster = [&](const double& value_us) {
+        if (dOffRaster_us < 0. && !IsOnRaster(value_us, dRaster_us)) dOffRaster_us = value_us;
+    };
+    checkRaster(gradEvent.delay);
+    // Step between a sample at dOffset_us from the waveform's edge and the neighbour's
+    // gradient at that edge, 0 if the neighbour has none there
+    auto edgeSlew = [&](const double& value_Hz_m, const double& dOffset_us, SeqBlock* pNeighbour, const bool& bNeighbourEnd) {
+        double neighbour_Hz_m(0.);
+        double dNeighbourOffset_us(0.);
+        EdgeSample(pNeighbour, channel, bNeighbourEnd, dRaster_us, neighbour_Hz_m, dNeighbourOffset_us);
+        const double dt = dOffset_us + dNeighbourOffset_us;
+        return dt > 0. ? std::fabs(value_Hz_m - neighbour_Hz_m) / dt * 1e6 : 0.;
+    };
+
+    if (pBlock->isTrapGradient(channel))
+    {
+        peak_Hz_m = amp;
+        if (gradEvent.rampUpTime > 0) slew_Hz_m_s = std::max(slew_Hz_m_s, amp / gradEvent.rampUpTime * 1e6);
+        if (gradEvent.rampDownTime > 0) slew_Hz_m_s = std::max(slew_Hz_m_s, amp / gradEvent.rampDownTime * 1e6);
+        checkRaster(gradEvent.rampUpTime);
+        checkRaster(gradEvent.flatTime);
+        checkRaster(gradEvent.rampDownTime);
+        dEnd_us = gradEvent.delay + gradEvent.rampUpTime + gradEvent.flatTime + gradEvent.rampDownTime;
+    }
+    else if (pBlock->isArbitraryGradient(channel))
+    {
+        const float* pShape = pBlock->GetArbGradShapePtr(channel);
+        const size_t samples = pBlock->GetArbGradNumSamples(channel);
+        if (nullptr == pShape) return;
+        peak_Hz_m = amp * MaxAbs(pShape, samples);
+        slew_Hz_m_s = amp * MaxAbsDiff(pShape, samples) / dRaster_us * 1e6;
+        dEnd_us = gradEvent.delay + samples * dRaster_us;
+        // Samples sit at the raster centers, half a raster inside the waveform. A gradient
+        // continuing over a block edge is stepped from the neighbour's sample, else from 0
+        const bool bFromPrevious = gradEvent.delay == 0;
+        const bool bIntoNext = dEnd_us >= pBlock->GetDuration() - 1e-6;
+        slew_Hz_m_s = std::max(slew_Hz_m_s, edgeSlew(gradEvent.amplitude * pShape[0], 0.5 * dRaster_us,
+                                                     bFromPrevious ? pPrevious : nullptr, true));
+        slew_Hz_m_s = std::max(slew_Hz_m_s, edgeSlew(gradEvent.amplitude * pShape[samples - 1], 0.5 * dRaster_us,
+                                                     bIntoNext ? pNext : nullptr, false));
+    }
+    else if (pBlock->isExtTrapGradient(channel))
+    {
+        // Arbitrary gradients with a time shape are decoded into time points as well
+        const std::vector<long>& vecTimes = pBlock->GetExtTrapGradTimes(channel);
+        const std::vector<float>& vecShape = pBlock->GetExtTrapGradShape(channel);
+        if (vecShape.empty()) return;
+        peak_Hz_m = amp * MaxAbs(vecShape.data(), vecShape.size());
+        // A time shape starting after 0 leaves a ramp up to its first point, an arbitrary
+        // gradient in the previous block one from its last sample
+        slew_Hz_m_s = edgeSlew(gradEvent.amplitude * vecShape.front(), vecTimes.front(),
+                               gradEvent.delay == 0 ? pPrevious : nullptr, true);
+        checkRaster(vecTimes.front());
+        for (size_t index = 1; index < vecShape.size(); index++)
+        {
+            const long dt = vecTimes[index] - vecTimes[index - 1];
+            if (dt > 0)
+            {
+                slew_Hz_m_s = std::max(slew_Hz_m_s, amp * std::fabs(vecShape[index] - vecShape[index - 1]) / dt * 1e6);
+            }
+            checkRaster(vecTimes[index]);
+        }
+        dEnd_us = gradEvent.delay + vecTimes.back();
+    }
+    else
+    {
+        return;
+    }
+
+    if (peak_Hz_m > m_stLimits.maxGrad_Hz_m)
+    {
+        violations.emplace_back(kGradAmplitude, blockIndex, channel, dStart_us, peak_Hz_m, m_stLimits.maxGrad_Hz_m);
+    }
+    if (slew_Hz_m_s > m_stLimits.maxSlew_Hz_m_s)
+    {
+        violations.emplace_back(kGradSlewRate, blockIndex, channel, dStart_us, slew_Hz_m_s, m_stLimits.maxSlew_Hz_m_s);
+    }
+    if (dOffRaster_us >= 0.)
+    {
+        violations.emplace_back(kGradRaster, blockIndex, channel, dStart_us, dOffRaster_us, dRaster_us);
+    }
+    if (dEnd_us > pBlock->GetDuration() + 1e-6)
+    {
+        violations.emplace_back(kEventTiming, blockIndex, channel, dStart_us, dEnd_us, pBlock->GetDuration());
+    }
+}
+
+std::string SequenceChecker::TypeName(const ViolationType& type)
+{
+    switch (type)
+    {
+    case kGradAmplitude: return "Gradient amplitude";
+    case kGradSlewRate:  return "Gradient slew rate";
+    case kRfPeakB1:      return "RF peak B1";
+    case kRfRaster:      return "RF raster";
+    case kGradRaster:    return "Gradient raster";
+    case kAdcRaster:     return "ADC raster";
+    case kBlockRaster:   return "Block duration raster";
+    case kEventTiming:   return "Event exceeds block";
+    }
+    return "Unknown";
+}
+
+std::string SequenceChecker::Describe(const LimitViolation& violation)
+{
+    static const char* axisNames[NUM_GRADS] = {"GX", "GY", "GZ"};
+
+    std::ostringstream oss;
+    oss << "Block " << violation.blockIndex << ": " << TypeName(violation.type);
+    if (violation.channel >= 0 && violation.channel < NUM_GRADS)
+    {
+        oss << " (" << axisNames[violation.channel] << ")";
+    }
+    switch (violation.type)
+    {
+    case kGradAmplitude:
+        oss << " " << violation.value / GAMMA_HZ_T * 1e3 << " mT/m > " << violation.limit / GAMMA_HZ_T * 1e3 << " mT/m";
+        break;
+    case kGradSlewRate:
+        oss << " " << violation.value / GAMMA_HZ_T << " T/m/s > " << violation.limit / GAMMA_HZ_T << " T/m/s";
+        break;
+    case kRfPeakB1:
+        oss << " " << violation.value / GAMMA_HZ_T * 1e6 << " uT > " << violation.limit / GAMMA_HZ_T * 1e6 << " uT";
+        break;
+    case kEventTiming:
+        oss << " ends at " << violation.value << " us, block duration " << violation.limit << " us";
+        break;
+    default:
+        oss << " " << violation.value << " us not on " << violation.limit << " us raster";
+        break;
+    }
+    return oss.str();
+}
@@ -0,0 +1,91 @@
+#ifndef SEQUENCE_CHECKER_H
+#define SEQUENCE_CHECKER_H
+
+#include <string>
+#include <vector>
+#include <ExternalSequence.h>
+#include "mr_constants.h"
+
+enum ViolationType
+{
+    kGradAmplitude = 0,
+    kGradSlewRate,
+    kRfPeakB1,
+    kRfRaster,
+    kGradRaster,
+    kAdcRaster,
+    kBlockRaster,
+    kEventTiming
+};
+
+struct SystemLimits
+{
+    double maxGrad_Hz_m;
+    double maxSlew_Hz_m_s;
+    double maxB1_Hz;
+    double rfRasterTime_us;
+    double gradRasterTime_us;
+    double adcRasterTime_us;
+    double blockDurationRaster_us;
+
+    SystemLimits()
+        : maxGrad_Hz_m(40e-3 * GAMMA_HZ_T)
+        , maxSlew_Hz_m_s(200. * GAMMA_HZ_T)
+        , maxB1_Hz(20e-6 * GAMMA_HZ_T)
+        , rfRasterTime_us(1.)
+        , gradRasterTime_us(10.)
+        , adcRasterTime_us(0.1)
+        , blockDurationRaster_us(10.)
+    {}
+};
+
+struct LimitViolation
+{
+    ViolationType type;
+    int blockIndex;
+    int channel;            // GX/GY/GZ for gradient violations, -1 otherwise
+    double time_us;         // absolute time of the offending sample or event
+    double value;
+    double limit;
+
+    LimitViolation(
+        const ViolationType& eType,
+        const int& nBlockIndex,
+        const int& nChannel,
+        const double& dTime_us,
+        const double& dValue,
+        const double& dLimit)
+        : type(eType)
+        , blockIndex(nBlockIndex)
+        , channel(nChannel)
+        , time_us(dTime_us)
+        , value(dValue)
+        , limit(dLimit)
+    {}
+};
+
+class SequenceChecker
+{
+public:
+    explicit SequenceChecker(const SystemLimits& limits);
+
+    // Check all decoded blocks. Blocks are split into ranges that are checked
+    // concurrently; the per-sample kernels are written as branch-free
+    // reductions so they vectorize. Violations are returned in block order.
+    // Block start times are those of SequenceFingerprint::startTime_us.
+    std::vector<LimitViolation> Check(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us) const;
+
+    static std::string TypeName(const ViolationType& type);
+    static std::string Describe(const LimitViolation& violation);
+
+private:
+    // The neighbouring blocks, nullptr at either end, are needed for gradients continuing over a block edge
+    void CheckBlock(SeqBlock* pBlock, SeqBlock* pPrevious, SeqBlock* pNext, const double& dBlockStart_us, std::vector<LimitViolation>& violations) const;
+    void CheckGradient(SeqBlock* pBlock, SeqBlock* pPrevious, SeqBlock* pNext, const int& channel, const double& dBlockStart_us,
+                       std::vector<LimitViolation>& violations) const;
+    bool IsOnRaster(const double& value_us, const double& raster_us) const;
+
+    SystemLimits m_stLimits;
+};
+
+#endif // SEQUENCE_CHECKER_H
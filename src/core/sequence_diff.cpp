@@ -0,0 +1,399 @@
+#include "sequence_diff.h"
+#include "hash_mix.h"
+#include "inflate_stream.h"
+#include "parallel_for.h"
+#include "sequence_timeline.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define HASH_MIN_BLOCKS_PER_THREAD   (4096)
+#define HASH_MIN_SHAPES_PER_THREAD   (64)
+#define FINGERPRINT_BATCH_BLOCKS     (65536)
+#define DIFF_MAX_EDITS               (2048)
+#define DIFF_MAX_SNAKE_STEPS         (1 << 27)
+
+// Edit script operations
+#define DIFF_OP_EQUAL    ('=')
+#define DIFF_OP_CHANGE   ('!')
+#define DIFF_OP_INSERT   ('+')
+#define DIFF_OP_REMOVE   ('-')
+
+// -0 and +0 hash equally
+static inline uint64_t FloatBits(float value)
+{
+    if (value == 0.f) value = 0.f;
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline uint64_t DoubleBits(double value)
+{
+    if (value == 0.) value = 0.;
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+BlockHasher::BlockHasher(const std::map<int, CompressedShape>& shapeLib)
+{
+    std::vector<const std::pair<const int, CompressedShape>*> vecShapes;
+    vecShapes.reserve(shapeLib.size());
+    for (const auto& shape : shapeLib)
+    {
+        vecShapes.push_back(&shape);
+    }
+
+    // Compressed samples are hashed as stored, which is deterministic for a given exporter
+    std::vector<uint64_t> vecHashes(vecShapes.size(), 0);
+    ParallelFor(0, vecShapes.size(), HASH_MIN_SHAPES_PER_THREAD,
+                [&](size_t, size_t begin, size_t end) {
+                    for (size_t index = begin; index < end; index++)
+                    {
+                        const CompressedShape& shape = vecShapes[index]->second;
+                        uint64_t hash(0);
+                        HashCombine(hash, shape.numUncompressedSamples);
+                        HashCombine(hash, shape.isCompressed);
+                        HashCombine(hash, shape.samples.size());
+                        for (const float& sample : shape.samples)
+                        {
+                            HashCombine(hash, FloatBits(sample));
+                        }
+                        vecHashes[index] = hash;
+                    }
+                });
+
+    m_mapShapeHashes.reserve(vecShapes.size());
+    for (size_t index = 0; index < vecShapes.size(); index++)
+    {
+        m_mapShapeHashes[vecShapes[index]->first] = vecHashes[index];
+    }
+}
+
+uint64_t BlockHasher::ShapeHash(const int& shapeID) const
+{
+    if (shapeID <= 0) return 0;
+    auto it = m_mapShapeHashes.find(shapeID);
+    return it == m_mapShapeHashes.end() ? 0 : it->second;
+}
+
+uint64_t BlockHasher::Hash(SeqBlock* pBlock) const
+{
+    return HashBlock(pBlock, false);
+}
+
+uint64_t BlockHasher::Signature(SeqBlock* pBlock) const
+{
+    return HashBlock(pBlock, true);
+}
+
+uint64_t BlockHasher::HashBlock(SeqBlock* pBlock, const bool& bNormalized) const
+{
+    // Every event is prefixed with a tag so that absent events cannot alias
+    uint64_t hash(0);
+    HashCombine(hash, DoubleBits(pBlock->GetDuration()));
+
+    if (pBlock->isRF())
+    {
+        const RFEvent& rf = pBlock->GetRFEvent();
+        HashCombine(hash, RF + 1);
+        HashCombine(hash, ShapeHash(rf.magShape));
+        HashCombine(hash, ShapeHash(rf.phaseShape));
+        HashCombine(hash, ShapeHash(rf.timeShape));
+        HashCombine(hash, rf.delay);
+        if (!bNormalized)
+        {
+            HashCombine(hash, FloatBits(rf.amplitude));
+            HashCombine(hash, FloatBits(rf.freqOffset));
+            HashCombine(hash, FloatBits(rf.phaseOffset));
+        }
+    }
+
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        if (pBlock->GetEventIndex(static_cast<Event>(GX + channel)) <= 0) continue;
+        const GradEvent& grad = pBlock->GetGradEvent(channel);
+        HashCombine(hash, GX + channel + 1);
+        HashCombine(hash, grad.delay);
+        if (!bNormalized) HashCombine(hash, FloatBits(grad.amplitude));
+        if (pBlock->isTrapGradient(channel))
+        {
+            HashCombine(hash, grad.rampUpTime);
+            HashCombine(hash, grad.flatTime);
+            HashCombine(hash, grad.rampDownTime);
+        }
+        else
+        {
+            HashCombine(hash, ShapeHash(grad.waveShape));
+            HashCombine(hash, ShapeHash(grad.timeShape));
+        }
+    }
+
+    if (pBlock->isADC())
+    {
+        const ADCEvent& adc = pBlock->GetADCEvent();
+        HashCombine(hash, ADC + 1);
+        HashCombine(hash, adc.numSamples);
+        HashCombine(hash, adc.dwellTime);
+        HashCombine(hash, adc.delay);
+        if (!bNormalized)
+        {
+            HashCombine(hash, FloatBits(adc.freqOffset));
+            HashCombine(hash, FloatBits(adc.phaseOffset));
+        }
+    }
+
+    if (pBlock->isTrigger())
+    {
+        const TriggerEvent& trigger = pBlock->GetTriggerEvent();
+        HashCombine(hash, EXT + EXT_TRIGGER);
+        HashCombine(hash, trigger.triggerType);
+        HashCombine(hash, trigger.triggerChannel);
+        HashCombine(hash, trigger.delay);
+        HashCombine(hash, trigger.duration);
+    }
+
+    if (pBlock->isRotation())
+    {
+        const RotationEvent& rotation = pBlock->GetRotationEvent();
+        HashCombine(hash, EXT + EXT_ROTATION);
+        if (!bNormalized)
+        {
+            for (const double& element : rotation.rotMatrix)
+            {
+                HashCombine(hash, DoubleBits(element));
+            }
+        }
+    }
+
+    // Label values count up through the repetitions
+    if (bNormalized) return hash;
+    for (const ExtType& extType : {EXT_LABELSET, EXT_LABELINC})
+    {
+        const std::vector<LabelEvent>& labels = extType == EXT_LABELSET ? pBlock->GetLabelSetEvents() : pBlock->GetLabelIncEvents();
+        for (const LabelEvent& label : labels)
+        {
+            HashCombine(hash, EXT + extType);
+            HashCombine(hash, label.numVal.first);
+            HashCombine(hash, label.numVal.second);
+            HashCombine(hash, label.flagVal.first);
+            HashCombine(hash, label.flagVal.second);
+        }
+    }
+    return hash;
+}
+
+SequenceFingerprint BlockHasher::Fingerprint(const std::vector<SeqBlock*>& blocks, const double& blockDurationRaster_us) const
+{
+    SequenceFingerprint fingerprint;
+    fingerprint.blockHashes.resize(blocks.size());
+    fingerprint.blockSignatures.resize(blocks.size());
+    ParallelFor(0, blocks.size(), HASH_MIN_BLOCKS_PER_THREAD,
+                [&](size_t, size_t begin, size_t end) {
+                    for (size_t index = begin; index < end; index++)
+                    {
+                        fingerprint.blockHashes[index] = Hash(blocks[index]);
+                        fingerprint.blockSignatures[index] = Signature(blocks[index]);
+                    }
+                });
+
+    SequenceTimeline::BlockStarts(blocks, blockDurationRaster_us, fingerprint.startTime_us);
+    return fingerprint;
+}
+
+bool BlockHasher::FingerprintFile(const std::string& sFilePath, SequenceFingerprint& fingerprint)
+{
+    fingerprint.reset();
+    ExternalSequence sequence;
+    SequenceInput input;
+    const bool bLoaded = SequenceInput::IsSequentialPath(sFilePath) ? input.Load(sequence, sFilePath) : sequence.load(sFilePath);
+    if (!bLoaded) return false;
+
+    // Hashing only needs the event structures, so blocks are not decoded and
+    // are released batch by batch to keep memory flat
+    const BlockHasher hasher(sequence.GetShapeLibrary());
+    const int blockNum = sequence.GetNumberOfBlocks();
+    const double dRaster_us = sequence.GetBlockDurationRaster_us();
+    int64_t start_ru(0);
+    fingerprint.blockHashes.resize(blockNum);
+    fingerprint.blockSignatures.resize(blockNum);
+    fingerprint.startTime_us.resize(blockNum + 1, 0.);
+
+    std::vector<SeqBlock*> vecBatch;
+    for (int batchBegin = 0; batchBegin < blockNum; batchBegin += FINGERPRINT_BATCH_BLOCKS)
+    {
+        const int batchEnd = std::min(blockNum, batchBegin + FINGERPRINT_BATCH_BLOCKS);
+        vecBatch.resize(batchEnd - batchBegin);
+        for (int index = batchBegin; index < batchEnd; index++)
+        {
+            vecBatch[index - batchBegin] = sequence.GetBlock(index);
+        }
+
+        ParallelFor(0, vecBatch.size(), HASH_MIN_BLOCKS_PER_THREAD,
+                    [&](size_t, size_t begin, size_t end) {
+                        for (size_t index = begin; index < end; index++)
+                        {
+                            fingerprint.blockHashes[batchBegin + index] = hasher.Hash(vecBatch[index]);
+                            fingerprint.blockSignatures[batchBegin + index] = hasher.Signature(vecBatch[index]);
+                        }
+                    });
+
+        for (int index = batchBegin; index < batchEnd; index++)
+        {
+            SeqBlock* pBlock = vecBatch[index - batchBegin];
+            start_ru += pBlock->GetDuration_ru();
+            fingerprint.startTime_us[index + 1] = static_cast<double>(start_ru) * dRaster_us;
+            delete pBlock;
+        }
+    }
+    return true;
+}
+
+// Greedy Myers diff. Returns false if the edit distance or the total work
+// exceeds the budget, ops then is left untouched.
+static bool MyersDiff(const uint64_t* a, const int64_t& n, const uint64_t* b, const int64_t& m, std::vector<char>& ops)
+{
+    const int64_t maxD = std::min<int64_t>(n + m, DIFF_MAX_EDITS);
+    const int64_t offset = maxD + 1;
+    std::vector<int64_t> v(2 * offset + 1, 0);
+    // trace[d] keeps v[-d-1 .. d+1] as it was before step d
+    std::vector<std::vector<int64_t>> trace;
+    int64_t steps(0);
+    bool found(false);
+
+    for (int64_t d = 0; d <= maxD && !found; d++)
+    {
+        trace.emplace_back(v.begin() + offset - d - 1, v.begin() + offset + d + 2);
+        for (int64_t k = -d; k <= d; k += 2)
+        {
+            int64_t x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) ? v[offset + k + 1] : v[offset + k - 1] + 1;
+            int64_t y = x - k;
+            const int64_t snakeStart = x;
+            while (x < n && y < m && a[x] == b[y])
+            {
+                x++;
+                y++;
+            }
+            steps += x - snakeStart + 1;
+            v[offset + k] = x;
+            if (x >= n && y >= m)
+            {
+                found = true;
+                break;
+            }
+        }
+        if (!found && steps > DIFF_MAX_SNAKE_STEPS) return false;
+    }
+    if (!found) return false;
+
+    std::vector<char> reversed;
+    int64_t x(n), y(m);
+    for (int64_t d = static_cast<int64_t>(trace.size()) - 1; d >= 0; d--)
+    {
+        const std::vector<int64_t>& vd = trace[d];
+        auto V = [&vd, d](const int64_t& k) { return vd[k + d + 1]; };
+        const int64_t k = x - y;
+        const int64_t prevK = (k == -d || (k != d && V(k - 1) < V(k + 1))) ? k + 1 : k - 1;
+        const int64_t prevX = V(prevK);
+        const int64_t prevY = prevX - prevK;
+        while (x > prevX && y > prevY)
+        {
+            reversed.push_back(DIFF_OP_EQUAL);
+            x--;
+            y--;
+        }
+        if (d > 0) reversed.push_back(x == prevX ? DIFF_OP_INSERT : DIFF_OP_REMOVE);
+        x = prevX;
+        y = prevY;
+    }
+    ops.assign(reversed.rbegin(), reversed.rend());
+    return true;
+}
+
+static void PositionalDiff(const uint64_t* a, const size_t& n, const uint64_t* b, const size_t& m, std::vector<char>& ops)
+{
+    const size_t common = std::min(n, m);
+    ops.resize(std::max(n, m));
+    for (size_t index = 0; index < common; index++)
+    {
+        ops[index] = a[index] == b[index] ? DIFF_OP_EQUAL : DIFF_OP_CHANGE;
+    }
+    std::fill(ops.begin() + common, ops.end(), n > m ? DIFF_OP_REMOVE : DIFF_OP_INSERT);
+}
+
+std::vector<BlockDiffInterval> SequenceDiff::Compare(const SequenceFingerprint& a, const SequenceFingerprint& b, bool& bExact)
+{
+    bExact = true;
+    const std::vector<uint64_t>& hashesA = a.blockHashes;
+    const std::vector<uint64_t>& hashesB = b.blockHashes;
+    const size_t n = hashesA.size();
+    const size_t m = hashesB.size();
+
+    // Parameter changes mostly leave long common head and tail runs
+    size_t prefix(0);
+    while (prefix < n && prefix < m && hashesA[prefix] == hashesB[prefix]) prefix++;
+    size_t suffix(0);
+    while (suffix < n - prefix && suffix < m - prefix && hashesA[n - 1 - suffix] == hashesB[m - 1 - suffix]) suffix++;
+
+    const size_t midN = n - prefix - suffix;
+    const size_t midM = m - prefix - suffix;
+    const uint64_t* pMidA = hashesA.data() + prefix;
+    const uint64_t* pMidB = hashesB.data() + prefix;
+
+    // Equal block counts are compared position by position, which is what a
+    // changed parameter produces; otherwise blocks were inserted or removed
+    std::vector<char> ops;
+    if (midN == midM)
+    {
+        PositionalDiff(pMidA, midN, pMidB, midM, ops);
+    }
+    else if (!MyersDiff(pMidA, midN, pMidB, midM, ops))
+    {
+        bExact = false;
+        PositionalDiff(pMidA, midN, pMidB, midM, ops);
+    }
+
+    std::vector<BlockDiffInterval> intervals;
+    size_t indexA(prefix), indexB(prefix), op(0);
+    while (op < ops.size())
+    {
+        if (ops[op] == DIFF_OP_EQUAL)
+        {
+            indexA++;
+            indexB++;
+            op++;
+            continue;
+        }
+
+        BlockDiffInterval interval;
+        interval.beginA = indexA;
+        interval.beginB = indexB;
+        for (; op < ops.size() && ops[op] != DIFF_OP_EQUAL; op++)
+        {
+            if (ops[op] != DIFF_OP_INSERT) indexA++;
+            if (ops[op] != DIFF_OP_REMOVE) indexB++;
+        }
+        interval.endA = indexA;
+        interval.endB = indexB;
+        interval.type = interval.beginA == interval.endA ? kDiffInserted
+                      : (interval.beginB == interval.endB ? kDiffRemoved : kDiffChanged);
+        interval.startA_us = a.startTime_us[interval.beginA];
+        interval.endA_us = a.startTime_us[interval.endA];
+        interval.startB_us = b.startTime_us[interval.beginB];
+        interval.endB_us = b.startTime_us[interval.endB];
+        intervals.push_back(interval);
+    }
+    return intervals;
+}
+
+std::string SequenceDiff::TypeName(const DiffType& type)
+{
+    switch (type)
+    {
+    case kDiffChanged:  return "Changed";
+    case kDiffInserted: return "Inserted";
+    case kDiffRemoved:  return "Removed";
+    }
+    return "Unknown";
+}
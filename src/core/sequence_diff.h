@@ -0,0 +1,85 @@
+#ifndef SEQUENCE_DIFF_H
+#define SEQUENCE_DIFF_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ExternalSequence.h>
+
+enum DiffType
+{
+    kDiffChanged = 0,
+    kDiffInserted,      // blocks only present in the second sequence
+    kDiffRemoved        // blocks only present in the first sequence
+};
+
+// Content hash of every block plus the block start times, which is all a
+// diff needs. startTime_us holds one entry more than blockHashes, the last
+// one being the total duration. Signatures hash the block structure with
+// amplitudes and phase/frequency offsets left out, so repetitions that only
+// differ in e.g. the phase-encode step share a signature.
+struct SequenceFingerprint
+{
+    std::vector<uint64_t> blockHashes;
+    std::vector<uint64_t> blockSignatures;
+    std::vector<double>   startTime_us;
+
+    void reset()
+    {
+        blockHashes.clear();
+        blockSignatures.clear();
+        startTime_us.clear();
+    }
+};
+
+// Aligned interval: blocks [beginA, endA) of the first sequence correspond to
+// blocks [beginB, endB) of the second one. One side is empty for insertions
+// and removals.
+struct BlockDiffInterval
+{
+    DiffType type;
+    size_t beginA;
+    size_t endA;
+    size_t beginB;
+    size_t endB;
+    double startA_us;
+    double endA_us;
+    double startB_us;
+    double endB_us;
+};
+
+// Hashes blocks by content rather than by event ID, so sequences whose event
+// libraries were renumbered between exports still compare equal. Shapes are
+// hashed once per library entry, blocks in parallel.
+class BlockHasher
+{
+public:
+    explicit BlockHasher(const std::map<int, CompressedShape>& shapeLib);
+
+    uint64_t Hash(SeqBlock* pBlock) const;
+    uint64_t Signature(SeqBlock* pBlock) const;
+    SequenceFingerprint Fingerprint(const std::vector<SeqBlock*>& blocks, const double& blockDurationRaster_us) const;
+
+    // Load a sequence and fingerprint it without keeping the decoded blocks
+    static bool FingerprintFile(const std::string& sFilePath, SequenceFingerprint& fingerprint);
+
+private:
+    uint64_t HashBlock(SeqBlock* pBlock, const bool& bNormalized) const;
+    uint64_t ShapeHash(const int& shapeID) const;
+
+    std::unordered_map<int, uint64_t> m_mapShapeHashes;
+};
+
+class SequenceDiff
+{
+public:
+    // Align the two block hash sequences and return the differing intervals in
+    // order. bExact is false if the edit distance was too large for a minimal
+    // alignment and the blocks were compared position by position instead.
+    static std::vector<BlockDiffInterval> Compare(const SequenceFingerprint& a, const SequenceFingerprint& b, bool& bExact);
+
+    static std::string TypeName(const DiffType& type);
+};
+
+#endif // SEQUENCE_DIFF_H
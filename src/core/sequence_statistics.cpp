@@ -0,0 +1,222 @@
+#include "sequence_statistics.h"
+#include "mr_constants.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Scaled extrema and sum of squares of a normalized shape in one sweep
+static void AddShape(GradientStatistics& stats, const double& amplitude, const float* pShape, const size_t& count, double& sumSquares)
+{
+    sumSquares = 0.;
+    if (nullptr == pShape || count == 0) return;
+    float lower(pShape[0]);
+    float upper(pShape[0]);
+    double squares(0.);
+    for (size_t index = 0; index < count; index++)
+    {
+        lower = std::min(lower, pShape[index]);
+        upper = std::max(upper, pShape[index]);
+        squares += static_cast<double>(pShape[index]) * pShape[index];
+    }
+    const double a = amplitude * lower;
+    const double b = amplitude * upper;
+    stats.amplitude_Hz_m.Add(std::min(a, b), std::max(a, b));
+    sumSquares = amplitude * amplitude * squares;
+}
+
+SequenceStatistics::SequenceStatistics(const double& blockDurationRaster_us, const double& gradRasterTime_us)
+    : blocks(0)
+    , totalDuration_ru(0)
+    , totalDuration_us(0.)
+    , rfCount(0)
+    , rfActiveTime_us(0.)
+    , rfSquareIntegral_Hz2_us(0.)
+    , rfPeak_uT(0.)
+    , rfRms_uT(0.)
+    , rfDutyCycle(0.)
+    , adcCount(0)
+    , adcSamples(0)
+    , readoutTime_us(0.)
+    , m_dBlockDurationRaster_us(blockDurationRaster_us)
+    , m_dGradRasterTime_us(gradRasterTime_us)
+{
+}
+
+SequenceStatistics SequenceStatistics::Compute(const std::vector<SeqBlock*>& blocks, const double& blockDurationRaster_us, const double& gradRasterTime_us)
+{
+    const size_t chunks = ParallelChunkCount(0, blocks.size(), STATISTICS_MIN_BLOCKS_PER_THREAD);
+    std::vector<SequenceStatistics> vecChunks(chunks, SequenceStatistics(blockDurationRaster_us, gradRasterTime_us));
+    ParallelFor(0, blocks.size(), STATISTICS_MIN_BLOCKS_PER_THREAD,
+                [&](size_t chunk, size_t begin, size_t end) {
+                    for (size_t index = begin; index < end; index++)
+                    {
+                        vecChunks[chunk].Add(blocks[index]);
+                    }
+                });
+
+    SequenceStatistics stats(blockDurationRaster_us, gradRasterTime_us);
+    for (const SequenceStatistics& chunk : vecChunks)
+    {
+        stats.Merge(chunk);
+    }
+    stats.Finish();
+    return stats;
+}
+
+int SequenceStatistics::BlockType(SeqBlock* pSeqBlock)
+{
+    int type(0);
+    if (pSeqBlock->isRF()) type |= kBlockTypeRf;
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        if (pSeqBlock->isTrapGradient(channel) || pSeqBlock->isArbitraryGradient(channel) || pSeqBlock->isExtTrapGradient(channel))
+        {
+            type |= kBlockTypeGx << channel;
+        }
+    }
+    if (pSeqBlock->isADC()) type |= kBlockTypeAdc;
+    return type;
+}
+
+std::string SequenceStatistics::BlockTypeName(const int& type)
+{
+    static const char* names[] = {"RF", "GX", "GY", "GZ", "ADC"};
+    std::string sName;
+    for (int bit = 0; bit < 5; bit++)
+    {
+        if (0 == (type & (1 << bit))) continue;
+        if (!sName.empty()) sName += "+";
+        sName += names[bit];
+    }
+    return sName.empty() ? "Delay" : sName;
+}
+
+void SequenceStatistics::Add(SeqBlock* pSeqBlock)
+{
+    blocks++;
+    const int64_t duration_ru = pSeqBlock->GetDuration_ru();
+    totalDuration_ru += duration_ru;
+    BlockTypeStatistics& blockType = blockTypes[BlockType(pSeqBlock)];
+    blockType.count++;
+    blockType.duration_ru += duration_ru;
+
+    if (pSeqBlock->isRF())
+    {
+        const RFEvent& rfEvent = pSeqBlock->GetRFEvent();
+        const size_t samples = static_cast<size_t>(pSeqBlock->GetRFLength());
+        const double dwell_us = pSeqBlock->GetRFDwellTime();
+        rfCount++;
+        rfActiveTime_us += samples * dwell_us;
+        if (samples > 0)
+        {
+            // Peak and energy of the magnitude shape in one sweep
+            const float* pAmp = pSeqBlock->GetRFAmplitudePtr();
+            float peak(0.f);
+            double squares(0.);
+            for (size_t index = 0; index < samples; index++)
+            {
+                peak = std::max(peak, std::fabs(pAmp[index]));
+                squares += static_cast<double>(pAmp[index]) * pAmp[index];
+            }
+            const double amplitude = std::fabs(rfEvent.amplitude);
+            rfAmplitude_Hz.Add(0., amplitude * peak);
+            rfSquareIntegral_Hz2_us += amplitude * amplitude * squares * dwell_us;
+        }
+    }
+
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        const GradEvent& gradEvent = pSeqBlock->GetGradEvent(channel);
+        GradientStatistics& stats = grad[channel];
+        const double amplitude = gradEvent.amplitude;
+        if (pSeqBlock->isTrapGradient(channel))
+        {
+            // Ramps contribute a third of amplitude^2 times their length
+            const double rise_us = gradEvent.rampUpTime;
+            const double flat_us = gradEvent.flatTime;
+            const double fall_us = gradEvent.rampDownTime;
+            stats.amplitude_Hz_m.Add(amplitude, amplitude);
+            stats.activeTime_us += rise_us + flat_us + fall_us;
+            stats.squareIntegral_Hz2_m2_us += amplitude * amplitude * (flat_us + (rise_us + fall_us) / 3.);
+        }
+        else if (pSeqBlock->isArbitraryGradient(channel))
+        {
+            const size_t samples = static_cast<size_t>(pSeqBlock->GetArbGradNumSamples(channel));
+            double sumSquares(0.);
+            AddShape(stats, amplitude, pSeqBlock->GetArbGradShapePtr(channel), samples, sumSquares);
+            stats.activeTime_us += samples * m_dGradRasterTime_us;
+            stats.squareIntegral_Hz2_m2_us += sumSquares * m_dGradRasterTime_us;
+        }
+        else if (pSeqBlock->isExtTrapGradient(channel))
+        {
+            const std::vector<long>& times = pSeqBlock->GetExtTrapGradTimes(channel);
+            const std::vector<float>& shape = pSeqBlock->GetExtTrapGradShape(channel);
+            double sumSquares(0.);
+            AddShape(stats, amplitude, shape.data(), shape.size(), sumSquares);
+            // Piecewise linear between the corner points
+            const size_t points = std::min(times.size(), shape.size());
+            for (size_t point = 1; point < points; point++)
+            {
+                const double a = amplitude * shape[point - 1];
+                const double b = amplitude * shape[point];
+                stats.squareIntegral_Hz2_m2_us += (a * a + a * b + b * b) / 3. * (times[point] - times[point - 1]);
+            }
+            if (points > 0) stats.activeTime_us += static_cast<double>(times[points - 1] - times[0]);
+        }
+        else
+        {
+            continue;
+        }
+        stats.count++;
+    }
+
+    if (pSeqBlock->isADC())
+    {
+        const ADCEvent& adcEvent = pSeqBlock->GetADCEvent();
+        adcCount++;
+        adcSamples += adcEvent.numSamples;
+        readoutTime_us += adcEvent.numSamples * adcEvent.dwellTime * 1e-3;
+    }
+}
+
+void SequenceStatistics::Merge(const SequenceStatistics& other)
+{
+    blocks += other.blocks;
+    totalDuration_ru += other.totalDuration_ru;
+    rfCount += other.rfCount;
+    rfAmplitude_Hz.Merge(other.rfAmplitude_Hz);
+    rfActiveTime_us += other.rfActiveTime_us;
+    rfSquareIntegral_Hz2_us += other.rfSquareIntegral_Hz2_us;
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        grad[channel].count += other.grad[channel].count;
+        grad[channel].amplitude_Hz_m.Merge(other.grad[channel].amplitude_Hz_m);
+        grad[channel].activeTime_us += other.grad[channel].activeTime_us;
+        grad[channel].squareIntegral_Hz2_m2_us += other.grad[channel].squareIntegral_Hz2_m2_us;
+    }
+    adcCount += other.adcCount;
+    adcSamples += other.adcSamples;
+    readoutTime_us += other.readoutTime_us;
+    for (int type = 0; type < kBlockTypeNum; type++)
+    {
+        blockTypes[type].count += other.blockTypes[type].count;
+        blockTypes[type].duration_ru += other.blockTypes[type].duration_ru;
+    }
+}
+
+void SequenceStatistics::Finish()
+{
+    totalDuration_us = static_cast<double>(totalDuration_ru) * m_dBlockDurationRaster_us;
+    const double total_us = totalDuration_us > 0. ? totalDuration_us : 1.;
+    // B1 in uT from Hz
+    const double dHzToUt = 1e6 / GAMMA_HZ_T;
+    rfPeak_uT = rfAmplitude_Hz.IsEmpty() ? 0. : rfAmplitude_Hz.max * dHzToUt;
+    rfRms_uT = std::sqrt(rfSquareIntegral_Hz2_us / total_us) * dHzToUt;
+    rfDutyCycle = rfActiveTime_us / total_us;
+    for (GradientStatistics& stats : grad)
+    {
+        stats.rms_Hz_m = std::sqrt(stats.squareIntegral_Hz2_m2_us / total_us);
+        stats.dutyCycle = stats.activeTime_us / total_us;
+    }
+}
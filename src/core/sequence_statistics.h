@@ -0,0 +1,124 @@
+#ifndef SEQUENCE_STATISTICS_H
+#define SEQUENCE_STATISTICS_H
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+#include <ExternalSequence.h>
+
+#define STATISTICS_MIN_BLOCKS_PER_THREAD     (4096)
+
+// Block types are the set of events a block plays, one bit per event
+enum BlockTypeBit
+{
+    kBlockTypeRf  = 1 << 0,
+    kBlockTypeGx  = 1 << 1,
+    kBlockTypeGy  = 1 << 2,
+    kBlockTypeGz  = 1 << 3,
+    kBlockTypeAdc = 1 << 4,
+    kBlockTypeNum = 1 << 5
+};
+
+struct AmplitudeRange
+{
+    uint64_t count;
+    double min;
+    double max;
+
+    AmplitudeRange()
+        : count(0)
+        , min(std::numeric_limits<double>::infinity())
+        , max(-std::numeric_limits<double>::infinity())
+    {}
+
+    inline void Add(const double& lower, const double& upper)
+    {
+        count++;
+        if (lower < min) min = lower;
+        if (upper > max) max = upper;
+    }
+    inline void Merge(const AmplitudeRange& other)
+    {
+        count += other.count;
+        if (other.min < min) min = other.min;
+        if (other.max > max) max = other.max;
+    }
+    inline bool IsEmpty() const { return count == 0; }
+};
+
+// One gradient axis over trapezoids, extended trapezoids and arbitrary gradients
+struct GradientStatistics
+{
+    uint64_t count;
+    AmplitudeRange amplitude_Hz_m;
+    double activeTime_us;               // time an event plays on this axis
+    double squareIntegral_Hz2_m2_us;    // integral of the squared waveform
+    // Over the whole sequence, set by Finish()
+    double rms_Hz_m;
+    double dutyCycle;
+
+    GradientStatistics()
+        : count(0)
+        , activeTime_us(0.)
+        , squareIntegral_Hz2_m2_us(0.)
+        , rms_Hz_m(0.)
+        , dutyCycle(0.)
+    {}
+};
+
+struct BlockTypeStatistics
+{
+    uint64_t count;
+    int64_t duration_ru;
+
+    BlockTypeStatistics() : count(0), duration_ru(0) {}
+};
+
+// Summary of a decoded sequence. Compute() splits the blocks into ranges that
+// are summarized concurrently and merged in block order, so every figure comes
+// out of one pass. Add() takes one block at a time for callers that free
+// blocks as they go; Finish() then derives the RMS values and duty cycles.
+class SequenceStatistics
+{
+public:
+    SequenceStatistics(const double& blockDurationRaster_us = 10., const double& gradRasterTime_us = 10.);
+
+    static SequenceStatistics Compute(const std::vector<SeqBlock*>& blocks, const double& blockDurationRaster_us, const double& gradRasterTime_us);
+
+    void Add(SeqBlock* pSeqBlock);
+    void Merge(const SequenceStatistics& other);
+    void Finish();
+
+    // e.g. "RF+GZ", "GX+ADC" or "Delay" for a block without events
+    static std::string BlockTypeName(const int& type);
+    static int BlockType(SeqBlock* pSeqBlock);
+    inline double BlockDurationRaster_us() const { return m_dBlockDurationRaster_us; }
+
+    uint64_t                        blocks;
+    int64_t                         totalDuration_ru;
+    double                          totalDuration_us;
+
+    // RF, amplitudes in Hz
+    uint64_t                        rfCount;
+    AmplitudeRange                  rfAmplitude_Hz;         // 0 up to the peak B1 of every pulse
+    double                          rfActiveTime_us;
+    double                          rfSquareIntegral_Hz2_us;
+    double                          rfPeak_uT;              // set by Finish(), as rfRms_uT and rfDutyCycle
+    double                          rfRms_uT;
+    double                          rfDutyCycle;
+
+    GradientStatistics              grad[NUM_GRADS];        // GX, GY, GZ
+
+    uint64_t                        adcCount;
+    uint64_t                        adcSamples;
+    double                          readoutTime_us;
+
+    BlockTypeStatistics             blockTypes[kBlockTypeNum];
+
+private:
+    double                          m_dBlockDurationRaster_us;
+    double                          m_dGradRasterTime_us;
+};
+
+#endif // SEQUENCE_STATISTICS_H
@@ -0,0 +1,89 @@
+#include "sequence_timeline.h"
+
+SequenceTimeline::SequenceTimeline(const bool& bKeepEvents)
+    : m_bKeepEvents(bKeepEvents)
+{
+    Reset();
+}
+
+void SequenceTimeline::Build(const std::vector<SeqBlock*>& blocks, const double& blockDurationRaster_us)
+{
+    Reset();
+    blockStart_us.reserve(blocks.size() + 1);
+    for (SeqBlock* pSeqBlock : blocks)
+    {
+        Append(pSeqBlock, blockDurationRaster_us);
+    }
+}
+
+void SequenceTimeline::BlockStarts(const std::vector<SeqBlock*>& blocks, const double& blockDurationRaster_us, std::vector<double>& vecStart_us)
+{
+    vecStart_us.resize(blocks.size() + 1);
+    int64_t start_ru(0);
+    vecStart_us[0] = 0.;
+    for (size_t index = 0; index < blocks.size(); index++)
+    {
+        start_ru += blocks[index]->GetDuration_ru();
+        vecStart_us[index + 1] = static_cast<double>(start_ru) * blockDurationRaster_us;
+    }
+}
+
+void SequenceTimeline::Reset()
+{
+    totalDuration_ru = 0;
+    totalDuration_us = 0.;
+    blockStart_us.assign(1, 0.);
+    rf.clear();
+    adc.clear();
+    adcSamples = 0;
+    rfCount = 0;
+    adcCount = 0;
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        trap[channel].clear();
+        gradCount[channel] = 0;
+    }
+}
+
+void SequenceTimeline::Append(SeqBlock* pSeqBlock, const double& blockDurationRaster_us)
+{
+    const double dCurrentStartTime_us = totalDuration_us;
+    if (pSeqBlock->isRF())
+    {
+        const RFEvent& rfEvent = pSeqBlock->GetRFEvent();
+        const uint64_t samples = static_cast<uint64_t>(pSeqBlock->GetRFLength());
+        const float dwell = pSeqBlock->GetRFDwellTime();
+        rfCount++;
+        if (m_bKeepEvents) rf.push_back({dCurrentStartTime_us + rfEvent.delay, samples * dwell, samples, dwell, pSeqBlock});
+    }
+
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        const GradEvent& gradEvent = pSeqBlock->GetGradEvent(channel);
+        if (pSeqBlock->isTrapGradient(channel))
+        {
+            if (m_bKeepEvents)
+            {
+                trap[channel].push_back({dCurrentStartTime_us + gradEvent.delay, gradEvent.rampUpTime, gradEvent.flatTime,
+                                         gradEvent.rampDownTime, &gradEvent});
+            }
+        }
+        else if (!pSeqBlock->isArbitraryGradient(channel) && !pSeqBlock->isExtTrapGradient(channel))
+        {
+            continue;
+        }
+        gradCount[channel]++;
+    }
+
+    if (pSeqBlock->isADC())
+    {
+        const ADCEvent& adcEvent = pSeqBlock->GetADCEvent();
+        adcCount++;
+        if (m_bKeepEvents) adc.push_back({dCurrentStartTime_us + adcEvent.delay, adcEvent.dwellTime * adcEvent.numSamples * 1e-3, &adcEvent});
+        adcSamples += adcEvent.numSamples;
+    }
+
+    totalDuration_ru += pSeqBlock->GetDuration_ru();
+    totalDuration_us = static_cast<double>(totalDuration_ru) * blockDurationRaster_us;
+    if (m_bKeepEvents) blockStart_us.push_back(totalDuration_us);
+}
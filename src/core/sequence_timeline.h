@@ -0,0 +1,70 @@
+#ifndef SEQUENCE_TIMELINE_H
+#define SEQUENCE_TIMELINE_H
+
+#include <cstdint>
+#include <vector>
+#include <ExternalSequence.h>
+
+struct TimelineRf
+{
+    double startAbsTime_us;
+    double duration_us;
+    uint64_t samples;
+    float dwell_us;
+    SeqBlock* block;
+};
+
+struct TimelineTrap
+{
+    double startAbsTime_us;
+    int64_t rampUpTime_us;
+    int64_t flatTime_us;
+    int64_t rampDownTime_us;
+    const GradEvent* event;
+};
+
+struct TimelineAdc
+{
+    double startAbsTime_us;
+    double duration_us;
+    const ADCEvent* event;
+};
+
+// Absolute placement of the events of decoded blocks, the Qt-free part of
+// PulseqLoader::LoadPulseqEvents() shared with the command line tools. Block
+// start times come from the raster durations of the sequence rather than
+// SeqBlock::GetDuration(), whose raster is shared by all loaded sequences.
+// Durations are summed as integer raster units and scaled once per block, so
+// start times do not drift from scanner timing however long the sequence is.
+// Without events only the totals and counts are kept, so a caller can free
+// every block right after Append(). Amplitudes, RMS values and duty cycles
+// are summarized by SequenceStatistics.
+class SequenceTimeline
+{
+public:
+    explicit SequenceTimeline(const bool& bKeepEvents = true);
+
+    void Build(const std::vector<SeqBlock*>& blocks, const double& blockDurationRaster_us);
+    void Reset();
+    void Append(SeqBlock* pSeqBlock, const double& blockDurationRaster_us);
+
+    // Start of every block plus the end of the last one, the same times Build() gives
+    static void BlockStarts(const std::vector<SeqBlock*>& blocks, const double& blockDurationRaster_us, std::vector<double>& vecStart_us);
+
+    int64_t                         totalDuration_ru;
+    double                          totalDuration_us;   // totalDuration_ru scaled, never summed in us
+    std::vector<double>             blockStart_us;      // one past the last block gives the end
+    std::vector<TimelineRf>         rf;
+    std::vector<TimelineTrap>       trap[NUM_GRADS];    // trapezoids only, in GX, GY, GZ order
+    std::vector<TimelineAdc>        adc;
+    uint64_t                        adcSamples;
+
+    uint64_t                        rfCount;
+    uint64_t                        gradCount[NUM_GRADS];
+    uint64_t                        adcCount;
+
+private:
+    bool                            m_bKeepEvents;
+};
+
+#endif // SEQUENCE_TIMELINE_H
@@ -0,0 +1,323 @@
+#include "sequence_validator.h"
+#include "inflate_stream.h"
+#include "message_log.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+
+// Parser messages of one file, classified by their text like the checks in
+// the parser print them. A file is decoded on one thread, so no lock is needed.
+class ResultMessageSink : public MessageSink
+{
+public:
+    explicit ResultMessageSink(ValidationResult& result)
+        : m_result(result)
+    {}
+
+    void Write(MessageType, const std::string& str) override
+    {
+        if (str.find("ERROR") != std::string::npos)
+        {
+            if (!m_result.error.empty()) m_result.error += "; ";
+            m_result.error += str;
+        }
+        else if (str.find("WARNING") != std::string::npos)
+        {
+            m_result.warnings++;
+        }
+    }
+
+private:
+    ValidationResult& m_result;
+};
+
+static std::string FormatNumber(const double& value)
+{
+    if (!std::isfinite(value)) return std::string();
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.10g", value);
+    return buffer;
+}
+
+static std::string CsvField(const std::string& str)
+{
+    if (str.find_first_of(",\"\r\n") == std::string::npos) return str;
+    std::string sQuoted("\"");
+    for (const char& c : str)
+    {
+        if (c == '"') sQuoted += '"';
+        sQuoted += c;
+    }
+    return sQuoted + "\"";
+}
+
+static std::string JsonString(const std::string& str)
+{
+    std::string sEscaped("\"");
+    for (const char& c : str)
+    {
+        switch (c)
+        {
+        case '"':  sEscaped += "\\\""; break;
+        case '\\': sEscaped += "\\\\"; break;
+        case '\n': sEscaped += "\\n"; break;
+        case '\r': sEscaped += "\\r"; break;
+        case '\t': sEscaped += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                sEscaped += buffer;
+            }
+            else
+            {
+                sEscaped += c;
+            }
+        }
+    }
+    return sEscaped + "\"";
+}
+
+// Empty ranges are written as null
+static std::string JsonNumber(const double& value)
+{
+    const std::string str = FormatNumber(value);
+    return str.empty() ? "null" : str;
+}
+
+static double BytesPerBlock(const ValidationResult& result)
+{
+    return result.blocks > 0 ? double(result.parserBytes + result.decodedBytes) / result.blocks : 0.;
+}
+
+ValidationResult::ValidationResult()
+    : loaded(false)
+    , warnings(0)
+    , fileSize(0)
+    , loadTime_ms(0.)
+    , version(0)
+    , signature(kSignatureUnsigned)
+    , blocks(0)
+    , parserBytes(0)
+    , decodedBytes(0)
+{
+}
+
+ValidationResult SequenceValidator::Validate(const std::string& sFilePath)
+{
+    return ValidateFile(sFilePath);
+}
+
+ValidationResult SequenceValidator::ValidateFile(const std::string& sFilePath)
+{
+    const auto start = std::chrono::steady_clock::now();
+    ValidationResult result;
+    result.path = sFilePath;
+
+    std::error_code ec;
+    const uintmax_t fileSize = std::filesystem::file_size(sFilePath, ec);
+    result.fileSize = ec ? 0 : fileSize;
+
+    ExternalSequence seq;
+    ResultMessageSink sink(result);
+    ScopedMessageSink scopedSink(seq, &sink, WARNING_MSG);
+    // Compressed files and standard input are parsed in one forward pass, which
+    // leaves no second look at the signed bytes, so signatures are not verified
+    const bool bSequential = SequenceInput::IsSequentialPath(sFilePath);
+    SequenceInput input;
+    SignatureVerifier verifier;
+    const bool bLoaded = bSequential ? input.Load(seq, sFilePath)
+                                     : verifier.Open(sFilePath) && seq.load(verifier.Stream());
+    if (!bLoaded)
+    {
+        if (bSequential && !input.Error().empty())
+        {
+            if (!result.error.empty()) result.error += "; ";
+            result.error += input.Error();
+        }
+        if (result.error.empty()) result.error = "Failed to load " + sFilePath;
+    }
+    else
+    {
+        if (bSequential && !input.Warning().empty()) result.warnings++;
+        result.version = seq.GetVersion();
+        result.signature = bSequential ? (seq.isSigned() ? kSignatureUnverifiable : kSignatureUnsigned)
+                                       : verifier.Verify(seq.isSigned(), seq.getSignature(), seq.getSignatureType());
+        result.parserBytes = MemoryEstimator::ShapeLibrary(seq) + MemoryEstimator::EventLibraries(seq) + MemoryEstimator::BlockTable(seq);
+        result.decodedBytes = static_cast<uint64_t>(seq.GetNumberOfBlocks()) * sizeof(SeqBlock*);
+
+        // Blocks are summarized and freed one at a time, so big files running side by side stay small
+        SequenceStatistics statistics(seq.GetBlockDurationRaster_us(), seq.GetGradientRasterTime_us());
+        const int blockNum = seq.GetNumberOfBlocks();
+        result.loaded = true;
+        for (int index = 0; index < blockNum; index++)
+        {
+            std::unique_ptr<SeqBlock> spBlock(seq.GetBlock(index));
+            if (nullptr == spBlock || !seq.decodeBlock(spBlock.get()))
+            {
+                result.loaded = false;
+                if (!result.error.empty()) result.error += "; ";
+                result.error += "Decode SeqBlock failed, block index: " + std::to_string(index);
+                break;
+            }
+            statistics.Add(spBlock.get());
+            result.decodedBytes += MemoryEstimator::DecodedBlock(spBlock.get());
+        }
+        statistics.Finish();
+        result.blocks = blockNum;
+        result.statistics = statistics;
+    }
+
+    result.loadTime_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::vector<ValidationResult> SequenceValidator::ValidateAll(const std::vector<std::string>& vecFiles, const int& jobs)
+{
+    std::vector<ValidationResult> results(vecFiles.size());
+    if (vecFiles.empty()) return results;
+    // Every file routes its messages to its own result, see ValidateFile()
+
+    const size_t workerNum = std::min(vecFiles.size(), jobs > 0 ? static_cast<size_t>(jobs) : ParallelWorkerCount());
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t index = next++; index < vecFiles.size(); index = next++)
+        {
+            results[index] = ValidateFile(vecFiles[index]);
+        }
+    };
+    TaskGroup group;
+    for (size_t worker = 1; worker < workerNum; worker++)
+    {
+        group.Run(work);
+    }
+    work();
+    group.Wait();
+    return results;
+}
+
+std::vector<std::string> SequenceValidator::CollectFiles(const std::vector<std::string>& vecPaths)
+{
+    namespace fs = std::filesystem;
+    std::vector<std::string> vecFiles;
+    for (const std::string& sPath : vecPaths)
+    {
+        std::error_code ec;
+        if (fs::is_directory(sPath, ec))
+        {
+            for (fs::recursive_directory_iterator it(sPath, fs::directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec))
+            {
+                if (it->is_regular_file(ec) && (it->path().extension() == ".seq" || SequenceInput::IsSequentialPath(it->path().string())))
+                {
+                    vecFiles.push_back(it->path().string());
+                }
+            }
+        }
+        else
+        {
+            vecFiles.push_back(sPath);
+        }
+    }
+    std::sort(vecFiles.begin(), vecFiles.end());
+    vecFiles.erase(std::unique(vecFiles.begin(), vecFiles.end()), vecFiles.end());
+    return vecFiles;
+}
+
+const char* SequenceValidator::SignatureName(const SignatureStatus& status)
+{
+    switch (status)
+    {
+    case kSignatureVerified:        return "verified";
+    case kSignatureFailed:          return "mismatch";
+    case kSignatureUnverifiable:    return "not verified";
+    default:                        return "unsigned";
+    }
+}
+
+void SequenceValidator::WriteCsv(std::ostream& out, const std::vector<ValidationResult>& results)
+{
+    static const char* axes[NUM_GRADS] = {"gx", "gy", "gz"};
+    out << "path,status,error,warnings,file_size,load_time_ms,version,signature,blocks,duration_us,rf_count,rf_max_Hz";
+    for (const char* axis : axes)
+    {
+        out << "," << axis << "_count," << axis << "_min_Hz_m," << axis << "_max_Hz_m";
+    }
+    out << ",adc_count,adc_samples,parser_bytes,decoded_bytes,bytes_per_block,rf_peak_uT,rf_rms_uT,rf_duty";
+    for (const char* axis : axes)
+    {
+        out << "," << axis << "_rms_Hz_m," << axis << "_duty";
+    }
+    out << ",readout_us\n";
+
+    for (const ValidationResult& result : results)
+    {
+        const SequenceStatistics& stats = result.statistics;
+        out << CsvField(result.path) << "," << (result.loaded ? "ok" : "error") << "," << CsvField(result.error) << ","
+            << result.warnings << "," << result.fileSize << "," << FormatNumber(result.loadTime_ms) << "," << result.version << ","
+            << SignatureName(result.signature) << "," << result.blocks << "," << FormatNumber(stats.totalDuration_us) << ","
+            << stats.rfCount << "," << FormatNumber(stats.rfAmplitude_Hz.max);
+        for (const GradientStatistics& grad : stats.grad)
+        {
+            out << "," << grad.count << "," << FormatNumber(grad.amplitude_Hz_m.min) << "," << FormatNumber(grad.amplitude_Hz_m.max);
+        }
+        out << "," << stats.adcCount << "," << stats.adcSamples << "," << result.parserBytes << "," << result.decodedBytes << ","
+            << FormatNumber(BytesPerBlock(result)) << "," << FormatNumber(stats.rfPeak_uT) << "," << FormatNumber(stats.rfRms_uT) << ","
+            << FormatNumber(stats.rfDutyCycle);
+        for (const GradientStatistics& grad : stats.grad)
+        {
+            out << "," << FormatNumber(grad.rms_Hz_m) << "," << FormatNumber(grad.dutyCycle);
+        }
+        out << "," << FormatNumber(stats.readoutTime_us) << "\n";
+    }
+}
+
+void SequenceValidator::WriteJson(std::ostream& out, const std::vector<ValidationResult>& results)
+{
+    static const char* axes[NUM_GRADS] = {"gx", "gy", "gz"};
+    uint64_t failed(0);
+    for (const ValidationResult& result : results)
+    {
+        if (!result.loaded) failed++;
+    }
+
+    out << "{\n  \"files\": " << results.size() << ",\n  \"failed\": " << failed << ",\n  \"results\": [";
+    for (size_t index = 0; index < results.size(); index++)
+    {
+        const ValidationResult& result = results[index];
+        const SequenceStatistics& stats = result.statistics;
+        out << (index == 0 ? "\n" : ",\n") << "    {"
+            << "\"path\": " << JsonString(result.path)
+            << ", \"status\": " << (result.loaded ? "\"ok\"" : "\"error\"")
+            << ", \"error\": " << JsonString(result.error)
+            << ", \"warnings\": " << result.warnings
+            << ", \"file_size\": " << result.fileSize
+            << ", \"load_time_ms\": " << JsonNumber(result.loadTime_ms)
+            << ", \"version\": " << result.version
+            << ", \"signature\": " << JsonString(SignatureName(result.signature))
+            << ", \"blocks\": " << result.blocks
+            << ", \"duration_us\": " << JsonNumber(stats.totalDuration_us)
+            << ", \"rf\": {\"count\": " << stats.rfCount << ", \"max_Hz\": " << JsonNumber(stats.rfAmplitude_Hz.max)
+            << ", \"peak_uT\": " << JsonNumber(stats.rfPeak_uT) << ", \"rms_uT\": " << JsonNumber(stats.rfRms_uT)
+            << ", \"duty\": " << JsonNumber(stats.rfDutyCycle) << "}";
+        for (int channel = 0; channel < NUM_GRADS; channel++)
+        {
+            const GradientStatistics& grad = stats.grad[channel];
+            out << ", \"" << axes[channel] << "\": {\"count\": " << grad.count
+                << ", \"min_Hz_m\": " << JsonNumber(grad.amplitude_Hz_m.min) << ", \"max_Hz_m\": " << JsonNumber(grad.amplitude_Hz_m.max)
+                << ", \"rms_Hz_m\": " << JsonNumber(grad.rms_Hz_m) << ", \"duty\": " << JsonNumber(grad.dutyCycle) << "}";
+        }
+        out << ", \"adc\": {\"count\": " << stats.adcCount << ", \"samples\": " << stats.adcSamples
+            << ", \"readout_us\": " << JsonNumber(stats.readoutTime_us) << "}"
+            << ", \"memory\": {\"parser_bytes\": " << result.parserBytes << ", \"decoded_bytes\": " << result.decodedBytes
+            << ", \"bytes_per_block\": " << JsonNumber(BytesPerBlock(result)) << "}}";
+    }
+    out << (results.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
@@ -0,0 +1,55 @@
+#ifndef SEQUENCE_VALIDATOR_H
+#define SEQUENCE_VALIDATOR_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "signature_verifier.h"
+#include "sequence_statistics.h"
+#include "memory_accounting.h"
+
+// Summary of one sequence file, one row of the validation report
+struct ValidationResult
+{
+    std::string path;
+    bool loaded;
+    std::string error;                  // load or decode error, parser messages included
+    uint64_t warnings;                  // parser warnings
+    uint64_t fileSize;
+    double loadTime_ms;
+    int version;
+    SignatureStatus signature;
+    uint64_t blocks;
+    SequenceStatistics statistics;      // counts, amplitudes, RMS values and duty cycles of the decoded blocks
+    // Memory the viewer would hold for this file, see MemoryEstimator
+    uint64_t parserBytes;               // shape and event libraries, block table
+    uint64_t decodedBytes;              // all blocks decoded
+
+    ValidationResult();
+};
+
+// Loads, decodes and summarizes sequence files without Qt. Files are
+// validated concurrently, each worker takes the next file when it is done,
+// so a few large files do not hold up the rest.
+class SequenceValidator
+{
+public:
+    // Parser messages are captured into the results from here on
+    static ValidationResult Validate(const std::string& sFilePath);
+    // Results in the order of the files, jobs <= 0 uses every worker of the shared TaskPool
+    static std::vector<ValidationResult> ValidateAll(const std::vector<std::string>& vecFiles, const int& jobs);
+
+    // .seq files below the given files or directories, sorted
+    static std::vector<std::string> CollectFiles(const std::vector<std::string>& vecPaths);
+
+    static void WriteCsv(std::ostream& out, const std::vector<ValidationResult>& results);
+    static void WriteJson(std::ostream& out, const std::vector<ValidationResult>& results);
+
+    static const char* SignatureName(const SignatureStatus& status);
+
+private:
+    static ValidationResult ValidateFile(const std::string& sFilePath);
+};
+
+#endif // SEQUENCE_VALIDATOR_H
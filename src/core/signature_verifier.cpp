@@ -0,0 +1,459 @@
+#include "signature_verifier.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+static inline uint32_t RotateLeft(const uint32_t& x, const int& bits)
+{
+    return (x << bits) | (x >> (32 - bits));
+}
+
+static inline uint32_t RotateRight(const uint32_t& x, const int& bits)
+{
+    return (x >> bits) | (x << (32 - bits));
+}
+
+static inline uint32_t LoadBigEndian(const unsigned char* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static inline uint32_t LoadLittleEndian(const unsigned char* p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+// "SHA-256" -> "sha256"
+static std::string NormalizeType(const std::string& sType)
+{
+    std::string sNormalized;
+    for (const char& c : sType)
+    {
+        if (std::isalnum(static_cast<unsigned char>(c)))
+        {
+            sNormalized += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+    }
+    return sNormalized;
+}
+
+static std::string Trim(const std::string& str)
+{
+    const size_t first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return std::string();
+    const size_t last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+}
+
+// Common part of the three hashes: 64-byte blocks, 0x80 padding and a 64-bit bit count
+class BlockDigest : public Digest
+{
+public:
+    BlockDigest(const bool& bBigEndian, const int& words)
+        : m_bBigEndian(bBigEndian)
+        , m_iWords(words)
+        , m_lLength(0)
+        , m_uiBuffered(0)
+    {
+    }
+
+    void Update(const unsigned char* pData, size_t size) override
+    {
+        m_lLength += size;
+        if (m_uiBuffered > 0)
+        {
+            const size_t take = std::min(size, 64 - m_uiBuffered);
+            std::memcpy(m_buffer + m_uiBuffered, pData, take);
+            m_uiBuffered += take;
+            pData += take;
+            size -= take;
+            if (m_uiBuffered < 64) return;
+            Compress(m_buffer);
+            m_uiBuffered = 0;
+        }
+        for (; size >= 64; pData += 64, size -= 64)
+        {
+            Compress(pData);
+        }
+        std::memcpy(m_buffer, pData, size);
+        m_uiBuffered = size;
+    }
+
+    std::string Final() override
+    {
+        const uint64_t bits = m_lLength * 8;
+        unsigned char padding[64] = {0x80};
+        Update(padding, m_uiBuffered < 56 ? 56 - m_uiBuffered : 120 - m_uiBuffered);
+        unsigned char length[8];
+        for (int index = 0; index < 8; index++)
+        {
+            length[index] = static_cast<unsigned char>(bits >> (m_bBigEndian ? 56 - 8 * index : 8 * index));
+        }
+        Update(length, 8);
+
+        static const char* hex = "0123456789abcdef";
+        std::string sDigest;
+        for (int word = 0; word < m_iWords; word++)
+        {
+            for (int index = 0; index < 4; index++)
+            {
+                const unsigned char byte = static_cast<unsigned char>(m_state[word] >> (m_bBigEndian ? 24 - 8 * index : 8 * index));
+                sDigest += hex[byte >> 4];
+                sDigest += hex[byte & 0xf];
+            }
+        }
+        return sDigest;
+    }
+
+protected:
+    virtual void Compress(const unsigned char* pBlock) = 0;
+
+    uint32_t            m_state[8];
+
+private:
+    bool                m_bBigEndian;
+    int                 m_iWords;
+    uint64_t            m_lLength;
+    size_t              m_uiBuffered;
+    unsigned char       m_buffer[64];
+};
+
+class Md5Digest : public BlockDigest
+{
+public:
+    Md5Digest()
+        : BlockDigest(false, 4)
+    {
+        m_state[0] = 0x67452301;
+        m_state[1] = 0xefcdab89;
+        m_state[2] = 0x98badcfe;
+        m_state[3] = 0x10325476;
+    }
+
+protected:
+    void Compress(const unsigned char* pBlock) override
+    {
+        static const uint32_t K[64] = {
+            0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+            0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+            0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+            0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+            0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+            0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+            0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+            0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+        static const int S[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+
+        uint32_t M[16];
+        for (int index = 0; index < 16; index++)
+        {
+            M[index] = LoadLittleEndian(pBlock + 4 * index);
+        }
+        uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+        for (int step = 0; step < 64; step++)
+        {
+            const int round = step / 16;
+            uint32_t f;
+            int g;
+            switch (round)
+            {
+            case 0:  f = (b & c) | (~b & d); g = step; break;
+            case 1:  f = (d & b) | (~d & c); g = (5 * step + 1) % 16; break;
+            case 2:  f = b ^ c ^ d;          g = (3 * step + 5) % 16; break;
+            default: f = c ^ (b | ~d);       g = (7 * step) % 16; break;
+            }
+            const uint32_t rotated = RotateLeft(a + f + K[step] + M[g], S[round * 4 + step % 4]);
+            a = d;
+            d = c;
+            c = b;
+            b += rotated;
+        }
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+    }
+};
+
+class Sha1Digest : public BlockDigest
+{
+public:
+    Sha1Digest()
+        : BlockDigest(true, 5)
+    {
+        m_state[0] = 0x67452301;
+        m_state[1] = 0xefcdab89;
+        m_state[2] = 0x98badcfe;
+        m_state[3] = 0x10325476;
+        m_state[4] = 0xc3d2e1f0;
+    }
+
+protected:
+    void Compress(const unsigned char* pBlock) override
+    {
+        uint32_t W[80];
+        for (int index = 0; index < 16; index++)
+        {
+            W[index] = LoadBigEndian(pBlock + 4 * index);
+        }
+        for (int index = 16; index < 80; index++)
+        {
+            W[index] = RotateLeft(W[index - 3] ^ W[index - 8] ^ W[index - 14] ^ W[index - 16], 1);
+        }
+        uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3], e = m_state[4];
+        for (int step = 0; step < 80; step++)
+        {
+            uint32_t f, k;
+            if (step < 20)      { f = (b & c) | (~b & d);           k = 0x5a827999; }
+            else if (step < 40) { f = b ^ c ^ d;                    k = 0x6ed9eba1; }
+            else if (step < 60) { f = (b & c) | (b & d) | (c & d);  k = 0x8f1bbcdc; }
+            else                { f = b ^ c ^ d;                    k = 0xca62c1d6; }
+            const uint32_t temp = RotateLeft(a, 5) + f + e + k + W[step];
+            e = d;
+            d = c;
+            c = RotateLeft(b, 30);
+            b = a;
+            a = temp;
+        }
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+        m_state[4] += e;
+    }
+};
+
+class Sha256Digest : public BlockDigest
+{
+public:
+    Sha256Digest()
+        : BlockDigest(true, 8)
+    {
+        m_state[0] = 0x6a09e667;
+        m_state[1] = 0xbb67ae85;
+        m_state[2] = 0x3c6ef372;
+        m_state[3] = 0xa54ff53a;
+        m_state[4] = 0x510e527f;
+        m_state[5] = 0x9b05688c;
+        m_state[6] = 0x1f83d9ab;
+        m_state[7] = 0x5be0cd19;
+    }
+
+protected:
+    void Compress(const unsigned char* pBlock) override
+    {
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+        uint32_t W[64];
+        for (int index = 0; index < 16; index++)
+        {
+            W[index] = LoadBigEndian(pBlock + 4 * index);
+        }
+        for (int index = 16; index < 64; index++)
+        {
+            const uint32_t s0 = RotateRight(W[index - 15], 7) ^ RotateRight(W[index - 15], 18) ^ (W[index - 15] >> 3);
+            const uint32_t s1 = RotateRight(W[index - 2], 17) ^ RotateRight(W[index - 2], 19) ^ (W[index - 2] >> 10);
+            W[index] = W[index - 16] + s0 + W[index - 7] + s1;
+        }
+        uint32_t v[8];
+        std::memcpy(v, m_state, sizeof(v));
+        for (int step = 0; step < 64; step++)
+        {
+            const uint32_t S1 = RotateRight(v[4], 6) ^ RotateRight(v[4], 11) ^ RotateRight(v[4], 25);
+            const uint32_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+            const uint32_t temp1 = v[7] + S1 + ch + K[step] + W[step];
+            const uint32_t S0 = RotateRight(v[0], 2) ^ RotateRight(v[0], 13) ^ RotateRight(v[0], 22);
+            const uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+            const uint32_t temp2 = S0 + maj;
+            v[7] = v[6];
+            v[6] = v[5];
+            v[5] = v[4];
+            v[4] = v[3] + temp1;
+            v[3] = v[2];
+            v[2] = v[1];
+            v[1] = v[0];
+            v[0] = temp1 + temp2;
+        }
+        for (int index = 0; index < 8; index++)
+        {
+            m_state[index] += v[index];
+        }
+    }
+};
+
+std::unique_ptr<Digest> Digest::Create(const std::string& sType)
+{
+    const std::string sNormalized = NormalizeType(sType);
+    if (sNormalized == "md5") return std::unique_ptr<Digest>(new Md5Digest());
+    if (sNormalized == "sha1") return std::unique_ptr<Digest>(new Sha1Digest());
+    if (sNormalized == "sha256") return std::unique_ptr<Digest>(new Sha256Digest());
+    return nullptr;
+}
+
+DigestStreamBuf::DigestStreamBuf()
+    : m_vecBuffer(SIGNATURE_BUFFER_SIZE)
+    , m_lBufferStart(0)
+    , m_lFileSize(0)
+    , m_lSignedSize(0)
+    , m_lHashed(0)
+{
+}
+
+bool DigestStreamBuf::Open(const std::string& sFilePath)
+{
+    if (m_source.is_open()) m_source.close();
+    setg(nullptr, nullptr, nullptr);
+    m_lBufferStart = 0;
+    m_lHashed = 0;
+    m_lSignedSize = 0;
+    m_sType.clear();
+    m_spDigest.reset();
+
+    if (nullptr == m_source.open(sFilePath.c_str(), std::ios::in | std::ios::binary)) return false;
+    m_lFileSize = m_source.pubseekoff(0, std::ios::end, std::ios::in);
+    if (m_lFileSize < 0) return false;
+    if (ProbeSignature())
+    {
+        m_spDigest = Digest::Create(m_sType);
+    }
+    return m_source.pubseekpos(0, std::ios::in) == std::streampos(0);
+}
+
+bool DigestStreamBuf::ProbeSignature()
+{
+    const std::streamoff probeStart = std::max<std::streamoff>(0, m_lFileSize - SIGNATURE_PROBE_SIZE);
+    std::string sTail(static_cast<size_t>(m_lFileSize - probeStart), '\0');
+    m_source.pubseekpos(probeStart, std::ios::in);
+    if (m_source.sgetn(&sTail[0], sTail.size()) != static_cast<std::streamsize>(sTail.size())) return false;
+
+    // The section header has to start a line
+    size_t header = sTail.rfind("[SIGNATURE]");
+    while (header != std::string::npos && header > 0 && sTail[header - 1] != '\n' && sTail[header - 1] != '\r')
+    {
+        header = (header == 0) ? std::string::npos : sTail.rfind("[SIGNATURE]", header - 1);
+    }
+    if (header == std::string::npos || (header == 0 && probeStart > 0)) return false;
+
+    // The line break in front of the header is part of the signature
+    size_t signedEnd = header;
+    if (signedEnd > 0 && sTail[signedEnd - 1] == '\n') signedEnd--;
+    if (signedEnd > 0 && sTail[signedEnd - 1] == '\r') signedEnd--;
+    m_lSignedSize = probeStart + signedEnd;
+
+    size_t lineStart = sTail.find_first_of("\r\n", header);
+    while (lineStart != std::string::npos)
+    {
+        lineStart = sTail.find_first_not_of("\r\n", lineStart);
+        if (lineStart == std::string::npos || sTail[lineStart] == '[') break;
+        const size_t lineEnd = sTail.find_first_of("\r\n", lineStart);
+        const std::string sLine = sTail.substr(lineStart, lineEnd == std::string::npos ? std::string::npos : lineEnd - lineStart);
+        if (sLine.compare(0, 4, "Type") == 0 && sLine.size() > 4 && std::isspace(static_cast<unsigned char>(sLine[4])))
+        {
+            m_sType = Trim(sLine.substr(4));
+        }
+        lineStart = lineEnd;
+    }
+    // Files written before the type was recorded are signed with MD5
+    if (m_sType.empty()) m_sType = "md5";
+    return true;
+}
+
+bool DigestStreamBuf::Fill(const std::streamoff& position)
+{
+    if (position >= m_lFileSize) return false;
+    if (m_source.pubseekpos(position, std::ios::in) != std::streampos(position)) return false;
+    const std::streamsize count = m_source.sgetn(m_vecBuffer.data(), m_vecBuffer.size());
+    if (count <= 0) return false;
+    m_lBufferStart = position;
+    setg(m_vecBuffer.data(), m_vecBuffer.data(), m_vecBuffer.data() + count);
+
+    // Only bytes right after the hashed part are hashed, a seek back does not hash twice
+    if (nullptr != m_spDigest && m_lHashed >= position && m_lHashed < position + count && m_lHashed < m_lSignedSize)
+    {
+        const std::streamoff end = std::min<std::streamoff>(position + count, m_lSignedSize);
+        m_spDigest->Update(reinterpret_cast<const unsigned char*>(m_vecBuffer.data() + (m_lHashed - position)), end - m_lHashed);
+        m_lHashed = end;
+    }
+    return true;
+}
+
+DigestStreamBuf::int_type DigestStreamBuf::underflow()
+{
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    if (!Fill(m_lBufferStart + (egptr() - eback()))) return traits_type::eof();
+    return traits_type::to_int_type(*gptr());
+}
+
+DigestStreamBuf::pos_type DigestStreamBuf::seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode mode)
+{
+    if (!(mode & std::ios_base::in)) return pos_type(off_type(-1));
+    std::streamoff target = offset;
+    if (dir == std::ios_base::cur) target += m_lBufferStart + (gptr() - eback());
+    else if (dir == std::ios_base::end) target += m_lFileSize;
+    if (target < 0 || target > m_lFileSize) return pos_type(off_type(-1));
+
+    // Seeks inside the buffer, e.g. tellg(), keep the buffered bytes
+    if (nullptr != eback() && target >= m_lBufferStart && target <= m_lBufferStart + (egptr() - eback()))
+    {
+        setg(eback(), eback() + (target - m_lBufferStart), egptr());
+    }
+    else
+    {
+        setg(nullptr, nullptr, nullptr);
+        m_lBufferStart = target;
+    }
+    return pos_type(target);
+}
+
+DigestStreamBuf::pos_type DigestStreamBuf::seekpos(pos_type position, std::ios_base::openmode mode)
+{
+    return seekoff(off_type(position), std::ios_base::beg, mode);
+}
+
+std::string DigestStreamBuf::Finish()
+{
+    if (nullptr == m_spDigest) return std::string();
+    // Whatever the parser skipped
+    while (m_lHashed < m_lSignedSize)
+    {
+        if (!Fill(m_lHashed)) break;
+    }
+    setg(nullptr, nullptr, nullptr);
+    m_lBufferStart = 0;
+    if (m_lHashed < m_lSignedSize) return std::string();
+    const std::string sDigest = m_spDigest->Final();
+    m_spDigest.reset();
+    return sDigest;
+}
+
+SignatureVerifier::SignatureVerifier()
+    : m_stream(&m_buffer)
+{
+}
+
+bool SignatureVerifier::Open(const std::string& sFilePath)
+{
+    m_sComputed.clear();
+    m_stream.clear();
+    return m_buffer.Open(sFilePath);
+}
+
+SignatureStatus SignatureVerifier::Verify(const bool& bSigned, const std::string& sExpectedHash, const std::string& sExpectedType)
+{
+    if (!bSigned) return kSignatureUnsigned;
+    if (!m_buffer.IsDigesting()) return kSignatureUnverifiable;
+    if (!sExpectedType.empty() && NormalizeType(sExpectedType) != NormalizeType(m_buffer.Type())) return kSignatureUnverifiable;
+
+    m_sComputed = m_buffer.Finish();
+    if (m_sComputed.empty()) return kSignatureUnverifiable;
+    return NormalizeType(sExpectedHash) == m_sComputed ? kSignatureVerified : kSignatureFailed;
+}
@@ -0,0 +1,95 @@
+#ifndef SIGNATURE_VERIFIER_H
+#define SIGNATURE_VERIFIER_H
+
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#define SIGNATURE_BUFFER_SIZE       (1 << 16)
+#define SIGNATURE_PROBE_SIZE        (1 << 14)
+
+enum SignatureStatus
+{
+    kSignatureUnsigned = 0,
+    kSignatureVerified,
+    kSignatureFailed,
+    kSignatureUnverifiable      // unsupported hash type, or the signature is not the last section
+};
+
+// Incremental MD5, SHA-1 or SHA-256, the hash types a Pulseq signature may name
+class Digest
+{
+public:
+    virtual ~Digest() {}
+    virtual void Update(const unsigned char* pData, size_t size) = 0;
+    // Lower case hex string, the digest can not be updated afterwards
+    virtual std::string Final() = 0;
+
+    // Accepts e.g. "md5", "SHA1", "sha-256". Returns nullptr for unsupported types.
+    static std::unique_ptr<Digest> Create(const std::string& sType);
+};
+
+// Reads a file and hashes the signed part of it on the way. A Pulseq signature
+// covers the file up to, not including, the line break in front of
+// [SIGNATURE], which is the last section. Bytes are hashed when the parser
+// first reads them; re-reading after a seek does not hash anything twice, so
+// the sequential pass of ExternalSequence::buildFileIndex() hashes the file
+// without extra I/O.
+class DigestStreamBuf : public std::streambuf
+{
+public:
+    DigestStreamBuf();
+
+    // Looks for [SIGNATURE] in the last SIGNATURE_PROBE_SIZE bytes to learn the hash type up front
+    bool Open(const std::string& sFilePath);
+    // Hashes what the parser has not read and returns the lower case hex digest
+    std::string Finish();
+
+    inline const std::string& Type() const { return m_sType; }
+    inline bool IsDigesting() const { return nullptr != m_spDigest; }
+
+protected:
+    int_type underflow() override;
+    pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode mode) override;
+    pos_type seekpos(pos_type position, std::ios_base::openmode mode) override;
+
+private:
+    bool Fill(const std::streamoff& position);
+    bool ProbeSignature();
+
+    std::filebuf                        m_source;
+    std::vector<char>                   m_vecBuffer;
+    std::streamoff                      m_lBufferStart;     // file offset of m_vecBuffer[0]
+    std::streamoff                      m_lFileSize;
+    std::streamoff                      m_lSignedSize;      // bytes covered by the signature
+    std::streamoff                      m_lHashed;          // bytes fed to the digest so far
+    std::string                         m_sType;
+    std::unique_ptr<Digest>             m_spDigest;
+};
+
+// Single .seq file opened for parsing with its signature checked on the way
+class SignatureVerifier
+{
+public:
+    SignatureVerifier();
+
+    bool Open(const std::string& sFilePath);
+    inline std::istream& Stream() { return m_stream; }
+
+    // Call after parsing with the parsed signature; expected hash and type come from the [SIGNATURE] section
+    SignatureStatus Verify(const bool& bSigned, const std::string& sExpectedHash, const std::string& sExpectedType);
+
+    inline const std::string& Type() const { return m_buffer.Type(); }
+    inline const std::string& Computed() const { return m_sComputed; }
+
+private:
+    DigestStreamBuf                     m_buffer;
+    std::istream                        m_stream;
+    std::string                         m_sComputed;
+};
+
+#endif // SIGNATURE_VERIFIER_H
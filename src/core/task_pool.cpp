@@ -0,0 +1,228 @@
+#include "task_pool.h"
+
+#include <algorithm>
+#include <iterator>
+
+static std::atomic<size_t> s_lConfiguredWorkers(0);
+static std::atomic<bool> s_bInstanceCreated(false);
+
+// Worker identity of the current thread, a thread belongs to at most one pool
+static thread_local TaskPool* s_pWorkerPool = nullptr;
+static thread_local size_t s_lWorkerIndex = 0;
+static thread_local TaskPriority s_eCurrentPriority = kTaskNormal;
+
+TaskPool::TaskPool(const size_t& workers)
+    : m_lNextQueue(0)
+    , m_lBackgroundRunning(0)
+    , m_lGeneration(0)
+    , m_bStop(false)
+{
+    size_t count = workers;
+    if (count == 0)
+    {
+        const unsigned int hw = std::thread::hardware_concurrency();
+        count = hw > 0 ? hw : 1;
+    }
+    m_lBackgroundLimit = count > 1 ? count - 1 : 1;
+    m_vecQueues.reserve(count);
+    for (size_t index = 0; index < count; index++)
+    {
+        m_vecQueues.push_back(std::make_unique<Queue>());
+    }
+    m_vecWorkers.reserve(count);
+    for (size_t index = 0; index < count; index++)
+    {
+        m_vecWorkers.emplace_back([this, index]() { WorkerLoop(index); });
+    }
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_cvWork.notify_all();
+    for (std::thread& worker : m_vecWorkers)
+    {
+        worker.join();
+    }
+}
+
+bool TaskPool::Configure(const size_t& workers)
+{
+    if (s_bInstanceCreated.load()) return false;
+    s_lConfiguredWorkers = workers;
+    return true;
+}
+
+TaskPool& TaskPool::Instance()
+{
+    static TaskPool pool([]() {
+        s_bInstanceCreated = true;
+        return s_lConfiguredWorkers.load();
+    }());
+    return pool;
+}
+
+TaskPriority TaskPool::CurrentPriority()
+{
+    return s_eCurrentPriority;
+}
+
+void TaskPool::Notify(const bool& bAll)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lGeneration++;
+    }
+    bAll ? m_cvWork.notify_all() : m_cvWork.notify_one();
+}
+
+void TaskPool::Submit(std::function<void()> task, const TaskPriority& priority, const void* pGroup)
+{
+    // A worker keeps what it splits off close at hand, others spread their tasks
+    const size_t index = s_pWorkerPool == this ? s_lWorkerIndex : m_lNextQueue++ % m_vecQueues.size();
+    {
+        Queue& queue = *m_vecQueues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks[priority].push_back({std::move(task), priority, pGroup});
+    }
+    Notify(false);
+}
+
+bool TaskPool::TryPop(const size_t& first, const bool& bLimitBackground, const void* pGroup, Task& task)
+{
+    const size_t count = m_vecQueues.size();
+    for (int priority = 0; priority < kTaskPriorityNum; priority++)
+    {
+        if (priority == kTaskBackground && bLimitBackground && m_lBackgroundRunning.load() >= m_lBackgroundLimit) break;
+        for (size_t offset = 0; offset < count; offset++)
+        {
+            const bool bOwn = offset == 0 && s_pWorkerPool == this;
+            Queue& queue = *m_vecQueues[(first + offset) % count];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            std::deque<Task>& tasks = queue.tasks[priority];
+            // Own tasks newest first while their data is still in cache, stolen ones oldest first
+            auto match = [pGroup](const Task& candidate) { return nullptr == pGroup || candidate.group == pGroup; };
+            auto it = tasks.end();
+            if (bOwn)
+            {
+                auto rit = std::find_if(tasks.rbegin(), tasks.rend(), match);
+                if (rit != tasks.rend()) it = std::prev(rit.base());
+            }
+            else
+            {
+                it = std::find_if(tasks.begin(), tasks.end(), match);
+            }
+            if (it == tasks.end()) continue;
+            // The slot is taken together with the task, two workers cannot both pass the limit
+            if (priority == kTaskBackground && bLimitBackground && !ReserveBackground()) return false;
+            task = std::move(*it);
+            tasks.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskPool::ReserveBackground()
+{
+    size_t running = m_lBackgroundRunning.load();
+    do
+    {
+        if (running >= m_lBackgroundLimit) return false;
+    } while (!m_lBackgroundRunning.compare_exchange_weak(running, running + 1));
+    return true;
+}
+
+void TaskPool::Execute(Task& task, const bool& bReservedBackground)
+{
+    const bool bBackground = bReservedBackground && task.priority == kTaskBackground;
+    const TaskPriority ePrevious = s_eCurrentPriority;
+    s_eCurrentPriority = task.priority;
+    task.run();
+    s_eCurrentPriority = ePrevious;
+    task.run = nullptr;
+    if (bBackground)
+    {
+        m_lBackgroundRunning--;
+        // A worker may have passed over background tasks while the limit was reached
+        Notify(true);
+    }
+}
+
+bool TaskPool::RunOne(const void* pGroup)
+{
+    // A waiting thread already holds its slot, it helps whatever the priority
+    const size_t first = s_pWorkerPool == this ? s_lWorkerIndex : 0;
+    Task task;
+    if (!TryPop(first, false, pGroup, task)) return false;
+    Execute(task, false);
+    return true;
+}
+
+void TaskPool::WorkerLoop(const size_t& index)
+{
+    s_pWorkerPool = this;
+    s_lWorkerIndex = index;
+    while (true)
+    {
+        uint64_t generation(0);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_bStop) return;
+            generation = m_lGeneration;
+        }
+        Task task;
+        if (TryPop(index, true, nullptr, task))
+        {
+            Execute(task, true);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cvWork.wait(lock, [this, generation]() { return m_bStop || m_lGeneration != generation; });
+    }
+}
+
+TaskGroup::TaskGroup(const TaskPriority& priority, TaskPool& pool)
+    : m_pool(pool)
+    , m_ePriority(priority)
+    , m_spState(std::make_shared<State>())
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    Wait();
+}
+
+void TaskGroup::Run(std::function<void()> task)
+{
+    Run(std::move(task), m_ePriority);
+}
+
+void TaskGroup::Run(std::function<void()> task, const TaskPriority& priority)
+{
+    std::shared_ptr<State> spState = m_spState;
+    spState->outstanding++;
+    m_pool.Submit([spState, task = std::move(task)]() {
+        task();
+        if (--spState->outstanding == 0)
+        {
+            std::lock_guard<std::mutex> lock(spState->mutex);
+            spState->done.notify_all();
+        }
+    }, priority, spState.get());
+}
+
+void TaskGroup::Wait()
+{
+    while (m_spState->outstanding.load() > 0)
+    {
+        if (m_pool.RunOne(m_spState.get())) continue;
+        // Everything left is running elsewhere
+        std::unique_lock<std::mutex> lock(m_spState->mutex);
+        m_spState->done.wait(lock, [this]() { return m_spState->outstanding.load() == 0; });
+    }
+}
@@ -0,0 +1,120 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pending tasks of a higher priority are always taken first
+enum TaskPriority
+{
+    kTaskInteractive = 0,   // loading and render preparation the user waits for
+    kTaskNormal      = 1,   // analyses and exports started from a menu
+    kTaskBackground  = 2,   // prefetching and other work nobody waits for
+    kTaskPriorityNum = 3
+};
+
+// Application-wide worker threads shared by loading, analysis and export.
+// Every worker owns a queue per priority: tasks submitted from a worker go to
+// its own queue and are taken back newest first, idle workers steal the
+// oldest task of another queue. Background tasks never occupy more than all
+// but one worker, so an interactive task always finds a thread soon. A thread
+// waiting for a TaskGroup runs the pending tasks of that group meanwhile, so
+// nested ParallelFor() calls progress even when every worker is waiting, and
+// the GUI thread never picks up somebody else's load.
+class TaskPool
+{
+public:
+    explicit TaskPool(const size_t& workers);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    // Worker count of the shared pool, 0 for one per core. Only effective
+    // before the first Instance() call.
+    static bool Configure(const size_t& workers);
+    static TaskPool& Instance();
+
+    void Submit(std::function<void()> task, const TaskPriority& priority = kTaskNormal, const void* pGroup = nullptr);
+    // Runs one pending task of the group on the calling thread, false if there was none
+    bool RunOne(const void* pGroup);
+
+    inline size_t WorkerCount() const { return m_vecWorkers.size(); }
+    // Priority of the task running on this thread, kTaskNormal outside of tasks
+    static TaskPriority CurrentPriority();
+
+private:
+    struct Task
+    {
+        std::function<void()> run;
+        TaskPriority priority;
+        const void* group;
+    };
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks[kTaskPriorityNum];
+    };
+
+    void WorkerLoop(const size_t& index);
+    // Any task if pGroup is nullptr
+    bool TryPop(const size_t& first, const bool& bLimitBackground, const void* pGroup, Task& task);
+    // Takes one of the m_lBackgroundLimit slots, false if all are in use
+    bool ReserveBackground();
+    // A background task popped with bLimitBackground releases its slot afterwards
+    void Execute(Task& task, const bool& bReservedBackground);
+    void Notify(const bool& bAll);
+
+    std::vector<std::unique_ptr<Queue>>     m_vecQueues;
+    std::vector<std::thread>                m_vecWorkers;
+    std::atomic<size_t>                     m_lNextQueue;
+    std::atomic<size_t>                     m_lBackgroundRunning;
+    size_t                                  m_lBackgroundLimit;
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_cvWork;
+    uint64_t                                m_lGeneration;      // bumped whenever a task may have become runnable
+    bool                                    m_bStop;
+};
+
+// Tasks waited for together. Tasks run at the priority the group was created
+// with, by default the one of the task creating it, so the work split off an
+// interactive load stays interactive.
+class TaskGroup
+{
+public:
+    explicit TaskGroup(const TaskPriority& priority = TaskPool::CurrentPriority(), TaskPool& pool = TaskPool::Instance());
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void Run(std::function<void()> task);
+    // A task of the group at another priority, e.g. a load among analyses
+    void Run(std::function<void()> task, const TaskPriority& priority);
+    // Returns once every task run so far has finished, runs pending tasks meanwhile
+    void Wait();
+    inline bool IsIdle() const { return m_spState->outstanding.load() == 0; }
+
+private:
+    struct State
+    {
+        std::atomic<size_t> outstanding;
+        std::mutex mutex;
+        std::condition_variable done;
+        State() : outstanding(0) {}
+    };
+
+    TaskPool&                               m_pool;
+    TaskPriority                            m_ePriority;
+    std::shared_ptr<State>                  m_spState;
+};
+
+#endif // TASK_POOL_H
@@ -0,0 +1,286 @@
+#include "waveform_exporter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+WaveformExporter::WaveformExporter(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us, const double& gradRasterTime_us)
+    : m_vecBlocks(blocks)
+    , m_vecBlockStart_us(vecBlockStart_us)
+    , m_dGradRasterTime_us(gradRasterTime_us)
+{
+}
+
+uint64_t WaveformExporter::SampleCount(const ExportOptions& options)
+{
+    if (options.raster_us <= 0. || options.end_us <= options.start_us) return 0;
+    return static_cast<uint64_t>(std::ceil((options.end_us - options.start_us) / options.raster_us - 1e-9));
+}
+
+std::string WaveformExporter::ChannelName(const int& channel)
+{
+    switch (channel)
+    {
+    case kExportRfMagnitude: return "rf_magnitude";
+    case kExportRfPhase:     return "rf_phase";
+    case kExportGx:          return "gx";
+    case kExportGy:          return "gy";
+    case kExportGz:          return "gz";
+    case kExportAdc:         return "adc";
+    }
+    return "unknown";
+}
+
+std::string WaveformExporter::ChannelUnit(const int& channel)
+{
+    switch (channel)
+    {
+    case kExportRfMagnitude: return "Hz";
+    case kExportRfPhase:     return "rad";
+    case kExportGx:
+    case kExportGy:
+    case kExportGz:          return "Hz/m";
+    case kExportAdc:         return "gate";
+    }
+    return "";
+}
+
+void WaveformExporter::FillBlock(const size_t& blockIndex, const double& dFirstTime_us, const double& raster_us,
+                                 const size_t& count, float* pOut) const
+{
+    std::fill(pOut, pOut + count * EXPORT_CHANNEL_NUM, 0.f);
+    SeqBlock* pBlock = m_vecBlocks[blockIndex];
+    const double dFirst_us = dFirstTime_us - m_vecBlockStart_us[blockIndex];
+
+    // RF is sample-and-hold on its dwell time
+    if (pBlock->isRF())
+    {
+        const RFEvent& rf = pBlock->GetRFEvent();
+        const float* pAmplitude = pBlock->GetRFAmplitudePtr();
+        const float* pPhase = pBlock->GetRFPhasePtr();
+        const int length = pBlock->GetRFLength();
+        const double dwell = pBlock->GetRFDwellTime();
+        for (size_t index = 0; index < count; index++)
+        {
+            const double position = (dFirst_us + index * raster_us - rf.delay) / dwell;
+            if (position < 0. || position >= length) continue;
+            const int sample = static_cast<int>(position);
+            pOut[index * EXPORT_CHANNEL_NUM + kExportRfMagnitude] = rf.amplitude * pAmplitude[sample];
+            pOut[index * EXPORT_CHANNEL_NUM + kExportRfPhase] = pPhase[sample] + rf.phaseOffset;
+        }
+    }
+
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        if (pBlock->GetEventIndex(static_cast<Event>(GX + channel)) <= 0) continue;
+        const GradEvent& grad = pBlock->GetGradEvent(channel);
+        float* pChannel = pOut + kExportGx + channel;
+
+        if (pBlock->isTrapGradient(channel))
+        {
+            const double rampUpEnd = grad.rampUpTime;
+            const double flatEnd = rampUpEnd + grad.flatTime;
+            const double rampDownEnd = flatEnd + grad.rampDownTime;
+            for (size_t index = 0; index < count; index++)
+            {
+                const double t = dFirst_us + index * raster_us - grad.delay;
+                double shape(0.);
+                if (t <= 0. || t >= rampDownEnd) shape = 0.;
+                else if (t < rampUpEnd) shape = t / rampUpEnd;
+                else if (t <= flatEnd) shape = 1.;
+                else shape = (rampDownEnd - t) / grad.rampDownTime;
+                pChannel[index * EXPORT_CHANNEL_NUM] = grad.amplitude * shape;
+            }
+        }
+        else if (pBlock->isArbitraryGradient(channel))
+        {
+            // Samples sit at the centers of the gradient raster intervals
+            const int length = pBlock->GetArbGradNumSamples(channel);
+            const float* pShape = pBlock->GetArbGradShapePtr(channel);
+            if (length <= 0) continue;
+            for (size_t index = 0; index < count; index++)
+            {
+                const double t = dFirst_us + index * raster_us - grad.delay;
+                if (t < 0. || t > length * m_dGradRasterTime_us) continue;
+                const double position = std::min(std::max(t / m_dGradRasterTime_us - 0.5, 0.), length - 1.);
+                const int sample = std::min(static_cast<int>(position), length - 1);
+                const int next = std::min(sample + 1, length - 1);
+                const double weight = position - sample;
+                pChannel[index * EXPORT_CHANNEL_NUM] = grad.amplitude * (pShape[sample] * (1. - weight) + pShape[next] * weight);
+            }
+        }
+        else if (pBlock->isExtTrapGradient(channel))
+        {
+            // Sample times only move forward, so the segment is tracked incrementally
+            const std::vector<long>& vecTimes = pBlock->GetExtTrapGradTimes(channel);
+            const std::vector<float>& vecShape = pBlock->GetExtTrapGradShape(channel);
+            if (vecTimes.size() < 2) continue;
+            size_t segment(0);
+            for (size_t index = 0; index < count; index++)
+            {
+                const double t = dFirst_us + index * raster_us - grad.delay;
+                if (t < vecTimes.front() || t > vecTimes.back()) continue;
+                while (segment + 2 < vecTimes.size() && t > vecTimes[segment + 1]) segment++;
+                const double span = vecTimes[segment + 1] - vecTimes[segment];
+                const double weight = span > 0. ? (t - vecTimes[segment]) / span : 0.;
+                pChannel[index * EXPORT_CHANNEL_NUM] = grad.amplitude * (vecShape[segment] * (1. - weight) + vecShape[segment + 1] * weight);
+            }
+        }
+    }
+
+    if (pBlock->isADC())
+    {
+        const ADCEvent& adc = pBlock->GetADCEvent();
+        const double duration_us = adc.dwellTime * adc.numSamples * 1e-3;
+        for (size_t index = 0; index < count; index++)
+        {
+            const double t = dFirst_us + index * raster_us - adc.delay;
+            pOut[index * EXPORT_CHANNEL_NUM + kExportAdc] = (t >= 0. && t < duration_us) ? 1.f : 0.f;
+        }
+    }
+}
+
+void WaveformExporter::Sample(const double& start_us, const double& raster_us, const uint64_t& count, float* pOut) const
+{
+    if (m_vecBlocks.empty())
+    {
+        std::fill(pOut, pOut + count * EXPORT_CHANNEL_NUM, 0.f);
+        return;
+    }
+
+    const double dTotal_us = m_vecBlockStart_us.back();
+    const size_t blockNum = m_vecBlocks.size();
+    size_t block = std::upper_bound(m_vecBlockStart_us.begin(), m_vecBlockStart_us.end() - 1, start_us) - m_vecBlockStart_us.begin();
+    block = block > 0 ? block - 1 : 0;
+
+    uint64_t sample = 0;
+    while (sample < count)
+    {
+        const double t = start_us + sample * raster_us;
+        float* pSample = pOut + sample * EXPORT_CHANNEL_NUM;
+        if (t >= dTotal_us || t < 0.)
+        {
+            std::fill(pSample, pSample + EXPORT_CHANNEL_NUM, 0.f);
+            sample++;
+            continue;
+        }
+        while (block + 1 < blockNum && m_vecBlockStart_us[block + 1] <= t) block++;
+
+        // All samples falling into the current block
+        const double position = (m_vecBlockStart_us[block + 1] - start_us) / raster_us;
+        uint64_t last = static_cast<uint64_t>(std::max(0., std::ceil(position - 1e-9)));
+        last = std::min(count, std::max(last, sample + 1));
+        FillBlock(block, t, raster_us, static_cast<size_t>(last - sample), pSample);
+        sample = last;
+    }
+}
+
+std::string WaveformExporter::NpyHeader(const uint64_t& samples)
+{
+    std::ostringstream dict;
+    dict << "{'descr': '<f4', 'fortran_order': False, 'shape': (" << samples << ", " << EXPORT_CHANNEL_NUM << "), }";
+    std::string header = dict.str();
+
+    // Magic, version 1.0 and the header length; the whole preamble is padded to 64 bytes
+    const size_t preamble = 10;
+    const size_t padded = ((preamble + header.size() + 1 + 63) / 64) * 64;
+    header.append(padded - preamble - header.size() - 1, ' ');
+    header.push_back('\n');
+
+    std::string result("\x93NUMPY\x01\x00", 8);
+    result.push_back(static_cast<char>(header.size() & 0xff));
+    result.push_back(static_cast<char>((header.size() >> 8) & 0xff));
+    return result + header;
+}
+
+std::string WaveformExporter::JsonHeader(const ExportOptions& options, const uint64_t& samples, const std::string& sDataFile)
+{
+    auto quoted = [](const std::string& text) {
+        std::string result("\"");
+        for (const char& c : text)
+        {
+            if (c == '"' || c == '\\') result.push_back('\\');
+            result.push_back(c);
+        }
+        return result + "\"";
+    };
+
+    std::ostringstream json;
+    json.precision(17);
+    json << "{\n"
+         << "    \"dataFile\": " << quoted(sDataFile) << ",\n"
+         << "    \"sourceFile\": " << quoted(options.sSourceFile) << ",\n"
+         << "    \"format\": " << quoted(options.format == kExportNpy ? "npy" : "raw") << ",\n"
+         << "    \"dtype\": \"float32\",\n"
+         << "    \"byteOrder\": \"little\",\n"
+         << "    \"layout\": \"sample-major\",\n"
+         << "    \"shape\": [" << samples << ", " << EXPORT_CHANNEL_NUM << "],\n"
+         << "    \"start_us\": " << options.start_us << ",\n"
+         << "    \"raster_us\": " << options.raster_us << ",\n"
+         << "    \"channels\": [\n";
+    for (int channel = 0; channel < EXPORT_CHANNEL_NUM; channel++)
+    {
+        json << "        {\"name\": " << quoted(ChannelName(channel)) << ", \"unit\": " << quoted(ChannelUnit(channel)) << "}"
+             << (channel + 1 < EXPORT_CHANNEL_NUM ? ",\n" : "\n");
+    }
+    json << "    ]\n}\n";
+    return json.str();
+}
+
+bool WaveformExporter::Export(const std::string& sFilePath, const ExportOptions& options,
+                              const std::function<void(int)>& progress, std::string& sError) const
+{
+    const uint64_t samples = SampleCount(options);
+    if (samples == 0 || m_vecBlocks.empty())
+    {
+        sError = "Nothing to export, check the time range and raster!";
+        return false;
+    }
+
+    std::ofstream file(sFilePath, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        sError = "Cannot create " + sFilePath;
+        return false;
+    }
+    if (options.format == kExportNpy)
+    {
+        const std::string header = NpyHeader(samples);
+        file.write(header.data(), header.size());
+    }
+
+    std::vector<float> vecChunk(static_cast<size_t>(EXPORT_CHUNK_SAMPLES) * EXPORT_CHANNEL_NUM, 0.f);
+    int lastPercent(-1);
+    for (uint64_t chunkBegin = 0; chunkBegin < samples; chunkBegin += EXPORT_CHUNK_SAMPLES)
+    {
+        const uint64_t chunkEnd = std::min<uint64_t>(samples, chunkBegin + EXPORT_CHUNK_SAMPLES);
+        Sample(options.start_us + chunkBegin * options.raster_us, options.raster_us, chunkEnd - chunkBegin, vecChunk.data());
+
+        file.write(reinterpret_cast<const char*>(vecChunk.data()), (chunkEnd - chunkBegin) * EXPORT_CHANNEL_NUM * sizeof(float));
+        if (!file)
+        {
+            sError = "Writing " + sFilePath + " failed!";
+            return false;
+        }
+
+        const int percent = static_cast<int>(chunkEnd * 100 / samples);
+        if (progress && percent != lastPercent)
+        {
+            progress(percent);
+            lastPercent = percent;
+        }
+    }
+    file.close();
+
+    std::ofstream json(sFilePath + ".json", std::ios::trunc);
+    const size_t separator = sFilePath.find_last_of("/\\");
+    json << JsonHeader(options, samples, separator == std::string::npos ? sFilePath : sFilePath.substr(separator + 1));
+    if (!json)
+    {
+        sError = "Writing " + sFilePath + ".json failed!";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef WAVEFORM_EXPORTER_H
+#define WAVEFORM_EXPORTER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <ExternalSequence.h>
+
+#define EXPORT_CHANNEL_NUM     (6)
+#define EXPORT_CHUNK_SAMPLES   (65536)
+
+enum ExportFormat
+{
+    kExportNpy = 0,     // NumPy .npy, float32 array of shape (samples, channels)
+    kExportRaw          // headerless little-endian float32, same layout
+};
+
+enum ExportChannel
+{
+    kExportRfMagnitude = 0,
+    kExportRfPhase,
+    kExportGx,
+    kExportGy,
+    kExportGz,
+    kExportAdc
+};
+
+struct ExportOptions
+{
+    double start_us;
+    double end_us;
+    double raster_us;
+    ExportFormat format;
+    std::string sSourceFile;    // recorded in the JSON header only
+
+    ExportOptions()
+        : start_us(0.)
+        , end_us(0.)
+        , raster_us(10.)
+        , format(kExportNpy)
+    {}
+};
+
+// Samples RF magnitude/phase, GX/GY/GZ and the ADC gate of decoded blocks on
+// a uniform raster and streams them to disk chunk by chunk, so memory stays
+// constant and the cost is dominated by the file writes. A JSON header
+// describing the layout is written next to the data file.
+class WaveformExporter
+{
+public:
+    WaveformExporter(const std::vector<SeqBlock*>& blocks, const std::vector<double>& vecBlockStart_us, const double& gradRasterTime_us);
+
+    static uint64_t SampleCount(const ExportOptions& options);
+    static std::string ChannelName(const int& channel);
+    static std::string ChannelUnit(const int& channel);
+
+    // count samples from start_us on, EXPORT_CHANNEL_NUM interleaved floats per
+    // sample and zeros outside the sequence. Const, so threads may sample
+    // separate windows at the same time.
+    void Sample(const double& start_us, const double& raster_us, const uint64_t& count, float* pOut) const;
+
+    // progress(percent) is called from the calling thread whenever the percentage changes
+    bool Export(const std::string& sFilePath, const ExportOptions& options,
+                const std::function<void(int)>& progress, std::string& sError) const;
+
+private:
+    void FillBlock(const size_t& blockIndex, const double& dFirstTime_us, const double& raster_us,
+                   const size_t& count, float* pOut) const;
+    static std::string NpyHeader(const uint64_t& samples);
+    static std::string JsonHeader(const ExportOptions& options, const uint64_t& samples, const std::string& sDataFile);
+
+    std::vector<SeqBlock*>      m_vecBlocks;
+    std::vector<double>         m_vecBlockStart_us;     // blocks + 1 entries
+    double                      m_dGradRasterTime_us;
+};
+
+#endif // WAVEFORM_EXPORTER_H
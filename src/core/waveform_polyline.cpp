@@ -0,0 +1,172 @@
+#include "waveform_polyline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static const double kGap = std::numeric_limits<double>::quiet_NaN();
+
+// Gradients are shown in kHz/m
+#define GRAD_DISPLAY_SCALE   (1e-3)
+
+static void AppendGap(std::vector<double>& time, std::vector<double>& value)
+{
+    time.push_back(time.empty() ? 0. : time.back());
+    value.push_back(kGap);
+}
+
+static void AppendBox(const double& start, const double& end, const double& lower, const double& upper,
+                      std::vector<double>& time, std::vector<double>& value)
+{
+    time.insert(time.end(), {start, start, start, end, end, end});
+    value.insert(value.end(), {0., lower, upper, upper, lower, 0.});
+    AppendGap(time, value);
+}
+
+WaveformPolyline::WaveformPolyline(const double& gradRasterTime_us)
+    : m_dGradRasterTime_us(gradRasterTime_us)
+{
+}
+
+std::string WaveformPolyline::LaneName(const int& lane)
+{
+    switch (lane)
+    {
+    case kLaneRf:  return "RF";
+    case kLaneGz:  return "GZ";
+    case kLaneGy:  return "GY";
+    case kLaneGx:  return "GX";
+    case kLaneAdc: return "ADC";
+    }
+    return "";
+}
+
+std::string WaveformPolyline::LaneLabel(const int& lane)
+{
+    switch (lane)
+    {
+    case kLaneRf:  return "RF (Hz)";
+    case kLaneGz:  return "GZ (kHz/m)";
+    case kLaneGy:  return "GY (kHz/m)";
+    case kLaneGx:  return "GX (kHz/m)";
+    case kLaneAdc: return "ADC";
+    }
+    return "";
+}
+
+int WaveformPolyline::LaneFromName(const std::string& sName)
+{
+    for (int lane = 0; lane < kLaneNum; lane++)
+    {
+        if (LaneName(lane) == sName) return lane;
+    }
+    return -1;
+}
+
+void WaveformPolyline::AppendBlock(SeqBlock* pBlock, const double& dBlockStart_us, const int& lane, const double& minEventWidth_us,
+                                   std::vector<double>& time, std::vector<double>& value) const
+{
+    switch (lane)
+    {
+    case kLaneRf:
+    {
+        if (!pBlock->isRF()) return;
+        const RFEvent& rf = pBlock->GetRFEvent();
+        const float* pAmplitude = pBlock->GetRFAmplitudePtr();
+        const int length = pBlock->GetRFLength();
+        const double dwell = pBlock->GetRFDwellTime();
+        const double start = dBlockStart_us + rf.delay;
+        const double end = start + length * dwell;
+        if (length <= 0) return;
+        if (end - start < minEventWidth_us)
+        {
+            const auto range = std::minmax_element(pAmplitude, pAmplitude + length);
+            AppendBox(start, end, std::min(0., rf.amplitude * (double)*range.first), std::max(0., rf.amplitude * (double)*range.second), time, value);
+            return;
+        }
+        // Sample-and-hold, as drawn by the main view
+        time.push_back(start);
+        value.push_back(0.);
+        for (int index = 0; index < length; index++)
+        {
+            const double sample = rf.amplitude * pAmplitude[index];
+            time.push_back(start + index * dwell);
+            value.push_back(sample);
+            time.push_back(start + (index + 1) * dwell);
+            value.push_back(sample);
+        }
+        time.push_back(end);
+        value.push_back(0.);
+        AppendGap(time, value);
+        return;
+    }
+    case kLaneGz:
+        AppendGradient(pBlock, dBlockStart_us, GZ - GX, minEventWidth_us, time, value);
+        return;
+    case kLaneGy:
+        AppendGradient(pBlock, dBlockStart_us, GY - GX, minEventWidth_us, time, value);
+        return;
+    case kLaneGx:
+        AppendGradient(pBlock, dBlockStart_us, 0, minEventWidth_us, time, value);
+        return;
+    case kLaneAdc:
+    {
+        if (!pBlock->isADC()) return;
+        const ADCEvent& adc = pBlock->GetADCEvent();
+        const double start = dBlockStart_us + adc.delay;
+        AppendBox(start, start + adc.dwellTime * adc.numSamples * 1e-3, 0., 1., time, value);
+        return;
+    }
+    }
+}
+
+void WaveformPolyline::AppendGradient(SeqBlock* pBlock, const double& dBlockStart_us, const int& channel, const double& minEventWidth_us,
+                                      std::vector<double>& time, std::vector<double>& value, const bool& bNormalized) const
+{
+    if (pBlock->GetEventIndex(static_cast<Event>(GX + channel)) <= 0) return;
+    const GradEvent& grad = pBlock->GetGradEvent(channel);
+    const double start = dBlockStart_us + grad.delay;
+    const double amplitude = bNormalized ? 1. : grad.amplitude * GRAD_DISPLAY_SCALE;
+
+    if (pBlock->isTrapGradient(channel))
+    {
+        const double flatStart = start + grad.rampUpTime;
+        const double flatEnd = flatStart + grad.flatTime;
+        time.insert(time.end(), {start, flatStart, flatEnd, flatEnd + grad.rampDownTime});
+        value.insert(value.end(), {0., amplitude, amplitude, 0.});
+        AppendGap(time, value);
+    }
+    else if (pBlock->isArbitraryGradient(channel))
+    {
+        const int length = pBlock->GetArbGradNumSamples(channel);
+        const float* pShape = pBlock->GetArbGradShapePtr(channel);
+        if (length <= 0) return;
+        const double end = start + length * m_dGradRasterTime_us;
+        if (end - start < minEventWidth_us)
+        {
+            const auto range = std::minmax_element(pShape, pShape + length);
+            const double a = amplitude * *range.first;
+            const double b = amplitude * *range.second;
+            AppendBox(start, end, std::min(a, b), std::max(a, b), time, value);
+            return;
+        }
+        // Samples sit at the centers of the raster intervals
+        for (int index = 0; index < length; index++)
+        {
+            time.push_back(start + (index + 0.5) * m_dGradRasterTime_us);
+            value.push_back(amplitude * pShape[index]);
+        }
+        AppendGap(time, value);
+    }
+    else if (pBlock->isExtTrapGradient(channel))
+    {
+        const std::vector<long>& vecTimes = pBlock->GetExtTrapGradTimes(channel);
+        const std::vector<float>& vecShape = pBlock->GetExtTrapGradShape(channel);
+        for (size_t index = 0; index < vecTimes.size() && index < vecShape.size(); index++)
+        {
+            time.push_back(start + vecTimes[index]);
+            value.push_back(amplitude * vecShape[index]);
+        }
+        AppendGap(time, value);
+    }
+}
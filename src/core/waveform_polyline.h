@@ -0,0 +1,45 @@
+#ifndef WAVEFORM_POLYLINE_H
+#define WAVEFORM_POLYLINE_H
+
+#include <string>
+#include <vector>
+#include <ExternalSequence.h>
+
+// Plot lanes, in the order the viewer stacks them
+enum WaveformLane
+{
+    kLaneRf = 0,
+    kLaneGz,
+    kLaneGy,
+    kLaneGx,
+    kLaneAdc,
+    kLaneNum
+};
+
+// Builds the display polyline of one lane from decoded blocks. Events are
+// separated by NaN gaps, so a whole lane can be drawn as a single graph.
+// Events narrower than minEventWidth_us (typically one pixel) are reduced to
+// their envelope, which keeps zoomed-out views of long sequences small.
+// Display units: RF in Hz, gradients in kHz/m, ADC as a 0/1 gate.
+class WaveformPolyline
+{
+public:
+    explicit WaveformPolyline(const double& gradRasterTime_us);
+
+    static std::string LaneName(const int& lane);
+    static std::string LaneLabel(const int& lane);
+    static int LaneFromName(const std::string& sName);
+
+    void AppendBlock(SeqBlock* pBlock, const double& dBlockStart_us, const int& lane, const double& minEventWidth_us,
+                     std::vector<double>& time, std::vector<double>& value) const;
+    // Any gradient of the channel (0 for GX): trapezoid, arbitrary or extended
+    // trapezoid. bNormalized leaves out the event amplitude, e.g. to scale one
+    // shape by the amplitudes of several repetitions.
+    void AppendGradient(SeqBlock* pBlock, const double& dBlockStart_us, const int& channel, const double& minEventWidth_us,
+                        std::vector<double>& time, std::vector<double>& value, const bool& bNormalized = false) const;
+
+private:
+    double m_dGradRasterTime_us;
+};
+
+#endif // WAVEFORM_POLYLINE_H
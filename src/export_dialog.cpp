@@ -0,0 +1,84 @@
+#include "export_dialog.h"
+
+#include <QDialogButtonBox>
+#include <QLocale>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+ExportDialog::ExportDialog(QWidget *parent)
+    : QDialog(parent)
+    , m_dTotal_us(0.)
+{
+    setWindowTitle("Export Waveforms");
+    QVBoxLayout* pLayout = new QVBoxLayout(this);
+    m_pFormLayout = new QFormLayout;
+    pLayout->addLayout(m_pFormLayout);
+
+    m_pFullSequenceCheckBox = new QCheckBox(this);
+    m_pFormLayout->addRow("Full sequence", m_pFullSequenceCheckBox);
+    m_pStartSpinBox = AddSpinBox("Start", 1, 1e12);
+    m_pEndSpinBox = AddSpinBox("End", 1, 1e12);
+    m_pRasterSpinBox = AddSpinBox("Raster", 3, 1e6);
+    m_pRasterSpinBox->setMinimum(0.001);
+    m_pSizeLabel = new QLabel(this);
+    m_pFormLayout->addRow("File size", m_pSizeLabel);
+
+    connect(m_pFullSequenceCheckBox, &QCheckBox::toggled, this, &ExportDialog::onOptionsChanged);
+    for (QDoubleSpinBox* pSpinBox : {m_pStartSpinBox, m_pEndSpinBox, m_pRasterSpinBox})
+    {
+        connect(pSpinBox, &QDoubleSpinBox::valueChanged, this, &ExportDialog::onOptionsChanged);
+    }
+
+    QDialogButtonBox* pButtonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(pButtonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(pButtonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    pLayout->addWidget(pButtonBox);
+}
+
+QDoubleSpinBox* ExportDialog::AddSpinBox(const QString& label, const int& decimals, const double& max)
+{
+    QDoubleSpinBox* pSpinBox = new QDoubleSpinBox(this);
+    pSpinBox->setDecimals(decimals);
+    pSpinBox->setRange(0., max);
+    pSpinBox->setSuffix(" us");
+    m_pFormLayout->addRow(label, pSpinBox);
+    return pSpinBox;
+}
+
+void ExportDialog::SetRange(const double& dStart_us, const double& dEnd_us, const double& dTotal_us)
+{
+    m_dTotal_us = dTotal_us;
+    m_pStartSpinBox->setMaximum(dTotal_us);
+    m_pEndSpinBox->setMaximum(dTotal_us);
+    m_pStartSpinBox->setValue(std::max(0., dStart_us));
+    m_pEndSpinBox->setValue(std::min(dTotal_us, dEnd_us));
+    m_pFullSequenceCheckBox->setChecked(dStart_us <= 0. && dEnd_us >= dTotal_us);
+    onOptionsChanged();
+}
+
+void ExportDialog::SetRaster(const double& raster_us)
+{
+    m_pRasterSpinBox->setValue(raster_us);
+}
+
+ExportOptions ExportDialog::GetOptions() const
+{
+    ExportOptions options;
+    const bool bFull = m_pFullSequenceCheckBox->isChecked();
+    options.start_us = bFull ? 0. : m_pStartSpinBox->value();
+    options.end_us = bFull ? m_dTotal_us : m_pEndSpinBox->value();
+    options.raster_us = m_pRasterSpinBox->value();
+    return options;
+}
+
+void ExportDialog::onOptionsChanged()
+{
+    const bool bFull = m_pFullSequenceCheckBox->isChecked();
+    m_pStartSpinBox->setEnabled(!bFull);
+    m_pEndSpinBox->setEnabled(!bFull);
+
+    const uint64_t samples = WaveformExporter::SampleCount(GetOptions());
+    const qint64 bytes = static_cast<qint64>(samples * EXPORT_CHANNEL_NUM * sizeof(float));
+    m_pSizeLabel->setText(QString("%1 samples, %2").arg(samples).arg(QLocale().formattedDataSize(bytes)));
+}
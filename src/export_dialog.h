@@ -0,0 +1,39 @@
+#ifndef EXPORT_DIALOG_H
+#define EXPORT_DIALOG_H
+
+#include <QCheckBox>
+#include <QDialog>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QLabel>
+
+#include "waveform_exporter.h"
+
+// Chooses the time window and the uniform raster of a waveform export and
+// shows the resulting file size before anything is written.
+class ExportDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit ExportDialog(QWidget *parent = nullptr);
+
+    void SetRange(const double& dStart_us, const double& dEnd_us, const double& dTotal_us);
+    void SetRaster(const double& raster_us);
+    ExportOptions GetOptions() const;
+
+private slots:
+    void onOptionsChanged();
+
+private:
+    QDoubleSpinBox* AddSpinBox(const QString& label, const int& decimals, const double& max);
+
+    QFormLayout                          *m_pFormLayout;
+    QCheckBox                            *m_pFullSequenceCheckBox;
+    QDoubleSpinBox                       *m_pStartSpinBox;
+    QDoubleSpinBox                       *m_pEndSpinBox;
+    QDoubleSpinBox                       *m_pRasterSpinBox;
+    QLabel                               *m_pSizeLabel;
+    double                               m_dTotal_us;
+};
+
+#endif // EXPORT_DIALOG_H
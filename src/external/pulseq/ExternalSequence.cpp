@@ -13,6 +13,17 @@
 
 using namespace std::placeholders;
 
+// Format and deliver a message only if its level is enabled, so disabled
+// debug messages on the per-block paths cost a single comparison
+#define SEQ_MSG(level, ...) \
+	do { \
+		if (IsMsgEnabled(level)) { \
+			std::ostringstream seq_msg; \
+			seq_msg << __VA_ARGS__; \
+			emit_msg((level), seq_msg); \
+		} \
+	} while (0)
+
 ExternalSequence::PrintFunPtr ExternalSequence::print_fun = &ExternalSequence::defaultPrint;
 const int ExternalSequence::MAX_LINE_SIZE = 256;
 const char ExternalSequence::COMMENT_CHAR = '#';
@@ -28,6 +39,8 @@ ExternalSequence::ExternalSequence()
 	version_revision=0;
 	version_combined=0;
 	m_bSignatureDefined=false;
+	msg_sink=NULL;
+	msg_level=MSG_LEVEL;
 }
 
 /***********************************************************/
@@ -48,10 +61,22 @@ void ExternalSequence::print_msg(MessageType level, std::ostream& ss) {
 	}
 }
 
+/***********************************************************/
+void ExternalSequence::emit_msg(MessageType level, std::ostringstream& ss) const {
+	if (msg_sink==NULL) {
+		print_msg(level, ss);
+		return;
+	}
+	std::ostringstream oss;
+	oss.width(2*(level-1)); oss << "";
+	oss << ss.str();
+	msg_sink->Write(level, oss.str());
+}
+
 /***********************************************************/
 void ExternalSequence::reset()
 {
-	print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "Resetting the sequence state");
+	SEQ_MSG(DEBUG_HIGH_LEVEL, "Resetting the sequence state");
 
 	// reset the internal structures in case this is a repeated call to load()
 	m_adcLibrary.clear();
@@ -71,6 +96,7 @@ void ExternalSequence::reset()
 	m_rotationLibrary.clear();
 	m_shapeLibrary.clear();
 	m_signatureMap.clear();
+	m_tmpDelayLibrary.clear();
 	m_strSignature="";
 	m_strSignatureType="";
 	m_triggerLibrary.clear();
@@ -83,7 +109,7 @@ bool ExternalSequence::load(std::string path)
 	//reset(); // moved to the stream loader
 
 	// now time to read...
-	print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "Reading external sequence files");
+	SEQ_MSG(DEBUG_HIGH_LEVEL, "Reading external sequence files");
 
 	// **********************************************************************************************************************
 	// ************************ READ SHAPES ***********************************
@@ -113,12 +139,12 @@ bool ExternalSequence::load(std::string path)
 		
 		if (!data_file.good())
 		{
-			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Failed to read file " << filepath);
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Failed to read file " << filepath);
 			return false;
 		}
 
 		if (!load(data_file, lm_shapes)) {
-			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Failed to load shapes from file " << filepath);
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Failed to load shapes from file " << filepath);
 			return false;
 		}
 
@@ -129,12 +155,12 @@ bool ExternalSequence::load(std::string path)
 
 		if (!data_file.good())
 		{
-			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Failed to read file " << filepath);
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Failed to read file " << filepath);
 			return false;
 		}
 
 		if (!load(data_file, lm_events)) {
-			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Failed to load events from file " << filepath);
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Failed to load events from file " << filepath);
 			return false;
 		}
 
@@ -145,12 +171,12 @@ bool ExternalSequence::load(std::string path)
 
 		if (!data_file.good())
 		{
-			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Failed to read file " << filepath);
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Failed to read file " << filepath);
 			return false;
 		}
 		
 		if (!load(data_file, lm_blocks)) {
-			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Failed to load blocks from file " << filepath);
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Failed to load blocks from file " << filepath);
 			return false;
 		}
 
@@ -164,7 +190,7 @@ bool ExternalSequence::load(std::string path)
 
 bool ExternalSequence::load_from_buffer(char * buffer) 
 {
-	print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "Loading sequence from a text buffer");
+	SEQ_MSG(DEBUG_HIGH_LEVEL, "Loading sequence from a text buffer");
 
 	// Try single file mode (everything in a single .seq file)
 	std::istringstream string_stream(buffer);
@@ -181,229 +207,89 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 
 	if (!data_stream.good())
 	{
-		print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Function load() failed to read from the stream provided");
+		SEQ_MSG(ERROR_MSG, "*** ERROR: Function load() failed to read from the stream provided");
 		return false;
 	}
 
 	char buffer[MAX_LINE_SIZE];
-	char tmpStr[MAX_LINE_SIZE];
 
-	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Building index" );
+	SEQ_MSG(DEBUG_LOW_LEVEL, "Building index" );
 
-	// Save locations of section tags
-	buildFileIndex(data_stream);
+	// Save locations of section tags, reload() uses the index built by indexFile()
+	if (loadMode != lm_sections)
+		buildFileIndex(data_stream);
 
 	// Read version section
 	if (m_fileIndex.find("[VERSION]") != m_fileIndex.end()) {
-		print_msg(DEBUG_MEDIUM_LEVEL, std::ostringstream().flush() << "decoding VERSION section");
+		SEQ_MSG(DEBUG_MEDIUM_LEVEL, "decoding VERSION section");
 		// Version is a recommended but not a compulsory section
 		// very basic reading code, repeated keywords will overwrite previous values, no serious error checking
 		data_stream.seekg(m_fileIndex["[VERSION]"], std::ios::beg);
-		skipComments(data_stream,buffer);			// load up some data and ignore comments & empty lines
-		while (data_stream.good() && buffer[0]!='[')
-		{
-			//print_msg(DEBUG_MEDIUM_LEVEL, std::ostringstream().flush() << "buffer: \n" << buffer << std::endl );
-			if (0==strncmp(buffer,"major",5)) {
-				    if (1!=sscanf(buffer+5, "%d", &version_major)) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode version_major");
-					return false;
-				}
-			    print_msg(DEBUG_MEDIUM_LEVEL, std::ostringstream().flush() << "major=" << version_major);		
-			} else if (0==strncmp(buffer,"minor",5)) {
-				if (1!=sscanf(buffer+5, "%d", &version_minor)) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode version_minor");
-					return false;
-				}
-				print_msg(DEBUG_MEDIUM_LEVEL, std::ostringstream().flush() << "minor=" << version_minor);
-			}
-			else if (0==strncmp(buffer,"revision",8)) {
-				if (1!=sscanf(buffer+8, "%d", &version_revision)) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode version_revision \n" << buffer << std::endl );
-					return false;
-				}
-				print_msg(DEBUG_MEDIUM_LEVEL, std::ostringstream().flush() << "revision=" << version_revision);
-			}
-			else
-			{
-				print_msg(WARNING_MSG, std::ostringstream().flush() << "*** WARNING: unknown field in the [VERSION] block");
-				return false;
-			}
-			//getline(data_stream, buffer, MAX_LINE_SIZE);
-			skipComments(data_stream,buffer);			// load up some data and ignore comments & empty lines
-		}
-		version_combined=version_major*1000000L+version_minor*1000L+version_revision;
+		if (!readVersion(data_stream, buffer))
+			return false;
 	}
 	else
 	{
-		print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: supported Pulseq files MUST contain the [VERSION] section");
+		SEQ_MSG(ERROR_MSG, "*** ERROR: supported Pulseq files MUST contain the [VERSION] section");
 		return false;
 	}
 
 	if (version_combined<1002000L)
 	{
-		print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: unsupported Pulseq file version " << version_combined << ". The oldest supported version is 1.2.0.");
+		SEQ_MSG(ERROR_MSG, "*** ERROR: unsupported Pulseq file version " << version_combined << ". The oldest supported version is 1.2.0.");
 		return false;
 	}
 	
 	// **********************************************************************************************************************
 	// ************************ READ SHAPES ***********************************
 
-	if (loadMode == lm_singlefile || loadMode == lm_shapes) 
+	if (loadMode == lm_singlefile || loadMode == lm_shapes || (loadMode == lm_sections && isSectionSelected(loadMode, "[SHAPES]")))
 	{
 		// Read shapes section
 		// ------------------------
 		m_shapeLibrary.clear();
 		if (m_fileIndex.find("[SHAPES]") != m_fileIndex.end()) {
 			data_stream.seekg(m_fileIndex["[SHAPES]"], std::ios::beg);
-			skipComments(data_stream,buffer);			// Ignore comments & empty lines
-
-			int shapeId, numSamples;
-			float sample;
-
-			while (data_stream.good() && buffer[0]=='s')
-			{
-				if (2!=sscanf(buffer, "%s%d", tmpStr, &shapeId)) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode 'shapeId'\n" << buffer << std::endl );
-					return false;
-				}
-				getline(data_stream, buffer, MAX_LINE_SIZE);
-				if (2!=sscanf(buffer, "%s%d", tmpStr, &numSamples)) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode 'numSamples'\n" << buffer << std::endl );
-					return false;
-				}
-
-				//print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Reading shape " << shapeId );
-
-				CompressedShape shape;
-				shape.samples.clear();
-				while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-					if (buffer[0]=='s' || strlen(buffer)==0) {
-						break;
-					}
-					if (1!=sscanf(buffer, "%f", &sample)) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode 'sample'\n" << buffer << std::endl );
-						return false;
-					}
-					shape.samples.push_back(sample);
-				}
-				// number of samples equal to the data length is used as a non-compressed flag
-				// but only for v1.4.0 or above
-				if (version_combined >= 1004000 && numSamples==shape.samples.size())
-					shape.isCompressed=false;
-				else 
-					shape.isCompressed=true;
-				shape.numUncompressedSamples=numSamples;
-
-				print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Shape index " << shapeId << " has " << shape.samples.size()
-					<< " compressed and " << shape.numUncompressedSamples << " uncompressed samples" );
-
-				m_shapeLibrary[shapeId] = shape;
-
-				skipComments(data_stream,buffer);			// Ignore comments & empty lines
-			}
-			data_stream.clear();	// In case EOF reached
-
-			print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "-- SHAPES READ numShapes: " << m_shapeLibrary.size() );
+			if (!readShapes(data_stream, buffer))
+				return false;
 		}
 		else
 		{
-			print_msg(NORMAL_MSG, std::ostringstream().flush() << "-- No SHAPES section found, which is permisible but unusual" );
+			SEQ_MSG(NORMAL_MSG, "-- No SHAPES section found, which is permisible but unusual" );
 		}
 	}
 
 	// **********************************************************************************************************************
 	// ************************ READ EVENTS ********************
 	
-	if (loadMode == lm_singlefile || loadMode == lm_events) 
+	if (loadMode == lm_singlefile || loadMode == lm_events || loadMode == lm_sections) 
 	{
 		// Read RF section
 		// ------------------------
-		if (m_fileIndex.find("[RF]") != m_fileIndex.end()) {
+		if (isSectionSelected(loadMode, "[RF]") && m_fileIndex.find("[RF]") != m_fileIndex.end()) {
 			data_stream.seekg(m_fileIndex["[RF]"], std::ios::beg);
-
-			int rfId;
-			m_rfLibrary.clear();
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				RFEvent event;
-				if (version_combined<1004000L)
-				{
-					if (7!=sscanf(buffer, "%d%f%d%d%d%f%f", &rfId, &(event.amplitude),
-								&(event.magShape),&(event.phaseShape), &(event.delay),
-								&(event.freqOffset), &(event.phaseOffset)
-								)) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode RF event\n" << buffer << std::endl );
-						return false;
-					}
-					event.timeShape=0;
-				}
-				else
-				{
-					if (8!=sscanf(buffer, "%d%f%d%d%d%d%f%f", &rfId, &(event.amplitude),
-								&(event.magShape),&(event.phaseShape),&(event.timeShape),&(event.delay),
-								&(event.freqOffset), &(event.phaseOffset)
-								)) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode RF event\n" << buffer << std::endl );
-						return false;
-					}
-				}
-				m_rfLibrary[rfId] = event;
-			}
+			if (!readRF(data_stream, buffer))
+				return false;
 		}
 		
 		// Read *arbitrary* gradient section
 		// -------------------------------
-		m_gradLibrary.clear();
-		if (m_fileIndex.find("[GRADIENTS]") != m_fileIndex.end()) {
+		// both sections share the gradient library and are always read together
+		bool bReadGradients = isSectionSelected(loadMode, "[GRADIENTS]") || isSectionSelected(loadMode, "[TRAP]");
+		if (bReadGradients)
+			m_gradLibrary.clear();
+		if (bReadGradients && m_fileIndex.find("[GRADIENTS]") != m_fileIndex.end()) {
 			data_stream.seekg(m_fileIndex["[GRADIENTS]"], std::ios::beg);
-
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				int gradId;
-				GradEvent event;
-				if ( version_combined>=1004000L )
-				{
-					if (5!=sscanf(buffer, "%d%f%d%d%d", &gradId, &(event.amplitude), &(event.waveShape), &(event.timeShape), &(event.delay))) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode v1.4.x gradient event\n" << buffer << std::endl );
-						return false;
-					}
-				}
-				else
-				{
-					event.timeShape=0;
-					if (4!=sscanf(buffer, "%d%f%d%d", &gradId, &(event.amplitude), &(event.waveShape), &(event.delay))) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode v1.2.x gradient event\n" << buffer << std::endl );
-						return false;
-					}
-				}
-				m_gradLibrary[gradId] = event;
-			}
+			if (!readGradients(data_stream, buffer))
+				return false;
 		}
 
 		// Read *trapezoid* gradient section
 		// -------------------------------
-		if (m_fileIndex.find("[TRAP]") != m_fileIndex.end()) {
+		if (bReadGradients && m_fileIndex.find("[TRAP]") != m_fileIndex.end()) {
 			data_stream.seekg(m_fileIndex["[TRAP]"], std::ios::beg);
-
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				int gradId;
-				GradEvent event;
-				if (6!=sscanf(buffer, "%d%f%ld%ld%ld%d", &gradId, &(event.amplitude),
-					&(event.rampUpTime),&(event.flatTime),&(event.rampDownTime),&(event.delay))) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode trapezoid gradient entry" << buffer << std::endl );
-					return false;
-				}					
-				event.waveShape=0;
-				event.timeShape=0;
-				m_gradLibrary[gradId] = event;
-			}
+			if (!readTraps(data_stream, buffer))
+				return false;
 		}
 
 		// Sort gradients based on index
@@ -412,170 +298,48 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 
 		// Read ADC section
 		// -------------------------------
-		if (m_fileIndex.find("[ADC]") != m_fileIndex.end()) {
+		if (isSectionSelected(loadMode, "[ADC]") && m_fileIndex.find("[ADC]") != m_fileIndex.end()) {
 			data_stream.seekg(m_fileIndex["[ADC]"], std::ios::beg);
-
-			int adcId;
-			m_adcLibrary.clear();
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				ADCEvent event;
-				if (6!=sscanf(buffer, "%d%d%d%d%f%f", &adcId, &(event.numSamples),
-							&(event.dwellTime),&(event.delay),&(event.freqOffset),&(event.phaseOffset))) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode ADC event\n" << buffer << std::endl );
-					return false;
-				}
-				m_adcLibrary[adcId] = event;
-			}
+			if (!readADC(data_stream, buffer))
+				return false;
 		}
 
 		// Read delays section (comatibility with Pulseq version prior to 1.4.0)
 		// ---------------------------------------------------------------------
-		//std::map<int,long> tmpDelayLibrary;
-		m_tmpDelayLibrary.clear();
-		if (m_fileIndex.find("[DELAYS]") != m_fileIndex.end()) {
-			data_stream.seekg(m_fileIndex["[DELAYS]"], std::ios::beg);
-
-			int delayId;
-			long delay;
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				if (2!=sscanf(buffer, "%d%ld", &delayId, &delay)) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode delay event\n" << buffer << std::endl );
+		// reload() keeps the delays for converting re-read blocks unless the section changed
+		if (isSectionSelected(loadMode, "[DELAYS]")) {
+			m_tmpDelayLibrary.clear();
+			if (m_fileIndex.find("[DELAYS]") != m_fileIndex.end()) {
+				data_stream.seekg(m_fileIndex["[DELAYS]"], std::ios::beg);
+				if (!readDelays(data_stream, buffer))
 					return false;
-				}
-				m_tmpDelayLibrary[delayId] = delay;
 			}
 		}
 
 		// Read extensions section
 		// -------------------------------
-		m_extensionLibrary.clear();
-		m_extensionNameIDs.clear();
-		m_triggerLibrary.clear(); // clear also all known extension libraries
-		m_labelsetLibrary.clear();
-		m_labelincLibrary.clear();
+		bool bReadExtensions = isSectionSelected(loadMode, "[EXTENSIONS]");
+		if (bReadExtensions) {
+			m_extensionLibrary.clear();
+			m_extensionNameIDs.clear();
+			m_triggerLibrary.clear(); // clear also all known extension libraries
+			m_rotationLibrary.clear();
+			m_labelsetLibrary.clear();
+			m_labelincLibrary.clear();
+		}
 		std::map<std::string,int>::iterator itFI = m_fileIndex.find("[EXTENSIONS]");
-		if ( itFI != m_fileIndex.end()) {
+		if ( bReadExtensions && itFI != m_fileIndex.end()) {
 			data_stream.seekg(itFI->second, std::ios::beg);
 			std::set<int>::iterator itSFI = m_fileSections.find(itFI->second);
 			if ( itSFI==m_fileSections.end() ||
 				 (++itSFI)==m_fileSections.end() )
 			{
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed find the end of the section while reading EXTENSIONS");
+				SEQ_MSG(ERROR_MSG, "*** ERROR: failed find the end of the section while reading EXTENSIONS");
 				return false;
 			}
 			int sectionEnd = *itSFI;
-			// we first read in the extension list
-			int nID;
-			int nExtensionID=EXT_LIST; // EXT_LIST means we are reading the extension list
-			while ( data_stream.tellg()<sectionEnd &&
-					getline(data_stream, buffer, MAX_LINE_SIZE)) 
-			{
-				if (buffer[0]=='#' || buffer[0]=='[' || strlen(buffer)==0) {
-					continue;
-				}
-				print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "input line: " << buffer);
-				if (0==strncmp(buffer,"extension",9)) {
-					// read new extension ID from the header
-					char szStrID[MAX_LINE_SIZE];
-					int nInternalID=0;
-					int nKnownID=EXT_UNKNOWN;
-					if (2!=sscanf(buffer, "extension %s %d", szStrID, &nInternalID)) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode extension header entry\n" << buffer << std::endl );
-						return false;
-					}
-					// here is the list if extensions we currently recognize
-					if (0==strcmp("TRIGGERS",szStrID))
-						nKnownID=EXT_TRIGGER;
-					else if (0==strcmp("ROTATIONS",szStrID))
-						nKnownID=EXT_ROTATION;
-					else if (0==strcmp("LABELSET",szStrID))
-						nKnownID=EXT_LABELSET;
-					else if (0==strcmp("LABELINC",szStrID))
-						nKnownID=EXT_LABELINC;
-					if (nKnownID!=EXT_UNKNOWN)
-						m_extensionNameIDs[nInternalID]=std::make_pair(std::string(szStrID),nKnownID);
-					else {
-						print_msg(WARNING_MSG, std::ostringstream().flush() << "*** WARNING: unknown extension ignored\n" << buffer << std::endl );
-					}
-					nExtensionID=nKnownID;
-				}
-				else
-				{
-					ExtensionListEntry extEntry;
-					TriggerEvent trigger;
-					RotationEvent rotation;
-					int  nVal;					   // read label set/inc values from label set/inc extension
-					int  nRet;                     // conversion result / return value
-					char szLabelID[MAX_LINE_SIZE]; // read labels strings from label set/inc extension
-					LabelEvent	label;			   // write label event
-					switch (nExtensionID) {
-						case EXT_LIST: 
-							if (4!=sscanf(buffer, "%d%d%d%ld", &nID, &(extEntry.type), &(extEntry.ref), &(extEntry.next))) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode extension list entry\n" << buffer << std::endl );
-								return false;
-							}
-							print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "decoding extension list entry " << buffer);
-							m_extensionLibrary[nID] = extEntry;
-							print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "nID:" << nID << " type:" << extEntry.type << " ref" << extEntry.ref << " next:" << extEntry.next);
-							break;
-						case EXT_TRIGGER: 
-							if (5!=sscanf(buffer, "%d%d%d%ld%ld", &nID, &(trigger.triggerType), &(trigger.triggerChannel), &(trigger.delay), &(trigger.duration))) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode trigger event\n" << buffer << std::endl );
-								return false;
-							}
-							m_triggerLibrary[nID] = trigger;
-							break;
-						case EXT_ROTATION: 
-							if (10!=sscanf(buffer, "%d%lf%lf%lf%lf%lf%lf%lf%lf%lf", &nID, 
-										&rotation.rotMatrix[0], &rotation.rotMatrix[1], &rotation.rotMatrix[2],
-										&rotation.rotMatrix[3], &rotation.rotMatrix[4], &rotation.rotMatrix[5],
-										&rotation.rotMatrix[6], &rotation.rotMatrix[7], &rotation.rotMatrix[8])) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode rotation event\n" << buffer << std::endl );
-								return false;
-							}
-							rotation.defined=true;
-							m_rotationLibrary[nID] = rotation; 
-							break;
-						case EXT_LABELSET: 
-							if (3!=sscanf(buffer, "%d%d%s", &nID, &nVal, szLabelID)) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to load labelset event\n" << buffer << std::endl );
-								return false;
-							}
-							nRet = decodeLabel(EXT_LABELSET,nVal,szLabelID,label);
-							if (nRet<0) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode labelset event\n" << buffer << std::endl );
-								return false;
-							}else if(nRet>0) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** decoding labelset event returned 0\n" << buffer << std::endl );
-							} 
-							m_labelsetLibrary[nID] = label;
-							break;
-						case EXT_LABELINC: 
-							if (3!=sscanf(buffer, "%d%d%s", &nID, &nVal, szLabelID)) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode labelinc event\n" << buffer << std::endl );
-								return false;
-							}
-							nRet = decodeLabel(EXT_LABELINC,nVal,szLabelID,label);
-							if (nRet<0) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode labelinc event\n" << buffer << std::endl );
-								return false;
-							}else if(nRet>0) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: decoding labelinc event returnd 0\n" << buffer << std::endl );
-							}
-
-							m_labelincLibrary[nID] = label;
-							break;
-						case EXT_UNKNOWN:
-							break; // just ignore unknown extensions
-					}
-				}
-			}
+			if (!readExtensions(data_stream, buffer, sectionEnd))
+				return false;
 		}
 		
 		// Read gradient rotation section
@@ -594,7 +358,7 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 							&event.rotMatrix[0], &event.rotMatrix[1], &event.rotMatrix[2],
 							&event.rotMatrix[3], &event.rotMatrix[4], &event.rotMatrix[5],
 							&event.rotMatrix[6], &event.rotMatrix[7], &event.rotMatrix[8])) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode rotation event\n" << buffer << std::endl );
+					SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode rotation event\n" << buffer << std::endl );
 					return false;
 				}
 				m_controlLibrary[controlId] = event;
@@ -602,7 +366,7 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 		}*/
 		
 		
-		print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "-- EVENTS READ: "
+		SEQ_MSG(DEBUG_HIGH_LEVEL, "-- EVENTS READ: "
 			<<" RF: " << m_rfLibrary.size()
 			<<" GRAD: " << m_gradLibrary.size()
 			<<" ADC: " << m_adcLibrary.size()
@@ -611,282 +375,761 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 
 	// **********************************************************************************************************************
 	// ************************ READ BLOCKS ********************
-	if (loadMode == lm_singlefile || loadMode == lm_blocks) 
+	if (loadMode == lm_singlefile || loadMode == lm_blocks || loadMode == lm_sections) 
 	{
 		unsigned int numBlocks = 0;
 		
 		// Read definition section
 		// ------------------------
-		if (m_fileIndex.find("[DEFINITIONS]") != m_fileIndex.end()) {
+		if (isSectionSelected(loadMode, "[DEFINITIONS]") && m_fileIndex.find("[DEFINITIONS]") != m_fileIndex.end()) {
 			data_stream.seekg(m_fileIndex["[DEFINITIONS]"], std::ios::beg);
+			if (!readDefinitions(data_stream, buffer))
+				return false;
+		} // if definitions exist
 
-			// Read each definition line
-			m_definitions.clear();
-			m_definitions_str.clear();
-			int retgl=0;
-			while (retgl=getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				// this was not compatible with Numaris4 VB line (MSVC6)
-				/*std::istringstream ss(buffer);
-				while(retgl==gl_truncated) { // if the line was truncated read in the rest of it into the stream/buffer
-					retgl=getline(data_stream, buffer, MAX_LINE_SIZE);
-					ss.str(ss.str()+buffer); 
-				}*/
-				// stupid compatible code
-				std::string stmp(buffer);
-				while(retgl==gl_truncated) { // if the line was truncated read in the rest of it into the temporary string
-					retgl=getline(data_stream, buffer, MAX_LINE_SIZE);
-					stmp+=buffer;
-				}
-				char* tmp_buff1= new char[stmp.length()+1]; // old compilers like MSVC6 require such stupid conversions
-				strcpy(tmp_buff1,stmp.c_str());
-				print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "--- reading definitions, tmp_buff1=`"<<tmp_buff1<<"'"<<std::endl);
-				std::istringstream ss(tmp_buff1);
-				// delete [] tmp_buff1; // moved few lines below
-				// end of stupid compatible code (except for the delete line below)
-				std::string key;
-				ss >> key;
-				std::string str_value;
-				if (std::getline(ss,str_value)) {
-					str_value = str_trim(str_value);
-					m_definitions_str[key] = str_value; 
-					// old compilers like MSVC6 require such stupid conversions
-					char* tmp_buff2= new char[str_value.length()+1];
-					strcpy(tmp_buff2,str_value.c_str());
-					print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "--- reading definitions(2), tmp_buff2=`"<<tmp_buff2<<"'"<<std::endl);
-					std::istringstream ssv(tmp_buff2);
-					double value;
-					std::vector<double> values;
-					while (ssv >> value) {
-						//print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "v["<<values.size()<<"]="<<value);
-						values.push_back(value);
-					}
-					delete [] tmp_buff2;
-					m_definitions[key] = values;
-				}
-				// this 'delete' should be here because some compilers pass the buffer by reference
-				delete [] tmp_buff1;
-			}
+		SEQ_MSG(DEBUG_LOW_LEVEL, "--- Starting to interpret definitions");
 
-			std::ostringstream out;
-			out << "-- " << "DEFINITIONS READ: " << m_definitions.size() << " : ";
-			for (std::map<std::string,std::vector<double> >::iterator it=m_definitions.begin(); it!=m_definitions.end(); ++it)
-			{
-				out<< it->first << " ";
-				for (int i=0; i<it->second.size(); i++)
-					out << it->second[i] << " ";
-			}
+		if (!interpretDefinitions())
+			return false;
 
-			print_msg(DEBUG_HIGH_LEVEL, out);
+		SEQ_MSG(DEBUG_LOW_LEVEL, "--- Finished reading definitions, reading blocks ...");
 
-		} // if definitions exist
+		// Read blocks section
+		// ------------------------
+		if (m_fileIndex.find("[BLOCKS]") == m_fileIndex.end()) {
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Required: [BLOCKS] section");
+			return false;
+		}
+		data_stream.seekg(m_fileIndex["[BLOCKS]"], std::ios::beg);
 
-		print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "--- Starting to interpret definitions");
+		// Read blocks, reload() keeps them unless the section is selected
+		bool bReadBlocks = isSectionSelected(loadMode, "[BLOCKS]");
+		if (bReadBlocks) {
+			m_blocks.clear();
+			m_blockDurations_ru.clear();
+		}
+		if (bReadBlocks && !readBlocks(data_stream, buffer, true))
+			return false;
 
-		if (version_combined<1004000L)
-		{
-			// initialize default raster times
-			m_dAdcRasterTime_us=1e-1; // Siemens default: 1e-07 
-			m_dGradientRasterTime_us=10.0; // Siemens default: 1e-05 
-			m_dRadiofrequencyRasterTime_us=1.0; // Siemens default: 1e-06 
-			m_dBlockDurationRaster_us = m_dGradientRasterTime_us;
+		SEQ_MSG(DEBUG_HIGH_LEVEL, "-- BLOCKS READ: " << m_blocks.size());
+		// Num_Blocks definition (if defined) is used to check the correct number of blocks are read
+		if (numBlocks>0 && m_blocks.size()!=numBlocks) {
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Expected " << numBlocks
+				<< " blocks but read " << m_blocks.size() << " blocks");
+			return false;
 		}
-		else
+		
+		SEQ_MSG(DEBUG_LOW_LEVEL, "--- Reading signature...");
+		// Read signature section
+		// ------------------------
+		if (isSectionSelected(loadMode, "[SIGNATURE]") && m_fileIndex.find("[SIGNATURE]") != m_fileIndex.end()) {
+			data_stream.seekg(m_fileIndex["[SIGNATURE]"], std::ios::beg);
+			if (!readSignature(data_stream, buffer))
+				return false;
+		} // if signature exists
+
+		SEQ_MSG(DEBUG_LOW_LEVEL, "--- Finished reading signature");
+
+		if (version_combined<1004000L) 
 		{
-			// for v1.4.x and later we REQUIRE definitions to be present
-			std::vector<double> def = GetDefinition("AdcRasterTime");
-			if (def.empty()){
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Required: definition AdcRasterTime is not present in the file");
+			if (!convertLegacyBlocks())
 				return false;
-			}
-			m_dAdcRasterTime_us=1e6*def[0];
-			def = GetDefinition("GradientRasterTime");
-			if (def.empty()){
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Required: definition GradientRasterTime is not present in the file");
+		}
+	}
+
+	//std::vector<double> def = GetDefinition("Scan_ID");
+	//int scanID = def.empty() ? 0: (int)def[0];
+	//SEQ_MSG(NORMAL_MSG, "==========================================" );
+	//SEQ_MSG(NORMAL_MSG, "===== EXTERNAL SEQUENCE #" << std::setw(5) << scanID << " ===========" );
+	//SEQ_MSG(NORMAL_MSG, "==========================================" );
+
+	return true;
+};
+
+
+/***********************************************************/
+static bool isSectionHeader(const char *buffer)
+{
+	size_t len=strlen(buffer);
+	return len>1 && buffer[0]=='[' && buffer[len-1]==']';
+}
+
+/***********************************************************/
+bool ExternalSequence::loadSequential(std::istream& data_stream)
+{
+	reset();
+
+	if (!data_stream.good())
+	{
+		SEQ_MSG(ERROR_MSG, "*** ERROR: Function loadSequential() failed to read from the stream provided");
+		return false;
+	}
+
+	char buffer[MAX_LINE_SIZE];
+	buffer[0]='\0';
+	std::set<std::string> sectionsRead;
+
+	for (;;) {
+		// a section reader stops at the line after the section, which often is the next header already
+		while (!isSectionHeader(buffer) && getline(data_stream, buffer, MAX_LINE_SIZE)) {
+		}
+		if (!isSectionHeader(buffer))
+			break;	// end of the stream
+
+		std::string section(buffer);
+		buffer[0]='\0';
+		SEQ_MSG(DEBUG_MEDIUM_LEVEL, "decoding " << section << " section");
+		if (!sectionsRead.insert(section).second) {
+			SEQ_MSG(ERROR_MSG, "*** ERROR: section " << section << " appears more than once");
+			return false;
+		}
+		if (section!="[VERSION]" && section!="[DEFINITIONS]" && section!="[SIGNATURE]" && version_combined==0) {
+			SEQ_MSG(ERROR_MSG, "*** ERROR: the [VERSION] section has to come before " << section << " when reading sequentially");
+			return false;
+		}
+
+		bool ok=true;
+		if (section=="[VERSION]")
+			ok=readVersion(data_stream, buffer);
+		else if (section=="[DEFINITIONS]")
+			ok=readDefinitions(data_stream, buffer);
+		else if (section=="[BLOCKS]")
+			ok=readBlocks(data_stream, buffer, false);	// events may follow the blocks
+		else if (section=="[RF]")
+			ok=readRF(data_stream, buffer);
+		else if (section=="[GRADIENTS]")
+			ok=readGradients(data_stream, buffer);
+		else if (section=="[TRAP]")
+			ok=readTraps(data_stream, buffer);
+		else if (section=="[ADC]")
+			ok=readADC(data_stream, buffer);
+		else if (section=="[DELAYS]")
+			ok=readDelays(data_stream, buffer);
+		else if (section=="[EXTENSIONS]")
+			ok=readExtensions(data_stream, buffer, -1);
+		else if (section=="[SHAPES]")
+			ok=readShapes(data_stream, buffer);
+		else if (section=="[SIGNATURE]")
+			ok=readSignature(data_stream, buffer);
+		else
+			SEQ_MSG(DEBUG_MEDIUM_LEVEL, "-- skipping unknown section " << section);
+		if (!ok)
+			return false;
+	}
+
+	if (sectionsRead.count("[VERSION]")==0) {
+		SEQ_MSG(ERROR_MSG, "*** ERROR: supported Pulseq files MUST contain the [VERSION] section");
+		return false;
+	}
+	if (version_combined<1002000L) {
+		SEQ_MSG(ERROR_MSG, "*** ERROR: unsupported Pulseq file version " << version_combined << ". The oldest supported version is 1.2.0.");
+		return false;
+	}
+	if (sectionsRead.count("[BLOCKS]")==0) {
+		SEQ_MSG(ERROR_MSG, "*** ERROR: Required: [BLOCKS] section");
+		return false;
+	}
+	if (sectionsRead.count("[SHAPES]")==0)
+		SEQ_MSG(NORMAL_MSG, "-- No SHAPES section found, which is permisible but unusual" );
+	if (!interpretDefinitions())
+		return false;
+
+	for (unsigned int b=0; b<m_blocks.size(); ++b) {
+		if (!checkBlockReferences(m_blocks[b])) {
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Block " << b+1
+				<< " contains references to undefined events" );
+			return false;
+		}
+	}
+	SEQ_MSG(DEBUG_HIGH_LEVEL, "-- BLOCKS READ: " << m_blocks.size());
+
+	if (version_combined<1004000L)
+		return convertLegacyBlocks();
+	return true;
+};
+
+/***********************************************************/
+bool ExternalSequence::readVersion(std::istream &data_stream, char *buffer)
+{
+	skipComments(data_stream,buffer);			// load up some data and ignore comments & empty lines
+	while (data_stream.good() && buffer[0]!='[')
+	{
+		//SEQ_MSG(DEBUG_MEDIUM_LEVEL, "buffer: \n" << buffer << std::endl );
+		if (0==strncmp(buffer,"major",5)) {
+			    if (1!=sscanf(buffer+5, "%d", &version_major)) {
+				SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode version_major");
 				return false;
 			}
-			m_dGradientRasterTime_us=1e6*def[0];
-			def = GetDefinition("RadiofrequencyRasterTime");
-			if (def.empty()){
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Required: definition RadiofrequencyRasterTime is not present in the file");
+		    SEQ_MSG(DEBUG_MEDIUM_LEVEL, "major=" << version_major);		
+		} else if (0==strncmp(buffer,"minor",5)) {
+			if (1!=sscanf(buffer+5, "%d", &version_minor)) {
+				SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode version_minor");
 				return false;
 			}
-			m_dRadiofrequencyRasterTime_us=1e6*def[0];
-			def = GetDefinition("BlockDurationRaster");
-			if (def.empty()){
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Required: definition BlockDurationRaster is not present in the file");
+			SEQ_MSG(DEBUG_MEDIUM_LEVEL, "minor=" << version_minor);
+		}
+		else if (0==strncmp(buffer,"revision",8)) {
+			if (1!=sscanf(buffer+8, "%d", &version_revision)) {
+				SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode version_revision \n" << buffer << std::endl );
 				return false;
 			}
-			m_dBlockDurationRaster_us=1e6*def[0];
+			SEQ_MSG(DEBUG_MEDIUM_LEVEL, "revision=" << version_revision);
 		}
-		SeqBlock::s_blockDurationRaster=m_dBlockDurationRaster_us;
+		else
+		{
+			SEQ_MSG(WARNING_MSG, "*** WARNING: unknown field in the [VERSION] block");
+			return false;
+		}
+		//getline(data_stream, buffer, MAX_LINE_SIZE);
+		skipComments(data_stream,buffer);			// load up some data and ignore comments & empty lines
+	}
+	version_combined=version_major*1000000L+version_minor*1000L+version_revision;
+	return true;
+};
 
-		print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "--- Finished reading definitions, reading blocks ...");
+/***********************************************************/
+bool ExternalSequence::readShapes(std::istream &data_stream, char *buffer)
+{
+	char tmpStr[MAX_LINE_SIZE];
+	skipComments(data_stream,buffer);			// Ignore comments & empty lines
 
-		// Read blocks section
-		// ------------------------
-		if (m_fileIndex.find("[BLOCKS]") == m_fileIndex.end()) {
-			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Required: [BLOCKS] section");
+	int shapeId, numSamples;
+	float sample;
+
+	while (data_stream.good() && buffer[0]=='s')
+	{
+		if (2!=sscanf(buffer, "%s%d", tmpStr, &shapeId)) {
+			SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode 'shapeId'\n" << buffer << std::endl );
+			return false;
+		}
+		getline(data_stream, buffer, MAX_LINE_SIZE);
+		if (2!=sscanf(buffer, "%s%d", tmpStr, &numSamples)) {
+			SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode 'numSamples'\n" << buffer << std::endl );
 			return false;
 		}
-		data_stream.seekg(m_fileIndex["[BLOCKS]"], std::ios::beg);
 
-		int blockIdx;
-		EventIDs events;
+		//SEQ_MSG(DEBUG_LOW_LEVEL, "Reading shape " << shapeId );
 
-		// Read blocks
-		m_blocks.clear();
+		CompressedShape shape;
+		shape.samples.clear();
 		while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-			if (buffer[0]=='[' || strlen(buffer)==0) {
+			if (buffer[0]=='s' || strlen(buffer)==0) {
 				break;
 			}
+			if (1!=sscanf(buffer, "%f", &sample)) {
+				SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode 'sample'\n" << buffer << std::endl );
+				return false;
+			}
+			shape.samples.push_back(sample);
+		}
+		// number of samples equal to the data length is used as a non-compressed flag
+		// but only for v1.4.0 or above
+		if (version_combined >= 1004000 && numSamples==shape.samples.size())
+			shape.isCompressed=false;
+		else 
+			shape.isCompressed=true;
+		shape.numUncompressedSamples=numSamples;
+
+		SEQ_MSG(DEBUG_LOW_LEVEL, "Shape index " << shapeId << " has " << shape.samples.size()
+			<< " compressed and " << shape.numUncompressedSamples << " uncompressed samples" );
 
-			memset(events.id, 0, NUM_EVENTS*sizeof(int));
-			long dur_ru =0;
-
-			int ret=sscanf(buffer, "%d%d%d%d%d%d%d%d", &blockIdx,
-					&dur_ru,                                        // block duration
-					&events.id[RF],                                 // RF
-					&events.id[GX],&events.id[GY],&events.id[GZ],   // Gradients
-					&events.id[ADC],                                // ADCs
-					&events.id[EXT]                                 // Extensions
-					);
-			if (7>ret
-					) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode event table entry:\n" << buffer << std::endl );
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "***        number of fields read: " << ret << std::endl );
+		m_shapeLibrary[shapeId] = shape;
+
+		skipComments(data_stream,buffer);			// Ignore comments & empty lines
+	}
+	data_stream.clear();	// In case EOF reached
+
+	SEQ_MSG(DEBUG_HIGH_LEVEL, "-- SHAPES READ numShapes: " << m_shapeLibrary.size() );
+	return true;
+};
+
+/***********************************************************/
+bool ExternalSequence::readRF(std::istream &data_stream, char *buffer)
+{
+	int rfId;
+	m_rfLibrary.clear();
+	while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
+		if (buffer[0]=='[' || strlen(buffer)==0) {
+			break;
+		}
+		RFEvent event;
+		if (version_combined<1004000L)
+		{
+			if (7!=sscanf(buffer, "%d%f%d%d%d%f%f", &rfId, &(event.amplitude),
+						&(event.magShape),&(event.phaseShape), &(event.delay),
+						&(event.freqOffset), &(event.phaseOffset)
+						)) {
+				SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode RF event\n" << buffer << std::endl );
 				return false;
 			}
+			event.timeShape=0;
+		}
+		else
+		{
+			if (8!=sscanf(buffer, "%d%f%d%d%d%d%f%f", &rfId, &(event.amplitude),
+						&(event.magShape),&(event.phaseShape),&(event.timeShape),&(event.delay),
+						&(event.freqOffset), &(event.phaseOffset)
+						)) {
+				SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode RF event\n" << buffer << std::endl );
+				return false;
+			}
+		}
+		m_rfLibrary[rfId] = event;
+	}
+	return true;
+};
 
-			if (!checkBlockReferences(events)) {
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Block " << blockIdx
-					<< " contains references to undefined events" );
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "***        RF:" << events.id[RF] << " GX:" << events.id[GX] << " GY:" << events.id[GY] << " GZ:" << events.id[GZ] << " ADC:" << events.id[ADC] << " EXT:" << events.id[EXT]);
+/***********************************************************/
+bool ExternalSequence::readGradients(std::istream &data_stream, char *buffer)
+{
+	while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
+		if (buffer[0]=='[' || strlen(buffer)==0) {
+			break;
+		}
+		int gradId;
+		GradEvent event;
+		if ( version_combined>=1004000L )
+		{
+			if (5!=sscanf(buffer, "%d%f%d%d%d", &gradId, &(event.amplitude), &(event.waveShape), &(event.timeShape), &(event.delay))) {
+				SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode v1.4.x gradient event\n" << buffer << std::endl );
 				return false;
 			}
-			// Add event IDs to list of blocks
-			m_blocks.push_back(events);
-			m_blockDurations_ru.push_back(dur_ru); // ATTENTION, for versions prior to 1.4.0 this will contain delayIDs, we fix it below
 		}
+		else
+		{
+			event.timeShape=0;
+			if (4!=sscanf(buffer, "%d%f%d%d", &gradId, &(event.amplitude), &(event.waveShape), &(event.delay))) {
+				SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode v1.2.x gradient event\n" << buffer << std::endl );
+				return false;
+			}
+		}
+		m_gradLibrary[gradId] = event;
+	}
+	return true;
+};
 
-		print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "-- BLOCKS READ: " << m_blocks.size());
-		// Num_Blocks definition (if defined) is used to check the correct number of blocks are read
-		if (numBlocks>0 && m_blocks.size()!=numBlocks) {
-			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Expected " << numBlocks
-				<< " blocks but read " << m_blocks.size() << " blocks");
+/***********************************************************/
+bool ExternalSequence::readTraps(std::istream &data_stream, char *buffer)
+{
+	while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
+		if (buffer[0]=='[' || strlen(buffer)==0) {
+			break;
+		}
+		int gradId;
+		GradEvent event;
+		if (6!=sscanf(buffer, "%d%f%ld%ld%ld%d", &gradId, &(event.amplitude),
+			&(event.rampUpTime),&(event.flatTime),&(event.rampDownTime),&(event.delay))) {
+			SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode trapezoid gradient entry" << buffer << std::endl );
+			return false;
+		}					
+		event.waveShape=0;
+		event.timeShape=0;
+		m_gradLibrary[gradId] = event;
+	}
+	return true;
+};
+
+/***********************************************************/
+bool ExternalSequence::readADC(std::istream &data_stream, char *buffer)
+{
+	int adcId;
+	m_adcLibrary.clear();
+	while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
+		if (buffer[0]=='[' || strlen(buffer)==0) {
+			break;
+		}
+		ADCEvent event;
+		if (6!=sscanf(buffer, "%d%d%d%d%f%f", &adcId, &(event.numSamples),
+					&(event.dwellTime),&(event.delay),&(event.freqOffset),&(event.phaseOffset))) {
+			SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode ADC event\n" << buffer << std::endl );
 			return false;
 		}
-		
-		print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "--- Reading signature...");
-		// Read signature section
-		// ------------------------
-		if (m_fileIndex.find("[SIGNATURE]") != m_fileIndex.end()) {
-			data_stream.seekg(m_fileIndex["[SIGNATURE]"], std::ios::beg);
+		m_adcLibrary[adcId] = event;
+	}
+	return true;
+};
 
-			// Read each signature line
-			m_signatureMap.clear();
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				if (buffer[0]=='#')
-					continue;
-				std::istringstream ss(buffer);
-				std::string key;
-				ss >> key;
-				std::string str_value;
-				if (std::getline(ss,str_value)) {
-					str_value = str_trim(str_value);
-					m_signatureMap[key] = str_value; // old compilers like MSVC6 require such stupid conversions
-				}
-			}
+/***********************************************************/
+bool ExternalSequence::readDelays(std::istream &data_stream, char *buffer)
+{
+	int delayId;
+	long delay;
+	while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
+		if (buffer[0]=='[' || strlen(buffer)==0) {
+			break;
+		}
+		if (2!=sscanf(buffer, "%d%ld", &delayId, &delay)) {
+			SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode delay event\n" << buffer << std::endl );
+			return false;
+		}
+		m_tmpDelayLibrary[delayId] = delay;
+	}
+	return true;
+};
 
-			std::ostringstream out;
-			out << "-- " << "SIGNATURE SECTION READ with " << m_signatureMap.size() << " entries:" << std::endl;
-			for (std::map<std::string, std::string >::iterator it=m_signatureMap.begin(); it!=m_signatureMap.end(); ++it)
-				out << it->first << " : " << it->second << std::endl;		
-			print_msg(DEBUG_HIGH_LEVEL, out);
-
-			// convert the relevant field(s) into the internal structure(s)
-			if (m_signatureMap.count("Hash")>0) {
-				m_bSignatureDefined = true;
-				m_strSignature = m_signatureMap["Hash"];
-				if (m_signatureMap.count("Type")>0) 
-					m_strSignatureType = m_signatureMap["Type"];
+/***********************************************************/
+bool ExternalSequence::readExtensions(std::istream &data_stream, char *buffer, int sectionEnd)
+{
+	// we first read in the extension list
+	int nID;
+	int nExtensionID=EXT_LIST; // EXT_LIST means we are reading the extension list
+	while ( (sectionEnd<0 || data_stream.tellg()<sectionEnd) &&
+			getline(data_stream, buffer, MAX_LINE_SIZE)) 
+	{
+		if (sectionEnd<0 && buffer[0]=='[') {
+			break;	// forward-only reading stops at the next section
+		}
+		if (buffer[0]=='#' || buffer[0]=='[' || strlen(buffer)==0) {
+			continue;
+		}
+		SEQ_MSG(DEBUG_LOW_LEVEL, "input line: " << buffer);
+		if (0==strncmp(buffer,"extension",9)) {
+			// read new extension ID from the header
+			char szStrID[MAX_LINE_SIZE];
+			int nInternalID=0;
+			int nKnownID=EXT_UNKNOWN;
+			if (2!=sscanf(buffer, "extension %s %d", szStrID, &nInternalID)) {
+				SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode extension header entry\n" << buffer << std::endl );
+				return false;
 			}
-		} // if signature exists
-
-		print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "--- Finished reading signature");
-
-		if (version_combined<1004000L) 
+			// here is the list if extensions we currently recognize
+			if (0==strcmp("TRIGGERS",szStrID))
+				nKnownID=EXT_TRIGGER;
+			else if (0==strcmp("ROTATIONS",szStrID))
+				nKnownID=EXT_ROTATION;
+			else if (0==strcmp("LABELSET",szStrID))
+				nKnownID=EXT_LABELSET;
+			else if (0==strcmp("LABELINC",szStrID))
+				nKnownID=EXT_LABELINC;
+			if (nKnownID!=EXT_UNKNOWN)
+				m_extensionNameIDs[nInternalID]=std::make_pair(std::string(szStrID),nKnownID);
+			else {
+				SEQ_MSG(WARNING_MSG, "*** WARNING: unknown extension ignored\n" << buffer << std::endl );
+			}
+			nExtensionID=nKnownID;
+		}
+		else
 		{
-			print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "-- converting blocks from version " << version_combined);
-			// we need to calculate dutation of every block and save it in m_blockDurations_ru
-
-			for (int b=0; b<m_blocks.size(); ++b) 
-			{
-				SeqBlock* block=GetBlock(b);
-				// Calculate duration of block
-				long duration = 0;
-				// special processing of the delay objects (which are now eliminated)
-				if (m_blockDurations_ru[b]) // non-zero means old delay library reference
-				{
-					if (m_tmpDelayLibrary.end()==m_tmpDelayLibrary.find(m_blockDurations_ru[b])) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: invalid delay library reference " << m_blockDurations_ru[b] << " in block " << b << " detected while convering the Pulseq file from older version");
+			ExtensionListEntry extEntry;
+			TriggerEvent trigger;
+			RotationEvent rotation;
+			int  nVal;					   // read label set/inc values from label set/inc extension
+			int  nRet;                     // conversion result / return value
+			char szLabelID[MAX_LINE_SIZE]; // read labels strings from label set/inc extension
+			LabelEvent	label;			   // write label event
+			switch (nExtensionID) {
+				case EXT_LIST: 
+					if (4!=sscanf(buffer, "%d%d%d%d", &nID, &(extEntry.type), &(extEntry.ref), &(extEntry.next))) {
+						SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode extension list entry\n" << buffer << std::endl );
 						return false;
 					}
-					duration=m_tmpDelayLibrary[m_blockDurations_ru[b]]; // we know delay is still 0, see above
-				}
-				// fairly standard code, copied from the old version of GetBlock()
-				if (block->isRF()) {
-					RFEvent &rf = block->GetRFEvent();
-					duration = MAX(duration, rf.delay+(long)m_shapeLibrary[rf.magShape].numUncompressedSamples); // in versions prior to v 1.4.0 RF raster was 1us and there was no RF time shape
-				}
-				for (int iC=0; iC<NUM_GRADS; iC++)
-				{
-					GradEvent &grad = block->GetGradEvent(iC);
-					if (block->isArbitraryGradient(iC))
-						duration = MAX(duration, (long)(m_dGradientRasterTime_us*m_shapeLibrary[grad.waveShape].numUncompressedSamples) + grad.delay); // in versions prior to v 1.4.0 there was no time shape
-					else if (block->isTrapGradient(iC))
-						duration = MAX(duration, grad.rampUpTime + grad.flatTime + grad.rampDownTime + grad.delay); 
-					else if (block->isExtTrapGradient(iC)) {
-						// in versions prior to 1.4.0 there were no extended trapezoids (no time shape IDs) so this should never happen
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: unexpected error while converting arbitrary gradients");
+					SEQ_MSG(DEBUG_LOW_LEVEL, "decoding extension list entry " << buffer);
+					m_extensionLibrary[nID] = extEntry;
+					SEQ_MSG(DEBUG_LOW_LEVEL, "nID:" << nID << " type:" << extEntry.type << " ref" << extEntry.ref << " next:" << extEntry.next);
+					break;
+				case EXT_TRIGGER: 
+					if (5!=sscanf(buffer, "%d%d%d%ld%ld", &nID, &(trigger.triggerType), &(trigger.triggerChannel), &(trigger.delay), &(trigger.duration))) {
+						SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode trigger event\n" << buffer << std::endl );
 						return false;
 					}
-				}
-				if (block->isADC()) {
-					ADCEvent &adc = block->GetADCEvent();
-					duration = MAX(duration, adc.delay + (adc.numSamples*adc.dwellTime)/1000);
-				}
-				if (block->isTrigger()) {
-					TriggerEvent &trigger = block->GetTriggerEvent();
-					duration = MAX(duration, trigger.delay+trigger.duration );
-				}
-				// clean up memory
-				delete block;
-				// convert duration to raster units and store it
-				m_blockDurations_ru[b]=ceil(duration/SeqBlock::s_blockDurationRaster - 1e-12);
-				// sanity check
-				if (fabs(m_blockDurations_ru[b]*SeqBlock::s_blockDurationRaster-duration)>1e-9) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** WARNING: rounding up block duration for block" << b);
-				}
+					m_triggerLibrary[nID] = trigger;
+					break;
+				case EXT_ROTATION: 
+					if (10!=sscanf(buffer, "%d%lf%lf%lf%lf%lf%lf%lf%lf%lf", &nID, 
+								&rotation.rotMatrix[0], &rotation.rotMatrix[1], &rotation.rotMatrix[2],
+								&rotation.rotMatrix[3], &rotation.rotMatrix[4], &rotation.rotMatrix[5],
+								&rotation.rotMatrix[6], &rotation.rotMatrix[7], &rotation.rotMatrix[8])) {
+						SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode rotation event\n" << buffer << std::endl );
+						return false;
+					}
+					rotation.defined=true;
+					m_rotationLibrary[nID] = rotation; 
+					break;
+				case EXT_LABELSET: 
+					if (3!=sscanf(buffer, "%d%d%s", &nID, &nVal, szLabelID)) {
+						SEQ_MSG(ERROR_MSG, "*** ERROR: failed to load labelset event\n" << buffer << std::endl );
+						return false;
+					}
+					nRet = decodeLabel(EXT_LABELSET,nVal,szLabelID,label);
+					if (nRet<0) {
+						SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode labelset event\n" << buffer << std::endl );
+						return false;
+					}else if(nRet>0) {
+						SEQ_MSG(ERROR_MSG, "*** decoding labelset event returned 0\n" << buffer << std::endl );
+					} 
+					m_labelsetLibrary[nID] = label;
+					break;
+				case EXT_LABELINC: 
+					if (3!=sscanf(buffer, "%d%d%s", &nID, &nVal, szLabelID)) {
+						SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode labelinc event\n" << buffer << std::endl );
+						return false;
+					}
+					nRet = decodeLabel(EXT_LABELINC,nVal,szLabelID,label);
+					if (nRet<0) {
+						SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode labelinc event\n" << buffer << std::endl );
+						return false;
+					}else if(nRet>0) {
+						SEQ_MSG(ERROR_MSG, "*** ERROR: decoding labelinc event returnd 0\n" << buffer << std::endl );
+					}
+
+					m_labelincLibrary[nID] = label;
+					break;
+				case EXT_UNKNOWN:
+					break; // just ignore unknown extensions
 			}
-			m_tmpDelayLibrary.clear();
 		}
 	}
+	return true;
+};
 
-	//std::vector<double> def = GetDefinition("Scan_ID");
-	//int scanID = def.empty() ? 0: (int)def[0];
-	//print_msg(NORMAL_MSG, std::ostringstream().flush() << "==========================================" );
-	//print_msg(NORMAL_MSG, std::ostringstream().flush() << "===== EXTERNAL SEQUENCE #" << std::setw(5) << scanID << " ===========" );
-	//print_msg(NORMAL_MSG, std::ostringstream().flush() << "==========================================" );
+/***********************************************************/
+bool ExternalSequence::readDefinitions(std::istream &data_stream, char *buffer)
+{
+	// Read each definition line
+	m_definitions.clear();
+	m_definitions_str.clear();
+	int retgl=0;
+	while (retgl=getline(data_stream, buffer, MAX_LINE_SIZE)) {
+		if (buffer[0]=='[' || strlen(buffer)==0) {
+			break;
+		}
+		// this was not compatible with Numaris4 VB line (MSVC6)
+		/*std::istringstream ss(buffer);
+		while(retgl==gl_truncated) { // if the line was truncated read in the rest of it into the stream/buffer
+			retgl=getline(data_stream, buffer, MAX_LINE_SIZE);
+			ss.str(ss.str()+buffer); 
+		}*/
+		// stupid compatible code
+		std::string stmp(buffer);
+		while(retgl==gl_truncated) { // if the line was truncated read in the rest of it into the temporary string
+			retgl=getline(data_stream, buffer, MAX_LINE_SIZE);
+			stmp+=buffer;
+		}
+		char* tmp_buff1= new char[stmp.length()+1]; // old compilers like MSVC6 require such stupid conversions
+		strcpy(tmp_buff1,stmp.c_str());
+		SEQ_MSG(DEBUG_LOW_LEVEL, "--- reading definitions, tmp_buff1=`"<<tmp_buff1<<"'"<<std::endl);
+		std::istringstream ss(tmp_buff1);
+		// delete [] tmp_buff1; // moved few lines below
+		// end of stupid compatible code (except for the delete line below)
+		std::string key;
+		ss >> key;
+		std::string str_value;
+		if (std::getline(ss,str_value)) {
+			str_value = str_trim(str_value);
+			m_definitions_str[key] = str_value; 
+			// old compilers like MSVC6 require such stupid conversions
+			char* tmp_buff2= new char[str_value.length()+1];
+			strcpy(tmp_buff2,str_value.c_str());
+			SEQ_MSG(DEBUG_LOW_LEVEL, "--- reading definitions(2), tmp_buff2=`"<<tmp_buff2<<"'"<<std::endl);
+			std::istringstream ssv(tmp_buff2);
+			double value;
+			std::vector<double> values;
+			while (ssv >> value) {
+				//SEQ_MSG(DEBUG_LOW_LEVEL, "v["<<values.size()<<"]="<<value);
+				values.push_back(value);
+			}
+			delete [] tmp_buff2;
+			m_definitions[key] = values;
+		}
+		// this 'delete' should be here because some compilers pass the buffer by reference
+		delete [] tmp_buff1;
+	}
 
+	if (IsMsgEnabled(DEBUG_HIGH_LEVEL)) {
+		std::ostringstream out;
+		out << "-- " << "DEFINITIONS READ: " << m_definitions.size() << " : ";
+		for (std::map<std::string,std::vector<double> >::iterator it=m_definitions.begin(); it!=m_definitions.end(); ++it)
+		{
+			out<< it->first << " ";
+			for (int i=0; i<it->second.size(); i++)
+				out << it->second[i] << " ";
+		}
+
+		emit_msg(DEBUG_HIGH_LEVEL, out);
+	}
 	return true;
 };
 
+/***********************************************************/
+bool ExternalSequence::interpretDefinitions()
+{
+	if (version_combined<1004000L)
+	{
+		// initialize default raster times
+		m_dAdcRasterTime_us=1e-1; // Siemens default: 1e-07 
+		m_dGradientRasterTime_us=10.0; // Siemens default: 1e-05 
+		m_dRadiofrequencyRasterTime_us=1.0; // Siemens default: 1e-06 
+		m_dBlockDurationRaster_us = m_dGradientRasterTime_us;
+	}
+	else
+	{
+		// for v1.4.x and later we REQUIRE definitions to be present
+		std::vector<double> def = GetDefinition("AdcRasterTime");
+		if (def.empty()){
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Required: definition AdcRasterTime is not present in the file");
+			return false;
+		}
+		m_dAdcRasterTime_us=1e6*def[0];
+		def = GetDefinition("GradientRasterTime");
+		if (def.empty()){
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Required: definition GradientRasterTime is not present in the file");
+			return false;
+		}
+		m_dGradientRasterTime_us=1e6*def[0];
+		def = GetDefinition("RadiofrequencyRasterTime");
+		if (def.empty()){
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Required: definition RadiofrequencyRasterTime is not present in the file");
+			return false;
+		}
+		m_dRadiofrequencyRasterTime_us=1e6*def[0];
+		def = GetDefinition("BlockDurationRaster");
+		if (def.empty()){
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Required: definition BlockDurationRaster is not present in the file");
+			return false;
+		}
+		m_dBlockDurationRaster_us=1e6*def[0];
+	}
+	SeqBlock::s_blockDurationRaster=m_dBlockDurationRaster_us;
+	return true;
+};
+
+/***********************************************************/
+bool ExternalSequence::readBlocks(std::istream &data_stream, char *buffer, bool bCheckReferences)
+{
+	int blockIdx;
+	EventIDs events;
+
+	while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
+		if (buffer[0]=='[' || strlen(buffer)==0) {
+			break;
+		}
+
+		memset(events.id, 0, NUM_EVENTS*sizeof(int));
+		long dur_ru =0;
+
+		int ret=sscanf(buffer, "%d%d%d%d%d%d%d%d", &blockIdx,
+				&dur_ru,                                        // block duration
+				&events.id[RF],                                 // RF
+				&events.id[GX],&events.id[GY],&events.id[GZ],   // Gradients
+				&events.id[ADC],                                // ADCs
+				&events.id[EXT]                                 // Extensions
+				);
+		if (7>ret
+				) {
+					SEQ_MSG(ERROR_MSG, "*** ERROR: failed to decode event table entry:\n" << buffer << std::endl );
+					SEQ_MSG(ERROR_MSG, "***        number of fields read: " << ret << std::endl );
+			return false;
+		}
+
+		if (bCheckReferences && !checkBlockReferences(events)) {
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Block " << blockIdx
+				<< " contains references to undefined events" );
+			SEQ_MSG(ERROR_MSG, "***        RF:" << events.id[RF] << " GX:" << events.id[GX] << " GY:" << events.id[GY] << " GZ:" << events.id[GZ] << " ADC:" << events.id[ADC] << " EXT:" << events.id[EXT]);
+			return false;
+		}
+		// Add event IDs to list of blocks
+		m_blocks.push_back(events);
+		m_blockDurations_ru.push_back(dur_ru); // ATTENTION, for versions prior to 1.4.0 this will contain delayIDs, we fix it below
+	}
+	return true;
+};
+
+/***********************************************************/
+bool ExternalSequence::readSignature(std::istream &data_stream, char *buffer)
+{
+	// Read each signature line
+	m_signatureMap.clear();
+	while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
+		if (buffer[0]=='[' || strlen(buffer)==0) {
+			break;
+		}
+		if (buffer[0]=='#')
+			continue;
+		std::istringstream ss(buffer);
+		std::string key;
+		ss >> key;
+		std::string str_value;
+		if (std::getline(ss,str_value)) {
+			str_value = str_trim(str_value);
+			m_signatureMap[key] = str_value; // old compilers like MSVC6 require such stupid conversions
+		}
+	}
+
+	if (IsMsgEnabled(DEBUG_HIGH_LEVEL)) {
+		std::ostringstream out;
+		out << "-- " << "SIGNATURE SECTION READ with " << m_signatureMap.size() << " entries:" << std::endl;
+		for (std::map<std::string, std::string >::iterator it=m_signatureMap.begin(); it!=m_signatureMap.end(); ++it)
+			out << it->first << " : " << it->second << std::endl;
+		emit_msg(DEBUG_HIGH_LEVEL, out);
+	}
+
+	// convert the relevant field(s) into the internal structure(s)
+	if (m_signatureMap.count("Hash")>0) {
+		m_bSignatureDefined = true;
+		m_strSignature = m_signatureMap["Hash"];
+		if (m_signatureMap.count("Type")>0) 
+			m_strSignatureType = m_signatureMap["Type"];
+	}
+	return true;
+};
+
+/***********************************************************/
+bool ExternalSequence::convertLegacyBlocks()
+{
+	SEQ_MSG(DEBUG_HIGH_LEVEL, "-- converting blocks from version " << version_combined);
+	// we need to calculate dutation of every block and save it in m_blockDurations_ru
+
+	for (int b=0; b<m_blocks.size(); ++b) 
+	{
+		SeqBlock* block=GetBlock(b);
+		// Calculate duration of block
+		long duration = 0;
+		// special processing of the delay objects (which are now eliminated)
+		if (m_blockDurations_ru[b]) // non-zero means old delay library reference
+		{
+			if (m_tmpDelayLibrary.end()==m_tmpDelayLibrary.find(m_blockDurations_ru[b])) {
+				SEQ_MSG(ERROR_MSG, "*** ERROR: invalid delay library reference " << m_blockDurations_ru[b] << " in block " << b << " detected while convering the Pulseq file from older version");
+				return false;
+			}
+			duration=m_tmpDelayLibrary[m_blockDurations_ru[b]]; // we know delay is still 0, see above
+		}
+		// fairly standard code, copied from the old version of GetBlock()
+		if (block->isRF()) {
+			RFEvent &rf = block->GetRFEvent();
+			duration = MAX(duration, rf.delay+(long)m_shapeLibrary[rf.magShape].numUncompressedSamples); // in versions prior to v 1.4.0 RF raster was 1us and there was no RF time shape
+		}
+		for (int iC=0; iC<NUM_GRADS; iC++)
+		{
+			GradEvent &grad = block->GetGradEvent(iC);
+			if (block->isArbitraryGradient(iC))
+				duration = MAX(duration, (long)(m_dGradientRasterTime_us*m_shapeLibrary[grad.waveShape].numUncompressedSamples) + grad.delay); // in versions prior to v 1.4.0 there was no time shape
+			else if (block->isTrapGradient(iC))
+				duration = MAX(duration, grad.rampUpTime + grad.flatTime + grad.rampDownTime + grad.delay); 
+			else if (block->isExtTrapGradient(iC)) {
+				// in versions prior to 1.4.0 there were no extended trapezoids (no time shape IDs) so this should never happen
+				SEQ_MSG(ERROR_MSG, "*** ERROR: unexpected error while converting arbitrary gradients");
+				return false;
+			}
+		}
+		if (block->isADC()) {
+			ADCEvent &adc = block->GetADCEvent();
+			duration = MAX(duration, adc.delay + (adc.numSamples*adc.dwellTime)/1000);
+		}
+		if (block->isTrigger()) {
+			TriggerEvent &trigger = block->GetTriggerEvent();
+			duration = MAX(duration, trigger.delay+trigger.duration );
+		}
+		// clean up memory
+		delete block;
+		// convert duration to raster units and store it
+		m_blockDurations_ru[b]=ceil(duration/m_dBlockDurationRaster_us - 1e-12);
+		// sanity check
+		if (fabs(m_blockDurations_ru[b]*m_dBlockDurationRaster_us-duration)>1e-9) {
+			SEQ_MSG(ERROR_MSG, "*** WARNING: rounding up block duration for block" << b);
+		}
+	}
+	return true;
+};
 
 /***********************************************************/
 void ExternalSequence::skipComments(std::istream &fileStream, char *buffer)
@@ -906,7 +1149,7 @@ void ExternalSequence::buildFileIndex(std::istream &fileStream)
 	
 	while (getline(fileStream, buffer, MAX_LINE_SIZE)) {
 		std::string line = std::string(buffer);
-		//ExternalSequence::print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "buildFileIndex(): read line: [" << line << "]");
+		//ExternalSequence::SEQ_MSG(DEBUG_LOW_LEVEL, "buildFileIndex(): read line: [" << line << "]");
 		if (line[0]=='[' && line[line.length()-1]==']') {
 			m_fileIndex[line] = fileStream.tellg();
 			m_fileSections.insert(fileStream.tellg());			
@@ -917,6 +1160,56 @@ void ExternalSequence::buildFileIndex(std::istream &fileStream)
 	fileStream.seekg(0, std::ios::beg);
 };
 
+/***********************************************************/
+void ExternalSequence::indexFile(std::istream &data_stream)
+{
+	m_fileIndex.clear();
+	m_fileSections.clear();
+	buildFileIndex(data_stream);
+};
+
+/***********************************************************/
+bool ExternalSequence::reload(std::istream &data_stream, const std::set<std::string>& sections)
+{
+	static const char* reloadable[] = {"[SHAPES]", "[RF]", "[GRADIENTS]", "[TRAP]", "[ADC]", "[DELAYS]", "[EXTENSIONS]", "[BLOCKS]", "[SIGNATURE]"};
+	const std::set<std::string> reloadableSections(reloadable, reloadable + sizeof(reloadable)/sizeof(reloadable[0]));
+
+	for (std::set<std::string>::const_iterator it=sections.begin(); it!=sections.end(); ++it) {
+		if (reloadableSections.count(*it)==0) {
+			SEQ_MSG(DEBUG_HIGH_LEVEL, "-- reload() does not support the section " << *it);
+			return false;
+		}
+	}
+
+	SEQ_MSG(DEBUG_HIGH_LEVEL, "Reloading " << sections.size() << " sections");
+	m_reloadSections = sections;
+	// block durations of older files were converted from delays and events, so they are read again
+	if (version_combined<1004000L)
+		m_reloadSections.insert("[BLOCKS]");
+	bool ok = load(data_stream, lm_sections);
+	m_reloadSections.clear();
+	if (!ok)
+		return false;
+
+	// blocks that were kept may refer to events which no longer exist
+	if (sections.count("[BLOCKS]")==0) {
+		for (unsigned int b=0; b<m_blocks.size(); ++b) {
+			if (!checkBlockReferences(m_blocks[b])) {
+				SEQ_MSG(ERROR_MSG, "*** ERROR: Block " << b+1
+					<< " contains references to undefined events" );
+				return false;
+			}
+		}
+	}
+	return true;
+};
+
+/***********************************************************/
+bool ExternalSequence::isSectionSelected(load_mode loadMode, const std::string& section)
+{
+	return loadMode!=lm_sections || m_reloadSections.count(section)>0;
+};
+
 /***********************************************************/
 SeqBlock*	ExternalSequence::GetBlock(int index) {
 	SeqBlock *block = new SeqBlock();
@@ -925,7 +1218,7 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 	EventIDs events = m_blocks[index];
 	std::copy(events.id,events.id+NUM_EVENTS,&block->events[0]);
 
-	//ExternalSequence::print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "GetBlock(" << index << ") : [ " << events.id[0] << " " << events.id[1] << " " << events.id[2] << " " << events.id[3] << " " << events.id[4] << " " << events.id[5] << " " << events.id[6] << "  ]");
+	//ExternalSequence::SEQ_MSG(DEBUG_LOW_LEVEL, "GetBlock(" << index << ") : [ " << events.id[0] << " " << events.id[1] << " " << events.id[2] << " " << events.id[3] << " " << events.id[4] << " " << events.id[5] << " " << events.id[6] << "  ]");
 
 	// Set some defaults
 	block->index = index;
@@ -948,7 +1241,7 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 		while (nNextExtID) {
 			std::map<int,ExtensionListEntry>::iterator itEL = m_extensionLibrary.find(nNextExtID);
 			if (itEL == m_extensionLibrary.end()) {
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "ERROR: could not find extension list entry " << nNextExtID);
+				SEQ_MSG(ERROR_MSG, "ERROR: could not find extension list entry " << nNextExtID);
 				//return NULL;
 				break;
 			}
@@ -959,7 +1252,7 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 				switch (itEN->second.second) {
 					case EXT_TRIGGER:
 						if (block->trigger.triggerType!=0) {
-							print_msg(WARNING_MSG, std::ostringstream().flush() << "*** WARNING: only one trigger per block is supported; error block: " << index );
+							SEQ_MSG(WARNING_MSG, "*** WARNING: only one trigger per block is supported; error block: " << index );
 						}
 						else {
 							// ok, lets find the trigger in the library
@@ -968,7 +1261,7 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 						break;
 					case EXT_ROTATION:
 						if (block->rotation.defined) {
-							print_msg(WARNING_MSG, std::ostringstream().flush() << "*** WARNING: only one rotation per block is supported; error block: " << index );
+							SEQ_MSG(WARNING_MSG, "*** WARNING: only one rotation per block is supported; error block: " << index );
 						}
 						else {
 							// ok, lets find the rotation in the library
@@ -986,12 +1279,12 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 							block->labelinc.push_back(m_labelincLibrary[itEL->second.ref]); // do we have to check whether it can be found?
 						break;
 					default:
-						print_msg(WARNING_MSG, std::ostringstream().flush() << "*** WARNING: unimplemented extension type " << itEN->second.first << " in block " << index );
+						SEQ_MSG(WARNING_MSG, "*** WARNING: unimplemented extension type " << itEN->second.first << " in block " << index );
 				}
 			}
 			else
 			{
-				print_msg(WARNING_MSG, std::ostringstream().flush() << "*** WARNING: unrecognized extension type " << itEL->second.type << " in block " << index );
+				SEQ_MSG(WARNING_MSG, "*** WARNING: unrecognized extension type " << itEL->second.type << " in block " << index );
 			}
 			// update the next pointer
 			nNextExtID=itEL->second.next;
@@ -1042,7 +1335,7 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 	//	block->duration = MAX(duration, block->delay);
 	*/
 
-	//ExternalSequence::print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "block duration: " << block->duration);
+	//ExternalSequence::SEQ_MSG(DEBUG_LOW_LEVEL, "block duration: " << block->duration);
     
 	return block;
 }
@@ -1051,7 +1344,7 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 bool ExternalSequence::decodeBlock(SeqBlock *block)
 {
 	int *events = &block->events[0];
-	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Decoding block " << block->index << " events: "
+	SEQ_MSG(DEBUG_LOW_LEVEL, "Decoding block " << block->index << " events: "
 		<< events[0]+1 << " " << events[1]+1 << " " << events[2]+1 << " "
 		<< events[3]+1 << " " << events[4]+1 );
 	
@@ -1060,13 +1353,17 @@ bool ExternalSequence::decodeBlock(SeqBlock *block)
 	if (block->isRF())
 	{
 		// Decompress the shape for this channel
-		CompressedShape& shape = m_shapeLibrary[block->rf.magShape];
+		CompressedShape* pShape = findShape(block->rf.magShape);
+		if (pShape==NULL) return false;
+		CompressedShape& shape = *pShape;
 		waveform.resize(shape.numUncompressedSamples);
 		if (!decompressShape(shape,&waveform[0]))
 			return false;
 
 		//MZ: original Kelvin's code follows
-		CompressedShape& shapePhase = m_shapeLibrary[block->rf.phaseShape];
+		CompressedShape* pShapePhase = findShape(block->rf.phaseShape);
+		if (pShapePhase==NULL) return false;
+		CompressedShape& shapePhase = *pShapePhase;
 		std::vector<float> waveform_p;
 		waveform_p.resize(shapePhase.numUncompressedSamples);
 		if (!decompressShape(shapePhase,&waveform_p[0]))
@@ -1080,7 +1377,9 @@ bool ExternalSequence::decodeBlock(SeqBlock *block)
 		if (block->rf.timeShape) 
 		{
 			// new file format (v1.4.x)
-			CompressedShape& shapeTime = m_shapeLibrary[block->rf.timeShape];
+			CompressedShape* pShapeTime = findShape(block->rf.timeShape);
+			if (pShapeTime==NULL) return false;
+			CompressedShape& shapeTime = *pShapeTime;
 			// detect regular sampling 
 			if (shapeTime.samples.size()!=shapeTime.numUncompressedSamples &&
 				(shapeTime.samples.size()==3 || shapeTime.samples.size()==4)) 
@@ -1140,21 +1439,23 @@ bool ExternalSequence::decodeBlock(SeqBlock *block)
 		if (block->isArbitraryGradient(iC-GX))	// is arbitrary gradient?
 		{
 			// Decompress the arbitrary shape for this channel
-			CompressedShape& shape = m_shapeLibrary[block->grad[iC-GX].waveShape];
+			CompressedShape* pShape = findShape(block->grad[iC-GX].waveShape);
+			if (pShape==NULL) return false;
+			CompressedShape& shape = *pShape;
 
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Loaded shape with "
+			SEQ_MSG(DEBUG_LOW_LEVEL, "Loaded shape with "
 				<< shape.samples.size() << " compressed samples" );
 
 			waveform.resize(shape.numUncompressedSamples);
 			if (!decompressShape(shape,&waveform[0]))
 				return false;
 
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Shape uncompressed to "
+			SEQ_MSG(DEBUG_LOW_LEVEL, "Shape uncompressed to "
 				<< shape.numUncompressedSamples << " samples" );
 
 			if (fabs(m_dGradientRasterTime_us-10)>1e-3)
 			{
-				print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Shape is on a raster that is different from the system raster, exitting... (will try resampling in the future versions...)" );
+				SEQ_MSG(DEBUG_LOW_LEVEL, "Shape is on a raster that is different from the system raster, exitting... (will try resampling in the future versions...)" );
 				// TODO: !!!
 				// PROBLEM: we need 'first' and 'last' to be able to interpolate correctly...
 				return false;
@@ -1188,7 +1489,7 @@ bool ExternalSequence::decodeBlock(SeqBlock *block)
 bool ExternalSequence::decodeExtTrapGradInBlock(SeqBlock *block)
 {
 	int *events = &block->events[0];
-	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Decoding ext gradient in block " << block->index << " events: "
+	SEQ_MSG(DEBUG_LOW_LEVEL, "Decoding ext gradient in block " << block->index << " events: "
 		<< events[0]+1 << " " << events[1]+1 << " " << events[2]+1 << " "
 		<< events[3]+1 << " " << events[4]+1 );
 
@@ -1202,27 +1503,31 @@ bool ExternalSequence::decodeExtTrapGradInBlock(SeqBlock *block)
 		{
 			// Decompress the ExtTrap shapes for this channel
 			// time shape first
-			CompressedShape& tshape = m_shapeLibrary[block->grad[iC-GX].timeShape];
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Loaded time shape " << block->grad[iC-GX].timeShape << " with " << tshape.samples.size() << " compressed samples" );
+			CompressedShape* pTShape = findShape(block->grad[iC-GX].timeShape);
+			if (pTShape==NULL) return false;
+			CompressedShape& tshape = *pTShape;
+			SEQ_MSG(DEBUG_LOW_LEVEL, "Loaded time shape " << block->grad[iC-GX].timeShape << " with " << tshape.samples.size() << " compressed samples" );
 			//for (int a=0; a<tshape.samples.size(); ++a) {
-			//	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << tshape.samples[a] );
+			//	SEQ_MSG(DEBUG_LOW_LEVEL, tshape.samples[a] );
 			//}
 			waveform.resize(tshape.numUncompressedSamples);
 			if (!decompressShape(tshape,&waveform[0])) return false;
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Time shape uncompressed to " << tshape.numUncompressedSamples << " samples" );
+			SEQ_MSG(DEBUG_LOW_LEVEL, "Time shape uncompressed to " << tshape.numUncompressedSamples << " samples" );
 			//block->gradExtTrapForms[iC-GX].first = std::vector<float>(waveform); 
 			block->gradExtTrapForms[iC-GX].first.resize(waveform.size());
 			for (int i=0;i<waveform.size();++i)
 				block->gradExtTrapForms[iC-GX].first[i]=long(0.5+m_dGradientRasterTime_us*waveform[i]); // convert to long usec from grad rasters 
 			// now wave amplitude shape
-			CompressedShape& wshape = m_shapeLibrary[block->grad[iC-GX].waveShape];
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Loaded wave shape " << block->grad[iC-GX].waveShape << " with " << wshape.samples.size() << " compressed samples" );
+			CompressedShape* pWShape = findShape(block->grad[iC-GX].waveShape);
+			if (pWShape==NULL) return false;
+			CompressedShape& wshape = *pWShape;
+			SEQ_MSG(DEBUG_LOW_LEVEL, "Loaded wave shape " << block->grad[iC-GX].waveShape << " with " << wshape.samples.size() << " compressed samples" );
 			waveform.resize(wshape.numUncompressedSamples);
 			if (!decompressShape(wshape,&waveform[0])) return false;
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Wave shape uncompressed to " << wshape.numUncompressedSamples << " samples" );
+			SEQ_MSG(DEBUG_LOW_LEVEL, "Wave shape uncompressed to " << wshape.numUncompressedSamples << " samples" );
 			block->gradExtTrapForms[iC-GX].second = std::vector<float>(waveform);
 			if (block->gradExtTrapForms[iC-GX].first.size() != block->gradExtTrapForms[iC-GX].second.size()) {
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "ERROR: uncompressed extended trapezoid time and wave shape lengths do not match" );
+				SEQ_MSG(ERROR_MSG, "ERROR: uncompressed extended trapezoid time and wave shape lengths do not match" );
 				return false;
 			}
 		}
@@ -1230,6 +1535,17 @@ bool ExternalSequence::decodeExtTrapGradInBlock(SeqBlock *block)
 	return true;
 }
 
+/***********************************************************/
+CompressedShape* ExternalSequence::findShape(int shapeId)
+{
+	std::map<int,CompressedShape>::iterator it = m_shapeLibrary.find(shapeId);
+	if (it == m_shapeLibrary.end()) {
+		SEQ_MSG(ERROR_MSG, "ERROR: could not find shape " << shapeId);
+		return NULL;
+	}
+	return &it->second;
+}
+
 /***********************************************************/
 bool ExternalSequence::decompressShape(CompressedShape& encoded, float *shape)
 {
@@ -1256,7 +1572,7 @@ bool ExternalSequence::decompressShape(CompressedShape& encoded, float *shape)
 			int rep = ((int)packed[countPack+1])+2;
 			if (fabs(packed[countPack+1]+2-rep)>1e-6) // MZ: detect format error present in some Pulseq Matlab toolbox versions
 			{
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "ERROR: compressed shape format error detected \n"
+				SEQ_MSG(ERROR_MSG, "ERROR: compressed shape format error detected \n"
 																	 "  packed[countPack-1]=" << packed[countPack-1] << "  packed[countPack]=" << packed[countPack] << std::endl <<
 																	 "  packed[countPack+1]=" << packed[countPack+1] << "  rep=" << rep << "  countPack=" << countPack );
 				return false;
@@ -1400,9 +1716,9 @@ int ExternalSequence::decodeLabel(ExtType exttype, int& nVal, char* szLabelID, L
 		LABELMAP_FLAG(NOROT);
 		LABELMAP_FLAG(NOSCL);
 		// check if all labels/flags have been added to the map
-		//print_msg(WARNING_MSG, std::ostringstream().flush() << "*** m_labelMap.mapLabelIdToStr.size()= " << m_labelMap.mapLabelIdToStr.size());
-		//print_msg(WARNING_MSG, std::ostringstream().flush() << "*** m_labelMap.mapFlagIdToStr.size()= " << m_labelMap.mapFlagIdToStr.size());
-		//print_msg(WARNING_MSG, std::ostringstream().flush() << "*** m_labelMap.mapStrToLabel.size()= " << m_labelMap.mapStrToLabel.size());
+		//SEQ_MSG(WARNING_MSG, "*** m_labelMap.mapLabelIdToStr.size()= " << m_labelMap.mapLabelIdToStr.size());
+		//SEQ_MSG(WARNING_MSG, "*** m_labelMap.mapFlagIdToStr.size()= " << m_labelMap.mapFlagIdToStr.size());
+		//SEQ_MSG(WARNING_MSG, "*** m_labelMap.mapStrToLabel.size()= " << m_labelMap.mapStrToLabel.size());
 		assert(m_labelMap.mapLabelIdToStr.size()==NUM_LABELS);
 		assert(m_labelMap.mapFlagIdToStr.size()==NUM_FLAGS);
 		assert(m_labelMap.mapStrToLabel.size()==NUM_LABELS+NUM_FLAGS);
@@ -1413,7 +1729,7 @@ int ExternalSequence::decodeLabel(ExtType exttype, int& nVal, char* szLabelID, L
 	if (it==m_labelMap.mapStrToLabel.end())
 	{
 		//label.defined=false; // when no label is founded, reset label.defined to false
-		print_msg(WARNING_MSG, std::ostringstream().flush() << "*** WARNING: unknown label specification\n");
+		SEQ_MSG(WARNING_MSG, "*** WARNING: unknown label specification\n");
 		return 1;
 	}
 
@@ -1433,52 +1749,52 @@ int ExternalSequence::decodeLabel(ExtType exttype, int& nVal, char* szLabelID, L
 	if (exttype==EXT_LABELSET){				//here we check if the values are valid
 		if (nKnownLBL!=LABEL_UNKNOWN){
 			/*if (nVal<0){
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Extension specification LABELSET for int-type MDH Headers is incorrect\n");
+				SEQ_MSG(ERROR_MSG, "*** ERROR: Extension specification LABELSET for int-type MDH Headers is incorrect\n");
 				return -1;
 			}else*/
 				return 0;
 		}else if (nKnownFG!=FLAG_UNKNOWN){
 			if ((nVal!=0)&&(nVal!=1)){
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Extension specification LABELSET for bool-type MDH Headers is incorrect\n");
+				SEQ_MSG(ERROR_MSG, "*** ERROR: Extension specification LABELSET for bool-type MDH Headers is incorrect\n");
 				return -1;
 			}else
 				return 0;
 		}else{
-			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: EXT_LABELSET only support LABEL&&FLAG\n");
+			SEQ_MSG(ERROR_MSG, "*** ERROR: EXT_LABELSET only support LABEL&&FLAG\n");
 			return -1;					 
 		}
 	}else if (exttype==EXT_LABELINC){
 		if (nKnownLBL!=LABEL_UNKNOWN){			
 			return 0;				 
 		}else if (nKnownFG!=FLAG_UNKNOWN){				// EXT_LABELINC should NOT be used for bool type MDH Headers
-			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Extension specification LABELINC is NOT for bool-type MDH Headers\n");
+			SEQ_MSG(ERROR_MSG, "*** ERROR: Extension specification LABELINC is NOT for bool-type MDH Headers\n");
 			return -1;
 		}else {
-			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: EXT_LABELINC only support LABEL&&FLAG\n");
+			SEQ_MSG(ERROR_MSG, "*** ERROR: EXT_LABELINC only support LABEL&&FLAG\n");
 			return -1;	
 		}		
 	}else{											// No ExtType recognized
-		print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Extension specification is NOT recognized\n");
+		SEQ_MSG(ERROR_MSG, "*** ERROR: Extension specification is NOT recognized\n");
 		return -1;					 
 	}
 }
 
 bool ExternalSequence::isGradientInBlockStartAtNonZero(SeqBlock *block, int channel) {
 	if (!block->isExtTrapGradient(channel) && !block->isArbitraryGradient(channel)) {
-		//ExternalSequence::print_msg(NORMAL_MSG, std::ostringstream().flush() << "isGradientInBlockStartAtNonZero() returns FALSE because there is no arb grad in channel " << channel);
+		//ExternalSequence::SEQ_MSG(NORMAL_MSG, "isGradientInBlockStartAtNonZero() returns FALSE because there is no arb grad in channel " << channel);
 		return false;
 	}
 	// only Arbitrary or ExtTrap gradients reach here
 	if (block->grad[channel].delay>0) {
-		//ExternalSequence::print_msg(NORMAL_MSG, std::ostringstream().flush() << "isGradientInBlockStartAtNonZero() returns FALSE because there is delay in channel " << channel);
+		//ExternalSequence::SEQ_MSG(NORMAL_MSG, "isGradientInBlockStartAtNonZero() returns FALSE because there is delay in channel " << channel);
 		return false;
 	}
 	if (!block->gradWaveforms[channel].empty()) { 
-		//ExternalSequence::print_msg(NORMAL_MSG, std::ostringstream().flush() << "isGradientInBlockStartAtNonZero() uses decompressed shape and returns " << (fabs(block->gradWaveforms[channel].front())>0));
+		//ExternalSequence::SEQ_MSG(NORMAL_MSG, "isGradientInBlockStartAtNonZero() uses decompressed shape and returns " << (fabs(block->gradWaveforms[channel].front())>0));
 		return fabs(block->gradWaveforms[channel].front())>0;
 	}
 	// we could decode the block's shapes at this point, but we can also just look up the first sample of the compressed shape
-	//ExternalSequence::print_msg(NORMAL_MSG, std::ostringstream().flush() << "isGradientInBlockStartAtNonZero() uses compressed shape and returns " << (fabs(m_shapeLibrary[block->grad[channel].waveShape].samples.front())>0));
+	//ExternalSequence::SEQ_MSG(NORMAL_MSG, "isGradientInBlockStartAtNonZero() uses compressed shape and returns " << (fabs(m_shapeLibrary[block->grad[channel].waveShape].samples.front())>0));
 	return fabs(m_shapeLibrary[block->grad[channel].waveShape].samples.front())>0;
 }
 
@@ -1486,7 +1802,7 @@ bool ExternalSequence::isAllGradientsInBlockStartAtZero(SeqBlock *block) {
 	for (int i=0; i<NUM_GRADS; ++i)
 		if (isGradientInBlockStartAtNonZero(block,i))
 			return false;
-	//ExternalSequence::print_msg(NORMAL_MSG, std::ostringstream().flush() << "isAllGradientsStartAtZero() returns TRUE");
+	//ExternalSequence::SEQ_MSG(NORMAL_MSG, "isAllGradientsStartAtZero() returns TRUE");
 	return true;
 }
 
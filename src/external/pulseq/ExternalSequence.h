@@ -52,6 +52,19 @@ const MessageType MSG_LEVEL = NORMAL_MSG;
 //const MessageType MSG_LEVEL = DEBUG_MEDIUM_LEVEL;
 //const MessageType MSG_LEVEL = DEBUG_LOW_LEVEL;
 
+/**
+ * @brief Receiver of the messages of one sequence
+ *
+ * Blocks of one sequence may be decoded on several threads at once, so
+ * implementations have to serialize Write() themselves.
+ */
+class MessageSink
+{
+  public:
+	virtual ~MessageSink() {}
+	virtual void Write(MessageType level, const std::string &str) = 0;
+};
+
 
 /**
  * @brief Internal storage order
@@ -644,9 +657,48 @@ class ExternalSequence
 	 * @param  path location of file or directory
 	 */
 
-	enum load_mode {lm_singlefile=0, lm_shapes, lm_events, lm_blocks};
+	enum load_mode {lm_singlefile=0, lm_shapes, lm_events, lm_blocks, lm_sections};
 	bool load(std::istream &data_stream, load_mode loadMose = lm_singlefile);
 
+	/**
+	 * @brief Load a single sequence file from a forward-only stream
+	 *
+	 * Unlike load() the stream is read once from start to end and never seeked,
+	 * so pipes, standard input and decompressing streams can be used. Sections
+	 * are parsed in file order; [VERSION] has to come before the sections that
+	 * depend on it, block references are checked once all sections are read.
+	 * No section index is built, so reload() is not available afterwards.
+	 *
+	 * @param  data_stream stream positioned at the start of the sequence file
+	 */
+	bool loadSequential(std::istream &data_stream);
+
+	/**
+	 * @brief Locate the sections of a single sequence file without loading it
+	 *
+	 * Rebuilds the section index (see GetFileIndex()) from the given stream. Used
+	 * before reload() to find out which sections of a file have changed.
+	 *
+	 * @param  data_stream stream of the complete sequence file
+	 */
+	void indexFile(std::istream &data_stream);
+
+	/**
+	 * @brief Re-parse selected sections of a previously loaded sequence
+	 *
+	 * Only the given sections, e.g. "[RF]" or "[BLOCKS]", are read again, all
+	 * other libraries are kept from the previous load. indexFile() must have been
+	 * called on the same stream. Supported for the sections [SHAPES], [RF], [GRADIENTS],
+	 * [TRAP], [ADC], [DELAYS], [EXTENSIONS], [BLOCKS] and [SIGNATURE]; returns false
+	 * otherwise, in which case the sequence has to be loaded completely. Files older
+	 * than version 1.4.0 always have their [BLOCKS] read again, as the block durations
+	 * are converted from the delays and events.
+	 *
+	 * @param  data_stream stream of the complete sequence file
+	 * @param  sections    names of the sections to re-parse
+	 */
+	bool reload(std::istream &data_stream, const std::set<std::string>& sections);
+
 	/**
 	 * @brief Report the version of the loaded sequence
 	 *
@@ -685,6 +737,22 @@ class ExternalSequence
 	 */
 	static void SetPrintFunction(PrintFunPtr fun);
 
+	/**
+	 * @brief Route the messages of this sequence to a sink
+	 *
+	 * Messages above the given level are neither formatted nor delivered. Without
+	 * a sink (NULL) messages go to the print function set by SetPrintFunction().
+	 *
+	 * @param  sink   receiver of the messages, not owned
+	 * @param  level  most detailed level to deliver
+	 */
+	void SetMessageSink(MessageSink *sink, MessageType level = MSG_LEVEL);
+
+	/**
+	 * @brief Check whether a message of the given level would be delivered
+	 */
+	bool IsMsgEnabled(MessageType level) const;
+
 	/**
 	 * @brief Lookup the custom definition
 	 *
@@ -727,6 +795,7 @@ class ExternalSequence
 	 *
 	 * This involves assigning the block's event objects from the libraries
 	 * as well as decompressing arbitrary RF and gradient shapes.
+	 * The sequence is only read, so different blocks may be decoded concurrently.
 	 *
 	 * @return true if successful
 	 */
@@ -755,6 +824,34 @@ class ExternalSequence
 	std::string getSignature();
 	std::string getSignatureType();
 
+	/**
+	 * @brief Return the raster times defined by the loaded sequence (in us)
+	 */
+	double GetAdcRasterTime_us();
+	double GetGradientRasterTime_us();
+	double GetRadiofrequencyRasterTime_us();
+	double GetBlockDurationRaster_us();
+
+	/**
+	 * @brief Return the library of compressed shapes referenced by the events
+	 */
+	const std::map<int,CompressedShape>& GetShapeLibrary();
+
+	/**
+	 * @brief Return the event libraries and the event table as read from the file
+	 */
+	const std::map<int,RFEvent>& GetRFLibrary();
+	const std::map<int,GradEvent>& GetGradLibrary();
+	const std::map<int,ADCEvent>& GetADCLibrary();
+	const EventIDs& GetBlockEvents(int index);
+	long GetBlockDuration_ru(int index);
+
+	/**
+	 * @brief Return the file location of every section and the sorted section offsets including the end of file
+	 */
+	const std::map<std::string,int>& GetFileIndex();
+	const std::set<int>& GetFileSections();
+
   private:
 
 	static const int MAX_LINE_SIZE;	/**< @brief Maximum length of line */
@@ -788,6 +885,14 @@ class ExternalSequence
 	 */
 	void buildFileIndex(std::istream &stream);
 
+	/**
+	 * @brief Return `true` if the section is to be read by the given load mode
+	 *
+	 * All sections are read, except for lm_sections where only the sections passed to
+	 * reload() are read.
+	 */
+	bool isSectionSelected(load_mode loadMode, const std::string& section);
+
 	/**
 	 * @brief Skip the comments and empty lines in the given input stream.
 	 *
@@ -796,6 +901,36 @@ class ExternalSequence
 	 */
 	void skipComments(std::istream &stream, char* buffer);
 
+	/**
+	 * @brief Section readers shared by load() and loadSequential()
+	 *
+	 * Each reader starts right after the section header and returns `false` on a
+	 * malformed entry. The buffer holds the line that ended the section, which is
+	 * the next section header if no empty line came in between. readExtensions()
+	 * stops at the given stream offset, or at the next header if it is negative.
+	 */
+	bool readVersion(std::istream &stream, char* buffer);
+	bool readShapes(std::istream &stream, char* buffer);
+	bool readRF(std::istream &stream, char* buffer);
+	bool readGradients(std::istream &stream, char* buffer);
+	bool readTraps(std::istream &stream, char* buffer);
+	bool readADC(std::istream &stream, char* buffer);
+	bool readDelays(std::istream &stream, char* buffer);
+	bool readExtensions(std::istream &stream, char* buffer, int sectionEnd);
+	bool readDefinitions(std::istream &stream, char* buffer);
+	bool readBlocks(std::istream &stream, char* buffer, bool bCheckReferences);
+	bool readSignature(std::istream &stream, char* buffer);
+
+	/**
+	 * @brief Raster times from the definitions, required for version 1.4.0 and later
+	 */
+	bool interpretDefinitions();
+
+	/**
+	 * @brief Block durations of files older than version 1.4.0 from their events and delays
+	 */
+	bool convertLegacyBlocks();
+
 	/**
 	 * @brief Decompress a run-length compressed shape
 	 *
@@ -804,6 +939,13 @@ class ExternalSequence
 	 */
 	bool decompressShape(CompressedShape& encoded, float *shape);
 
+	/**
+	 * @brief Look up a shape without inserting missing IDs into the library
+	 *
+	 * @return the shape, NULL if the library has no shape of that ID
+	 */
+	CompressedShape* findShape(int shapeId);
+
 
 	/**
 	 * @brief Check the IDs contains references to valid events in the library
@@ -855,6 +997,14 @@ class ExternalSequence
 
 	static PrintFunPtr print_fun;              /**< @brief Pointer to output print function */
 
+	/**
+	 * @brief Deliver a formatted message to the sink of this sequence
+	 */
+	void emit_msg(MessageType level, std::ostringstream& ss) const;
+
+	MessageSink *msg_sink;                     /**< @brief Receiver of the messages, NULL for print_fun */
+	MessageType msg_level;                     /**< @brief Most detailed level delivered */
+
 	// *** Members ***
 
 	int version_major;
@@ -864,6 +1014,7 @@ class ExternalSequence
 
 	std::map<std::string,int> m_fileIndex;     /**< @brief File location of sections, [RF], [ADC] etc */
 	std::set<int> m_fileSections;              /**< @brief File location of sections and EOF additionally */
+	std::set<std::string> m_reloadSections;    /**< @brief Sections read by reload() */
 
 	// Low level sequence blocks
 	std::vector<EventIDs> m_blocks;            /**< @brief List of sequence blocks */
@@ -887,7 +1038,7 @@ class ExternalSequence
 	std::map<int,RFEvent>      m_rfLibrary;       /**< @brief Library of RF events */
 	std::map<int,GradEvent>    m_gradLibrary;     /**< @brief Library of gradient events */
 	std::map<int,ADCEvent>     m_adcLibrary;      /**< @brief Library of ADC readouts */
-	std::map<int,long>         m_tmpDelayLibrary;    /**< @brief Library of delays, only used for loading older files and is cleaned immediately before load() is finished*/
+	std::map<int,long>         m_tmpDelayLibrary;    /**< @brief Library of delays, only used for converting the blocks of older files, kept for reload()*/
 	//std::map<int,ControlEvent> m_controlLibrary;  /**< @brief Library of control commands */
 	std::map<int,ExtensionListEntry> m_extensionLibrary;  /**< @brief Library of extension list entries */
 	std::map<int,std::pair<std::string,int> > m_extensionNameIDs; /**< @brief Map of extension IDs from the file to textIDs and internal known numeric IDs*/
@@ -927,9 +1078,24 @@ inline std::string	ExternalSequence::GetDefinitionStr(std::string key){
 
 inline void ExternalSequence::defaultPrint(const std::string &str) { std::cout << str << std::endl; }
 inline void ExternalSequence::SetPrintFunction(PrintFunPtr fun) { print_fun=fun; }
+inline void ExternalSequence::SetMessageSink(MessageSink *sink, MessageType level) { msg_sink=sink; msg_level=level; }
+inline bool ExternalSequence::IsMsgEnabled(MessageType level) const { return level<=msg_level; }
 
 inline bool ExternalSequence::isSigned() { return m_bSignatureDefined; }
 inline std::string ExternalSequence::getSignature() { return m_strSignature; }
 inline std::string ExternalSequence::getSignatureType() { return m_strSignatureType; }
 
+inline double ExternalSequence::GetAdcRasterTime_us() { return m_dAdcRasterTime_us; }
+inline double ExternalSequence::GetGradientRasterTime_us() { return m_dGradientRasterTime_us; }
+inline double ExternalSequence::GetRadiofrequencyRasterTime_us() { return m_dRadiofrequencyRasterTime_us; }
+inline double ExternalSequence::GetBlockDurationRaster_us() { return m_dBlockDurationRaster_us; }
+inline const std::map<int,CompressedShape>& ExternalSequence::GetShapeLibrary() { return m_shapeLibrary; }
+inline const std::map<int,RFEvent>& ExternalSequence::GetRFLibrary() { return m_rfLibrary; }
+inline const std::map<int,GradEvent>& ExternalSequence::GetGradLibrary() { return m_gradLibrary; }
+inline const std::map<int,ADCEvent>& ExternalSequence::GetADCLibrary() { return m_adcLibrary; }
+inline const EventIDs& ExternalSequence::GetBlockEvents(int index) { return m_blocks[index]; }
+inline long ExternalSequence::GetBlockDuration_ru(int index) { return m_blockDurations_ru[index]; }
+inline const std::map<std::string,int>& ExternalSequence::GetFileIndex() { return m_fileIndex; }
+inline const std::set<int>& ExternalSequence::GetFileSections() { return m_fileSections; }
+
 #endif	//_EXTERNAL_SEQUENCE_H_
@@ -0,0 +1,470 @@
+#include "interaction_bench.h"
+#include "mainwindow.h"
+#include "ui_mainwindow.h"
+#include "task_pool.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMessageBox>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QStyleFactory>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <qcustomplot.h>
+
+// Zooms into the middle, pans both ways, hides and shows every lane, zooms back out
+static const char* s_pDefaultScript =
+    "reset\n"
+    "zoom 0.5 x8\n"
+    "pan 0.25 x8\n"
+    "pan -0.25 x8\n"
+    "lane RF x2\n"
+    "lane GZ x2\n"
+    "lane GY x2\n"
+    "lane GX x2\n"
+    "lane ADC x2\n"
+    "zoom 2 x8\n"
+    "reset\n";
+
+// Step kinds of a script, the results add "all" over every frame
+static const QStringList s_listKinds{"zoom", "pan", "range", "lane", "reset"};
+
+// Nearest rank of a sorted list
+static double Percentile(const QVector<double>& vecSorted, const double& fraction)
+{
+    if (vecSorted.isEmpty()) return 0.;
+    const int count = static_cast<int>(vecSorted.size());
+    const int rank = static_cast<int>(std::ceil(fraction * count));
+    return vecSorted[qBound(0, rank - 1, count - 1)];
+}
+
+bool InteractionBench::IsRequested(int argc, char* argv[])
+{
+    for (int index = 1; index < argc; index++)
+    {
+        if (std::strcmp(argv[index], "--bench-interaction") == 0) return true;
+    }
+    return false;
+}
+
+int InteractionBench::Run(int argc, char* argv[])
+{
+    // No display is needed, the platform has to be chosen before the application exists
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication::setStyle(QStyleFactory::create("Fusion"));
+    QApplication app(argc, argv);
+    // Files loaded here must not show up among the recent files of the user
+    QApplication::setOrganizationName("PulseqViewer");
+    QApplication::setApplicationName("PulseqViewerBench");
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replay scripted zooms, pans and lane toggles on a Pulseq file and time every replot.");
+    parser.addHelpOption();
+    QCommandLineOption benchOption("bench-interaction", "Pulseq file to load.", "file");
+    QCommandLineOption scriptOption("script", "Interaction script, a built-in one by default.", "file");
+    QCommandLineOption repeatOption("repeat", "Passes over the script.", "n", QString::number(INTERACTION_DEFAULT_REPEAT));
+    QCommandLineOption sizeOption("size", "Window size.", "WxH", "1600x900");
+    QCommandLineOption noAntialiasOption("no-antialias", "Draw without antialiasing.");
+    QCommandLineOption openGlOption("opengl", "Draw through OpenGL if the platform provides it.");
+    QCommandLineOption outOption("out", "JSON results, - for stdout.", "file");
+    QCommandLineOption baselineOption("baseline", "JSON results of an earlier run to compare against.", "file");
+    QCommandLineOption thresholdOption("threshold", "Slowdown of the 90th percentile frame time that counts as a regression.", "pct",
+                                       QString::number(INTERACTION_DEFAULT_THRESHOLD_PCT));
+    parser.addOptions({benchOption, scriptOption, repeatOption, sizeOption, noAntialiasOption, openGlOption,
+                       outOption, baselineOption, thresholdOption});
+    parser.process(app);
+
+    const QString sFilePath = parser.value(benchOption);
+    const int repeat = parser.value(repeatOption).toInt();
+    const QStringList listSize = parser.value(sizeOption).split('x');
+    const int width = listSize.size() == 2 ? listSize[0].toInt() : 0;
+    const int height = listSize.size() == 2 ? listSize[1].toInt() : 0;
+    bool bThreshold(false);
+    const double threshold = parser.value(thresholdOption).toDouble(&bThreshold);
+    if (repeat < 1 || width <= 0 || height <= 0 || !bThreshold || threshold < 0.)
+    {
+        parser.showHelp(2);
+    }
+
+    QString sScript(s_pDefaultScript);
+    if (parser.isSet(scriptOption))
+    {
+        QFile scriptFile(parser.value(scriptOption));
+        if (!scriptFile.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            qCritical().noquote() << "Cannot open script" << parser.value(scriptOption);
+            return 2;
+        }
+        sScript = QString::fromUtf8(scriptFile.readAll());
+    }
+
+    QJsonObject baseline;
+    if (parser.isSet(baselineOption))
+    {
+        QFile baselineFile(parser.value(baselineOption));
+        const QJsonDocument document = baselineFile.open(QIODevice::ReadOnly) ? QJsonDocument::fromJson(baselineFile.readAll()) : QJsonDocument();
+        if (!document.isObject())
+        {
+            qCritical().noquote() << "Cannot read" << parser.value(baselineOption);
+            return 2;
+        }
+        baseline = document.object().value("steps").toObject();
+    }
+
+    TaskPool::Configure(QSettings().value("WorkerThreads", 0).toUInt());
+    MainWindow window;
+    window.resize(width, height);
+    window.show();
+    QCustomPlot* pPlot = window.ui->customPlot;
+    if (parser.isSet(noAntialiasOption))
+    {
+        pPlot->setAntialiasedElements(QCP::aeNone);
+        pPlot->setNotAntialiasedElements(QCP::aeAll);
+    }
+    if (parser.isSet(openGlOption))
+    {
+        pPlot->setOpenGl(true);
+        if (!pPlot->openGl()) qWarning() << "OpenGL is not available, drawing in software";
+    }
+
+    InteractionBench bench(window);
+    QVector<InteractionStep> vecSteps;
+    QString sError;
+    if (!bench.ParseScript(sScript, vecSteps, sError))
+    {
+        qCritical().noquote() << "Invalid script," << sError;
+        return 2;
+    }
+    if (!bench.Load(sFilePath, sError))
+    {
+        qCritical().noquote() << sFilePath << ":" << sError;
+        return 1;
+    }
+    for (int pass = 0; pass < repeat; pass++)
+    {
+        bench.Replay(vecSteps);
+    }
+
+    const QMap<QString, FrameDistribution> mapResults = bench.Summarize();
+    out << QString("%1: %2 blocks loaded in %3 ms, %4x%5, antialiasing %6, OpenGL %7")
+               .arg(QFileInfo(sFilePath).fileName()).arg(window.m_vecSeqBlocks.size()).arg(bench.m_dLoad_ms, 0, 'f', 0)
+               .arg(width).arg(height).arg(QString(parser.isSet(noAntialiasOption) ? "off" : "on")).arg(QString(pPlot->openGl() ? "on" : "off"))
+        << Qt::endl;
+    out << "step       steps  frames    p50 ms    p90 ms    p99 ms    max ms   lat p90" << Qt::endl;
+    for (auto it = mapResults.constBegin(); it != mapResults.constEnd(); ++it)
+    {
+        const FrameDistribution& result = it.value();
+        out << QString("%1 %2 %3 %4 %5 %6 %7 %8")
+                   .arg(it.key(), -8).arg(result.steps, 7).arg(result.frames, 7)
+                   .arg(result.p50_ms, 9, 'f', 2).arg(result.p90_ms, 9, 'f', 2).arg(result.p99_ms, 9, 'f', 2)
+                   .arg(result.max_ms, 9, 'f', 2).arg(result.latencyP90_ms, 9, 'f', 2)
+            << Qt::endl;
+    }
+
+    if (parser.isSet(outOption))
+    {
+        QJsonObject result{
+            {"file", QFileInfo(sFilePath).fileName()},
+            {"blocks", static_cast<double>(window.m_vecSeqBlocks.size())},
+            {"width", width},
+            {"height", height},
+            {"antialias", !parser.isSet(noAntialiasOption)},
+            {"opengl", pPlot->openGl()},
+            {"repeat", repeat},
+            {"load_ms", bench.m_dLoad_ms},
+            {"steps", bench.ToJson(mapResults)}};
+        const QByteArray json = QJsonDocument(result).toJson(QJsonDocument::Indented);
+        if (parser.value(outOption) == "-")
+        {
+            out << json;
+            out.flush();
+        }
+        else
+        {
+            QFile outFile(parser.value(outOption));
+            if (!outFile.open(QIODevice::WriteOnly) || outFile.write(json) != json.size())
+            {
+                qCritical().noquote() << "Cannot write" << parser.value(outOption);
+                return 2;
+            }
+        }
+    }
+
+    if (!parser.isSet(baselineOption)) return 0;
+
+    bool bRegressed(false);
+    QTextStream err(stderr);
+    err << QString("\nAgainst %1 (threshold %2%)").arg(parser.value(baselineOption)).arg(threshold, 0, 'f', 1) << Qt::endl;
+    for (auto it = mapResults.constBegin(); it != mapResults.constEnd(); ++it)
+    {
+        const double previous_ms = baseline.value(it.key()).toObject().value("p90_ms").toDouble();
+        if (previous_ms <= 0.)
+        {
+            err << QString("%1 no baseline").arg(it.key(), -8) << Qt::endl;
+            continue;
+        }
+        const double change = 100. * (it.value().p90_ms - previous_ms) / previous_ms;
+        const bool bSlower = change > threshold;
+        bRegressed |= bSlower;
+        err << QString("%1 %2%%3").arg(it.key(), -8).arg(change, 9, 'f', 1).arg(QString(bSlower ? "  REGRESSION" : "")) << Qt::endl;
+    }
+    return bRegressed ? 1 : 0;
+}
+
+InteractionBench::InteractionBench(MainWindow& window)
+    : m_window(window)
+    , m_pPlot(window.ui->customPlot)
+    , m_bFrameSeen(false)
+    , m_dLoad_ms(0.)
+{
+    m_stFrameConnection = QObject::connect(m_pPlot, &QCustomPlot::afterReplot, [this]() { OnFrame(); });
+}
+
+InteractionBench::~InteractionBench()
+{
+    QObject::disconnect(m_stFrameConnection);
+}
+
+bool InteractionBench::Load(const QString& sFilePath, QString& sError)
+{
+    if (!QFileInfo(sFilePath).isReadable())
+    {
+        sError = "cannot read the file";
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!m_window.LoadPulseqFile(sFilePath))
+    {
+        sError = "loading failed";
+        return false;
+    }
+    // A load error ends in a message box, nobody is there to close it
+    QEventLoop loop;
+    QTimer poll;
+    QObject::connect(&poll, &QTimer::timeout, &loop, [&]() {
+        if (QMessageBox* pBox = qobject_cast<QMessageBox*>(QApplication::activeModalWidget()))
+        {
+            sError = pBox->text();
+            pBox->reject();
+        }
+        if (!m_window.m_bLoading) loop.quit();
+    });
+    poll.start(INTERACTION_POLL_MS);
+    loop.exec();
+    poll.stop();
+    if (!sError.isEmpty()) return false;
+    if (m_window.m_vecSeqBlocks.isEmpty())
+    {
+        sError = "no blocks";
+        return false;
+    }
+    // The first full draw is part of the load, not of any step
+    Settle();
+    m_dLoad_ms = timer.nsecsElapsed() * 1e-6;
+    return true;
+}
+
+bool InteractionBench::ParseScript(const QString& sScript, QVector<InteractionStep>& vecSteps, QString& sError) const
+{
+    static const QRegularExpression separator("\\s+");
+    static const QRegularExpression repeatToken("^x(\\d+)$");
+    const QStringList listLines = sScript.split('\n');
+    for (int line = 0; line < listLines.size(); line++)
+    {
+        QStringList tokens = listLines[line].section('#', 0, 0).split(separator, Qt::SkipEmptyParts);
+        if (tokens.isEmpty()) continue;
+
+        int count(1);
+        const QRegularExpressionMatch match = repeatToken.match(tokens.last());
+        if (tokens.size() > 1 && match.hasMatch())
+        {
+            count = match.captured(1).toInt();
+            tokens.removeLast();
+        }
+
+        InteractionStep step;
+        step.sKind = tokens[0].toLower();
+        bool bValid(count > 0);
+        if (step.sKind == "zoom" && tokens.size() == 2)
+        {
+            step.value1 = tokens[1].toDouble(&bValid);
+            bValid = bValid && step.value1 > 0.;
+        }
+        else if (step.sKind == "pan" && tokens.size() == 2)
+        {
+            step.value1 = tokens[1].toDouble(&bValid);
+        }
+        else if (step.sKind == "range" && tokens.size() == 3)
+        {
+            bool bValid2(false);
+            step.value1 = tokens[1].toDouble(&bValid);
+            step.value2 = tokens[2].toDouble(&bValid2);
+            bValid = bValid && bValid2 && step.value2 > step.value1;
+        }
+        else if (step.sKind == "lane" && tokens.size() == 2)
+        {
+            step.sLane = tokens[1].toUpper();
+            bValid = m_window.m_mapAxisAction.contains(step.sLane);
+        }
+        else if (step.sKind != "reset" || tokens.size() != 1)
+        {
+            bValid = false;
+        }
+        if (!bValid)
+        {
+            sError = QString("line %1: %2").arg(line + 1).arg(listLines[line].trimmed());
+            return false;
+        }
+        for (int index = 0; index < count; index++)
+        {
+            vecSteps.append(step);
+        }
+    }
+    if (vecSteps.isEmpty())
+    {
+        sError = "no steps";
+        return false;
+    }
+    return true;
+}
+
+void InteractionBench::Replay(const QVector<InteractionStep>& vecSteps)
+{
+    for (const InteractionStep& step : vecSteps)
+    {
+        m_sKind = step.sKind;
+        m_bFrameSeen = false;
+        m_mapSteps[m_sKind]++;
+        m_stStepTimer.start();
+        Apply(step);
+        Settle();
+    }
+    m_sKind.clear();
+}
+
+void InteractionBench::Apply(const InteractionStep& step)
+{
+    // Wheel zooms and drags end up in the shared time axis just as these do
+    const QCPRange range = m_window.m_pTimeAxis->Range();
+    if (step.sKind == "zoom")
+    {
+        const double half = range.size() * step.value1 * 0.5;
+        m_window.UpdatePlotRange(range.center() - half, range.center() + half);
+    }
+    else if (step.sKind == "pan")
+    {
+        const double shift = range.size() * step.value1;
+        m_window.UpdatePlotRange(range.lower + shift, range.upper + shift);
+    }
+    else if (step.sKind == "range")
+    {
+        m_window.UpdatePlotRange(step.value1, step.value2);
+    }
+    else if (step.sKind == "lane")
+    {
+        // Toggles the check state and runs SlotEnable*Axis() like the View menu
+        m_window.m_mapAxisAction[step.sLane]->trigger();
+    }
+    else if (step.sKind == "reset")
+    {
+        m_window.SlotResetView();
+    }
+}
+
+void InteractionBench::Settle()
+{
+    QEventLoop loop;
+    QTimer idle;
+    idle.setSingleShot(true);
+    idle.setInterval(INTERACTION_SETTLE_MS);
+    QObject::connect(&idle, &QTimer::timeout, &loop, &QEventLoop::quit);
+    QObject::connect(m_pPlot, &QCustomPlot::afterReplot, &idle, [&idle]() { idle.start(); });
+    idle.start();
+    loop.exec();
+}
+
+void InteractionBench::OnFrame()
+{
+    if (m_sKind.isEmpty()) return;
+    m_mapFrames_ms[m_sKind].append(m_pPlot->replotTime());
+    if (!m_bFrameSeen)
+    {
+        m_bFrameSeen = true;
+        m_mapLatency_ms[m_sKind].append(m_stStepTimer.nsecsElapsed() * 1e-6);
+    }
+}
+
+FrameDistribution InteractionBench::Distribution(QVector<double> vecFrames_ms, QVector<double> vecLatency_ms, const int& steps)
+{
+    FrameDistribution result;
+    result.steps = steps;
+    result.frames = static_cast<int>(vecFrames_ms.size());
+    if (vecFrames_ms.isEmpty()) return result;
+    std::sort(vecFrames_ms.begin(), vecFrames_ms.end());
+    std::sort(vecLatency_ms.begin(), vecLatency_ms.end());
+    double sum(0.);
+    for (const double& frame_ms : vecFrames_ms)
+    {
+        sum += frame_ms;
+    }
+    result.p50_ms = Percentile(vecFrames_ms, 0.50);
+    result.p90_ms = Percentile(vecFrames_ms, 0.90);
+    result.p99_ms = Percentile(vecFrames_ms, 0.99);
+    result.max_ms = vecFrames_ms.last();
+    result.mean_ms = sum / vecFrames_ms.size();
+    result.latencyP50_ms = Percentile(vecLatency_ms, 0.50);
+    result.latencyP90_ms = Percentile(vecLatency_ms, 0.90);
+    return result;
+}
+
+QMap<QString, FrameDistribution> InteractionBench::Summarize() const
+{
+    QMap<QString, FrameDistribution> mapResults;
+    QVector<double> vecAllFrames_ms;
+    QVector<double> vecAllLatency_ms;
+    int allSteps(0);
+    for (const QString& sKind : s_listKinds)
+    {
+        const int steps = m_mapSteps.value(sKind, 0);
+        if (steps == 0) continue;
+        const QVector<double> vecFrames_ms = m_mapFrames_ms.value(sKind);
+        const QVector<double> vecLatency_ms = m_mapLatency_ms.value(sKind);
+        mapResults[sKind] = Distribution(vecFrames_ms, vecLatency_ms, steps);
+        vecAllFrames_ms += vecFrames_ms;
+        vecAllLatency_ms += vecLatency_ms;
+        allSteps += steps;
+    }
+    mapResults["all"] = Distribution(vecAllFrames_ms, vecAllLatency_ms, allSteps);
+    return mapResults;
+}
+
+QJsonObject InteractionBench::ToJson(const QMap<QString, FrameDistribution>& mapResults) const
+{
+    QJsonObject steps;
+    for (auto it = mapResults.constBegin(); it != mapResults.constEnd(); ++it)
+    {
+        const FrameDistribution& result = it.value();
+        steps[it.key()] = QJsonObject{
+            {"steps", result.steps},
+            {"frames", result.frames},
+            {"p50_ms", result.p50_ms},
+            {"p90_ms", result.p90_ms},
+            {"p99_ms", result.p99_ms},
+            {"max_ms", result.max_ms},
+            {"mean_ms", result.mean_ms},
+            {"latency_p50_ms", result.latencyP50_ms},
+            {"latency_p90_ms", result.latencyP90_ms}};
+    }
+    return steps;
+}
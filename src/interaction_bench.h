@@ -0,0 +1,108 @@
+#ifndef INTERACTION_BENCH_H
+#define INTERACTION_BENCH_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMap>
+#include <QMetaObject>
+#include <QString>
+#include <QVector>
+
+class MainWindow;
+class QCustomPlot;
+
+#define INTERACTION_DEFAULT_REPEAT          (3)
+#define INTERACTION_DEFAULT_THRESHOLD_PCT   (10.)
+#define INTERACTION_SETTLE_MS               (50)
+#define INTERACTION_POLL_MS                 (50)
+
+struct InteractionStep
+{
+    QString sKind;          // zoom, pan, range, lane or reset
+    double value1;
+    double value2;
+    QString sLane;
+
+    InteractionStep()
+        : value1(0.)
+        , value2(0.)
+    {}
+};
+
+struct FrameDistribution
+{
+    int steps;
+    int frames;
+    double p50_ms;          // replot time of a frame as timed by QCustomPlot
+    double p90_ms;
+    double p99_ms;
+    double max_ms;
+    double mean_ms;
+    double latencyP50_ms;   // start of a step to the end of its first frame
+    double latencyP90_ms;
+
+    FrameDistribution()
+        : steps(0)
+        , frames(0)
+        , p50_ms(0.)
+        , p90_ms(0.)
+        , p99_ms(0.)
+        , max_ms(0.)
+        , mean_ms(0.)
+        , latencyP50_ms(0.)
+        , latencyP90_ms(0.)
+    {}
+};
+
+// Scripted interaction latency on large files, e.g. to compare drawing options:
+//   PulseqViewer --bench-interaction big.seq [--script steps.txt] [--repeat N]
+//                [--size 1600x900] [--no-antialias] [--opengl]
+//                [--out result.json] [--baseline old.json] [--threshold PCT]
+// The file is loaded into a MainWindow on the offscreen QPA platform and the
+// script is replayed through the same calls the menus and the mouse end up in.
+// A step is over once no replot followed for INTERACTION_SETTLE_MS, every
+// replot meanwhile counts as one of its frames. The script has a step per line:
+//   zoom FACTOR        span times FACTOR around its centre, below 1 zooms in
+//   pan FRACTION       shift by a fraction of the span, negative to the left
+//   range START END    show START to END us
+//   lane NAME          toggle the RF, GZ, GY, GX or ADC lane
+//   reset              Reset View
+// A trailing xN repeats a step N times, # starts a comment.
+class InteractionBench
+{
+public:
+    static bool IsRequested(int argc, char* argv[]);
+    static int Run(int argc, char* argv[]);
+
+private:
+    explicit InteractionBench(MainWindow& window);
+    ~InteractionBench();
+
+    bool Load(const QString& sFilePath, QString& sError);
+    bool ParseScript(const QString& sScript, QVector<InteractionStep>& vecSteps, QString& sError) const;
+    void Replay(const QVector<InteractionStep>& vecSteps);
+    void Apply(const InteractionStep& step);
+    // Returns once the plot has not replotted for INTERACTION_SETTLE_MS
+    void Settle();
+    void OnFrame();
+
+    QMap<QString, FrameDistribution> Summarize() const;
+    QJsonObject ToJson(const QMap<QString, FrameDistribution>& mapResults) const;
+    static FrameDistribution Distribution(QVector<double> vecFrames_ms, QVector<double> vecLatency_ms, const int& steps);
+
+    MainWindow&                          m_window;
+    QCustomPlot*                         m_pPlot;
+    QMetaObject::Connection              m_stFrameConnection;
+
+    // Current step, frames outside of a step are not counted
+    QString                              m_sKind;
+    QElapsedTimer                        m_stStepTimer;
+    bool                                 m_bFrameSeen;
+
+    QMap<QString, int>                   m_mapSteps;
+    QMap<QString, QVector<double>>       m_mapFrames_ms;
+    QMap<QString, QVector<double>>       m_mapLatency_ms;
+    double                               m_dLoad_ms;
+};
+
+#endif // INTERACTION_BENCH_H
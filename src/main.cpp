@@ -1,13 +1,33 @@
 #include "mainwindow.h"
+#include "batch_renderer.h"
+#include "interaction_bench.h"
+#include "task_pool.h"
 
 #include <QApplication>
+#include <QSettings>
 #include <QStyleFactory>
 
 int main(int argc, char *argv[])
 {
+    // Headless batch rendering, see BatchRenderer
+    if (BatchRenderer::IsRequested(argc, argv))
+    {
+        return BatchRenderer::Run(argc, argv);
+    }
+    // Headless replot timing of scripted interactions, see InteractionBench
+    if (InteractionBench::IsRequested(argc, argv))
+    {
+        return InteractionBench::Run(argc, argv);
+    }
+
      QApplication::setStyle(QStyleFactory::create("Fusion"));
 
     QApplication app(argc, argv);
+    // Recent files and settings are stored per application
+    QApplication::setOrganizationName("PulseqViewer");
+    QApplication::setApplicationName("PulseqViewer");
+    // Loading and analysis share one pool of worker threads, 0 for one per core
+    TaskPool::Configure(QSettings().value("WorkerThreads", 0).toUInt());
     MainWindow window;
 #ifdef RELEASE
     window.showMaximized();
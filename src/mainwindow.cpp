@@ -1,6 +1,15 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "system_limits_dialog.h"
+#include "export_dialog.h"
+#include "waveform_polyline.h"
 
+#include <QInputDialog>
+#include <QSettings>
+#include <QToolTip>
+
+#include <cfloat>
+#include <cmath>
 #include <iostream>
 
 
@@ -11,9 +20,35 @@ MainWindow::MainWindow(QWidget *parent)
     , m_sPulseqFilePathCache("")
     , m_spPulseqSeq(std::make_shared<ExternalSequence>())
     , m_sPulseqVersion("")
+    , m_pFileWatcher(nullptr)
+    , m_pReloadTimer(nullptr)
+    , m_bLoading(false)
+    , m_bReloadPending(false)
+    , m_lRunningTasks(0)
+    , m_lPrefetchBudget(static_cast<uint64_t>(PREFETCH_BUDGET_MB) << 20)
+    , m_pPrefetchTimer(nullptr)
+    , m_bPrefetching(false)
+    , m_stPrefetchTasks(kTaskBackground)
+    , m_stWindowTasks(kTaskNormal)
     , m_bIsSelecting(false)
     , m_bIsDragging(false)
     , m_dDragStartRange(0.)
+    , m_pCheckResultDock(nullptr)
+    , m_pStatisticsDock(nullptr)
+    , m_sRfEnergyWindows("10, 360")
+    , m_pRfEnergyDock(nullptr)
+    , m_pRfEnergyAxis(nullptr)
+    , m_sForbiddenBands("1000-1200")
+    , m_pSpectrumDock(nullptr)
+    , m_pBandDock(nullptr)
+    , m_pSliceProfileDock(nullptr)
+    , m_pDiffDock(nullptr)
+    , m_pLabelDock(nullptr)
+    , m_lEventMatch(-1)
+    , m_pEventDock(nullptr)
+    , m_lFoldedRepetition(0)
+    , m_pTimeAxis(nullptr)
+    , m_pOverviewStrip(nullptr)
     , m_listAxis({"RF", "GZ", "GY", "GX", "ADC"})
     , m_pSelectedGraph(nullptr)
 {
@@ -30,8 +65,6 @@ MainWindow::MainWindow(QWidget *parent)
         {"ADC", ui->actionADC},
         };
 
-    m_listRecentPulseqFilePaths.resize(10);
-
     m_pSelectionRect = new QCPItemRect(ui->customPlot);
     m_pSelectionRect->setVisible(false);
     m_pSelectionRect->setBrush(QBrush(QColor(128, 128, 128, 128)));
@@ -55,16 +88,29 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // The prefetch writes into m_stParseCache; loads and analyses read the
+    // blocks ClearPulseqCache() deletes, so every task has to be over first
+    // Wait() may run a pending load here, its signals must not reach this window
+    disconnect(nullptr, nullptr, this, nullptr);
+    CancelPrefetch();
+    m_stPrefetchTasks.Wait();
+    m_stWindowTasks.Wait();
     ClearPulseqCache();
     delete ui;
     SAFE_DELETE(m_pVersionLabel);
+    SAFE_DELETE(m_pSignatureLabel);
+    SAFE_DELETE(m_pFrameLabel);
     SAFE_DELETE(m_pProgressBar);
+    SAFE_DELETE(m_pMemoryButton);
+    SAFE_DELETE(m_pMemoryDialog);
 }
 
 void MainWindow::Init()
 {
     InitStatusBar();
     InitSequenceFigure();
+    InitFileWatch();
+    InitRecentFiles();
     InitSlots();
 }
 
@@ -73,6 +119,10 @@ void MainWindow::InitStatusBar()
     m_pVersionLabel= new QLabel(this);
     ui->statusbar->addWidget(m_pVersionLabel);
 
+    m_pSignatureLabel = new QLabel(this);
+    m_pSignatureLabel->hide();
+    ui->statusbar->addWidget(m_pSignatureLabel);
+
     m_pProgressBar = new QProgressBar(this);
     m_pProgressBar->setMaximumWidth(200);
     m_pProgressBar->setMinimumWidth(200);
@@ -80,6 +130,51 @@ void MainWindow::InitStatusBar()
     m_pProgressBar->setRange(0, 100);
     m_pProgressBar->setValue(0);
     ui->statusbar->addWidget(m_pProgressBar);
+
+    m_pFrameLabel = new QLabel(this);
+    m_pFrameLabel->setToolTip("Replot time of the last frame, average and maximum");
+    ui->statusbar->addPermanentWidget(m_pFrameLabel);
+
+    m_pMemoryDialog = new MemoryDialog(this);
+    connect(m_pMemoryDialog, &MemoryDialog::refreshRequested, this, &MainWindow::UpdateMemoryUsage);
+    connect(m_pMemoryDialog, &MemoryDialog::resetPeaksRequested, this, [this]() {
+        m_stMemoryLedger.ResetPeaks();
+        UpdateMemoryUsage();
+    });
+
+    m_pMemoryButton = new QToolButton(this);
+    m_pMemoryButton->setAutoRaise(true);
+    m_pMemoryButton->setToolTip("Memory usage by component");
+    connect(m_pMemoryButton, &QToolButton::clicked, this, [this]() {
+        m_pMemoryDialog->show();
+        m_pMemoryDialog->raise();
+    });
+    ui->statusbar->addPermanentWidget(m_pMemoryButton);
+    UpdateMemoryUsage();
+}
+
+void MainWindow::InitFileWatch()
+{
+    m_pFileWatcher = new QFileSystemWatcher(this);
+    // Generators write a file in several steps, reload once it has settled
+    m_pReloadTimer = new QTimer(this);
+    m_pReloadTimer->setSingleShot(true);
+    m_pReloadTimer->setInterval(RELOAD_DEBOUNCE_MS);
+}
+
+void MainWindow::InitRecentFiles()
+{
+    QSettings settings;
+    m_listRecentPulseqFilePaths = settings.value("RecentFiles").toStringList().mid(0, MAX_RECENT_FILES);
+    m_lPrefetchBudget = static_cast<uint64_t>(settings.value("PrefetchBudgetMB", PREFETCH_BUDGET_MB).toInt()) << 20;
+    m_stParseCache.SetBudget(m_lPrefetchBudget);
+    UpdateRecentFilesMenu();
+
+    // Recent files are parsed in the background once the viewer has been idle for a while
+    m_pPrefetchTimer = new QTimer(this);
+    m_pPrefetchTimer->setSingleShot(true);
+    m_pPrefetchTimer->setInterval(PREFETCH_IDLE_MS);
+    m_pPrefetchTimer->start();
 }
 
 void MainWindow::InitSequenceFigure()
@@ -140,6 +235,19 @@ void MainWindow::InitSequenceFigure()
     ticker->addTick(1, "1");
     m_mapRect["ADC"]->axis(QCPAxis::atLeft)->setTicker(ticker);
 
+    QList<QCPAxisRect*> listLanes;
+    for (auto& axis : m_listAxis)
+    {
+        listLanes.append(m_mapRect[axis]);
+    }
+    m_pTimeAxis = new TimeAxisController(ui->customPlot, this);
+    m_pTimeAxis->SetLanes(listLanes);
+
+    // Overview strip above the lanes, shown once a sequence is loaded
+    m_pOverviewStrip = new OverviewStrip(ui->centralwidget);
+    static_cast<QBoxLayout*>(ui->centralwidget->layout())->insertWidget(0, m_pOverviewStrip);
+    m_pOverviewStrip->SetViewport(m_pTimeAxis->Range());
+
     // Hide all time axis but the last one
     UpdateAxisVisibility();
 
@@ -155,6 +263,13 @@ void MainWindow::InitSlots()
     connect(ui->actionOpen, &QAction::triggered, this, &MainWindow::SlotOpenPulseqFile);
     connect(ui->actionReopen, &QAction::triggered, this, &MainWindow::SlotReOpenPulseqFile);
     connect(ui->actionCloseFile, &QAction::triggered, this, &MainWindow::ClosePulseqFile);
+    connect(ui->actionWatchFile, &QAction::triggered, this, &MainWindow::UpdateFileWatch);
+    connect(m_pFileWatcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::SlotWatchedFileChanged);
+    connect(m_pReloadTimer, &QTimer::timeout, this, &MainWindow::SlotReloadChangedFile);
+    connect(ui->actionClearMenu, &QAction::triggered, this, &MainWindow::SlotClearRecentFiles);
+    connect(ui->actionPrefetchBudget, &QAction::triggered, this, &MainWindow::SlotSetPrefetchBudget);
+    connect(ui->actionWorkerThreads, &QAction::triggered, this, &MainWindow::SlotSetWorkerThreads);
+    connect(m_pPrefetchTimer, &QTimer::timeout, this, &MainWindow::SlotPrefetchRecentFiles);
 
     // View
     connect(ui->actionRF, &QAction::triggered, this, &MainWindow::SlotEnableRFAxis);
@@ -167,41 +282,55 @@ void MainWindow::InitSlots()
     connect(ui->actionScreenshot, &QAction::triggered, this, &MainWindow::SlotSaveScreenshot);
 
     connect(ui->actionResetView, &QAction::triggered, this, &MainWindow::SlotResetView);
+    connect(ui->actionFoldRepetitions, &QAction::triggered, this, &MainWindow::SlotFoldRepetitions);
+    connect(ui->actionOverlayRepetitions, &QAction::triggered, this, &MainWindow::SlotFoldRepetitions);
+    connect(ui->actionPrevRepetition, &QAction::triggered, this, &MainWindow::SlotPrevRepetition);
+    connect(ui->actionNextRepetition, &QAction::triggered, this, &MainWindow::SlotNextRepetition);
+    connect(ui->actionPhysicalAxes, &QAction::triggered, this, &MainWindow::SlotPhysicalAxes);
 
     // Analysis
     connect(ui->actionExportData, &QAction::triggered, this, &MainWindow::SlotExportData);
+    connect(ui->actionStatistics, &QAction::triggered, this, &MainWindow::SlotShowStatistics);
+    connect(ui->actionCheckLimits, &QAction::triggered, this, &MainWindow::SlotCheckSystemLimits);
+    connect(ui->actionRfEnergy, &QAction::triggered, this, &MainWindow::SlotEstimateRfEnergy);
+    connect(ui->actionGradientSpectrum, &QAction::triggered, this, &MainWindow::SlotGradientSpectrum);
+    connect(ui->actionSliceProfile, &QAction::triggered, this, &MainWindow::SlotSimulateSliceProfile);
+    connect(ui->actionCompare, &QAction::triggered, this, &MainWindow::SlotCompareSequence);
+    connect(ui->actionFindAdcByLabel, &QAction::triggered, this, &MainWindow::SlotFindAdcByLabel);
+    connect(ui->actionFindEvents, &QAction::triggered, this, &MainWindow::SlotFindEvents);
+    connect(ui->actionPrevMatch, &QAction::triggered, this, &MainWindow::SlotPrevMatch);
+    connect(ui->actionNextMatch, &QAction::triggered, this, &MainWindow::SlotNextMatch);
 
     // Interaction
     connect(ui->customPlot, &QCustomPlot::mousePress, this, &MainWindow::onMousePress);
     connect(ui->customPlot, &QCustomPlot::mouseMove, this, &MainWindow::onMouseMove);
     connect(ui->customPlot, &QCustomPlot::mouseRelease, this, &MainWindow::onMouseRelease);
     connect(ui->customPlot, &QCustomPlot::plottableClick, this, &MainWindow::onPlottableClick);
+    connect(m_pTimeAxis, &TimeAxisController::frameTimed, this, &MainWindow::UpdateFrameStats);
+    connect(m_pTimeAxis, &TimeAxisController::rangeChanged, m_pOverviewStrip, &OverviewStrip::SetViewport);
+    connect(m_pOverviewStrip, &OverviewStrip::rangeRequested, this, &MainWindow::UpdatePlotRange);
+}
 
+void MainWindow::UpdatePlotRange(const double& x1, const double& x2)
+{
+    m_pTimeAxis->SetRange(x1, x2);
+}
 
-    foreach (auto& rect1, m_mapRect)
-    {
-        if (rect1)
-        {
-            connect(rect1->axis(QCPAxis::atBottom),
-                    QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged),
-                    this, &MainWindow::onAxisRangeChanged);
-        }
-
-        foreach (auto& rect2, m_mapRect)
-        {
-            if (rect1 != rect2)
-            {
-                connect(rect1->axis(QCPAxis::atBottom), QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged),
-                        rect2->axis(QCPAxis::atBottom), QOverload<const QCPRange&>::of(&QCPAxis::setRange));
-            }
-        }
-    }
+void MainWindow::UpdateFrameStats(const FrameStats& stats)
+{
+    m_pFrameLabel->setText(QString("Frame %1 ms (avg %2, max %3)")
+                               .arg(stats.last_ms, 0, 'f', 1)
+                               .arg(stats.average_ms, 0, 'f', 1)
+                               .arg(stats.max_ms, 0, 'f', 1));
 }
 
-void MainWindow::UpdatePlotRange(const double& x1, const double& x2)
+void MainWindow::ShowTimeRange(const double& dStart_us, const double& dEnd_us)
 {
-    ui->customPlot->xAxis->setRange(x1, x2);
-    ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+    // Keep some context around short ranges so the event stays recognizable
+    const double span = std::max(dEnd_us - dStart_us, 100.);
+    const double x1 = std::max(0., dStart_us - span * 0.5);
+    const double x2 = std::min(m_stSeqInfo.totalDuration_us, dEnd_us + span * 0.5);
+    UpdatePlotRange(x1, x2);
 }
 
 void MainWindow::RestoreViewLayout()
@@ -247,7 +376,7 @@ void MainWindow::SlotOpenPulseqFile()
         this,
         "Selec a Pulseq File",                           // Dialog title
         QDir::currentPath(),                    // Default open folder
-        "Text Files (*.seq);;All Files (*)"  // File filter
+        "Pulseq Files (*.seq *.seq.gz);;All Files (*)"  // File filter
         );
 
     if (!m_sPulseqFilePath.isEmpty())
@@ -270,6 +399,200 @@ void MainWindow::SlotReOpenPulseqFile()
     }
 }
 
+void MainWindow::SlotWatchedFileChanged(const QString& sFilePath)
+{
+    Q_UNUSED(sFilePath);
+    m_pReloadTimer->start();
+}
+
+void MainWindow::SlotReloadChangedFile()
+{
+    if (!ui->actionWatchFile->isChecked() || m_sPulseqFilePathCache.isEmpty()) return;
+    // A reload deletes blocks that a load or an analysis may still be reading
+    if (m_bLoading || m_lRunningTasks > 0)
+    {
+        m_bReloadPending = true;
+        return;
+    }
+    if (!QFileInfo::exists(m_sPulseqFilePathCache))
+    {
+        ui->statusbar->showMessage(QString("%1 was removed").arg(m_sPulseqFilePathCache));
+        return;
+    }
+    // Only changed sections are parsed again if the previous load is still displayed
+    LoadPulseqFile(m_sPulseqFilePathCache, nullptr != m_spSectionIndex && !m_vecSeqBlocks.isEmpty());
+}
+
+void MainWindow::UpdateFileWatch()
+{
+    // Files replaced by a rename drop out of the watcher, so the path is added again after every load
+    if (!m_pFileWatcher->files().isEmpty())
+    {
+        m_pFileWatcher->removePaths(m_pFileWatcher->files());
+    }
+    if (ui->actionWatchFile->isChecked() && !m_vecSeqBlocks.isEmpty() && QFileInfo::exists(m_sPulseqFilePathCache))
+    {
+        m_pFileWatcher->addPath(m_sPulseqFilePathCache);
+    }
+}
+
+void MainWindow::AddRecentFile(const QString& sFilePath)
+{
+    const QString sAbsolutePath = QFileInfo(sFilePath).absoluteFilePath();
+    m_listRecentPulseqFilePaths.removeAll(sAbsolutePath);
+    m_listRecentPulseqFilePaths.prepend(sAbsolutePath);
+    while (m_listRecentPulseqFilePaths.size() > MAX_RECENT_FILES)
+    {
+        m_listRecentPulseqFilePaths.removeLast();
+    }
+    QSettings().setValue("RecentFiles", m_listRecentPulseqFilePaths);
+    UpdateRecentFilesMenu();
+}
+
+void MainWindow::UpdateRecentFilesMenu()
+{
+    qDeleteAll(m_listRecentActions);
+    m_listRecentActions.clear();
+    // File entries go in front of the separator
+    QAction* pSeparator = ui->menuRecent_Files->actions().value(0, nullptr);
+    for (int index = 0; index < m_listRecentPulseqFilePaths.size(); index++)
+    {
+        const QString& sFilePath = m_listRecentPulseqFilePaths[index];
+        QAction* pAction = new QAction(QString("&%1 %2").arg((index + 1) % 10).arg(QFileInfo(sFilePath).fileName()), ui->menuRecent_Files);
+        pAction->setToolTip(sFilePath);
+        pAction->setStatusTip(sFilePath);
+        connect(pAction, &QAction::triggered, this, [this, sFilePath]() { OpenRecentFile(sFilePath); });
+        ui->menuRecent_Files->insertAction(pSeparator, pAction);
+        m_listRecentActions.append(pAction);
+    }
+    ui->actionClearMenu->setEnabled(!m_listRecentPulseqFilePaths.isEmpty());
+}
+
+void MainWindow::OpenRecentFile(const QString& sFilePath)
+{
+    if (!QFileInfo::exists(sFilePath))
+    {
+        QMessageBox::warning(this, "File Error", QString("%1 does not exist anymore").arg(sFilePath));
+        m_listRecentPulseqFilePaths.removeAll(sFilePath);
+        QSettings().setValue("RecentFiles", m_listRecentPulseqFilePaths);
+        UpdateRecentFilesMenu();
+        return;
+    }
+    m_sPulseqFilePath = sFilePath;
+    if (!LoadPulseqFile(m_sPulseqFilePath))
+    {
+        m_sPulseqFilePath.clear();
+        DEBUG << "LoadPulseqFile failed!";
+    }
+    m_sPulseqFilePathCache = m_sPulseqFilePath;
+}
+
+void MainWindow::SlotClearRecentFiles()
+{
+    CancelPrefetch();
+    m_listRecentPulseqFilePaths.clear();
+    QSettings().setValue("RecentFiles", m_listRecentPulseqFilePaths);
+    UpdateRecentFilesMenu();
+    m_stParseCache.Clear();
+    UpdateMemoryUsage();
+}
+
+void MainWindow::SlotSetPrefetchBudget()
+{
+    bool bOk(false);
+    const int budget_MB = QInputDialog::getInt(this, "Prefetch Memory Budget",
+                                               "Memory for the displayed and the prefetched sequences (MB), 0 turns prefetching off:",
+                                               static_cast<int>(m_lPrefetchBudget >> 20), 0, 1 << 20, 64, &bOk);
+    if (!bOk) return;
+    m_lPrefetchBudget = static_cast<uint64_t>(budget_MB) << 20;
+    QSettings().setValue("PrefetchBudgetMB", budget_MB);
+    UpdateMemoryUsage();
+    m_pPrefetchTimer->start();
+}
+
+void MainWindow::SlotSetWorkerThreads()
+{
+    bool bOk(false);
+    const int workers = QInputDialog::getInt(this, "Worker Threads",
+                                             QString("Threads for loading and analysis, 0 for one per core (now %1). Takes effect after a restart:")
+                                                 .arg(TaskPool::Instance().WorkerCount()),
+                                             QSettings().value("WorkerThreads", 0).toInt(), 0, 1024, 1, &bOk);
+    if (!bOk) return;
+    QSettings().setValue("WorkerThreads", workers);
+}
+
+void MainWindow::RunTask(const TaskPriority& priority, const std::function<void()>& work, const std::function<void()>& done)
+{
+    QPointer<MainWindow> pWindow(this);
+    m_lRunningTasks++;
+    m_stWindowTasks.Run([work, done, pWindow]() {
+        work();
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [done, pWindow]() {
+            if (pWindow.isNull()) return;
+            pWindow->m_lRunningTasks--;
+            done();
+            if (0 == pWindow->m_lRunningTasks && !pWindow->m_bLoading && pWindow->m_bReloadPending)
+            {
+                pWindow->m_bReloadPending = false;
+                pWindow->m_pReloadTimer->start();
+            }
+        }, Qt::QueuedConnection);
+    }, priority);
+}
+
+void MainWindow::CancelPrefetch()
+{
+    m_pPrefetchTimer->stop();
+    if (nullptr != m_spPrefetchCancel)
+    {
+        m_spPrefetchCancel->store(true);
+    }
+}
+
+void MainWindow::SlotPrefetchRecentFiles()
+{
+    // One prefetch at a time and never next to a load
+    if (m_bLoading || m_bPrefetching || 0 == m_stParseCache.Free()) return;
+
+    std::vector<std::string> vecFilePaths;
+    int candidates(0);
+    for (const QString& sFilePath : m_listRecentPulseqFilePaths)
+    {
+        if (sFilePath == QFileInfo(m_sPulseqFilePathCache).absoluteFilePath()) continue;
+        if (candidates++ >= PREFETCH_FILES) break;
+        if (!QFileInfo::exists(sFilePath) || m_stParseCache.Contains(sFilePath.toStdString())) continue;
+        vecFilePaths.push_back(sFilePath.toStdString());
+    }
+    if (vecFilePaths.empty()) return;
+
+    std::shared_ptr<std::atomic<bool>> spCancel = std::make_shared<std::atomic<bool>>(false);
+    std::shared_ptr<QStringList> spPrefetched = std::make_shared<QStringList>();
+    ParseCache* pCache = &m_stParseCache;
+    m_spPrefetchCancel = spCancel;
+    m_bPrefetching = true;
+    QPointer<MainWindow> pWindow(this);
+    m_stPrefetchTasks.Run([pCache, vecFilePaths, spCancel, spPrefetched, pWindow]() {
+        // Most recent first, a file that does not fit into what is left is skipped
+        for (const std::string& sFilePath : vecFilePaths)
+        {
+            if (spCancel->load()) break;
+            if (pCache->Insert(ParseCache::Parse(sFilePath, pCache->Free(), spCancel.get())))
+            {
+                spPrefetched->append(QString::fromStdString(sFilePath));
+            }
+        }
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [pWindow, spPrefetched]() {
+            if (pWindow.isNull()) return;
+            if (!spPrefetched->isEmpty())
+            {
+                DEBUG << "Prefetched " << spPrefetched->join(", ");
+            }
+            pWindow->m_bPrefetching = false;
+            pWindow->UpdateMemoryUsage();
+        }, Qt::QueuedConnection);
+    });
+}
+
 void MainWindow::SlotEnableRFAxis()
 {
     const bool& isChecked = ui->actionRF->isChecked();
@@ -362,7 +685,41 @@ void MainWindow::SlotEnableTriggerAxis()
 void MainWindow::SlotResetView()
 {
     if (m_sPulseqFilePathCache.isEmpty()) return;
-    UpdatePlotRange(0, m_stSeqInfo.totalDuration_us);
+    const bool bFolded = ui->actionFoldRepetitions->isChecked();
+    UpdatePlotRange(0, bFolded ? m_stSeqInfo.period_us : m_stSeqInfo.totalDuration_us);
+}
+
+void MainWindow::SlotFoldRepetitions()
+{
+    UpdateRepetitionActions();
+    DrawFoldedPeriod();
+    const bool bFolded = ui->actionFoldRepetitions->isChecked();
+    UpdatePlotRange(0, bFolded ? m_stSeqInfo.period_us : m_stSeqInfo.totalDuration_us);
+}
+
+void MainWindow::SlotPrevRepetition()
+{
+    if (m_lFoldedRepetition == 0) return;
+    m_lFoldedRepetition -= 1;
+    DrawFoldedPeriod();
+}
+
+void MainWindow::SlotNextRepetition()
+{
+    if (m_lFoldedRepetition + 1 >= m_stSeqInfo.repetitions) return;
+    m_lFoldedRepetition += 1;
+    DrawFoldedPeriod();
+}
+
+void MainWindow::UpdateRepetitionActions()
+{
+    const bool bPeriodic = m_stSeqInfo.repetitions >= 2;
+    const bool bFolded = bPeriodic && ui->actionFoldRepetitions->isChecked();
+    const bool bStepping = bFolded && !ui->actionOverlayRepetitions->isChecked();
+    ui->actionFoldRepetitions->setEnabled(bPeriodic);
+    ui->actionOverlayRepetitions->setEnabled(bFolded);
+    ui->actionPrevRepetition->setEnabled(bStepping);
+    ui->actionNextRepetition->setEnabled(bStepping);
 }
 
 void MainWindow::ClearPulseqCache()
@@ -373,6 +730,7 @@ void MainWindow::ClearPulseqCache()
     m_pSelectedGraph = nullptr;
     if (NULL != ui->customPlot)
     {
+        ClearAnalysisResults();
         ui->customPlot->clearGraphs();
         m_vecRfGraphs.clear();
         m_vecGzGraphs.clear();
@@ -389,13 +747,21 @@ void MainWindow::ClearPulseqCache()
             {
                 m_mapRect[axis]->axis(QCPAxis::atLeft)->setRange(0, 5);
             }
-            m_mapRect[axis]->axis(QCPAxis::atBottom)->setRange(0, 100);
         }
+        m_pTimeAxis->SetBounds(0, 0);
+        m_pTimeAxis->SetRange(0, 100);
+        m_pTimeAxis->ResetStats();
+        m_pOverviewStrip->Clear();
         ui->customPlot->replot();
     }
 
     m_sPulseqVersion = "";
     m_stSeqInfo.reset();
+    UpdateRepetitionActions();
+    m_stFingerprint.reset();
+    m_spLabelTable.reset();
+    m_spSectionIndex.reset();
+    ui->actionPhysicalAxes->setEnabled(false);
 
     m_mapShapeLib.clear();
     m_vecRfLib.clear();
@@ -416,31 +782,111 @@ void MainWindow::ClearPulseqCache()
     this->setEnabled(true);
 }
 
-bool MainWindow::LoadPulseqFile(const QString& sPulseqFilePath)
+// Results derived from the displayed sequence, dropped whenever it changes
+void MainWindow::ClearAnalysisResults()
+{
+    ClearRfEnergyOverlay();
+    ClearHighlights();
+    ClearFoldedPeriod();
+    ClearPhysicalGradients();
+    m_lFoldedRepetition = 0;
+    ui->actionFoldRepetitions->setChecked(false);
+    if (nullptr != m_pCheckResultDock)
+    {
+        m_pCheckResultDock->Clear();
+    }
+    if (nullptr != m_pStatisticsDock)
+    {
+        m_pStatisticsDock->Clear();
+    }
+    if (nullptr != m_pRfEnergyDock)
+    {
+        m_pRfEnergyDock->Clear();
+    }
+    if (nullptr != m_pSpectrumDock)
+    {
+        m_pSpectrumDock->Clear();
+    }
+    if (nullptr != m_pBandDock)
+    {
+        m_pBandDock->Clear();
+    }
+    if (nullptr != m_pSliceProfileDock)
+    {
+        m_pSliceProfileDock->Clear();
+    }
+    if (nullptr != m_pDiffDock)
+    {
+        m_pDiffDock->Clear();
+    }
+    if (nullptr != m_pLabelDock)
+    {
+        m_pLabelDock->Clear();
+    }
+    if (nullptr != m_pEventDock)
+    {
+        m_pEventDock->Clear();
+    }
+    // Built from the current blocks, a reload needs a new one
+    m_spEventTable.reset();
+    m_vecEventMatches.clear();
+    m_lEventMatch = -1;
+    ui->actionPrevMatch->setEnabled(false);
+    ui->actionNextMatch->setEnabled(false);
+    m_spGradientRotator.reset();
+}
+
+bool MainWindow::LoadPulseqFile(const QString& sPulseqFilePath, const bool& bIncremental)
 {
     m_qTimer.start();
     this->setEnabled(false);
     setInteraction(false);
-    ClearPulseqCache();
-    m_sPulseqVersion = "";
-    m_pVersionLabel->setVisible(true);
-    m_pVersionLabel->setText("Loading...");
+    // The file is parsed in the foreground now, a prefetch of it would come too late
+    CancelPrefetch();
+    m_bLoading = true;
+    std::shared_ptr<ParsedSequence> spParsed;
+    if (!bIncremental)
+    {
+        ClearPulseqCache();
+        m_sPulseqVersion = "";
+        m_pVersionLabel->setVisible(true);
+        m_pVersionLabel->setText("Loading...");
+        m_pSignatureLabel->hide();
+        spParsed = m_stParseCache.Take(QFileInfo(sPulseqFilePath).absoluteFilePath().toStdString());
+        if (nullptr != spParsed)
+        {
+            DEBUG << sPulseqFilePath << " taken from the prefetch cache";
+            m_spPulseqSeq = spParsed->sequence;
+        }
+    }
     m_pProgressBar->setValue(0);
 
-    QThread* thread = new QThread(this);
+    // Runs on the shared TaskPool, the loader lives on the GUI thread so its signals arrive queued
     PulseqLoader* loader = new PulseqLoader;
-    loader->moveToThread(thread);
     loader->SetPulseqFile(sPulseqFilePath);
     loader->SetSequence(m_spPulseqSeq);
+    if (bIncremental)
+    {
+        loader->SetPreviousLoad(m_vecSeqBlocks, m_spSectionIndex);
+    }
+    loader->SetParsed(spParsed);
+    loader->SetMemoryLedger(&m_stMemoryLedger);
 
     connect(loader, &PulseqLoader::processingStarted,
             this, [this]() {
                 m_pProgressBar->show();
             });
-    connect(thread, &QThread::started, loader, &PulseqLoader::process);
-    connect(loader, &PulseqLoader::finished, thread, &QThread::quit);
-    connect(loader, &PulseqLoader::finished, loader, &PulseqLoader::deleteLater);
-    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
+    connect(loader, &PulseqLoader::finished, this, [this]() {
+        m_bLoading = false;
+        UpdateFileWatch();
+        UpdateMemoryUsage();
+        if (m_bReloadPending)
+        {
+            m_bReloadPending = false;
+            m_pReloadTimer->start();
+        }
+        m_pPrefetchTimer->start();
+    });
 
     connect(loader, &PulseqLoader::errorOccurred, this, [this](const QString& error) {
         QMessageBox::critical(this, "File Error", error);
@@ -460,8 +906,51 @@ bool MainWindow::LoadPulseqFile(const QString& sPulseqFilePath)
         m_pVersionLabel->setText("Pulseq Version: v" + m_sPulseqVersion);
     });
 
+    connect(loader, &PulseqLoader::signatureChecked, this, [this](int status, const QString& type) {
+        const QString sType = type.toUpper();
+        switch (status)
+        {
+        case kSignatureVerified:
+            m_pSignatureLabel->setText(QString("Signature: %1 verified").arg(sType));
+            m_pSignatureLabel->setStyleSheet("color: green;");
+            break;
+        case kSignatureFailed:
+            m_pSignatureLabel->setText(QString("Signature: %1 mismatch").arg(sType));
+            m_pSignatureLabel->setStyleSheet("color: red;");
+            break;
+        case kSignatureUnverifiable:
+            m_pSignatureLabel->setText(QString("Signature: %1 not verified").arg(sType));
+            m_pSignatureLabel->setStyleSheet("color: gray;");
+            break;
+        default:
+            m_pSignatureLabel->setText("Unsigned");
+            m_pSignatureLabel->setStyleSheet("color: gray;");
+            break;
+        }
+        m_pSignatureLabel->show();
+    });
+
+    connect(loader, &PulseqLoader::overviewReady, m_pOverviewStrip, &OverviewStrip::SetOverview);
+
+    connect(loader, &PulseqLoader::sectionsIndexed, this, [this](const std::shared_ptr<SectionIndex>& sections) {
+        m_spSectionIndex = sections;
+    });
+
+    std::shared_ptr<QString> spReloadInfo = std::make_shared<QString>();
+    connect(loader, &PulseqLoader::sectionsReloaded, this, [this, spReloadInfo](const QStringList& sections, uint64_t decodedBlocks) {
+        if (sections.isEmpty())
+        {
+            ui->statusbar->showMessage("File touched without changes");
+            m_pProgressBar->setValue(100);
+            this->setEnabled(true);
+            setInteraction(true);
+            return;
+        }
+        *spReloadInfo = QString("Reloaded %1, %2 blocks decoded").arg(sections.join(" ")).arg(decodedBlocks);
+    });
+
     connect(loader, &PulseqLoader::loadingCompleted,
-            this, [this, sPulseqFilePath](const SeqInfo& seqInfo,
+            this, [this, sPulseqFilePath, bIncremental, spReloadInfo](const SeqInfo& seqInfo,
                                         const QVector<SeqBlock*>& blocks,
                                         const QMap<int, QVector<float>>& shapeLib,
                                         const QVector<RfInfo>& rfLib,
@@ -469,8 +958,29 @@ bool MainWindow::LoadPulseqFile(const QString& sPulseqFilePath)
                                         const QVector<GradTrapInfo>& gzLib,
                                         const QVector<GradTrapInfo>& gyLib,
                                         const QVector<GradTrapInfo>& gxLib,
-                                        const QVector<AdcInfo>& adcLib
+                                        const QVector<AdcInfo>& adcLib,
+                                        const SequenceFingerprint& fingerprint,
+                                        const std::shared_ptr<LabelTable>& labelTable
                                         ) {
+                // The previous state is kept until the graphs are patched, its RF infos point into the previous blocks
+                QVector<SeqBlock*> vecPreviousBlocks;
+                QVector<RfInfo> vecPreviousRfLib;
+                RfTimeWaveShapeMap mapPreviousRfMagShapeLib;
+                QVector<GradTrapInfo> vecPreviousGzLib;
+                QVector<GradTrapInfo> vecPreviousGyLib;
+                QVector<GradTrapInfo> vecPreviousGxLib;
+                QVector<AdcInfo> vecPreviousAdcLib;
+                if (bIncremental)
+                {
+                    vecPreviousBlocks.swap(m_vecSeqBlocks);
+                    vecPreviousRfLib.swap(m_vecRfLib);
+                    mapPreviousRfMagShapeLib.swap(m_mapRfMagShapeLib);
+                    vecPreviousGzLib.swap(m_vecGzLib);
+                    vecPreviousGyLib.swap(m_vecGyLib);
+                    vecPreviousGxLib.swap(m_vecGxLib);
+                    vecPreviousAdcLib.swap(m_vecAdcLib);
+                }
+
                 m_stSeqInfo = seqInfo;
                 m_vecSeqBlocks = blocks;
                 m_mapShapeLib = shapeLib;
@@ -480,7 +990,32 @@ bool MainWindow::LoadPulseqFile(const QString& sPulseqFilePath)
                 m_vecGyLib = gyLib;
                 m_vecGxLib = gxLib;
                 m_vecAdcLib = adcLib;
-                DrawWaveform();
+                m_stFingerprint = fingerprint;
+                m_spLabelTable = labelTable;
+                if (bIncremental)
+                {
+                    ClearAnalysisResults();
+                    PatchWaveform(vecPreviousRfLib, mapPreviousRfMagShapeLib, vecPreviousGzLib, vecPreviousGyLib, vecPreviousGxLib, vecPreviousAdcLib);
+                    // Blocks decoded again replace the previous ones at the same index, the others were reused
+                    for (int index = 0; index < vecPreviousBlocks.size(); index++)
+                    {
+                        if (index >= m_vecSeqBlocks.size() || m_vecSeqBlocks[index] != vecPreviousBlocks[index])
+                        {
+                            SAFE_DELETE(vecPreviousBlocks[index]);
+                        }
+                    }
+                    ui->statusbar->showMessage(QString("%1 in %2 ms").arg(spReloadInfo->isEmpty() ? QString("Reloaded") : *spReloadInfo).arg(m_qTimer.elapsed()));
+                }
+                else
+                {
+                    DrawWaveform();
+                    AddRecentFile(sPulseqFilePath);
+                }
+                UpdateRepetitionActions();
+                // Statistics come with the load, an open panel follows the file
+                if (nullptr != m_pStatisticsDock && m_pStatisticsDock->isVisible()) ShowSequenceStatistics();
+                ui->actionPhysicalAxes->setEnabled(true);
+                if (ui->actionPhysicalAxes->isChecked()) DrawPhysicalGradients();
                 this->setWindowTitle(QString(BASIC_WIN_TITLE) + QString(": ") + sPulseqFilePath + QString("(v") + m_sPulseqVersion + QString(")"));
                 this->setWindowFilePath(sPulseqFilePath);
                 m_pProgressBar->setValue(100);
@@ -488,7 +1023,14 @@ bool MainWindow::LoadPulseqFile(const QString& sPulseqFilePath)
                 setInteraction(true);
             });
 
-    thread->start();
+    // Parsing and render preparation go ahead of any analysis. The loader is
+    // deleted once process() has returned, not on finished while it still emits
+    m_stWindowTasks.Run([loader]() {
+        loader->process();
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [loader]() {
+            delete loader;
+        }, Qt::QueuedConnection);
+    }, kTaskInteractive);
     return true;
 }
 
@@ -497,22 +1039,95 @@ bool MainWindow::ClosePulseqFile()
     m_pVersionLabel->setVisible(true);
     m_pVersionLabel->setText("Closing file...");
     ClearPulseqCache();
+    UpdateFileWatch();
+    UpdateMemoryUsage();
     m_pVersionLabel->setVisible(false);
     m_pVersionLabel->setText("");
+    m_pSignatureLabel->hide();
     return true;
 }
 
-void MainWindow::DrawWaveform()
+void MainWindow::UpdateMemoryUsage()
 {
-    if (m_vecSeqBlocks.size() == 0) return;
-    if (m_vecRfLib.size() == 0) return;
+    // The loader task owns the sequence until it has finished, it reports the parser and blocks itself
+    if (m_bLoading) return;
+
+    const std::vector<SeqBlock*> vecBlocks(m_vecSeqBlocks.begin(), m_vecSeqBlocks.end());
+    const bool bLoaded = nullptr != m_spPulseqSeq && !vecBlocks.empty();
+    m_stMemoryLedger.Report("Parser: shape library", bLoaded ? MemoryEstimator::ShapeLibrary(*m_spPulseqSeq) : 0);
+    m_stMemoryLedger.Report("Parser: event libraries", bLoaded ? MemoryEstimator::EventLibraries(*m_spPulseqSeq) : 0);
+    m_stMemoryLedger.Report("Parser: block table", bLoaded ? MemoryEstimator::BlockTable(*m_spPulseqSeq) : 0);
+    m_stMemoryLedger.Report("Decoded blocks", MemoryEstimator::DecodedBlocks(vecBlocks));
+
+    uint64_t eventBytes = m_vecRfLib.capacity() * sizeof(RfInfo) + m_vecAdcLib.capacity() * sizeof(AdcInfo);
+    for (const QVector<GradTrapInfo>* pLib : {&m_vecGzLib, &m_vecGyLib, &m_vecGxLib})
+    {
+        eventBytes += pLib->capacity() * sizeof(GradTrapInfo);
+        for (const GradTrapInfo& info : *pLib)
+        {
+            eventBytes += (info.time.capacity() + info.amplitude.capacity()) * sizeof(double);
+        }
+    }
+    for (const AdcInfo& info : m_vecAdcLib)
+    {
+        eventBytes += (info.time.capacity() + info.amplitude.capacity()) * sizeof(double);
+    }
+    m_stMemoryLedger.Report("Event libraries", eventBytes);
+
+    uint64_t shapeBytes = m_mapShapeLib.size() * (sizeof(int) + sizeof(QVector<float>) + MAP_NODE_OVERHEAD);
+    for (const QVector<float>& shape : m_mapShapeLib)
+    {
+        shapeBytes += shape.capacity() * sizeof(float);
+    }
+    m_stMemoryLedger.Report("Shape cache", shapeBytes);
+
+    uint64_t magnitudeBytes = m_mapRfMagShapeLib.size() * (sizeof(QPair<int, int>) + sizeof(QVector<double>) + MAP_NODE_OVERHEAD);
+    for (const QVector<double>& magnitudes : m_mapRfMagShapeLib)
+    {
+        magnitudeBytes += magnitudes.capacity() * sizeof(double);
+    }
+    m_stMemoryLedger.Report("RF magnitude cache", magnitudeBytes);
+
+    const uint64_t fingerprintBytes = (m_stFingerprint.blockHashes.capacity() + m_stFingerprint.blockSignatures.capacity()) * sizeof(uint64_t)
+                                    + m_stFingerprint.startTime_us.capacity() * sizeof(double);
+    m_stMemoryLedger.Report("Block fingerprints", fingerprintBytes);
+    m_stMemoryLedger.Report("Event query table", m_spEventTable ? m_spEventTable->MemoryBytes() : 0);
+
+    uint64_t plotBytes(0);
+    for (int index = 0; index < ui->customPlot->plottableCount(); index++)
+    {
+        QCPAbstractPlottable* pPlottable = ui->customPlot->plottable(index);
+        if (QCPGraph* pGraph = qobject_cast<QCPGraph*>(pPlottable))
+        {
+            plotBytes += sizeof(QCPGraph) + pGraph->data()->size() * sizeof(QCPGraphData);
+        }
+        else if (QCPCurve* pCurve = qobject_cast<QCPCurve*>(pPlottable))
+        {
+            plotBytes += sizeof(QCPCurve) + pCurve->data()->size() * sizeof(QCPCurveData);
+        }
+    }
+    m_stMemoryLedger.Report("Plot graphs", plotBytes);
+
+    // Prefetched files give way to the displayed one
+    m_stMemoryLedger.Report("Prefetch cache", 0);
+    const uint64_t displayedBytes = m_stMemoryLedger.Total();
+    m_stParseCache.SetBudget(m_lPrefetchBudget > displayedBytes ? m_lPrefetchBudget - displayedBytes : 0);
+    m_stMemoryLedger.Report("Prefetch cache", m_stParseCache.Bytes());
+
+    m_pMemoryButton->setText(QString("Memory: %1").arg(QString::fromStdString(MemoryLedger::FormatBytes(m_stMemoryLedger.Total()))));
+    if (m_pMemoryDialog->isVisible())
+    {
+        m_pMemoryDialog->SetEntries(m_stMemoryLedger.Entries(), m_stMemoryLedger.Total(), m_stMemoryLedger.PeakTotal(), vecBlocks.size());
+    }
+}
 
+// One graph per event of the whole sequence, value ranges are set by UpdateValueRanges()
+void MainWindow::AddFullGraphs()
+{
     QString timeCostInfo;
     QElapsedTimer timer;
     timer.start();
 
-    float rfMaxAmp(0.);
-    float rfMinAmp(0.);
     for(const auto& rfInfo : m_vecRfLib)
     {
         QCPGraph* rfGraph = ui->customPlot->addGraph(m_mapRect["RF"]->axis(QCPAxis::atBottom),
@@ -520,33 +1135,14 @@ void MainWindow::DrawWaveform()
         rfGraph->setLineStyle(QCPGraph::lsStepLeft);
         m_vecRfGraphs.append(rfGraph);
 
-        QPair<int, int> rfMagShapeID(rfInfo.event->magShape, rfInfo.event->phaseShape);
-        QVector<double> amplitudes = m_mapRfMagShapeLib[rfMagShapeID];
-
-        double sampleTime = rfInfo.startAbsTime_us;
-        QVector<double> timePoints(rfInfo.samples+2, 0.);
-        timePoints[0] = sampleTime;
-        for(uint32_t index = 1; index < amplitudes.size() - 1; index++)
-        {
-            timePoints[index] = sampleTime;
-            sampleTime += rfInfo.dwell;
-        }
-        timePoints.back() = sampleTime;
-
-
-        std::transform(amplitudes.begin(), amplitudes.end(), amplitudes.begin(),
-                       [rfInfo](double x) { return x * rfInfo.event->amplitude; });
-        auto maxIt = std::max_element(amplitudes.begin(), amplitudes.end());
-        auto minIt = std::min_element(amplitudes.begin(), amplitudes.end());
-        rfMaxAmp = std::max(rfMaxAmp, (float)*maxIt);
-        rfMinAmp = std::max(rfMinAmp, (float)*minIt);
+        QVector<double> timePoints;
+        QVector<double> amplitudes;
+        GetRfGraphData(rfInfo, timePoints, amplitudes);
 
         rfGraph->setData(timePoints, amplitudes);
         rfGraph->setPen(*m_mapAxisPen["RF"]);
         rfGraph->setSelectable(QCP::stWhole);
     }
-    double marginRF = (rfMaxAmp - rfMinAmp) * 0.1;
-    m_mapRect["RF"]->axis(QCPAxis::atLeft)->setRange(rfMinAmp - marginRF, rfMaxAmp + marginRF);
     timeCostInfo = QString("Rendering RF finished");
     PrintTimeCost(timer, timeCostInfo, true);
 
@@ -563,11 +1159,6 @@ void MainWindow::DrawWaveform()
         gzGraph->setPen(*m_mapAxisPen["GZ"]);
         gzGraph->setSelectable(QCP::stWhole);
     }
-    const double& gzMaxAmp_Hz_m = m_stSeqInfo.gzMaxAmp_Hz_m;
-    const double& gzMinAmp_Hz_m = m_stSeqInfo.gzMinAmp_Hz_m;
-    double maxGzAbsAmp = std::max(std::abs(gzMaxAmp_Hz_m), std::abs(gzMinAmp_Hz_m));
-    double marginGz = maxGzAbsAmp * 0.1;
-    m_mapRect["GZ"]->axis(QCPAxis::atLeft)->setRange(- maxGzAbsAmp - marginGz, maxGzAbsAmp + marginGz);
     timeCostInfo = QString("Rendering GZ finished");
     PrintTimeCost(timer, timeCostInfo, true);
 
@@ -584,11 +1175,6 @@ void MainWindow::DrawWaveform()
         gyGraph->setPen(*m_mapAxisPen["GY"]);
         gyGraph->setSelectable(QCP::stWhole);
     }
-    const double& gyMaxAmp_Hz_m = m_stSeqInfo.gyMaxAmp_Hz_m;
-    const double& gyMinAmp_Hz_m = m_stSeqInfo.gyMinAmp_Hz_m;
-    double maxGyAbsAmp = std::max(std::abs(gyMaxAmp_Hz_m), std::abs(gyMinAmp_Hz_m));
-    double marginGy = maxGyAbsAmp * 0.1;
-    m_mapRect["GY"]->axis(QCPAxis::atLeft)->setRange(- maxGyAbsAmp - marginGy, maxGyAbsAmp + marginGy);
     timeCostInfo = QString("Rendering GY finished");
     PrintTimeCost(timer, timeCostInfo, true);
 
@@ -605,11 +1191,6 @@ void MainWindow::DrawWaveform()
         gxGraph->setPen(*m_mapAxisPen["GX"]);
         gxGraph->setSelectable(QCP::stWhole);
     }
-    const double& gxMaxAmp_Hz_m = m_stSeqInfo.gxMaxAmp_Hz_m;
-    const double& gxMinAmp_Hz_m = m_stSeqInfo.gxMinAmp_Hz_m;
-    double maxGxAbsAmp = std::max(std::abs(gxMaxAmp_Hz_m), std::abs(gxMinAmp_Hz_m));
-    double marginGx = maxGxAbsAmp * 0.1;
-    m_mapRect["GX"]->axis(QCPAxis::atLeft)->setRange(- maxGxAbsAmp - marginGx, maxGxAbsAmp + marginGx);
     timeCostInfo = QString("Rendering GX finished");
     PrintTimeCost(timer, timeCostInfo, true);
 
@@ -628,77 +1209,505 @@ void MainWindow::DrawWaveform()
     }
     timeCostInfo = QString("Rendering ADC finished");
     PrintTimeCost(timer, timeCostInfo, true);
+}
 
+void MainWindow::RemoveFullGraphs()
+{
+    m_pSelectedGraph = nullptr;
+    for (QVector<QCPGraph*>* pGraphs : {&m_vecRfGraphs, &m_vecGzGraphs, &m_vecGyGraphs, &m_vecGxGraphs, &m_vecAdcGraphs})
+    {
+        for (QCPGraph* pGraph : *pGraphs)
+        {
+            ui->customPlot->removeGraph(pGraph);
+        }
+        pGraphs->clear();
+    }
+}
 
-    UpdatePlotRange(0, m_stSeqInfo.totalDuration_us);
-
-    timeCostInfo = QString("Loading finished");
-    PrintTimeCost(m_qTimer, timeCostInfo, false);
+bool MainWindow::HasFullGraphs() const
+{
+    return !m_vecRfGraphs.isEmpty() || !m_vecGzGraphs.isEmpty() || !m_vecGyGraphs.isEmpty()
+        || !m_vecGxGraphs.isEmpty() || !m_vecAdcGraphs.isEmpty();
 }
 
-void MainWindow::onMousePress(QMouseEvent *event)
+void MainWindow::DrawWaveform()
 {
     if (m_vecSeqBlocks.size() == 0) return;
-    if (event->button() == Qt::LeftButton)
-    {
-        ui->customPlot->setInteractions(QCP::Interactions());
-        m_bIsSelecting = true;
-        m_objSelectStartPos = event->pos();
+    if (m_vecRfLib.size() == 0) return;
 
-        // 初始化选择框
-        double x = ui->customPlot->xAxis->pixelToCoord(m_objSelectStartPos.x());
-        double y = ui->customPlot->yAxis->pixelToCoord(m_objSelectStartPos.y());
-        m_pSelectionRect->topLeft->setCoords(x, y);
-        m_pSelectionRect->bottomRight->setCoords(x, y);
-        m_pSelectionRect->setVisible(true);
+    AddFullGraphs();
+    UpdateValueRanges();
+    m_pTimeAxis->SetBounds(0, m_stSeqInfo.totalDuration_us);
+    UpdatePlotRange(0, m_stSeqInfo.totalDuration_us);
 
-        ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
-    }
-    else if (event->button() == Qt::RightButton)
-    {
-        m_bIsDragging = true;
-        setCursor(Qt::ClosedHandCursor);
-        m_objDragStartPos = event->pos();
-        m_dDragStartRange = ui->customPlot->xAxis->range().lower;
-    }
+    PrintTimeCost(m_qTimer, QString("Loading finished"), false);
 }
 
-void MainWindow::onMouseMove(QMouseEvent *event)
+void MainWindow::GetRfGraphData(const RfInfo& rfInfo, QVector<double>& timePoints, QVector<double>& amplitudes)
 {
-    if (m_vecSeqBlocks.size() == 0) return;
-    if(m_bIsSelecting)
-    {
-        double yMin = ui->customPlot->yAxis->range().lower;
-        double yMax = ui->customPlot->yAxis->range().upper;
-        // 更新选择框
-        double x1 = ui->customPlot->xAxis->pixelToCoord(m_objSelectStartPos.x());
-        double y1 = ui->customPlot->yAxis->pixelToCoord(m_objSelectStartPos.y());
-        double x2 = ui->customPlot->xAxis->pixelToCoord(event->pos().x());
-        double y2 = ui->customPlot->yAxis->pixelToCoord(event->pos().y());
+    QPair<int, int> rfMagShapeID(rfInfo.event->magShape, rfInfo.event->phaseShape);
+    const QVector<double>& magnitudes = m_mapRfMagShapeLib[rfMagShapeID];
 
-        // 限制 y 值在有效范围内
-        y1 = qBound(yMin, y1, yMax);
-        y2 = qBound(yMin, y2, yMax);
+    timePoints = QVector<double>(rfInfo.samples+2, 0.);
+    EventPolyline::RfTimes(rfInfo.startAbsTime_us, rfInfo.dwell, rfInfo.samples, timePoints.data());
+    amplitudes = QVector<double>(magnitudes.size(), 0.);
+    EventPolyline::Scale(magnitudes.constData(), magnitudes.size(), rfInfo.event->amplitude, amplitudes.data());
+}
 
-        m_pSelectionRect->topLeft->setCoords(qMin(x1, x2), qMax(y1, y2));
-        m_pSelectionRect->bottomRight->setCoords(qMax(x1, x2), qMin(y1, y2));
+// Brings the graphs of an incremental reload up to date. Graphs are matched to
+// events by index, only those whose event differs from the previous load get
+// new data, and graphs are only added or removed if the event count changed.
+// The time range stays where the user left it.
+void MainWindow::PatchWaveform(const QVector<RfInfo>& vecPreviousRfLib,
+                               const RfTimeWaveShapeMap& mapPreviousRfMagShapeLib,
+                               const QVector<GradTrapInfo>& vecPreviousGzLib,
+                               const QVector<GradTrapInfo>& vecPreviousGyLib,
+                               const QVector<GradTrapInfo>& vecPreviousGxLib,
+                               const QVector<AdcInfo>& vecPreviousAdcLib)
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_pSelectedGraph = nullptr;
 
-        ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+    QSet<QPair<int, int>> setChangedRfShapes;
+    for (auto it = m_mapRfMagShapeLib.constBegin(); it != m_mapRfMagShapeLib.constEnd(); ++it)
+    {
+        if (mapPreviousRfMagShapeLib.value(it.key()) != it.value()) setChangedRfShapes.insert(it.key());
     }
-    else if (m_bIsDragging)
+    uint64_t patched = PatchGraphs("RF", m_vecRfGraphs, m_vecRfLib.size(),
+        [&](const int& index) {
+            if (index >= vecPreviousRfLib.size()) return false;
+            const RfInfo& previous = vecPreviousRfLib[index];
+            const RfInfo& current = m_vecRfLib[index];
+            return previous.startAbsTime_us == current.startAbsTime_us && previous.samples == current.samples
+                && previous.dwell == current.dwell && previous.event->amplitude == current.event->amplitude
+                && previous.event->magShape == current.event->magShape && previous.event->phaseShape == current.event->phaseShape
+                && !setChangedRfShapes.contains(QPair<int, int>(current.event->magShape, current.event->phaseShape));
+        },
+        [&](QCPGraph* pGraph, const int& index) {
+            QVector<double> timePoints;
+            QVector<double> amplitudes;
+            GetRfGraphData(m_vecRfLib[index], timePoints, amplitudes);
+            pGraph->setData(timePoints, amplitudes);
+        });
+
+    const QStringList listGradAxis{"GZ", "GY", "GX"};
+    const QVector<GradTrapInfo>* pPreviousGradLibs[] = {&vecPreviousGzLib, &vecPreviousGyLib, &vecPreviousGxLib};
+    const QVector<GradTrapInfo>* pGradLibs[] = {&m_vecGzLib, &m_vecGyLib, &m_vecGxLib};
+    QVector<QCPGraph*>* pGradGraphs[] = {&m_vecGzGraphs, &m_vecGyGraphs, &m_vecGxGraphs};
+    for (int lane = 0; lane < listGradAxis.size(); lane++)
     {
-        int pixelDx = event->pos().x() - m_objDragStartPos.x();
-        double dx = ui->customPlot->xAxis->pixelToCoord(pixelDx) - ui->customPlot->xAxis->pixelToCoord(0);
-
-        const QCPRange& xRange = ui->customPlot->xAxis->range();
-        double xSpan = xRange.size();
-
-        double x1New = m_dDragStartRange - dx;
-        double x2New = x1New + xSpan;
-
-        x1New = x1New < 0 ? 0 : x1New;
-        x2New = x2New > m_stSeqInfo.totalDuration_us ? m_stSeqInfo.totalDuration_us : x2New;
-        UpdatePlotRange(x1New, x2New);
+        const QVector<GradTrapInfo>& vecPrevious = *pPreviousGradLibs[lane];
+        const QVector<GradTrapInfo>& vecCurrent = *pGradLibs[lane];
+        patched += PatchGraphs(listGradAxis[lane], *pGradGraphs[lane], vecCurrent.size(),
+            [&](const int& index) {
+                return index < vecPrevious.size() && vecPrevious[index].time == vecCurrent[index].time
+                    && vecPrevious[index].amplitude == vecCurrent[index].amplitude;
+            },
+            [&](QCPGraph* pGraph, const int& index) {
+                pGraph->setData(vecCurrent[index].time, vecCurrent[index].amplitude);
+            });
+    }
+
+    patched += PatchGraphs("ADC", m_vecAdcGraphs, m_vecAdcLib.size(),
+        [&](const int& index) {
+            return index < vecPreviousAdcLib.size() && vecPreviousAdcLib[index].time == m_vecAdcLib[index].time;
+        },
+        [&](QCPGraph* pGraph, const int& index) {
+            pGraph->setData(m_vecAdcLib[index].time, m_vecAdcLib[index].amplitude);
+        });
+
+    UpdateValueRanges();
+    SetFullGraphsVisible(true);
+    m_pTimeAxis->SetBounds(0, m_stSeqInfo.totalDuration_us);
+    ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+    PrintTimeCost(timer, QString("Patching waveforms finished, %1 graphs updated").arg(patched), false);
+}
+
+// Value ranges follow the amplitudes of the loaded sequence, RF from the magnitude extremes of every shape
+void MainWindow::UpdateValueRanges()
+{
+    double rfMaxAmp(0.);
+    double rfMinAmp(0.);
+    QMap<QPair<int, int>, QPair<double, double>> mapMagnitudeRange;
+    for (const auto& rfInfo : m_vecRfLib)
+    {
+        const QPair<int, int> rfMagShapeID(rfInfo.event->magShape, rfInfo.event->phaseShape);
+        auto it = mapMagnitudeRange.find(rfMagShapeID);
+        if (it == mapMagnitudeRange.end())
+        {
+            const QVector<double>& magnitudes = m_mapRfMagShapeLib[rfMagShapeID];
+            const auto minMax = std::minmax_element(magnitudes.begin(), magnitudes.end());
+            it = mapMagnitudeRange.insert(rfMagShapeID, magnitudes.isEmpty() ? qMakePair(0., 0.) : qMakePair(*minMax.first, *minMax.second));
+        }
+        const double amp1 = it->first * rfInfo.event->amplitude;
+        const double amp2 = it->second * rfInfo.event->amplitude;
+        rfMaxAmp = std::max(rfMaxAmp, std::max(amp1, amp2));
+        rfMinAmp = std::min(rfMinAmp, std::min(amp1, amp2));
+    }
+    const double marginRF = (rfMaxAmp - rfMinAmp) * 0.1;
+    m_mapRect["RF"]->axis(QCPAxis::atLeft)->setRange(rfMinAmp - marginRF, rfMaxAmp + marginRF);
+
+    const QMap<QString, QPair<double, double>> mapGradRange{
+        {"GZ", {m_stSeqInfo.gzMinAmp_Hz_m, m_stSeqInfo.gzMaxAmp_Hz_m}},
+        {"GY", {m_stSeqInfo.gyMinAmp_Hz_m, m_stSeqInfo.gyMaxAmp_Hz_m}},
+        {"GX", {m_stSeqInfo.gxMinAmp_Hz_m, m_stSeqInfo.gxMaxAmp_Hz_m}}};
+    for (auto it = mapGradRange.constBegin(); it != mapGradRange.constEnd(); ++it)
+    {
+        const double maxAbsAmp = std::max(std::abs(it.value().first), std::abs(it.value().second));
+        const double margin = maxAbsAmp * 0.1;
+        m_mapRect[it.key()]->axis(QCPAxis::atLeft)->setRange(- maxAbsAmp - margin, maxAbsAmp + margin);
+    }
+}
+
+uint64_t MainWindow::PatchGraphs(const QString& axis, QVector<QCPGraph*>& vecGraphs, const int& count,
+                                 const std::function<bool(const int&)>& isUnchanged,
+                                 const std::function<void(QCPGraph*, const int&)>& setGraphData)
+{
+    uint64_t patched(0);
+    while (vecGraphs.size() > count)
+    {
+        ui->customPlot->removeGraph(vecGraphs.takeLast());
+        patched++;
+    }
+    for (int index = 0; index < count; index++)
+    {
+        if (index < vecGraphs.size())
+        {
+            if (isUnchanged(index)) continue;
+        }
+        else
+        {
+            QCPGraph* pGraph = ui->customPlot->addGraph(m_mapRect[axis]->axis(QCPAxis::atBottom),
+                                                        m_mapRect[axis]->axis(QCPAxis::atLeft));
+            if ("RF" == axis) pGraph->setLineStyle(QCPGraph::lsStepLeft);
+            pGraph->setPen(*m_mapAxisPen[axis]);
+            pGraph->setSelectable(QCP::stWhole);
+            vecGraphs.append(pGraph);
+        }
+        setGraphData(vecGraphs[index], index);
+        patched++;
+    }
+    return patched;
+}
+
+void MainWindow::DrawFoldedPeriod()
+{
+    ClearFoldedPeriod();
+    const bool bFolded = ui->actionFoldRepetitions->isChecked() && m_stSeqInfo.repetitions >= 2;
+    if (!bFolded)
+    {
+        // The graphs of the whole sequence come back only when they are shown
+        if (!HasFullGraphs()) AddFullGraphs();
+        if (ui->actionPhysicalAxes->isChecked()) DrawPhysicalGradients();
+        else SetFullGraphsVisible(true);
+        ui->statusbar->clearMessage();
+        ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+        return;
+    }
+    // Folded, memory follows the period and not the sequence length
+    RemoveFullGraphs();
+    ClearPhysicalGradients();
+
+    // Overlay shows the amplitude envelope of all repetitions, stepping shows one of them.
+    // Either way every lane gets one graph (two for the envelope) whose events are
+    // separated by NaN gaps, so the cost depends on the period only.
+    const bool bOverlay = ui->actionOverlayRepetitions->isChecked();
+    const uint64_t period = m_stSeqInfo.periodBlocks;
+    const uint64_t repetitions = bOverlay ? m_stSeqInfo.repetitions : 1;
+    m_lFoldedRepetition = std::min<uint64_t>(m_lFoldedRepetition, m_stSeqInfo.repetitions - 1);
+    const uint64_t firstBlock = m_stSeqInfo.periodStartBlock + (bOverlay ? 0 : m_lFoldedRepetition * period);
+    const double dPeriodStart_us = m_stFingerprint.startTime_us[firstBlock];
+
+    QMap<QString, QVector<double>> mapTime, mapUpper, mapLower;
+    auto appendEvent = [&](const QString& axis, const QVector<double>& time, const QVector<double>& shape,
+                           const double& upper, const double& lower) {
+        for (int index = 0; index < time.size(); index++)
+        {
+            mapTime[axis].append(time[index]);
+            mapUpper[axis].append(shape[index] * upper);
+            mapLower[axis].append(shape[index] * lower);
+        }
+        mapTime[axis].append(time.last());
+        mapUpper[axis].append(qQNaN());
+        mapLower[axis].append(qQNaN());
+    };
+    // Gradient shapes at unit amplitude, each point takes the envelope of the repetition amplitudes
+    auto appendShape = [&](const QString& axis, const std::vector<double>& time, const std::vector<double>& shape,
+                           const double& upper, const double& lower) {
+        for (size_t index = 0; index < time.size(); index++)
+        {
+            mapTime[axis].append(time[index]);
+            mapUpper[axis].append(std::max(shape[index] * upper, shape[index] * lower));
+            mapLower[axis].append(std::min(shape[index] * upper, shape[index] * lower));
+        }
+    };
+    const QVector<double> vecTrapShape{0., 1., 1., 0.};
+    const QStringList listGradAxis{"GX", "GY", "GZ"};
+    const WaveformPolyline polyline(m_spPulseqSeq->GetGradientRasterTime_us());
+    std::vector<double> vecShapeTime, vecShape;
+
+    for (uint64_t position = 0; position < period; position++)
+    {
+        SeqBlock* pBlock = m_vecSeqBlocks[firstBlock + position];
+        const double dBlockStart_us = m_stFingerprint.startTime_us[firstBlock + position] - dPeriodStart_us;
+
+        // Repetitions share the block structure, only the amplitudes vary
+        double rfUpper(-DBL_MAX), rfLower(DBL_MAX);
+        double gradUpper[NUM_GRADS] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+        double gradLower[NUM_GRADS] = {DBL_MAX, DBL_MAX, DBL_MAX};
+        for (uint64_t repetition = 0; repetition < repetitions; repetition++)
+        {
+            SeqBlock* pRepBlock = m_vecSeqBlocks[firstBlock + repetition * period + position];
+            if (pRepBlock->isRF())
+            {
+                rfUpper = std::max(rfUpper, (double)pRepBlock->GetRFEvent().amplitude);
+                rfLower = std::min(rfLower, (double)pRepBlock->GetRFEvent().amplitude);
+            }
+            for (int channel = 0; channel < NUM_GRADS; channel++)
+            {
+                if (pRepBlock->GetEventIndex(static_cast<Event>(GX + channel)) <= 0) continue;
+                const double amp = pRepBlock->GetGradEvent(channel).amplitude * 1e-3;
+                gradUpper[channel] = std::max(gradUpper[channel], amp);
+                gradLower[channel] = std::min(gradLower[channel], amp);
+            }
+        }
+
+        if (pBlock->isRF())
+        {
+            const RFEvent& rfEvent = pBlock->GetRFEvent();
+            const QVector<double>& vecMagnitudes = m_mapRfMagShapeLib[QPair<int, int>(rfEvent.magShape, rfEvent.phaseShape)];
+            const float fDwell = pBlock->GetRFDwellTime();
+            double sampleTime = dBlockStart_us + rfEvent.delay;
+            QVector<double> timePoints(vecMagnitudes.size(), sampleTime);
+            for (int index = 1; index < vecMagnitudes.size() - 1; index++)
+            {
+                timePoints[index] = sampleTime;
+                sampleTime += fDwell;
+            }
+            timePoints.back() = sampleTime;
+            appendEvent("RF", timePoints, vecMagnitudes, rfUpper, rfLower);
+        }
+
+        // Trapezoids, arbitrary and extended trapezoid gradients as drawn by the batch renderer
+        for (int channel = 0; channel < NUM_GRADS; channel++)
+        {
+            if (pBlock->GetEventIndex(static_cast<Event>(GX + channel)) <= 0) continue;
+            vecShapeTime.clear();
+            vecShape.clear();
+            polyline.AppendGradient(pBlock, dBlockStart_us, channel, 0., vecShapeTime, vecShape, true);
+            appendShape(listGradAxis[channel], vecShapeTime, vecShape, gradUpper[channel], gradLower[channel]);
+        }
+
+        if (pBlock->isADC())
+        {
+            const ADCEvent& adcEvent = pBlock->GetADCEvent();
+            const double start = dBlockStart_us + adcEvent.delay;
+            const double end = start + adcEvent.dwellTime * adcEvent.numSamples * 1e-3;
+            appendEvent("ADC", {start, start, end, end}, vecTrapShape, 1., 1.);
+        }
+    }
+
+    for (auto& axis : m_listAxis)
+    {
+        if (!mapTime.contains(axis)) continue;
+        QCPAxisRect* pRect = m_mapRect[axis];
+        QCPGraph* pUpperGraph = ui->customPlot->addGraph(pRect->axis(QCPAxis::atBottom), pRect->axis(QCPAxis::atLeft));
+        pUpperGraph->setData(mapTime[axis], mapUpper[axis], true);
+        pUpperGraph->setPen(*m_mapAxisPen[axis]);
+        pUpperGraph->setSelectable(QCP::stNone);
+        m_vecFoldedGraphs.append(pUpperGraph);
+        if (bOverlay && axis != "ADC")
+        {
+            QCPGraph* pLowerGraph = ui->customPlot->addGraph(pRect->axis(QCPAxis::atBottom), pRect->axis(QCPAxis::atLeft));
+            pLowerGraph->setData(mapTime[axis], mapLower[axis], true);
+            pLowerGraph->setPen(*m_mapAxisPen[axis]);
+            pLowerGraph->setSelectable(QCP::stNone);
+            QColor fillColor = m_mapAxisPen[axis]->color();
+            fillColor.setAlpha(40);
+            pLowerGraph->setBrush(fillColor);
+            pLowerGraph->setChannelFillGraph(pUpperGraph);
+            m_vecFoldedGraphs.append(pLowerGraph);
+        }
+    }
+
+    // Back to the logical axis labels and ranges
+    if (ui->actionPhysicalAxes->isChecked()) DrawPhysicalGradients();
+
+    const QString sPeriod = QString("period of %1 blocks (%2 us)").arg(period).arg(m_stSeqInfo.period_us, 0, 'f', 1);
+    ui->statusbar->showMessage(bOverlay ? QString("Overlay of %1 repetitions, %2").arg(m_stSeqInfo.repetitions).arg(sPeriod)
+                                        : QString("Repetition %1 / %2, %3").arg(m_lFoldedRepetition + 1).arg(m_stSeqInfo.repetitions).arg(sPeriod));
+    ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+}
+
+void MainWindow::ClearFoldedPeriod()
+{
+    for (auto& pGraph : m_vecFoldedGraphs)
+    {
+        ui->customPlot->removeGraph(pGraph);
+    }
+    m_vecFoldedGraphs.clear();
+}
+
+void MainWindow::SetFullGraphsVisible(const bool& visible)
+{
+    // Rotated graphs stand in for the logical gradient graphs in physical-axis mode
+    const bool bPhysical = !m_vecPhysicalGraphs.isEmpty();
+    for (const QVector<QCPGraph*>* pGraphs : {&m_vecRfGraphs, &m_vecAdcGraphs, &m_vecPhysicalGraphs})
+    {
+        for (QCPGraph* pGraph : *pGraphs)
+        {
+            pGraph->setVisible(visible);
+        }
+    }
+    for (const QVector<QCPGraph*>* pGraphs : {&m_vecGzGraphs, &m_vecGyGraphs, &m_vecGxGraphs})
+    {
+        for (QCPGraph* pGraph : *pGraphs)
+        {
+            pGraph->setVisible(visible && !bPhysical);
+        }
+    }
+}
+
+void MainWindow::SlotPhysicalAxes()
+{
+    DrawPhysicalGradients();
+}
+
+void MainWindow::DrawPhysicalGradients()
+{
+    ClearPhysicalGradients();
+    // The folded view draws the logical axes of one period
+    const bool bPhysical = ui->actionPhysicalAxes->isChecked() && m_vecSeqBlocks.size() > 0 && m_vecFoldedGraphs.isEmpty();
+    const QStringList listGradAxis{"GX", "GY", "GZ"};
+    const double maxLogicalAmp[NUM_GRADS] = {
+        std::max(std::abs(m_stSeqInfo.gxMaxAmp_Hz_m), std::abs(m_stSeqInfo.gxMinAmp_Hz_m)),
+        std::max(std::abs(m_stSeqInfo.gyMaxAmp_Hz_m), std::abs(m_stSeqInfo.gyMinAmp_Hz_m)),
+        std::max(std::abs(m_stSeqInfo.gzMaxAmp_Hz_m), std::abs(m_stSeqInfo.gzMinAmp_Hz_m))};
+
+    std::vector<double> vecTime;
+    std::vector<double> vecValues[NUM_GRADS];
+    if (bPhysical)
+    {
+        // Rotated waveforms are cached, toggling back and forth only pays for the graphs
+        if (!m_spGradientRotator)
+        {
+            m_spGradientRotator = std::make_shared<GradientRotator>(m_spPulseqSeq->GetGradientRasterTime_us());
+        }
+        QElapsedTimer timer;
+        timer.start();
+        m_spGradientRotator->Rotate(std::vector<SeqBlock*>(m_vecSeqBlocks.begin(), m_vecSeqBlocks.end()),
+                                    m_stFingerprint.startTime_us, 1e-3, vecTime, vecValues);
+        PrintTimeCost(timer, QString("Rotating gradients finished, %1 cached waveforms").arg(m_spGradientRotator->CacheSize()), false);
+    }
+
+    const QVector<double> time(vecTime.begin(), vecTime.end());
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        const QString& axis = listGradAxis[channel];
+        QCPAxis* pValueAxis = m_mapRect[axis]->axis(QCPAxis::atLeft);
+        double maxAbsAmp = maxLogicalAmp[channel];
+        if (bPhysical)
+        {
+            QCPGraph* pGraph = ui->customPlot->addGraph(m_mapRect[axis]->axis(QCPAxis::atBottom), pValueAxis);
+            pGraph->setData(time, QVector<double>(vecValues[channel].begin(), vecValues[channel].end()), true);
+            pGraph->setPen(*m_mapAxisPen[axis]);
+            pGraph->setSelectable(QCP::stNone);
+            m_vecPhysicalGraphs.append(pGraph);
+
+            maxAbsAmp = 0.;
+            for (const double& value : vecValues[channel])
+            {
+                if (!std::isnan(value)) maxAbsAmp = std::max(maxAbsAmp, std::abs(value));
+            }
+        }
+        pValueAxis->setLabel(QString(bPhysical ? "%1 phys (kHz/m)" : "%1 (kHz/m)").arg(axis));
+        pValueAxis->setRange(-maxAbsAmp * 1.1, maxAbsAmp * 1.1);
+    }
+
+    SetFullGraphsVisible(m_vecFoldedGraphs.isEmpty());
+    ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+}
+
+void MainWindow::ClearPhysicalGradients()
+{
+    for (auto& pGraph : m_vecPhysicalGraphs)
+    {
+        ui->customPlot->removeGraph(pGraph);
+    }
+    m_vecPhysicalGraphs.clear();
+}
+
+void MainWindow::onMousePress(QMouseEvent *event)
+{
+    if (m_vecSeqBlocks.size() == 0) return;
+    QCPAxis* pTimeAxis = m_pTimeAxis->ReferenceAxis();
+    if (event->button() == Qt::LeftButton)
+    {
+        ui->customPlot->setInteractions(QCP::Interactions());
+        m_bIsSelecting = true;
+        m_objSelectStartPos = event->pos();
+
+        // 初始化选择框, in the lane under the cursor
+        QCPAxisRect* pLane = ui->customPlot->axisRectAt(event->pos());
+        if (nullptr == pLane) pLane = pTimeAxis->axisRect();
+        m_pSelectionRect->topLeft->setAxes(pLane->axis(QCPAxis::atBottom), pLane->axis(QCPAxis::atLeft));
+        m_pSelectionRect->bottomRight->setAxes(pLane->axis(QCPAxis::atBottom), pLane->axis(QCPAxis::atLeft));
+        m_pSelectionRect->setClipAxisRect(pLane);
+
+        double x = pTimeAxis->pixelToCoord(m_objSelectStartPos.x());
+        double y = pLane->axis(QCPAxis::atLeft)->pixelToCoord(m_objSelectStartPos.y());
+        m_pSelectionRect->topLeft->setCoords(x, y);
+        m_pSelectionRect->bottomRight->setCoords(x, y);
+        m_pSelectionRect->setVisible(true);
+
+        m_pTimeAxis->RequestReplot();
+    }
+    else if (event->button() == Qt::RightButton)
+    {
+        m_bIsDragging = true;
+        setCursor(Qt::ClosedHandCursor);
+        m_objDragStartPos = event->pos();
+        m_dDragStartRange = m_pTimeAxis->Range().lower;
+    }
+}
+
+void MainWindow::onMouseMove(QMouseEvent *event)
+{
+    if (m_vecSeqBlocks.size() == 0) return;
+    QCPAxis* pTimeAxis = m_pTimeAxis->ReferenceAxis();
+    if(m_bIsSelecting)
+    {
+        QCPAxis* pValueAxis = m_pSelectionRect->topLeft->valueAxis();
+        double yMin = pValueAxis->range().lower;
+        double yMax = pValueAxis->range().upper;
+        // 更新选择框
+        double x1 = pTimeAxis->pixelToCoord(m_objSelectStartPos.x());
+        double y1 = pValueAxis->pixelToCoord(m_objSelectStartPos.y());
+        double x2 = pTimeAxis->pixelToCoord(event->pos().x());
+        double y2 = pValueAxis->pixelToCoord(event->pos().y());
+
+        // 限制 y 值在有效范围内
+        y1 = qBound(yMin, y1, yMax);
+        y2 = qBound(yMin, y2, yMax);
+
+        m_pSelectionRect->topLeft->setCoords(qMin(x1, x2), qMax(y1, y2));
+        m_pSelectionRect->bottomRight->setCoords(qMax(x1, x2), qMin(y1, y2));
+
+        m_pTimeAxis->RequestReplot();
+    }
+    else if (m_bIsDragging)
+    {
+        int pixelDx = event->pos().x() - m_objDragStartPos.x();
+        double dx = pTimeAxis->pixelToCoord(pixelDx) - pTimeAxis->pixelToCoord(0);
+
+        // The controller clamps to the sequence and keeps the span
+        double x1New = m_dDragStartRange - dx;
+        UpdatePlotRange(x1New, x1New + m_pTimeAxis->Range().size());
+    }
+    else
+    {
+        UpdateAdcLabelToolTip(event);
     }
 }
 
@@ -707,14 +1716,16 @@ void MainWindow::onMouseRelease(QMouseEvent *event)
     if (m_vecSeqBlocks.size() == 0) return;
 
     setInteraction(true);
+    QCPAxis* pTimeAxis = m_pTimeAxis->ReferenceAxis();
     if(event->button() == Qt::LeftButton && m_bIsSelecting)
     {
         m_bIsSelecting = false;
         m_pSelectionRect->setVisible(false);
+        m_pTimeAxis->RequestReplot();
 
         // 获取选择的时间范围
-        double x1 = ui->customPlot->xAxis->pixelToCoord(m_objSelectStartPos.x());
-        double x2 = ui->customPlot->xAxis->pixelToCoord(event->pos().x());
+        double x1 = pTimeAxis->pixelToCoord(m_objSelectStartPos.x());
+        double x2 = pTimeAxis->pixelToCoord(event->pos().x());
 
         // 如果选择范围太小，认为是点击事件，不进行缩放
         if(qAbs(x2 - x1) > 5)
@@ -725,16 +1736,10 @@ void MainWindow::onMouseRelease(QMouseEvent *event)
             }
             else
             {
-                QCPRange currentRange = ui->customPlot->xAxis->range();
+                QCPRange currentRange = m_pTimeAxis->Range();
                 double center = (currentRange.lower + currentRange.upper) / 2;
                 double newSpan = currentRange.size() * 3;  // 可以调整这个倍数
-
-                double x1New = center - newSpan / 2;
-                double x2New = center + newSpan / 2;
-
-                x1New = x1New < 0 ? 0 : x1New;
-                x2New = x2New > m_stSeqInfo.totalDuration_us ? m_stSeqInfo.totalDuration_us : x2New;
-                UpdatePlotRange(x1New, x2New);
+                UpdatePlotRange(center - newSpan / 2, center + newSpan / 2);
             }
         }
     }
@@ -762,77 +1767,918 @@ void MainWindow::setInteraction(const bool& enable)
 
 void MainWindow::SlotExportData()
 {
-    if(!m_pSelectedGraph)
+    if (m_vecSeqBlocks.size() == 0) return;
+
+    // Default to the visible window on the gradient raster
+    const QCPRange range = m_mapRect["RF"]->axis(QCPAxis::atBottom)->range();
+    ExportDialog dialog(this);
+    dialog.SetRange(range.lower, range.upper, m_stSeqInfo.totalDuration_us);
+    dialog.SetRaster(m_spPulseqSeq->GetGradientRasterTime_us());
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    QString sSelectedFilter;
+    const QString sFilePath = QFileDialog::getSaveFileName(
+        this,
+        "Export Waveforms",
+        QFileInfo(m_sPulseqFilePathCache).absolutePath(),
+        "NumPy Files (*.npy);;Raw float32 Files (*.raw)",
+        &sSelectedFilter
+        );
+    if (sFilePath.isEmpty()) return;
+
+    ExportOptions options = dialog.GetOptions();
+    options.format = sFilePath.endsWith(".raw", Qt::CaseInsensitive) || sSelectedFilter.contains("*.raw") ? kExportRaw : kExportNpy;
+    options.sSourceFile = m_sPulseqFilePathCache.toStdString();
+
+    this->setEnabled(false);
+    m_pProgressBar->setValue(0);
+    m_pProgressBar->show();
+    ui->statusbar->showMessage("Exporting waveforms to " + sFilePath + "...");
+
+    QElapsedTimer timer;
+    timer.start();
+    const WaveformExporter exporter(std::vector<SeqBlock*>(m_vecSeqBlocks.begin(), m_vecSeqBlocks.end()),
+                                    m_stFingerprint.startTime_us,
+                                    m_spPulseqSeq->GetGradientRasterTime_us());
+    std::shared_ptr<std::string> spError = std::make_shared<std::string>();
+    std::shared_ptr<bool> spSuccess = std::make_shared<bool>(false);
+
+    QPointer<QProgressBar> pProgressBar(m_pProgressBar);
+    RunTask(kTaskNormal, [pProgressBar, exporter, sFilePath, options, spError, spSuccess]() {
+        *spSuccess = exporter.Export(sFilePath.toStdString(), options, [pProgressBar](int percent) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [pProgressBar, percent]() {
+                if (!pProgressBar.isNull()) pProgressBar->setValue(percent);
+            }, Qt::QueuedConnection);
+        }, *spError);
+    }, [this, timer, spError, spSuccess]() {
+        QElapsedTimer elapsed(timer);
+        PrintTimeCost(elapsed, "Exporting waveforms finished", false);
+        ui->statusbar->clearMessage();
+        m_pProgressBar->hide();
+        if (!*spSuccess)
+        {
+            QMessageBox::warning(this, "Export Failed", QString::fromStdString(*spError));
+        }
+        this->setEnabled(true);
+    });
+}
+
+void MainWindow::SlotSaveScreenshot()
+{
+    QString sSelectedFilter;
+    const QString sFilePath = QFileDialog::getSaveFileName(
+        this,
+        "Save Screenshot",
+        QFileInfo(m_sPulseqFilePathCache).absolutePath(),
+        "PNG Files (*.png);;PDF Files (*.pdf)",
+        &sSelectedFilter
+        );
+    if (sFilePath.isEmpty()) return;
+
+    // Rendered at twice the widget resolution so the image stays sharp when zoomed
+    bool bSaved(false);
+    if (sFilePath.endsWith(".pdf", Qt::CaseInsensitive) || sSelectedFilter.contains("*.pdf"))
+    {
+        bSaved = ui->customPlot->savePdf(sFilePath, 0, 0, QCP::epNoCosmetic, "PulseqViewer", QFileInfo(m_sPulseqFilePathCache).fileName());
+    }
+    else
+    {
+        bSaved = ui->customPlot->savePng(sFilePath, 0, 0, 2.0);
+    }
+    if (!bSaved)
+    {
+        QMessageBox::warning(this, "Screenshot", "Saving " + sFilePath + " failed!");
+    }
+}
+
+void MainWindow::SlotCheckSystemLimits()
+{
+    if (m_vecSeqBlocks.size() == 0) return;
+
+    // Hardware limits are kept between checks, rasters default to the loaded file
+    SystemLimits limits = m_stSystemLimits;
+    limits.rfRasterTime_us = m_spPulseqSeq->GetRadiofrequencyRasterTime_us();
+    limits.gradRasterTime_us = m_spPulseqSeq->GetGradientRasterTime_us();
+    limits.adcRasterTime_us = m_spPulseqSeq->GetAdcRasterTime_us();
+    limits.blockDurationRaster_us = m_spPulseqSeq->GetBlockDurationRaster_us();
+
+    SystemLimitsDialog dialog(this);
+    dialog.SetLimits(limits);
+    if (dialog.exec() != QDialog::Accepted) return;
+    m_stSystemLimits = dialog.GetLimits();
+
+    this->setEnabled(false);
+    ui->statusbar->showMessage("Checking system limits...");
+
+    QElapsedTimer timer;
+    timer.start();
+    const SequenceChecker checker(m_stSystemLimits);
+    const std::vector<SeqBlock*> blocks(m_vecSeqBlocks.begin(), m_vecSeqBlocks.end());
+    const std::vector<double> vecBlockStart_us = m_stFingerprint.startTime_us;
+    std::shared_ptr<std::vector<LimitViolation>> spViolations = std::make_shared<std::vector<LimitViolation>>();
+
+    RunTask(kTaskNormal, [checker, blocks, vecBlockStart_us, spViolations]() {
+        *spViolations = checker.Check(blocks, vecBlockStart_us);
+    }, [this, timer, spViolations]() {
+        QElapsedTimer elapsed(timer);
+        PrintTimeCost(elapsed, "Checking system limits finished", false);
+        ui->statusbar->clearMessage();
+        ShowLimitViolations(*spViolations);
+        this->setEnabled(true);
+    });
+}
+
+void MainWindow::ShowLimitViolations(const std::vector<LimitViolation>& violations)
+{
+    if (nullptr == m_pCheckResultDock)
+    {
+        m_pCheckResultDock = new ResultListDock("System Limit Violations", this);
+        m_pCheckResultDock->SetHeaders({"Block", "Time (us)", "Type", "Details"});
+        addDockWidget(Qt::BottomDockWidgetArea, m_pCheckResultDock);
+        connect(m_pCheckResultDock, &ResultListDock::rangeRequested, this, &MainWindow::ShowTimeRange);
+    }
+
+    m_pCheckResultDock->Clear();
+    for (const auto& violation : violations)
+    {
+        const double dDuration_us = m_vecSeqBlocks[violation.blockIndex]->GetDuration();
+        const QStringList columns{
+            QString::number(violation.blockIndex),
+            QString::number(violation.time_us, 'f', 1),
+            QString::fromStdString(SequenceChecker::TypeName(violation.type)),
+            QString::fromStdString(SequenceChecker::Describe(violation))};
+        if (!m_pCheckResultDock->AddItem(columns, violation.time_us, violation.time_us + dDuration_us)) break;
+    }
+
+    QString summary = violations.empty() ? QString("No violations found")
+                                         : QString("%1 violations found").arg(violations.size());
+    if (violations.size() > MAX_LISTED_RESULTS)
+    {
+        summary += QString(", showing the first %1").arg(MAX_LISTED_RESULTS);
+    }
+    m_pCheckResultDock->SetSummary(summary);
+    m_pCheckResultDock->show();
+    m_pCheckResultDock->raise();
+}
+
+void MainWindow::SlotEstimateRfEnergy()
+{
+    if (m_vecRfLib.size() == 0) return;
+
+    bool ok(false);
+    const QString sWindows = QInputDialog::getText(this, "RF Energy", "Averaging windows (s):",
+                                                   QLineEdit::Normal, m_sRfEnergyWindows, &ok);
+    if (!ok) return;
+
+    std::vector<double> vecWindows_s;
+    for (const QString& sWindow : sWindows.split(',', Qt::SkipEmptyParts))
+    {
+        const double window_s = sWindow.trimmed().toDouble(&ok);
+        if (ok && window_s > 0.) vecWindows_s.push_back(window_s);
+    }
+    if (vecWindows_s.empty())
     {
-        QMessageBox::information(this, "Hint", "Please select a graph!");
+        QMessageBox::warning(this, "RF Energy", "Please enter comma separated window lengths in seconds!");
         return;
     }
+    m_sRfEnergyWindows = sWindows;
 
-    // 找到选中的graph在vector中的索引
-    int graphIndex(-1);
+    QElapsedTimer timer;
+    timer.start();
 
-    if (std::find(m_vecRfGraphs.begin(), m_vecRfGraphs.end(), m_pSelectedGraph) != m_vecRfGraphs.end())
+    // Energy of a pulse: amplitude^2 * sum(|shape|^2) * dwell, the shape sum is cached per shape pair
+    RfEnergyEstimator estimator(vecWindows_s);
+    QMap<QPair<int, int>, double> mapShapeEnergy;
+    for (const auto& rfInfo : m_vecRfLib)
     {
-        graphIndex = m_vecRfGraphs.indexOf(m_pSelectedGraph);
+        const QPair<int, int> rfMagShapeID(rfInfo.event->magShape, rfInfo.event->phaseShape);
+        auto it = mapShapeEnergy.find(rfMagShapeID);
+        if (it == mapShapeEnergy.end())
+        {
+            const QVector<double>& vecMagnitudes = m_mapRfMagShapeLib[rfMagShapeID];
+            it = mapShapeEnergy.insert(rfMagShapeID, RfEnergyEstimator::ShapeEnergy(vecMagnitudes.constData(), vecMagnitudes.size()));
+        }
+        const double amp = rfInfo.event->amplitude;
+        estimator.AddPulse(rfInfo.startAbsTime_us, rfInfo.duration_us, amp * amp * it.value() * rfInfo.dwell * 1e-6);
     }
-    else if (std::find(m_vecGzGraphs.begin(), m_vecGzGraphs.end(), m_pSelectedGraph) != m_vecGzGraphs.end())
+    estimator.Finish(m_stSeqInfo.totalDuration_us);
+    PrintTimeCost(timer, "Estimating RF energy finished", false);
+
+    ShowRfEnergy(estimator);
+}
+
+void MainWindow::SlotShowStatistics()
+{
+    if (m_vecSeqBlocks.size() == 0) return;
+    ShowSequenceStatistics();
+}
+
+// Every row stands for the whole sequence, activating one shows all of it
+void MainWindow::ShowSequenceStatistics()
+{
+    if (nullptr == m_pStatisticsDock)
     {
-        graphIndex = m_vecGzGraphs.indexOf(m_pSelectedGraph);
+        m_pStatisticsDock = new ResultListDock("Sequence Statistics", this);
+        m_pStatisticsDock->SetHeaders({"Quantity", "Value"});
+        addDockWidget(Qt::BottomDockWidgetArea, m_pStatisticsDock);
+        connect(m_pStatisticsDock, &ResultListDock::rangeRequested, this, &MainWindow::ShowTimeRange);
     }
-    else if (std::find(m_vecGyGraphs.begin(), m_vecGyGraphs.end(), m_pSelectedGraph) != m_vecGyGraphs.end())
+
+    static const char* axes[NUM_GRADS] = {"GX", "GY", "GZ"};
+    const SequenceStatistics& stats = m_stSeqInfo.statistics;
+    const double dEnd_us = stats.totalDuration_us;
+    auto addRow = [this, &dEnd_us](const QString& sName, const QString& sValue) {
+        m_pStatisticsDock->AddItem({sName, sValue}, 0., dEnd_us);
+    };
+
+    m_pStatisticsDock->Clear();
+    addRow("Blocks", QString::number(stats.blocks));
+    addRow("Duration (s)", QString::number(stats.totalDuration_us * 1e-6, 'f', 3));
+    addRow("RF pulses", QString::number(stats.rfCount));
+    addRow("RF peak B1 (uT)", QString::number(stats.rfPeak_uT, 'f', 3));
+    addRow("RF B1rms (uT)", QString::number(stats.rfRms_uT, 'f', 3));
+    addRow("RF duty cycle (%)", QString::number(stats.rfDutyCycle * 100., 'f', 2));
+    for (int channel = 0; channel < NUM_GRADS; channel++)
     {
-        graphIndex = m_vecGyGraphs.indexOf(m_pSelectedGraph);
+        const GradientStatistics& grad = stats.grad[channel];
+        const double dPeak_mT_m = grad.amplitude_Hz_m.IsEmpty() ? 0.
+            : std::max(std::abs(grad.amplitude_Hz_m.min), std::abs(grad.amplitude_Hz_m.max)) / GAMMA_HZ_T * 1e3;
+        addRow(QString("%1 events").arg(axes[channel]), QString::number(grad.count));
+        addRow(QString("%1 peak (mT/m)").arg(axes[channel]), QString::number(dPeak_mT_m, 'f', 3));
+        addRow(QString("%1 RMS (mT/m)").arg(axes[channel]), QString::number(grad.rms_Hz_m / GAMMA_HZ_T * 1e3, 'f', 3));
+        addRow(QString("%1 duty cycle (%)").arg(axes[channel]), QString::number(grad.dutyCycle * 100., 'f', 2));
     }
-    else if (std::find(m_vecGxGraphs.begin(), m_vecGxGraphs.end(), m_pSelectedGraph) != m_vecGxGraphs.end())
+    addRow("ADCs", QString::number(stats.adcCount));
+    addRow("ADC samples", QString::number(stats.adcSamples));
+    addRow("Readout time (ms)", QString::number(stats.readoutTime_us * 1e-3, 'f', 3));
+    for (int type = 0; type < kBlockTypeNum; type++)
     {
-        graphIndex = m_vecGxGraphs.indexOf(m_pSelectedGraph);
+        const BlockTypeStatistics& blockType = stats.blockTypes[type];
+        if (blockType.count == 0) continue;
+        const double dDuration_ms = static_cast<double>(blockType.duration_ru) * stats.BlockDurationRaster_us() * 1e-3;
+        addRow(QString("%1 blocks").arg(QString::fromStdString(SequenceStatistics::BlockTypeName(type))),
+               QString("%1 (%2 ms)").arg(blockType.count).arg(dDuration_ms, 0, 'f', 3));
     }
-    else if (std::find(m_vecAdcGraphs.begin(), m_vecAdcGraphs.end(), m_pSelectedGraph) != m_vecAdcGraphs.end())
+
+    m_pStatisticsDock->SetSummary(QString("%1 blocks over %2 s").arg(stats.blocks).arg(stats.totalDuration_us * 1e-6, 0, 'f', 3));
+    m_pStatisticsDock->show();
+    m_pStatisticsDock->raise();
+}
+
+void MainWindow::ShowRfEnergy(const RfEnergyEstimator& estimator)
+{
+    static const QList<QColor> listWindowColors{QColor(230, 120, 30), QColor(200, 40, 40), QColor(120, 60, 170), QColor(30, 150, 90)};
+
+    if (nullptr == m_pRfEnergyDock)
     {
-        graphIndex = m_vecAdcGraphs.indexOf(m_pSelectedGraph);
+        m_pRfEnergyDock = new ResultListDock("RF Energy", this);
+        m_pRfEnergyDock->SetHeaders({"Window (s)", "Peak B1rms (uT)", "Peak start (s)", "Peak end (s)"});
+        addDockWidget(Qt::BottomDockWidgetArea, m_pRfEnergyDock);
+        connect(m_pRfEnergyDock, &ResultListDock::rangeRequested, this, &MainWindow::ShowTimeRange);
     }
-    else
+
+    ClearRfEnergyOverlay();
+    QCPAxisRect* pRfRect = m_mapRect["RF"];
+    if (nullptr == m_pRfEnergyAxis)
+    {
+        m_pRfEnergyAxis = pRfRect->addAxis(QCPAxis::atRight);
+        m_pRfEnergyAxis->setLabel("B1rms (uT)");
+    }
+    m_pRfEnergyAxis->setVisible(true);
+
+    m_pRfEnergyDock->Clear();
+    double maxB1rms_uT(0.);
+    const std::vector<RfEnergyWindowResult>& vecResults = estimator.GetResults();
+    for (size_t index = 0; index < vecResults.size(); index++)
+    {
+        const RfEnergyWindowResult& result = vecResults[index];
+        const QColor& color = listWindowColors[index % listWindowColors.size()];
+        const double peakB1rms_uT = result.peakB1rms_Hz / GAMMA_HZ_T * 1e6;
+        maxB1rms_uT = std::max(maxB1rms_uT, peakB1rms_uT);
+
+        m_pRfEnergyDock->AddItem({QString::number(result.window_us * 1e-6),
+                                  QString::number(peakB1rms_uT, 'f', 3),
+                                  QString::number(result.peakStart_us * 1e-6, 'f', 3),
+                                  QString::number(result.peakEnd_us * 1e-6, 'f', 3)},
+                                 result.peakStart_us, result.peakEnd_us);
+
+        QVector<double> vecTime, vecB1rms;
+        vecTime.reserve(result.trace.size());
+        vecB1rms.reserve(result.trace.size());
+        for (const auto& sample : result.trace)
+        {
+            vecTime.append(sample.first);
+            vecB1rms.append(sample.second / GAMMA_HZ_T * 1e6);
+        }
+        QCPGraph* pGraph = ui->customPlot->addGraph(pRfRect->axis(QCPAxis::atBottom), m_pRfEnergyAxis);
+        pGraph->setData(vecTime, vecB1rms, true);
+        pGraph->setPen(QPen(color, 1, Qt::DashLine));
+        pGraph->setSelectable(QCP::stNone);
+        m_vecRfEnergyGraphs.append(pGraph);
+
+        QCPItemRect* pPeakRect = new QCPItemRect(ui->customPlot);
+        pPeakRect->setClipAxisRect(pRfRect);
+        for (QCPItemPosition* pPosition : {pPeakRect->topLeft, pPeakRect->bottomRight})
+        {
+            pPosition->setAxes(pRfRect->axis(QCPAxis::atBottom), pRfRect->axis(QCPAxis::atLeft));
+            pPosition->setAxisRect(pRfRect);
+            pPosition->setTypeX(QCPItemPosition::ptPlotCoords);
+            pPosition->setTypeY(QCPItemPosition::ptAxisRectRatio);
+        }
+        pPeakRect->topLeft->setCoords(result.peakStart_us, 0.);
+        pPeakRect->bottomRight->setCoords(result.peakEnd_us, 1.);
+        pPeakRect->setPen(Qt::NoPen);
+        pPeakRect->setBrush(QColor(color.red(), color.green(), color.blue(), 40));
+        pPeakRect->setSelectable(false);
+        m_vecRfEnergyItems.append(pPeakRect);
+    }
+    m_pRfEnergyAxis->setRange(0., maxB1rms_uT > 0. ? maxB1rms_uT * 1.1 : 1.);
+
+    const double dTotal_s = m_stSeqInfo.totalDuration_us * 1e-6;
+    const double meanB1rms_uT = dTotal_s > 0. ? std::sqrt(estimator.GetTotalEnergy() / dTotal_s) / GAMMA_HZ_T * 1e6 : 0.;
+    m_pRfEnergyDock->SetSummary(QString("Sequence B1rms: %1 uT over %2 s").arg(meanB1rms_uT, 0, 'f', 3).arg(dTotal_s, 0, 'f', 1));
+    m_pRfEnergyDock->show();
+    m_pRfEnergyDock->raise();
+    ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+}
+
+void MainWindow::ClearRfEnergyOverlay()
+{
+    for (auto& pGraph : m_vecRfEnergyGraphs)
+    {
+        ui->customPlot->removeGraph(pGraph);
+    }
+    m_vecRfEnergyGraphs.clear();
+    for (auto& pItem : m_vecRfEnergyItems)
+    {
+        ui->customPlot->removeItem(pItem);
+    }
+    m_vecRfEnergyItems.clear();
+    if (nullptr != m_pRfEnergyAxis)
+    {
+        m_pRfEnergyAxis->setVisible(false);
+    }
+}
+
+void MainWindow::SlotGradientSpectrum()
+{
+    if (m_vecSeqBlocks.size() == 0) return;
+
+    bool ok(false);
+    const QString sBands = QInputDialog::getText(this, "Gradient Spectrum", "Forbidden bands (Hz), e.g. 1000-1200, 1900-2100:",
+                                                 QLineEdit::Normal, m_sForbiddenBands, &ok);
+    if (!ok) return;
+
+    SpectrumOptions options;
+    std::string sError;
+    if (!GradientSpectrumAnalyzer::ParseBands(sBands.toStdString(), options.bands, sError))
+    {
+        QMessageBox::warning(this, "Gradient Spectrum", QString::fromStdString(sError));
+        return;
+    }
+    m_sForbiddenBands = sBands;
+
+    // The visible window, which is the whole sequence after a view reset
+    const QCPRange range = m_pTimeAxis->Range();
+    options.start_us = std::max(0., range.lower);
+    options.end_us = std::min(m_stSeqInfo.totalDuration_us, range.upper);
+    options.raster_us = m_spPulseqSeq->GetGradientRasterTime_us();
+
+    this->setEnabled(false);
+    ui->statusbar->showMessage("Analyzing gradient spectra...");
+
+    QElapsedTimer timer;
+    timer.start();
+    const GradientSpectrumAnalyzer analyzer(std::vector<SeqBlock*>(m_vecSeqBlocks.begin(), m_vecSeqBlocks.end()),
+                                            m_stFingerprint.startTime_us,
+                                            options.raster_us);
+    std::shared_ptr<GradientSpectrum> spSpectrum = std::make_shared<GradientSpectrum>();
+    std::shared_ptr<std::string> spError = std::make_shared<std::string>();
+    std::shared_ptr<bool> spSuccess = std::make_shared<bool>(false);
+
+    RunTask(kTaskNormal, [analyzer, options, spSpectrum, spError, spSuccess]() {
+        *spSuccess = analyzer.Analyze(options, *spSpectrum, *spError);
+    }, [this, timer, options, spSpectrum, spError, spSuccess]() {
+        QElapsedTimer elapsed(timer);
+        PrintTimeCost(elapsed, "Analyzing gradient spectra finished", false);
+        ui->statusbar->clearMessage();
+        if (*spSuccess)
+        {
+            ShowGradientSpectrum(*spSpectrum, options.bands, options.start_us, options.end_us);
+        }
+        else
+        {
+            QMessageBox::warning(this, "Gradient Spectrum", QString::fromStdString(*spError));
+        }
+        this->setEnabled(true);
+    });
+}
+
+void MainWindow::ShowGradientSpectrum(const GradientSpectrum& spectrum, const std::vector<ForbiddenBand>& bands, const double& dStart_us, const double& dEnd_us)
+{
+    static const QStringList listAxisNames{"GX", "GY", "GZ"};
+
+    if (nullptr == m_pSpectrumDock)
+    {
+        m_pSpectrumDock = new SpectrumDock("Gradient Spectrum", this);
+        addDockWidget(Qt::BottomDockWidgetArea, m_pSpectrumDock);
+    }
+    if (nullptr == m_pBandDock)
+    {
+        m_pBandDock = new ResultListDock("Forbidden Bands", this);
+        m_pBandDock->SetHeaders({"Axis", "Band (Hz)", "Start (s)", "End (s)", "Blocks", "Band share", "Band rms (mT/m)"});
+        addDockWidget(Qt::BottomDockWidgetArea, m_pBandDock);
+        tabifyDockWidget(m_pSpectrumDock, m_pBandDock);
+        connect(m_pBandDock, &ResultListDock::rangeRequested, this, &MainWindow::ShowTimeRange);
+    }
+    m_pSpectrumDock->SetSpectrum(spectrum, bands);
+
+    m_pBandDock->Clear();
+    QVector<QPair<double, double>> vecRanges;
+    for (const BandViolation& violation : spectrum.violations)
+    {
+        const ForbiddenBand& band = bands[violation.band];
+        const QStringList columns{
+            listAxisNames[violation.channel],
+            QString("%1-%2").arg(band.low_Hz).arg(band.high_Hz),
+            QString::number(violation.start_us * 1e-6, 'f', 3),
+            QString::number(violation.end_us * 1e-6, 'f', 3),
+            QString("%1-%2").arg(violation.firstBlock).arg(violation.lastBlock),
+            QString::number(violation.peakFraction * 100., 'f', 1) + " %",
+            QString::number(violation.peakBandRms_Hz_m / GAMMA_HZ_T * 1e3, 'f', 3)};
+        m_pBandDock->AddItem(columns, violation.start_us, violation.end_us);
+        vecRanges.append(qMakePair(violation.start_us, violation.end_us));
+    }
+
+    // Band rms of every axis over the analyzed window
+    QStringList listBandRms;
+    for (size_t band = 0; band < bands.size(); band++)
     {
+        QStringList listAxisRms;
+        for (int channel = 0; channel < NUM_GRADS; channel++)
+        {
+            listAxisRms << QString("%1 %2").arg(listAxisNames[channel]).arg(spectrum.bandRms_Hz_m[channel][band] / GAMMA_HZ_T * 1e3, 0, 'f', 3);
+        }
+        listBandRms << QString("%1-%2 Hz: %3").arg(bands[band].low_Hz).arg(bands[band].high_Hz).arg(listAxisRms.join(", "));
+    }
+    m_pBandDock->SetSummary(QString("%1 segments of %2 to %3 s, %4 Hz resolution, %5 offending ranges\nBand rms (mT/m) %6")
+                                .arg(spectrum.segments)
+                                .arg(dStart_us * 1e-6, 0, 'f', 3)
+                                .arg(dEnd_us * 1e-6, 0, 'f', 3)
+                                .arg(spectrum.frequencyStep_Hz, 0, 'f', 1)
+                                .arg(spectrum.violations.size())
+                                .arg(listBandRms.join("; ")));
+
+    ClearHighlights();
+    HighlightTimeRanges(vecRanges, QColor(230, 120, 30));
+    m_pSpectrumDock->show();
+    m_pBandDock->show();
+    m_pBandDock->raise();
+    ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+}
+
+void MainWindow::SlotSimulateSliceProfile()
+{
+    if (m_vecSeqBlocks.size() == 0) return;
+
+    // The selected RF event, otherwise the first one in view
+    int rfIndex(-1);
+    if (nullptr != m_pSelectedGraph)
+    {
+        rfIndex = m_vecRfGraphs.indexOf(m_pSelectedGraph);
+    }
+    if (rfIndex < 0)
+    {
+        const QCPRange range = m_pTimeAxis->Range();
+        for (int index = 0; index < m_vecRfLib.size(); index++)
+        {
+            if (m_vecRfLib[index].startAbsTime_us + m_vecRfLib[index].duration_us < range.lower) continue;
+            if (m_vecRfLib[index].startAbsTime_us <= range.upper) rfIndex = index;
+            break;
+        }
+    }
+    if (rfIndex < 0 || rfIndex >= m_vecRfLib.size())
+    {
+        QMessageBox::information(this, "Slice Profile", "Select an RF event or bring one into view first.");
         return;
     }
 
-    // QString fileName = QFileDialog::getSaveFileName(this,
-    //                                                 tr("保存波形数据"), "",
-    //                                                 tr("文本文件 (*.txt);;所有文件 (*)"));
+    SliceProfileDialog dialog(this);
+    dialog.SetSettings(m_stSliceProfileSettings);
+    if (dialog.exec() != QDialog::Accepted) return;
+    m_stSliceProfileSettings = dialog.GetSettings();
+
+    const std::vector<double>& vecStart_us = m_stFingerprint.startTime_us;
+    const size_t block = std::upper_bound(vecStart_us.begin(), vecStart_us.end(), m_vecRfLib[rfIndex].startAbsTime_us) - vecStart_us.begin() - 1;
+    if (block >= m_vecSeqBlocks.size()) return;
+
+    this->setEnabled(false);
+    ui->statusbar->showMessage("Simulating slice profile...");
+
+    QElapsedTimer timer;
+    timer.start();
+    SeqBlock* pBlock = m_vecSeqBlocks[block];
+    const double gradRasterTime_us = m_spPulseqSeq->GetGradientRasterTime_us();
+    std::shared_ptr<std::vector<double>> spPosition_m = std::make_shared<std::vector<double>>();
+    std::shared_ptr<std::vector<double>> spOffResonance_Hz = std::make_shared<std::vector<double>>();
+    std::shared_ptr<std::vector<double>> spAxis = std::make_shared<std::vector<double>>();
+    m_stSliceProfileSettings.Isochromats(*spPosition_m, *spOffResonance_Hz, *spAxis);
+    std::shared_ptr<BlochProfile> spProfile = std::make_shared<BlochProfile>();
+    std::shared_ptr<bool> spSuccess = std::make_shared<bool>(false);
+
+    RunTask(kTaskNormal, [pBlock, gradRasterTime_us, spPosition_m, spOffResonance_Hz, spProfile, spSuccess]() {
+        BlochPulse pulse;
+        *spSuccess = BlochSimulator::SamplePulse(pBlock, gradRasterTime_us, pulse);
+        if (*spSuccess)
+        {
+            BlochSimulator::Simulate(pulse, *spPosition_m, *spOffResonance_Hz, *spProfile);
+        }
+    }, [this, timer, block, spAxis, spProfile, spSuccess]() {
+        QElapsedTimer elapsed(timer);
+        PrintTimeCost(elapsed, "Simulating slice profile finished", false);
+        ui->statusbar->clearMessage();
+        if (*spSuccess)
+        {
+            if (nullptr == m_pSliceProfileDock)
+            {
+                m_pSliceProfileDock = new SliceProfileDock("Slice Profile", this);
+                addDockWidget(Qt::RightDockWidgetArea, m_pSliceProfileDock);
+            }
+            m_pSliceProfileDock->setWindowTitle(QString("Slice Profile (block %1)").arg(block));
+            m_pSliceProfileDock->SetProfile(*spProfile, *spAxis,
+                                            m_stSliceProfileSettings.bSweepFrequency ? "Off-resonance (Hz)" : "Position (mm)");
+            m_pSliceProfileDock->show();
+            m_pSliceProfileDock->raise();
+        }
+        else
+        {
+            QMessageBox::warning(this, "Slice Profile", QString("Block %1 holds no RF samples.").arg(block));
+        }
+        this->setEnabled(true);
+    });
+}
+
+void MainWindow::SlotCompareSequence()
+{
+    if (m_vecSeqBlocks.size() == 0) return;
 
-    // if(fileName.isEmpty()) return;
+    const QString sOtherFilePath = QFileDialog::getOpenFileName(
+        this,
+        "Compare With",
+        QFileInfo(m_sPulseqFilePathCache).absolutePath(),
+        "Pulseq Files (*.seq *.seq.gz);;All Files (*)"
+        );
+    if (sOtherFilePath.isEmpty()) return;
 
-    QString fileName = "D:\\data.txt";
+    this->setEnabled(false);
+    ui->statusbar->showMessage("Comparing with " + sOtherFilePath + "...");
 
-    QFile file(fileName);
-    if(file.open(QIODevice::WriteOnly | QIODevice::Text))
+    struct DiffResult
     {
-        QTextStream stream(&file);
+        bool loaded = false;
+        bool exact = true;
+        std::vector<BlockDiffInterval> intervals;
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    const SequenceFingerprint fingerprint = m_stFingerprint;
+    std::shared_ptr<DiffResult> spResult = std::make_shared<DiffResult>();
 
-        QSharedPointer<QCPGraphDataContainer> data = m_pSelectedGraph->data();
-        double time(0.);
-        double point(0.);
-        for(int i = 0; i < data->size(); ++i)
+    RunTask(kTaskNormal, [fingerprint, sOtherFilePath, spResult]() {
+        SequenceFingerprint otherFingerprint;
+        spResult->loaded = BlockHasher::FingerprintFile(sOtherFilePath.toStdString(), otherFingerprint);
+        if (spResult->loaded)
+        {
+            spResult->intervals = SequenceDiff::Compare(fingerprint, otherFingerprint, spResult->exact);
+        }
+    }, [this, timer, spResult, sOtherFilePath]() {
+        QElapsedTimer elapsed(timer);
+        PrintTimeCost(elapsed, "Comparing sequences finished", false);
+        ui->statusbar->clearMessage();
+        if (spResult->loaded)
+        {
+            ShowSequenceDiff(spResult->intervals, spResult->exact, sOtherFilePath);
+        }
+        else
         {
-            time = data->at(i)->key;
-            point = data->at(i)->value;
-            stream << time << "\t" << point << "\n";
+            QMessageBox::critical(this, "File Error", "Load " + sOtherFilePath + " failed!");
         }
+        this->setEnabled(true);
+    });
+}
 
-        file.close();
-        QMessageBox::information(this, "成功", "数据已成功导出");
+void MainWindow::ShowSequenceDiff(const std::vector<BlockDiffInterval>& intervals, const bool& bExact, const QString& sOtherFilePath)
+{
+    if (nullptr == m_pDiffDock)
+    {
+        m_pDiffDock = new ResultListDock("Sequence Diff", this);
+        m_pDiffDock->SetHeaders({"Type", "Blocks (this)", "Blocks (other)", "Time (this, us)", "Time (other, us)"});
+        addDockWidget(Qt::BottomDockWidgetArea, m_pDiffDock);
+        connect(m_pDiffDock, &ResultListDock::rangeRequested, this, &MainWindow::ShowTimeRange);
+    }
+
+    auto blockRange = [](const size_t& begin, const size_t& end) {
+        if (begin == end) return QString("-");
+        if (end - begin == 1) return QString::number(begin);
+        return QString("%1-%2").arg(begin).arg(end - 1);
+    };
+    auto timeRange = [](const double& start_us, const double& end_us) {
+        return QString("%1-%2").arg(start_us, 0, 'f', 1).arg(end_us, 0, 'f', 1);
+    };
+
+    ClearHighlights();
+    m_pDiffDock->Clear();
+    QMap<DiffType, QVector<QPair<double, double>>> mapRanges;
+    size_t changedBlocks(0);
+    for (const auto& interval : intervals)
+    {
+        changedBlocks += std::max(interval.endA - interval.beginA, interval.endB - interval.beginB);
+        mapRanges[interval.type].append(qMakePair(interval.startA_us, interval.endA_us));
+        m_pDiffDock->AddItem({QString::fromStdString(SequenceDiff::TypeName(interval.type)),
+                              blockRange(interval.beginA, interval.endA),
+                              blockRange(interval.beginB, interval.endB),
+                              timeRange(interval.startA_us, interval.endA_us),
+                              timeRange(interval.startB_us, interval.endB_us)},
+                             interval.startA_us, interval.endA_us);
+    }
+
+    HighlightTimeRanges(mapRanges[kDiffChanged], QColor(230, 160, 30));
+    HighlightTimeRanges(mapRanges[kDiffInserted], QColor(40, 170, 80));
+    HighlightTimeRanges(mapRanges[kDiffRemoved], QColor(210, 50, 50));
+
+    QString summary = intervals.empty() ? QString("Sequences are identical")
+                                        : QString("%1 differing intervals, %2 blocks").arg(intervals.size()).arg(changedBlocks);
+    summary += " (other: " + QFileInfo(sOtherFilePath).fileName() + ")";
+    if (!bExact)
+    {
+        summary += ", too many edits for a minimal alignment, compared by position";
+    }
+    if (intervals.size() > MAX_LISTED_RESULTS)
+    {
+        summary += QString(", showing the first %1").arg(MAX_LISTED_RESULTS);
+    }
+    m_pDiffDock->SetSummary(summary);
+    m_pDiffDock->show();
+    m_pDiffDock->raise();
+    ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+}
+
+void MainWindow::HighlightTimeRanges(const QVector<QPair<double, double>>& ranges, const QColor& color)
+{
+    if (ranges.isEmpty()) return;
+
+    // One filled graph per lane on a hidden [0, 1] axis, which stays cheap for
+    // any number of ranges; zero-width ranges still show up through the pen
+    QVector<double> vecTime, vecValue;
+    vecTime.reserve(ranges.size() * 4);
+    vecValue.reserve(ranges.size() * 4);
+    for (const auto& range : ranges)
+    {
+        vecTime << range.first << range.first << range.second << range.second;
+        vecValue << 0. << 1. << 1. << 0.;
+    }
+
+    for (auto& axis : m_listAxis)
+    {
+        QCPAxisRect* pRect = m_mapRect[axis];
+        if (!m_mapHighlightAxis.contains(axis))
+        {
+            QCPAxis* pAxis = pRect->addAxis(QCPAxis::atRight);
+            pAxis->setRange(0., 1.);
+            pAxis->setVisible(false);
+            m_mapHighlightAxis[axis] = pAxis;
+        }
+        QCPGraph* pGraph = ui->customPlot->addGraph(pRect->axis(QCPAxis::atBottom), m_mapHighlightAxis[axis]);
+        pGraph->setData(vecTime, vecValue, true);
+        pGraph->setPen(QPen(color, 1));
+        pGraph->setBrush(QColor(color.red(), color.green(), color.blue(), 50));
+        pGraph->setSelectable(QCP::stNone);
+        pGraph->setLayer("grid");
+        m_vecHighlightGraphs.append(pGraph);
+    }
+}
+
+void MainWindow::ClearHighlights()
+{
+    for (auto& pGraph : m_vecHighlightGraphs)
+    {
+        ui->customPlot->removeGraph(pGraph);
+    }
+    m_vecHighlightGraphs.clear();
+}
+
+void MainWindow::SlotFindAdcByLabel()
+{
+    if (m_vecSeqBlocks.size() == 0) return;
+    if (!m_spLabelTable || m_spLabelTable->AdcCount() == 0)
+    {
+        ui->statusbar->showMessage("No ADC events in this sequence", 5000);
+        return;
+    }
+
+    bool ok(false);
+    const QString sQuery = QInputDialog::getText(this, "Find ADCs by Label", "Labels (e.g. LIN=64, SLC=3, REP=2, REV):",
+                                                 QLineEdit::Normal, m_sLabelQuery, &ok);
+    if (!ok) return;
+
+    std::vector<LabelQueryTerm> vecTerms;
+    std::string sError;
+    if (!LabelTable::ParseQuery(sQuery.toStdString(), vecTerms, sError))
+    {
+        QMessageBox::warning(this, "Find ADCs by Label", QString::fromStdString(sError));
+        return;
+    }
+    m_sLabelQuery = sQuery;
+
+    QElapsedTimer timer;
+    timer.start();
+    const std::vector<uint64_t> vecAdcs = m_spLabelTable->Query(vecTerms);
+    PrintTimeCost(timer, "Label query", false);
+    ShowAdcLabels(vecAdcs, sQuery);
+}
+
+void MainWindow::ShowAdcLabels(const std::vector<uint64_t>& adcs, const QString& sQuery)
+{
+    if (nullptr == m_pLabelDock)
+    {
+        m_pLabelDock = new ResultListDock("ADC Labels", this);
+        m_pLabelDock->SetHeaders({"ADC", "Block", "Time (us)", "Labels"});
+        addDockWidget(Qt::BottomDockWidgetArea, m_pLabelDock);
+        connect(m_pLabelDock, &ResultListDock::rangeRequested, this, &MainWindow::ShowTimeRange);
+    }
+
+    m_pLabelDock->Clear();
+    for (const uint64_t& adc : adcs)
+    {
+        const uint64_t block = m_spLabelTable->AdcBlock(adc);
+        const double dStart_us = m_stFingerprint.startTime_us[block];
+        const double dEnd_us = m_stFingerprint.startTime_us[block + 1];
+        if (!m_pLabelDock->AddItem({QString::number(adc),
+                                    QString::number(block),
+                                    QString::number(dStart_us, 'f', 1),
+                                    QString::fromStdString(m_spLabelTable->Describe(adc))},
+                                   dStart_us, dEnd_us)) break;
+    }
+
+    QString summary = QString("%1 of %2 ADCs match %3").arg(adcs.size()).arg(m_spLabelTable->AdcCount()).arg(sQuery);
+    if (adcs.size() > MAX_LISTED_RESULTS)
+    {
+        summary += QString(", showing the first %1").arg(MAX_LISTED_RESULTS);
+    }
+    m_pLabelDock->SetSummary(summary);
+    m_pLabelDock->show();
+    m_pLabelDock->raise();
+}
+
+void MainWindow::SlotFindEvents()
+{
+    if (m_vecSeqBlocks.size() == 0) return;
+
+    bool ok(false);
+    const QString sQuery = QInputDialog::getText(this, "Find Events",
+                                                 "Query (e.g. gx.peak > 30 kHz/m, rf.freqOffset != 0 or adc.samples = 256):",
+                                                 QLineEdit::Normal, m_sEventQuery, &ok);
+    if (!ok) return;
+
+    EventQuery query;
+    std::string sError;
+    if (!EventTable::ParseQuery(sQuery.toStdString(), query, sError))
+    {
+        QStringList listFields;
+        for (int field = 0; field < EventTable::FieldCount(); field++)
+        {
+            listFields << QString::fromStdString(EventTable::FieldName(field));
+        }
+        QMessageBox::warning(this, "Find Events", QString("%1\n\nFields: %2").arg(QString::fromStdString(sError)).arg(listFields.join(", ")));
+        return;
+    }
+    m_sEventQuery = sQuery;
+    m_stEventQuery = query;
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!m_spEventTable)
+    {
+        // Built on the first query after a load, field indices follow on first use
+        ui->statusbar->showMessage("Indexing events...");
+        m_spEventTable = EventTable::Build(std::vector<SeqBlock*>(m_vecSeqBlocks.begin(), m_vecSeqBlocks.end()),
+                                           m_stFingerprint.startTime_us,
+                                           m_spPulseqSeq->GetGradientRasterTime_us());
+        PrintTimeCost(timer, "Indexing events", true);
+        UpdateMemoryUsage();
+    }
+    m_vecEventMatches = m_spEventTable->Query(m_stEventQuery);
+    m_lEventMatch = -1;
+    PrintTimeCost(timer, "Event query", false);
+    ShowEventMatches(sQuery);
+}
+
+void MainWindow::ShowEventMatches(const QString& sQuery)
+{
+    if (nullptr == m_pEventDock)
+    {
+        m_pEventDock = new ResultListDock("Event Matches", this);
+        m_pEventDock->SetHeaders({"Block", "Time (us)", "Values"});
+        addDockWidget(Qt::BottomDockWidgetArea, m_pEventDock);
+        connect(m_pEventDock, &ResultListDock::rangeRequested, this, &MainWindow::ShowTimeRange);
+    }
+
+    m_pEventDock->Clear();
+    QVector<QPair<double, double>> vecRanges;
+    vecRanges.reserve(static_cast<int>(m_vecEventMatches.size()));
+    bool bListed(true);
+    for (const uint64_t& block : m_vecEventMatches)
+    {
+        const double dStart_us = m_stFingerprint.startTime_us[block];
+        const double dEnd_us = m_stFingerprint.startTime_us[block + 1];
+        vecRanges.append(qMakePair(dStart_us, dEnd_us));
+        if (!bListed) continue;
+        bListed = m_pEventDock->AddItem({QString::number(block),
+                                         QString::number(dStart_us, 'f', 1),
+                                         QString::fromStdString(m_spEventTable->Describe(m_stEventQuery, block))},
+                                        dStart_us, dEnd_us);
+    }
+
+    QString summary = QString("%1 of %2 blocks match %3, F3 / Shift+F3 step through them")
+                          .arg(m_vecEventMatches.size()).arg(m_spEventTable->BlockCount()).arg(sQuery);
+    if (m_vecEventMatches.size() > MAX_LISTED_RESULTS)
+    {
+        summary += QString(", listing the first %1").arg(MAX_LISTED_RESULTS);
+    }
+    m_pEventDock->SetSummary(summary);
+    m_pEventDock->show();
+    m_pEventDock->raise();
+
+    ClearHighlights();
+    HighlightTimeRanges(vecRanges, QColor(40, 160, 200));
+    ui->actionPrevMatch->setEnabled(!m_vecEventMatches.empty());
+    ui->actionNextMatch->setEnabled(!m_vecEventMatches.empty());
+    ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+}
+
+void MainWindow::SlotPrevMatch()
+{
+    StepEventMatch(false);
+}
+
+void MainWindow::SlotNextMatch()
+{
+    StepEventMatch(true);
+}
+
+void MainWindow::StepEventMatch(const bool& bForward)
+{
+    if (m_vecEventMatches.empty()) return;
+
+    // Wraps around at both ends
+    const int64_t count = static_cast<int64_t>(m_vecEventMatches.size());
+    if (m_lEventMatch < 0 || m_lEventMatch >= count)
+    {
+        m_lEventMatch = bForward ? 0 : count - 1;
     }
     else
     {
-        QMessageBox::warning(this, "错误", "无法创建文件");
+        m_lEventMatch = (m_lEventMatch + (bForward ? 1 : count - 1)) % count;
     }
+
+    const uint64_t block = m_vecEventMatches[m_lEventMatch];
+    ShowTimeRange(m_stFingerprint.startTime_us[block], m_stFingerprint.startTime_us[block + 1]);
+    ui->statusbar->showMessage(QString("Match %1 of %2: block %3 %4")
+                                   .arg(m_lEventMatch + 1)
+                                   .arg(count)
+                                   .arg(block)
+                                   .arg(QString::fromStdString(m_spEventTable->Describe(m_stEventQuery, block))));
 }
 
-void MainWindow::SlotSaveScreenshot()
+void MainWindow::UpdateAdcLabelToolTip(QMouseEvent* event)
 {
-    QPixmap pixmap(ui->customPlot->width(), ui->customPlot->height());
-    pixmap.setDevicePixelRatio(2.0);
-    ui->customPlot->savePng("D:\\pv.png");
+    // Folded views show period-relative times, the block lookup below needs absolute ones
+    if (!m_spLabelTable || m_spLabelTable->AdcCount() == 0 || !m_vecFoldedGraphs.isEmpty()) return;
+
+    const std::vector<double>& vecStart_us = m_stFingerprint.startTime_us;
+    QCPAxisRect* pRect = m_mapRect["ADC"];
+    if (ui->customPlot->axisRectAt(event->pos()) != pRect || vecStart_us.size() < 2)
+    {
+        QToolTip::hideText();
+        return;
+    }
+
+    const double time_us = pRect->axis(QCPAxis::atBottom)->pixelToCoord(event->pos().x());
+    const int64_t adc = time_us < 0. || time_us >= vecStart_us.back()
+        ? -1
+        : m_spLabelTable->FindAdcInBlock(std::upper_bound(vecStart_us.begin(), vecStart_us.end(), time_us) - vecStart_us.begin() - 1);
+    if (adc < 0)
+    {
+        QToolTip::hideText();
+        return;
+    }
+
+    const std::string sLabels = m_spLabelTable->Describe(adc);
+    QToolTip::showText(event->globalPosition().toPoint(),
+                       QString("ADC %1 (block %2)\n%3").arg(adc).arg(m_spLabelTable->AdcBlock(adc))
+                           .arg(sLabels.empty() ? QString("No labels") : QString::fromStdString(sLabels)),
+                       ui->customPlot);
 }
 
 void MainWindow::dragEnterEvent(QDragEnterEvent *event)
@@ -863,28 +2709,6 @@ void MainWindow::dropEvent(QDropEvent *event)
     }
 }
 
-void MainWindow::onAxisRangeChanged(const QCPRange& newRange)
-{
-    QCPAxis* axis = qobject_cast<QCPAxis*>(sender());
-    if (!axis) return;
-
-    // check if exceeding range
-    if (newRange.lower < 0 || newRange.upper > m_stSeqInfo.totalDuration_us) {
-        QCPRange boundedRange = newRange;
-        if (boundedRange.lower < 0)
-        {
-            boundedRange.lower = 0;
-            boundedRange.upper = qMin(0 + newRange.size(), m_stSeqInfo.totalDuration_us);
-        }
-        if (boundedRange.upper > m_stSeqInfo.totalDuration_us)
-        {
-            boundedRange.upper = m_stSeqInfo.totalDuration_us;
-            boundedRange.lower = qMax(m_stSeqInfo.totalDuration_us - newRange.size(), 0.);
-        }
-        axis->setRange(boundedRange);
-    }
-}
-
 void MainWindow::onPlottableClick(QCPAbstractPlottable *plottable, int dataIndex, QMouseEvent *event)
 {
     QCPGraph* graph = qobject_cast<QCPGraph*>(plottable);
@@ -4,14 +4,41 @@
 #include <QMainWindow>
 #include <QProgressBar>
 #include <QLabel>
+#include <QToolButton>
 #include <qcustomplot.h>
 #include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QPointer>
+#include <atomic>
+#include <functional>
 
 #include <ExternalSequence.h>
 #include "pulseq_loader.h"
+#include "sequence_checker.h"
+#include "rf_energy.h"
+#include "sequence_diff.h"
+#include "gradient_rotation.h"
+#include "result_list_dock.h"
+#include "signature_verifier.h"
+#include "memory_dialog.h"
+#include "gradient_spectrum.h"
+#include "spectrum_dock.h"
+#include "slice_profile_dialog.h"
+#include "slice_profile_dock.h"
+#include "event_polyline.h"
+#include "time_axis_controller.h"
+#include "event_query.h"
+#include "overview_strip.h"
+#include "parse_cache.h"
+#include "task_pool.h"
 
 #define BASIC_WIN_TITLE              ("PulseqViewer")
 #define SAFE_DELETE(p)               { if(p) { delete p; p = nullptr; } }
+#define RELOAD_DEBOUNCE_MS           (300)
+#define PREFETCH_IDLE_MS             (2000)
+#define PREFETCH_FILES               (3)
+#define PREFETCH_BUDGET_MB           (512)
 
 
 namespace Ui {
@@ -23,6 +50,8 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
     static const int MAX_RECENT_FILES = 10;
+    // Drives the window headless, see InteractionBench
+    friend class InteractionBench;
 
 public:
     explicit MainWindow(QWidget *parent = nullptr);
@@ -33,21 +62,76 @@ private:
     void InitSlots();
     void InitStatusBar();
     void InitSequenceFigure();
+    void InitFileWatch();
+    void InitRecentFiles();
     void UpdatePlotRange(const double& x1, const double& x2);
+    void ShowTimeRange(const double& dStart_us, const double& dEnd_us);
     void RestoreViewLayout();
     void UpdateAxisVisibility();
     void PrintTimeCost(QElapsedTimer& timer, const QString& info, const bool& restart);
 
     // Pulseq
     void ClearPulseqCache();
-    bool LoadPulseqFile(const QString& sPulseqFilePath);
+    bool LoadPulseqFile(const QString& sPulseqFilePath, const bool& bIncremental = false);
     bool ClosePulseqFile();
+    void UpdateFileWatch();
+    void AddRecentFile(const QString& sFilePath);
+    void UpdateRecentFilesMenu();
+    void OpenRecentFile(const QString& sFilePath);
+    void CancelPrefetch();
+    void UpdateMemoryUsage();
+    void UpdateFrameStats(const FrameStats& stats);
     void DrawWaveform();
+    void AddFullGraphs();
+    void RemoveFullGraphs();
+    bool HasFullGraphs() const;
+    void UpdateValueRanges();
+    void PatchWaveform(const QVector<RfInfo>& vecPreviousRfLib,
+                       const RfTimeWaveShapeMap& mapPreviousRfMagShapeLib,
+                       const QVector<GradTrapInfo>& vecPreviousGzLib,
+                       const QVector<GradTrapInfo>& vecPreviousGyLib,
+                       const QVector<GradTrapInfo>& vecPreviousGxLib,
+                       const QVector<AdcInfo>& vecPreviousAdcLib);
+    uint64_t PatchGraphs(const QString& axis, QVector<QCPGraph*>& vecGraphs, const int& count,
+                         const std::function<bool(const int&)>& isUnchanged,
+                         const std::function<void(QCPGraph*, const int&)>& setGraphData);
+    void GetRfGraphData(const RfInfo& rfInfo, QVector<double>& timePoints, QVector<double>& amplitudes);
+    void DrawFoldedPeriod();
+    void ClearFoldedPeriod();
+    void SetFullGraphsVisible(const bool& visible);
+    void UpdateRepetitionActions();
+    void DrawPhysicalGradients();
+    void ClearPhysicalGradients();
+
+    // Runs work on the shared TaskPool as part of m_stWindowTasks, then done on
+    // the GUI thread if the window still exists
+    void RunTask(const TaskPriority& priority, const std::function<void()>& work, const std::function<void()>& done);
+
+    // Analysis
+    void ClearAnalysisResults();
+    void ShowLimitViolations(const std::vector<LimitViolation>& violations);
+    void ShowRfEnergy(const RfEnergyEstimator& estimator);
+    void ShowSequenceStatistics();
+    void ClearRfEnergyOverlay();
+    void ShowGradientSpectrum(const GradientSpectrum& spectrum, const std::vector<ForbiddenBand>& bands, const double& dStart_us, const double& dEnd_us);
+    void ShowSequenceDiff(const std::vector<BlockDiffInterval>& intervals, const bool& bExact, const QString& sOtherFilePath);
+    void HighlightTimeRanges(const QVector<QPair<double, double>>& ranges, const QColor& color);
+    void ClearHighlights();
+    void ShowAdcLabels(const std::vector<uint64_t>& adcs, const QString& sQuery);
+    void UpdateAdcLabelToolTip(QMouseEvent* event);
+    void ShowEventMatches(const QString& sQuery);
+    void StepEventMatch(const bool& bForward);
 
 private slots:
     // Slots-File
     void SlotOpenPulseqFile();
     void SlotReOpenPulseqFile();
+    void SlotWatchedFileChanged(const QString& sFilePath);
+    void SlotReloadChangedFile();
+    void SlotClearRecentFiles();
+    void SlotPrefetchRecentFiles();
+    void SlotSetPrefetchBudget();
+    void SlotSetWorkerThreads();
     void SlotEnableRFAxis();
     void SlotEnableGZAxis();
     void SlotEnableGYAxis();
@@ -58,9 +142,23 @@ private slots:
     // Slot-Analysis
     void SlotExportData();
     void SlotSaveScreenshot();
+    void SlotCheckSystemLimits();
+    void SlotEstimateRfEnergy();
+    void SlotShowStatistics();
+    void SlotGradientSpectrum();
+    void SlotSimulateSliceProfile();
+    void SlotCompareSequence();
+    void SlotFindAdcByLabel();
+    void SlotFindEvents();
+    void SlotPrevMatch();
+    void SlotNextMatch();
 
     // Slot-View
     void SlotResetView();
+    void SlotFoldRepetitions();
+    void SlotPrevRepetition();
+    void SlotNextRepetition();
+    void SlotPhysicalAxes();
 
     // Slots-Interaction
     void onMousePress(QMouseEvent* event);
@@ -68,7 +166,6 @@ private slots:
     void onMouseRelease(QMouseEvent* event);
     void dragEnterEvent(QDragEnterEvent *event) override;
     void dropEvent(QDropEvent *event) override;
-    void onAxisRangeChanged(const QCPRange &newRange);
     void onPlottableClick(QCPAbstractPlottable *plottable, int dataIndex, QMouseEvent *event);
     void setInteraction(const bool& enable);
     void resizeEvent(QResizeEvent *event) override;
@@ -79,7 +176,12 @@ private:
     Ui::MainWindow                       *ui;
 
     QLabel                               *m_pVersionLabel;
+    QLabel                               *m_pSignatureLabel;
+    QLabel                               *m_pFrameLabel;
     QProgressBar                         *m_pProgressBar;
+    QToolButton                          *m_pMemoryButton;
+    MemoryDialog                         *m_pMemoryDialog;
+    MemoryLedger                         m_stMemoryLedger;
 
     QElapsedTimer                        m_qTimer;
 
@@ -91,6 +193,25 @@ private:
     QVector<SeqBlock*>                   m_vecSeqBlocks;
     QString                              m_sPulseqVersion;
     SeqInfo                              m_stSeqInfo;
+    SequenceFingerprint                  m_stFingerprint;
+    std::shared_ptr<LabelTable>          m_spLabelTable;
+    std::shared_ptr<SectionIndex>        m_spSectionIndex;
+    QFileSystemWatcher                   *m_pFileWatcher;
+    QTimer                               *m_pReloadTimer;
+    bool                                 m_bLoading;
+    bool                                 m_bReloadPending;
+    // Tasks of RunTask() whose done has not run yet, they may still read the blocks
+    uint64_t                             m_lRunningTasks;
+    QList<QAction*>                      m_listRecentActions;
+    // Recent files parsed while idle, the displayed sequence counts against the same budget
+    ParseCache                           m_stParseCache;
+    uint64_t                             m_lPrefetchBudget;
+    QTimer                               *m_pPrefetchTimer;
+    bool                                 m_bPrefetching;
+    TaskGroup                            m_stPrefetchTasks;
+    // Loads and analyses, waited for before the blocks they read are deleted
+    TaskGroup                            m_stWindowTasks;
+    std::shared_ptr<std::atomic<bool>>   m_spPrefetchCancel;
 
     QMap<int, QVector<float>>            m_mapShapeLib;
     RfTimeWaveShapeMap                   m_mapRfMagShapeLib;
@@ -113,6 +234,32 @@ private:
     uint64_t                             m_lAdcNum;
     QVector<AdcInfo>                     m_vecAdcLib;
 
+    // Analysis
+    SystemLimits                         m_stSystemLimits;
+    ResultListDock                       *m_pCheckResultDock;
+    ResultListDock                       *m_pStatisticsDock;
+    QString                              m_sRfEnergyWindows;
+    ResultListDock                       *m_pRfEnergyDock;
+    QCPAxis                              *m_pRfEnergyAxis;
+    QVector<QCPGraph*>                   m_vecRfEnergyGraphs;
+    QVector<QCPItemRect*>                m_vecRfEnergyItems;
+    QString                              m_sForbiddenBands;
+    SpectrumDock                         *m_pSpectrumDock;
+    ResultListDock                       *m_pBandDock;
+    SliceProfileSettings                 m_stSliceProfileSettings;
+    SliceProfileDock                     *m_pSliceProfileDock;
+    ResultListDock                       *m_pDiffDock;
+    QMap<QString, QCPAxis*>              m_mapHighlightAxis;
+    QVector<QCPGraph*>                   m_vecHighlightGraphs;
+    ResultListDock                       *m_pLabelDock;
+    QString                              m_sLabelQuery;
+    std::shared_ptr<EventTable>          m_spEventTable;
+    EventQuery                           m_stEventQuery;
+    QString                              m_sEventQuery;
+    std::vector<uint64_t>                m_vecEventMatches;
+    int64_t                              m_lEventMatch;
+    ResultListDock                       *m_pEventDock;
+
     // Plot
     QMap<QString, QVector<QCPGraph*>>    m_mapGraphs;
     QVector<QCPGraph*>                   m_vecRfGraphs;
@@ -120,7 +267,13 @@ private:
     QVector<QCPGraph*>                   m_vecGyGraphs;
     QVector<QCPGraph*>                   m_vecGxGraphs;
     QVector<QCPGraph*>                   m_vecAdcGraphs;
+    uint64_t                             m_lFoldedRepetition;
+    QVector<QCPGraph*>                   m_vecFoldedGraphs;
+    std::shared_ptr<GradientRotator>     m_spGradientRotator;
+    QVector<QCPGraph*>                   m_vecPhysicalGraphs;
     QMap<QString, QCPAxisRect*>          m_mapRect;
+    TimeAxisController                   *m_pTimeAxis;
+    OverviewStrip                        *m_pOverviewStrip;
     QMap<QString, QAction*>              m_mapAxisAction;
     QList<QString>                       m_listAxis;
     QMap<QString, QPen*>                 m_mapAxisPen;
@@ -0,0 +1,69 @@
+#include "memory_dialog.h"
+
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+static QString FormatBytes(const uint64_t& bytes)
+{
+    return QString::fromStdString(MemoryLedger::FormatBytes(bytes));
+}
+
+MemoryDialog::MemoryDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Memory Usage");
+    resize(520, 360);
+    QVBoxLayout* pLayout = new QVBoxLayout(this);
+
+    m_pSummaryLabel = new QLabel(this);
+    pLayout->addWidget(m_pSummaryLabel);
+
+    m_pTreeWidget = new QTreeWidget(this);
+    m_pTreeWidget->setRootIsDecorated(false);
+    m_pTreeWidget->setHeaderLabels({"Component", "Current", "Peak", "Per block"});
+    m_pTreeWidget->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    pLayout->addWidget(m_pTreeWidget);
+
+    QDialogButtonBox* pButtonBox = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    QPushButton* pResetButton = pButtonBox->addButton("Reset Peaks", QDialogButtonBox::ResetRole);
+    connect(pResetButton, &QPushButton::clicked, this, &MemoryDialog::resetPeaksRequested);
+    connect(pButtonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    pLayout->addWidget(pButtonBox);
+
+    m_pRefreshTimer = new QTimer(this);
+    m_pRefreshTimer->setInterval(MEMORY_REFRESH_MS);
+    connect(m_pRefreshTimer, &QTimer::timeout, this, &MemoryDialog::refreshRequested);
+}
+
+void MemoryDialog::SetEntries(const std::vector<MemoryEntry>& entries, const uint64_t& total, const uint64_t& peakTotal, const uint64_t& blocks)
+{
+    m_pSummaryLabel->setText(QString("Total %1, peak %2, %3 blocks").arg(FormatBytes(total), FormatBytes(peakTotal)).arg(blocks));
+    m_pTreeWidget->clear();
+    for (const MemoryEntry& entry : entries)
+    {
+        QTreeWidgetItem* pItem = new QTreeWidgetItem(m_pTreeWidget);
+        pItem->setText(0, QString::fromStdString(entry.component));
+        pItem->setText(1, FormatBytes(entry.bytes));
+        pItem->setText(2, FormatBytes(entry.peak));
+        pItem->setText(3, blocks > 0 ? QString::number(double(entry.bytes) / blocks, 'f', 1) + " B" : QString("-"));
+        for (int column = 1; column < 4; column++)
+        {
+            pItem->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+        }
+    }
+}
+
+void MemoryDialog::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+    emit refreshRequested();
+    m_pRefreshTimer->start();
+}
+
+void MemoryDialog::hideEvent(QHideEvent *event)
+{
+    m_pRefreshTimer->stop();
+    QDialog::hideEvent(event);
+}
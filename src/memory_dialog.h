@@ -0,0 +1,37 @@
+#ifndef MEMORY_DIALOG_H
+#define MEMORY_DIALOG_H
+
+#include <QDialog>
+#include <QLabel>
+#include <QTimer>
+#include <QTreeWidget>
+
+#include "memory_accounting.h"
+
+#define MEMORY_REFRESH_MS            (1000)
+
+// Current and peak bytes per component of the loaded sequence. While visible
+// it asks for fresh numbers every MEMORY_REFRESH_MS.
+class MemoryDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit MemoryDialog(QWidget *parent = nullptr);
+
+    void SetEntries(const std::vector<MemoryEntry>& entries, const uint64_t& total, const uint64_t& peakTotal, const uint64_t& blocks);
+
+signals:
+    void refreshRequested();
+    void resetPeaksRequested();
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    QLabel                               *m_pSummaryLabel;
+    QTreeWidget                          *m_pTreeWidget;
+    QTimer                               *m_pRefreshTimer;
+};
+
+#endif // MEMORY_DIALOG_H
@@ -0,0 +1,141 @@
+#include "overview_strip.h"
+
+#include <QMouseEvent>
+#include <QPainter>
+
+#include <algorithm>
+#include <cmath>
+
+OverviewStrip::OverviewStrip(QWidget *parent)
+    : QWidget(parent)
+    , m_stViewport(0., 0.)
+    , m_bDragging(false)
+    , m_dDragOffset(0.)
+{
+    setFixedHeight(OVERVIEW_ROW_HEIGHT * OVERVIEW_CHANNEL_NUM + 2);
+    setCursor(Qt::PointingHandCursor);
+    setToolTip("Sequence overview, click or drag to move the view");
+    setVisible(false);
+}
+
+void OverviewStrip::SetOverview(const std::shared_ptr<OverviewImage>& spOverview)
+{
+    static const QList<QColor> listRowColors{QColor(200, 40, 40), QColor(40, 80, 200), QColor(30, 150, 90),
+                                             QColor(150, 60, 180), QColor(220, 140, 20)};
+
+    m_spOverview = spOverview;
+    if (nullptr == m_spOverview || m_spOverview->IsEmpty())
+    {
+        Clear();
+        return;
+    }
+
+    // One pixel per column and channel, blended from white by the activity.
+    // The square root keeps sparse events visible next to busy ones.
+    m_objImage = QImage(static_cast<int>(m_spOverview->columns), OVERVIEW_CHANNEL_NUM, QImage::Format_RGB32);
+    for (int row = 0; row < OVERVIEW_CHANNEL_NUM; row++)
+    {
+        const QColor& color = listRowColors[row];
+        QRgb* pLine = reinterpret_cast<QRgb*>(m_objImage.scanLine(row));
+        const std::vector<float>& vecLevel = m_spOverview->level[row];
+        for (size_t column = 0; column < m_spOverview->columns; column++)
+        {
+            const float alpha = std::sqrt(vecLevel[column]);
+            pLine[column] = qRgb(static_cast<int>(255 + (color.red() - 255) * alpha),
+                                 static_cast<int>(255 + (color.green() - 255) * alpha),
+                                 static_cast<int>(255 + (color.blue() - 255) * alpha));
+        }
+    }
+    m_objPixmap = QPixmap();
+    setVisible(true);
+    update();
+}
+
+void OverviewStrip::SetViewport(const QCPRange& range)
+{
+    if (range == m_stViewport) return;
+    m_stViewport = range;
+    update();
+}
+
+void OverviewStrip::Clear()
+{
+    m_spOverview.reset();
+    m_objImage = QImage();
+    m_objPixmap = QPixmap();
+    m_bDragging = false;
+    setVisible(false);
+}
+
+void OverviewStrip::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    if (m_objImage.isNull()) return;
+
+    // Smooth scaling only when the size changes
+    const QSize size(width() - 2, height() - 2);
+    if (m_objPixmap.size() != size)
+    {
+        m_objPixmap = QPixmap::fromImage(m_objImage.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    }
+
+    QPainter painter(this);
+    painter.drawPixmap(1, 1, m_objPixmap);
+    painter.setPen(QColor(160, 160, 160));
+    painter.drawRect(0, 0, width() - 1, height() - 1);
+
+    // At least a few pixels wide, so a narrow window stays visible
+    const double left = XAt(m_stViewport.lower);
+    const double right = std::max(XAt(m_stViewport.upper), left + 3.);
+    painter.setPen(QPen(Qt::black, 1));
+    painter.setBrush(QColor(0, 0, 0, 40));
+    painter.drawRect(QRectF(left, 0.5, right - left, height() - 1.));
+}
+
+void OverviewStrip::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    m_objPixmap = QPixmap();
+}
+
+void OverviewStrip::mousePressEvent(QMouseEvent *event)
+{
+    if (nullptr == m_spOverview || event->button() != Qt::LeftButton) return;
+
+    // Grab the window where it was hit, otherwise jump with it centered
+    const double x = event->position().x();
+    const double left = XAt(m_stViewport.lower);
+    const double right = XAt(m_stViewport.upper);
+    m_dDragOffset = (x >= left && x <= right) ? x - left : 0.5 * (right - left);
+    m_bDragging = true;
+    MoveViewport(x);
+}
+
+void OverviewStrip::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!m_bDragging) return;
+    MoveViewport(event->position().x());
+}
+
+void OverviewStrip::mouseReleaseEvent(QMouseEvent *event)
+{
+    Q_UNUSED(event);
+    m_bDragging = false;
+}
+
+double OverviewStrip::TimeAt(const double& x) const
+{
+    return nullptr == m_spOverview ? 0. : (x - 1.) / std::max(1, width() - 2) * m_spOverview->duration_us;
+}
+
+double OverviewStrip::XAt(const double& time_us) const
+{
+    return nullptr == m_spOverview ? 0. : 1. + time_us / m_spOverview->duration_us * (width() - 2);
+}
+
+void OverviewStrip::MoveViewport(const double& x)
+{
+    // The span is kept, the time axis clamps it to the sequence
+    const double lower_us = TimeAt(x - m_dDragOffset);
+    emit rangeRequested(lower_us, lower_us + m_stViewport.size());
+}
@@ -0,0 +1,52 @@
+#ifndef OVERVIEW_STRIP_H
+#define OVERVIEW_STRIP_H
+
+#include <QImage>
+#include <QPixmap>
+#include <QWidget>
+#include <memory>
+#include <qcustomplot.h>
+
+#include "overview_density.h"
+
+#define OVERVIEW_ROW_HEIGHT          (7)         // px per channel
+
+// Thin strip above the lanes with the activity of the whole sequence and the
+// visible window as a rectangle. The density image comes precomputed from the
+// loader and is only rescaled on resize, so a pan or zoom repaints the cached
+// pixmap and the rectangle. Clicking centers the window on the clicked time,
+// dragging moves it.
+class OverviewStrip : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit OverviewStrip(QWidget *parent = nullptr);
+
+    void SetOverview(const std::shared_ptr<OverviewImage>& spOverview);
+    void SetViewport(const QCPRange& range);
+    void Clear();
+
+signals:
+    void rangeRequested(double start_us, double end_us);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+private:
+    double TimeAt(const double& x) const;
+    double XAt(const double& time_us) const;
+    void MoveViewport(const double& x);
+
+    std::shared_ptr<OverviewImage>       m_spOverview;
+    QImage                               m_objImage;
+    QPixmap                              m_objPixmap;
+    QCPRange                             m_stViewport;
+    bool                                 m_bDragging;
+    double                               m_dDragOffset;
+};
+
+#endif // OVERVIEW_STRIP_H
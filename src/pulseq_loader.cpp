@@ -1,11 +1,21 @@
 #include "pulseq_loader.h"
+#include "repetition_detector.h"
+#include "signature_verifier.h"
+#include "sequence_timeline.h"
+#include "event_polyline.h"
+#include "message_log.h"
+#include "inflate_stream.h"
+#include "parse_cache.h"
+#include "parallel_for.h"
 
-#include <complex>
+#include <atomic>
+#include <cstring>
 #include <qdebug.h>
 
 PulseqLoader::PulseqLoader(QObject *parent)
     : QObject{parent}
     , m_stSeqInfo(SeqInfo())
+    , m_pMemoryLedger(nullptr)
 {
 }
 
@@ -13,46 +23,224 @@ PulseqLoader::PulseqLoader(QObject *parent)
 void PulseqLoader::process()
 {
     emit processingStarted();
+    if (nullptr != m_spPulseqSeq)
+    {
+        // Messages of this load are collected in its own log and printed in one
+        // piece, debug messages are not even formatted
+        MessageLog log;
+        {
+            ScopedMessageSink scopedSink(*m_spPulseqSeq, &log, MSG_LEVEL);
+            Process();
+        }
+        const std::vector<LoggedMessage> vecMessages = log.Take();
+        if (!vecMessages.empty())
+        {
+            QString sMessages;
+            for (const LoggedMessage& message : vecMessages)
+            {
+                sMessages += "\n" + QString::fromStdString(message.text);
+            }
+            if (log.Dropped() > 0) sMessages += QString("\n... %1 more messages").arg(log.Dropped());
+            DEBUG << m_sFilePath << ":" << sMessages;
+        }
+    }
+    emit finished();
+}
 
-    if (!m_spPulseqSeq->load(m_sFilePath.toStdString())) {
-        emit errorOccurred("Load " + m_sFilePath + " failed!");
-        emit finished();
+void PulseqLoader::Process()
+{
+    // A single .seq file is parsed through the verifier, which hashes the signed bytes as they are read
+    // A file parsed ahead of time only needs its events collected
+    const bool bParsed = nullptr != m_spParsed;
+    SignatureVerifier verifier;
+    const bool bStreamed = !bParsed && m_sFilePath.endsWith(".seq") && verifier.Open(m_sFilePath.toStdString());
+
+    // With a previous load at hand only the changed sections are parsed again
+    EventChangeSet changes;
+    std::set<std::string> setChanged;
+    const bool bIncremental = bStreamed && ReloadChangedSections(verifier.Stream(), changes, setChanged);
+    if (bIncremental && setChanged.empty())
+    {
+        emit sectionsReloaded(QStringList(), 0);
         return;
     }
-    int64_t rfNum(0);
+    if (bParsed)
+    {
+        if (nullptr != m_spParsed->sections)
+        {
+            emit sectionsIndexed(m_spParsed->sections);
+        }
+    }
+    else if (!bIncremental)
+    {
+        if (bStreamed)
+        {
+            verifier.Stream().clear();
+            verifier.Stream().seekg(0, std::ios::beg);
+        }
+        // Compressed files are decompressed while they are parsed in a single forward pass
+        const bool bSequential = SequenceInput::IsSequentialPath(m_sFilePath.toStdString());
+        SequenceInput input;
+        bool bLoaded(false);
+        if (bSequential)
+        {
+            bLoaded = input.Load(*m_spPulseqSeq, m_sFilePath.toStdString());
+            if (!input.Warning().empty())
+            {
+                DEBUG << m_sFilePath << ": " << QString::fromStdString(input.Warning());
+            }
+        }
+        else
+        {
+            bLoaded = bStreamed ? m_spPulseqSeq->load(verifier.Stream()) : m_spPulseqSeq->load(m_sFilePath.toStdString());
+        }
+        if (!bLoaded) {
+            const QString sReason = input.Error().empty() ? QString() : ": " + QString::fromStdString(input.Error());
+            emit errorOccurred("Load " + m_sFilePath + " failed" + sReason + "!");
+            return;
+        }
+        std::shared_ptr<SectionIndex> spSections = bStreamed ? IndexSections(verifier.Stream()) : nullptr;
+        if (nullptr != spSections)
+        {
+            emit sectionsIndexed(spSections);
+        }
+    }
     const int shVersion = m_spPulseqSeq->GetVersion();
     emit versionLoaded(shVersion);
 
-    const int lSeqBlockNum = m_spPulseqSeq->GetNumberOfBlocks();
+    std::string sSignatureType = m_spPulseqSeq->getSignatureType().empty() ? verifier.Type() : m_spPulseqSeq->getSignatureType();
+    SignatureStatus signature = bStreamed
+        ? verifier.Verify(m_spPulseqSeq->isSigned(), m_spPulseqSeq->getSignature(), m_spPulseqSeq->getSignatureType())
+        : (m_spPulseqSeq->isSigned() ? kSignatureUnverifiable : kSignatureUnsigned);
+    std::string sComputed = verifier.Computed();
+    if (bParsed)
+    {
+        signature = m_spParsed->signature;
+        sSignatureType = m_spParsed->signatureType;
+        sComputed = m_spParsed->computedHash;
+    }
+    if (signature == kSignatureFailed)
+    {
+        DEBUG << "Signature mismatch, expected " << QString::fromStdString(m_spPulseqSeq->getSignature())
+              << ", computed " << QString::fromStdString(sComputed);
+    }
+    emit signatureChecked(signature, QString::fromStdString(sSignatureType));
+
+    ReportMemory(false);
+
+    const int64_t lSeqBlockNum = m_spPulseqSeq->GetNumberOfBlocks();
     m_vecSeqBlock.resize(lSeqBlockNum);
 
-    uint64_t progress(0.);
-    for (int ushBlockIndex = 0; ushBlockIndex < lSeqBlockNum; ushBlockIndex++)
+    // Blocks decoded ahead of time change hands, if they fitted into the cache
+    std::vector<SeqBlock*> vecParsedBlocks;
+    if (bParsed) vecParsedBlocks.swap(m_spParsed->blocks);
+
+    // Blocks reused from the parse cache or the previous load are handed over
+    // here, the others are set up in order and decoded in parallel below
+    std::vector<int64_t> vecDecode;
+    for (int64_t ushBlockIndex = 0; ushBlockIndex < lSeqBlockNum; ushBlockIndex++)
     {
-        m_vecSeqBlock[ushBlockIndex] = m_spPulseqSeq->GetBlock(ushBlockIndex);
-        if (!m_spPulseqSeq->decodeBlock(m_vecSeqBlock[ushBlockIndex]))
+        SeqBlock* pPrevious = (bIncremental && ushBlockIndex < m_vecPreviousBlocks.size()) ? m_vecPreviousBlocks[ushBlockIndex] : nullptr;
+        if (ushBlockIndex < static_cast<int64_t>(vecParsedBlocks.size()))
         {
-            emit errorOccurred(QString("Decode SeqBlock failed, block index: %1").arg(ushBlockIndex));
-            emit finished();
-            return;
+            m_vecSeqBlock[ushBlockIndex] = vecParsedBlocks[ushBlockIndex];
         }
-        if (m_vecSeqBlock[ushBlockIndex]->isRF())
+        else if (nullptr != pPrevious && !changes.IsBlockChanged(*m_spPulseqSeq, ushBlockIndex, pPrevious))
+        {
+            m_vecSeqBlock[ushBlockIndex] = pPrevious;
+        }
+        else
+        {
+            m_vecSeqBlock[ushBlockIndex] = m_spPulseqSeq->GetBlock(ushBlockIndex);
+            vecDecode.push_back(ushBlockIndex);
+        }
+    }
+
+    // decodeBlock() only reads the sequence. One signal per percent, not per
+    // block, and the lowest failing block is reported once every chunk is over
+    const uint64_t decodedBlocks = vecDecode.size();
+    std::atomic<uint64_t> finishedBlocks(0);
+    std::atomic<uint64_t> progress(0);
+    std::atomic<int64_t> failedBlock(lSeqBlockNum);
+    emit progressUpdated(0);
+    ParallelFor(0, vecDecode.size(), LOADER_DECODE_MIN_BLOCKS, [&](size_t, size_t begin, size_t end) {
+        for (size_t index = begin; index < end; index++)
+        {
+            const int64_t ushBlockIndex = vecDecode[index];
+            if (failedBlock.load() < lSeqBlockNum) return;
+            if (!m_spPulseqSeq->decodeBlock(m_vecSeqBlock[ushBlockIndex]))
+            {
+                int64_t failed = failedBlock.load();
+                while (ushBlockIndex < failed && !failedBlock.compare_exchange_weak(failed, ushBlockIndex)) {}
+                return;
+            }
+            const uint64_t percent = (++finishedBlocks) * 100 / (decodedBlocks + 1);
+            uint64_t previous = progress.load();
+            while (percent > previous)
+            {
+                if (progress.compare_exchange_weak(previous, percent))
+                {
+                    emit progressUpdated(percent);
+                    break;
+                }
+            }
+        }
+    });
+    if (failedBlock.load() < lSeqBlockNum)
+    {
+        ReleaseBlocks();
+        emit errorOccurred(QString("Decode SeqBlock failed, block index: %1").arg(failedBlock.load()));
+        return;
+    }
+    ReportMemory(true);
+
+    if (bIncremental)
+    {
+        QStringList listSections;
+        for (const auto& section : setChanged)
         {
-            rfNum += 1;
+            listSections.append(QString::fromStdString(section));
         }
-        progress = ushBlockIndex * 100 / lSeqBlockNum;
-        emit progressUpdated(progress);
+        DEBUG << "Reloaded " << listSections.join(", ") << ", " << changes.ChangedEventCount() << " events changed, "
+              << decodedBlocks << " of " << lSeqBlockNum << " blocks decoded";
+        emit sectionsReloaded(listSections, decodedBlocks);
+    }
+
+    // Content hashes for comparing sequences, computed in parallel while the blocks are at hand
+    const std::vector<SeqBlock*> vecBlocks(m_vecSeqBlock.begin(), m_vecSeqBlock.end());
+    const BlockHasher hasher(m_spPulseqSeq->GetShapeLibrary());
+    m_stFingerprint = hasher.Fingerprint(vecBlocks, m_spPulseqSeq->GetBlockDurationRaster_us());
+
+    const RepetitionInfo repetition = RepetitionDetector::Detect(m_stFingerprint.blockSignatures);
+    if (repetition.IsPeriodic())
+    {
+        m_stSeqInfo.periodBlocks = repetition.periodBlocks;
+        m_stSeqInfo.repetitions = repetition.repetitions;
+        m_stSeqInfo.periodStartBlock = repetition.firstBlock;
+        m_stSeqInfo.period_us = m_stFingerprint.startTime_us[repetition.firstBlock + repetition.periodBlocks]
+                              - m_stFingerprint.startTime_us[repetition.firstBlock];
+        DEBUG << repetition.repetitions << " repetitions of " << repetition.periodBlocks << " blocks detected!";
     }
 
-    m_stSeqInfo.rfNum = rfNum;
-    m_vecRfLib.reserve(rfNum);
+    // Label state seen by every ADC
+    m_spLabelTable = LabelTable::Evaluate(vecBlocks);
+
+    // Counts, extrema, RMS values and duty cycles in one parallel pass over the blocks
+    m_stSeqInfo.SetStatistics(SequenceStatistics::Compute(vecBlocks, m_spPulseqSeq->GetBlockDurationRaster_us(),
+                                                          m_spPulseqSeq->GetGradientRasterTime_us()));
+    m_vecRfLib.reserve(m_stSeqInfo.rfNum);
     if (!LoadPulseqEvents())
     {
+        ReleaseBlocks();
         emit errorOccurred("LoadPulseqEvents failed!");
-        emit finished();
         return;
     }
 
+    // Activity image of the overview strip, drawn from here on without touching the blocks
+    std::shared_ptr<OverviewImage> spOverview = std::make_shared<OverviewImage>();
+    OverviewDensity::Build(vecBlocks, m_stFingerprint.startTime_us, m_spPulseqSeq->GetGradientRasterTime_us(), OVERVIEW_COLUMNS, *spOverview);
+    emit overviewReady(spOverview);
+
     emit loadingCompleted(m_stSeqInfo,
                           m_vecSeqBlock,
                           m_mapShapeLib,
@@ -61,126 +249,153 @@ void PulseqLoader::process()
                           m_vecGzLib,
                           m_vecGyLib,
                           m_vecGxLib,
-                          m_vecAdcLib
+                          m_vecAdcLib,
+                          m_stFingerprint,
+                          m_spLabelTable
                           );
-    emit finished();
 }
 
-bool PulseqLoader::LoadPulseqEvents()
+bool PulseqLoader::ReloadChangedSections(std::istream& file, EventChangeSet& changes, std::set<std::string>& setChanged)
 {
+    if (nullptr == m_spPreviousSections || m_vecPreviousBlocks.isEmpty()) return false;
 
-    if (m_vecSeqBlock.size() == 0) return true;
-    double dCurrentStartTime_us(0.);
-    for (const auto& pSeqBlock : m_vecSeqBlock)
+    if (!file.good()) return false;
+    m_spPulseqSeq->indexFile(file);
+    std::shared_ptr<SectionIndex> spSections = IndexSections(file);
+    if (nullptr == spSections || !spSections->ChangedSections(*m_spPreviousSections, setChanged))
     {
-        if (pSeqBlock->isRF())
-        {
-            const RFEvent& rfEvent = pSeqBlock->GetRFEvent();
-            const int& ushSamples = pSeqBlock->GetRFLength();
-            const float& fDwell = pSeqBlock->GetRFDwellTime();
-            const double& dDuration_us = ushSamples * fDwell;
-            RfInfo rfInfo(dCurrentStartTime_us+rfEvent.delay, dDuration_us, ushSamples, fDwell, &rfEvent);
-            m_vecRfLib.push_back(rfInfo);
+        DEBUG << "Sections of " << m_sFilePath << " changed, loading the whole file";
+        return false;
+    }
+    if (setChanged.empty()) return true;
 
-            const int& magShapeID = rfEvent.magShape;
-            if (!m_mapShapeLib.contains(magShapeID))
-            {
-                QVector<float> vecAmp(ushSamples, 0.f);
-                const float* fAmp = pSeqBlock->GetRFAmplitudePtr();
-                std::memcpy(vecAmp.data(), fAmp, ushSamples * sizeof(float));
-                m_mapShapeLib.insert(magShapeID, vecAmp);
-            }
+    changes.Snapshot(*m_spPulseqSeq, setChanged);
+    if (!m_spPulseqSeq->reload(file, setChanged))
+    {
+        DEBUG << "Reloading sections failed, loading the whole file";
+        return false;
+    }
+    changes.Compare(*m_spPulseqSeq);
+    emit sectionsIndexed(spSections);
+    return true;
+}
 
-            const int& phaseShapeID = rfEvent.phaseShape;
-            if (!m_mapShapeLib.contains(phaseShapeID))
-            {
-                QVector<float> vecPhase(ushSamples, 0.f);
-                const float* fPhase = pSeqBlock->GetRFPhasePtr();
-                std::memcpy(vecPhase.data(), fPhase, ushSamples * sizeof(float));
-                m_mapShapeLib.insert(phaseShapeID, vecPhase);
-            }
+void PulseqLoader::ReleaseBlocks()
+{
+    // Blocks reused from the previous load are still owned by its caller
+    for (int64_t index = 0; index < m_vecSeqBlock.size(); index++)
+    {
+        const bool bReused = index < m_vecPreviousBlocks.size() && m_vecSeqBlock[index] == m_vecPreviousBlocks[index];
+        if (!bReused) delete m_vecSeqBlock[index];
+    }
+    m_vecSeqBlock.clear();
+}
 
-            QPair<int, int> magAbsShapeID(magShapeID, phaseShapeID);
-            if (!m_mapRfMagShapeLib.contains(magAbsShapeID))
-            {
-                double sampleTime = rfInfo.startAbsTime_us;
-                const QVector<float>& vecAmp = m_mapShapeLib[rfEvent.magShape];
-                const QVector<float>& vecPhase = m_mapShapeLib[rfEvent.phaseShape];
-                QVector<double> vecMagnitudes(ushSamples+2, 0.);
-
-                vecMagnitudes[0] = 0;
-                double signal(0.);
-                for(uint32_t index = 0; index < ushSamples; index++)
-                {
-                    const float& amp = vecAmp[index];
-                    const float& phase = vecPhase[index];
-                    signal = std::abs(std::polar(amp, phase));
-                    vecMagnitudes[index+1] = signal;
-                    sampleTime += rfInfo.dwell;
-                }
-                vecMagnitudes[ushSamples+1] = 0;
-                m_mapRfMagShapeLib.insert(magAbsShapeID, vecMagnitudes);
-            }
-        }
+void PulseqLoader::ReportMemory(const bool& bDecoded)
+{
+    if (nullptr == m_pMemoryLedger) return;
+    if (!bDecoded)
+    {
+        m_pMemoryLedger->Report("Parser: shape library", MemoryEstimator::ShapeLibrary(*m_spPulseqSeq));
+        m_pMemoryLedger->Report("Parser: event libraries", MemoryEstimator::EventLibraries(*m_spPulseqSeq));
+        m_pMemoryLedger->Report("Parser: block table", MemoryEstimator::BlockTable(*m_spPulseqSeq));
+        return;
+    }
+    m_pMemoryLedger->Report("Decoded blocks", MemoryEstimator::DecodedBlocks(std::vector<SeqBlock*>(m_vecSeqBlock.begin(), m_vecSeqBlock.end())));
+}
 
-        GradAxis gradAxis;
+std::shared_ptr<SectionIndex> PulseqLoader::IndexSections(std::istream& stream)
+{
+    if (!stream.good()) return nullptr;
+    std::shared_ptr<SectionIndex> spSections = std::make_shared<SectionIndex>();
+    if (!spSections->Build(stream, m_spPulseqSeq->GetFileIndex(), m_spPulseqSeq->GetFileSections())) return nullptr;
+    return spSections;
+}
 
-        if (pSeqBlock->isTrapGradient(gradAxis = kGZ))
+bool PulseqLoader::LoadPulseqEvents()
+{
+
+    if (m_vecSeqBlock.size() == 0) return true;
+    SequenceTimeline timeline;
+    timeline.Build(std::vector<SeqBlock*>(m_vecSeqBlock.begin(), m_vecSeqBlock.end()), m_spPulseqSeq->GetBlockDurationRaster_us());
+
+    for (const TimelineRf& rf : timeline.rf)
+    {
+        SeqBlock* pSeqBlock = rf.block;
+        const RFEvent& rfEvent = pSeqBlock->GetRFEvent();
+        const uint64_t lSamples = rf.samples;
+        RfInfo rfInfo(rf.startAbsTime_us, rf.duration_us, lSamples, rf.dwell_us, &rfEvent);
+        m_vecRfLib.push_back(rfInfo);
+
+        const int& magShapeID = rfEvent.magShape;
+        if (!m_mapShapeLib.contains(magShapeID))
         {
-            const GradEvent& gradEvent = pSeqBlock->GetGradEvent(gradAxis);
-            const float& amp = gradEvent.amplitude * 1e-3;
-            m_stSeqInfo.gzMaxAmp_Hz_m = std::max(m_stSeqInfo.gzMaxAmp_Hz_m, (double)amp);
-            m_stSeqInfo.gzMinAmp_Hz_m = std::min(m_stSeqInfo.gzMinAmp_Hz_m, (double)amp);
-            int duration_us = gradEvent.rampUpTime + gradEvent.flatTime + gradEvent.rampDownTime;
-            double absStartTime_us = dCurrentStartTime_us + gradEvent.delay;
-            QVector<double> time{absStartTime_us, absStartTime_us+gradEvent.rampUpTime, absStartTime_us+gradEvent.rampUpTime+gradEvent.flatTime, absStartTime_us+duration_us};
-            QVector<double> amplitudes{0, amp, amp, 0};
-            GradTrapInfo gradTrapInfo(absStartTime_us, duration_us, time, amplitudes, &gradEvent);
-            m_vecGzLib.push_back(gradTrapInfo);
+            QVector<float> vecAmp(lSamples, 0.f);
+            const float* fAmp = pSeqBlock->GetRFAmplitudePtr();
+            std::memcpy(vecAmp.data(), fAmp, lSamples * sizeof(float));
+            m_mapShapeLib.insert(magShapeID, vecAmp);
         }
 
-        if (pSeqBlock->isTrapGradient(gradAxis = kGY))
+        const int& phaseShapeID = rfEvent.phaseShape;
+        if (!m_mapShapeLib.contains(phaseShapeID))
         {
-            const GradEvent& gradEvent = pSeqBlock->GetGradEvent(gradAxis);
-            const float& amp = gradEvent.amplitude * 1e-3;
-            m_stSeqInfo.gyMaxAmp_Hz_m = std::max(m_stSeqInfo.gyMaxAmp_Hz_m, (double)amp);
-            m_stSeqInfo.gyMinAmp_Hz_m = std::min(m_stSeqInfo.gyMinAmp_Hz_m, (double)amp);
-            int duration_us = gradEvent.rampUpTime + gradEvent.flatTime + gradEvent.rampDownTime;
-            double absStartTime_us = dCurrentStartTime_us + gradEvent.delay;
-            QVector<double> time{absStartTime_us, absStartTime_us+gradEvent.rampUpTime, absStartTime_us+gradEvent.rampUpTime+gradEvent.flatTime, absStartTime_us+duration_us};
-            QVector<double> amplitudes{0, amp, amp, 0};
-            GradTrapInfo gradTrapInfo(absStartTime_us, duration_us, time, amplitudes, &gradEvent);
-            m_vecGyLib.push_back(gradTrapInfo);
+            QVector<float> vecPhase(lSamples, 0.f);
+            const float* fPhase = pSeqBlock->GetRFPhasePtr();
+            std::memcpy(vecPhase.data(), fPhase, lSamples * sizeof(float));
+            m_mapShapeLib.insert(phaseShapeID, vecPhase);
         }
 
-        if (pSeqBlock->isTrapGradient(gradAxis = kGX))
+        QPair<int, int> magAbsShapeID(magShapeID, phaseShapeID);
+        if (!m_mapRfMagShapeLib.contains(magAbsShapeID))
         {
-            const GradEvent& gradEvent = pSeqBlock->GetGradEvent(gradAxis);
-            const float& amp = gradEvent.amplitude * 1e-3;
-            m_stSeqInfo.gxMaxAmp_Hz_m = std::max(m_stSeqInfo.gxMaxAmp_Hz_m, (double)amp);
-            m_stSeqInfo.gxMinAmp_Hz_m = std::min(m_stSeqInfo.gxMinAmp_Hz_m, (double)amp);
-            int duration_us = gradEvent.rampUpTime + gradEvent.flatTime + gradEvent.rampDownTime;
-            double absStartTime_us = dCurrentStartTime_us + gradEvent.delay;
-            QVector<double> time{absStartTime_us, absStartTime_us+gradEvent.rampUpTime, absStartTime_us+gradEvent.rampUpTime+gradEvent.flatTime, absStartTime_us+duration_us};
-            QVector<double> amplitudes{0, amp, amp, 0};
-            GradTrapInfo gradTrapInfo(absStartTime_us, duration_us, time, amplitudes, &gradEvent);
-            m_vecGxLib.push_back(gradTrapInfo);
+            const QVector<float>& vecAmp = m_mapShapeLib[rfEvent.magShape];
+            const QVector<float>& vecPhase = m_mapShapeLib[rfEvent.phaseShape];
+            QVector<double> vecMagnitudes(lSamples+2, 0.);
+            EventPolyline::RfMagnitudes(vecAmp.constData(), vecPhase.constData(), lSamples, vecMagnitudes.data());
+            m_mapRfMagShapeLib.insert(magAbsShapeID, vecMagnitudes);
         }
+    }
 
-        if (pSeqBlock->isADC())
+    struct GradTarget
+    {
+        GradAxis axis;
+        QVector<GradTrapInfo>* lib;
+    };
+    const GradTarget targets[] = {
+        {kGZ, &m_vecGzLib},
+        {kGY, &m_vecGyLib},
+        {kGX, &m_vecGxLib},
+    };
+    for (const GradTarget& target : targets)
+    {
+        target.lib->reserve(timeline.trap[target.axis].size());
+        for (const TimelineTrap& trap : timeline.trap[target.axis])
         {
-            const ADCEvent& adcEvent = pSeqBlock->GetADCEvent();
-            const double duration_us  = adcEvent.dwellTime * adcEvent.numSamples * 1e-3;
-            double absStartTime_us = dCurrentStartTime_us + adcEvent.delay;
-            QVector<double> time{absStartTime_us, absStartTime_us, absStartTime_us+duration_us, absStartTime_us+duration_us};
-            QVector<double> amplitudes{0, 1, 1, 0};
-            AdcInfo adcInfo(absStartTime_us, duration_us, adcEvent.numSamples, adcEvent.dwellTime, time, amplitudes, &adcEvent);
-            m_vecAdcLib.push_back(adcInfo);
+            const GradEvent& gradEvent = *trap.event;
+            const float& amp = gradEvent.amplitude * 1e-3;
+            const int64_t duration_us = trap.rampUpTime_us + trap.flatTime_us + trap.rampDownTime_us;
+            QVector<double> time(4);
+            QVector<double> amplitudes(4);
+            EventPolyline::Trapezoid(trap, amp, time.data(), amplitudes.data());
+            GradTrapInfo gradTrapInfo(trap.startAbsTime_us, duration_us, time, amplitudes, &gradEvent);
+            target.lib->push_back(gradTrapInfo);
         }
+    }
 
-        dCurrentStartTime_us += pSeqBlock->GetDuration();
-        m_stSeqInfo.totalDuration_us += pSeqBlock->GetDuration();
+    m_vecAdcLib.reserve(timeline.adc.size());
+    for (const TimelineAdc& adc : timeline.adc)
+    {
+        const ADCEvent& adcEvent = *adc.event;
+        const double& absStartTime_us = adc.startAbsTime_us;
+        const double& duration_us = adc.duration_us;
+        QVector<double> time{absStartTime_us, absStartTime_us, absStartTime_us+duration_us, absStartTime_us+duration_us};
+        QVector<double> amplitudes{0, 1, 1, 0};
+        AdcInfo adcInfo(absStartTime_us, duration_us, adcEvent.numSamples, adcEvent.dwellTime, time, amplitudes, &adcEvent);
+        m_vecAdcLib.push_back(adcInfo);
     }
+
+    m_stSeqInfo.totalDuration_ru = timeline.totalDuration_ru;
+    m_stSeqInfo.totalDuration_us = timeline.totalDuration_us;
     DEBUG << m_vecRfLib.size() << " RF events detetced!";
     DEBUG << m_vecGzLib.size() << " GZ events detetced!";
     DEBUG << m_vecGyLib.size() << " GY events detetced!";
@@ -1,11 +1,20 @@
 #ifndef PULSEQ_LOADER_H
 #define PULSEQ_LOADER_H
 
+#include <algorithm>
 #include <QObject>
 #include <QMap>
 #include <ExternalSequence.h>
+#include "sequence_diff.h"
+#include "label_table.h"
+#include "incremental_reload.h"
+#include "overview_density.h"
+#include "parse_cache.h"
+#include "sequence_statistics.h"
+#include "memory_accounting.h"
 
 #define DEBUG qDebug().nospace().noquote()
+#define LOADER_DECODE_MIN_BLOCKS    (256)
 typedef QMap<QPair<int, int>, QVector<double>> RfTimeWaveShapeMap;
 
 enum GradAxis
@@ -17,6 +26,7 @@ enum GradAxis
 
 struct SeqInfo
 {
+    int64_t totalDuration_ru;   // exact, in block duration raster units
     double totalDuration_us;
     // RF
     uint64_t rfNum;
@@ -38,8 +48,17 @@ struct SeqInfo
     double gxMaxAmp_Hz_m;
     double gxMinAmp_Hz_m;
 
+    // Repetitions
+    uint64_t periodBlocks;
+    uint64_t repetitions;
+    uint64_t periodStartBlock;
+    double period_us;
+
+    SequenceStatistics statistics;
+
     SeqInfo()
-        : totalDuration_us(0.)
+        : totalDuration_ru(0)
+        , totalDuration_us(0.)
         , rfNum(0)
         , rfMaxAmp_Hz(0.)
         , rfMinAmp_Hz(0.)
@@ -52,10 +71,15 @@ struct SeqInfo
         , gxNum(0)
         , gxMaxAmp_Hz_m(0.)
         , gxMinAmp_Hz_m(0.)
+        , periodBlocks(0)
+        , repetitions(0)
+        , periodStartBlock(0)
+        , period_us(0.)
     {}
 
     void reset()
     {
+        totalDuration_ru = 0;
         totalDuration_us = 0;
 
         // RF
@@ -74,6 +98,32 @@ struct SeqInfo
         gxNum = 0;
         gxMaxAmp_Hz_m = 0.;
         gxMinAmp_Hz_m = 0.;
+        // Repetitions
+        periodBlocks = 0;
+        repetitions = 0;
+        periodStartBlock = 0;
+        period_us = 0.;
+        statistics = SequenceStatistics();
+    }
+
+    // Keeps the statistics and derives the counts and plot ranges, gradients in kHz/m like the
+    // plotted waveforms. Ranges include zero, the baseline of every channel.
+    void SetStatistics(const SequenceStatistics& stats)
+    {
+        statistics = stats;
+        rfNum = stats.rfCount;
+        rfMaxAmp_Hz = stats.rfAmplitude_Hz.IsEmpty() ? 0. : stats.rfAmplitude_Hz.max;
+        rfMinAmp_Hz = 0.;
+        uint64_t* counts[NUM_GRADS] = {&gxNum, &gyNum, &gzNum};
+        double* maxAmps[NUM_GRADS] = {&gxMaxAmp_Hz_m, &gyMaxAmp_Hz_m, &gzMaxAmp_Hz_m};
+        double* minAmps[NUM_GRADS] = {&gxMinAmp_Hz_m, &gyMinAmp_Hz_m, &gzMinAmp_Hz_m};
+        for (int channel = 0; channel < NUM_GRADS; channel++)
+        {
+            const GradientStatistics& grad = stats.grad[channel];
+            *counts[channel] = grad.count;
+            *maxAmps[channel] = grad.amplitude_Hz_m.IsEmpty() ? 0. : std::max(0., grad.amplitude_Hz_m.max * 1e-3);
+            *minAmps[channel] = grad.amplitude_Hz_m.IsEmpty() ? 0. : std::min(0., grad.amplitude_Hz_m.min * 1e-3);
+        }
     }
 };
 
@@ -81,19 +131,19 @@ struct RfInfo
 {
     double startAbsTime_us;
     double duration_us;
-    uint16_t samples;
+    uint64_t samples;
     float dwell;
     const RFEvent* event;
 
     RfInfo(
         const double& dStartAbsTime_us,
         const double& dDuration_us,
-        const uint16_t& ushSamples,
+        const uint64_t& lSamples,
         const float& fDwell,
         const RFEvent* rfEvent)
         : startAbsTime_us(dStartAbsTime_us)
         , duration_us(dDuration_us)
-        , samples(ushSamples)
+        , samples(lSamples)
         , dwell(fDwell)
         , event(rfEvent)
     {}
@@ -102,19 +152,19 @@ struct RfInfo
 struct GradTrapInfo
 {
     double startAbsTime_us;
-    long duration_us;
+    int64_t duration_us;
     QVector<double> time;
     QVector<double> amplitude;
     const GradEvent* event;
 
     GradTrapInfo(
         const double& dStartAbsTime_us,
-        const double& dDuration_us,
+        const int64_t& lDuration_us,
         const QVector<double>& vecTime,
         const QVector<double>& vecAmplitude,
         const GradEvent* gradEvent)
         : startAbsTime_us(dStartAbsTime_us)
-        , duration_us(dDuration_us)
+        , duration_us(lDuration_us)
         , time(vecTime)
         , amplitude(vecAmplitude)
         , event(gradEvent)
@@ -126,7 +176,7 @@ struct AdcInfo
 {
     double startAbsTime_us;
     double duration_us;
-    int samples;
+    uint64_t samples;
     int dwell_ns;
     QVector<double> time;
     QVector<double> amplitude;
@@ -135,14 +185,14 @@ struct AdcInfo
     AdcInfo(
         const double& dStartAbsTime_us,
         const double& dDuration_us,
-        const int& ushSamples,
+        const uint64_t& lSamples,
         const int& fDwell,
         const QVector<double>& vecTime,
         const QVector<double>& vecAmplitude,
         const ADCEvent* rfEvent)
         : startAbsTime_us(dStartAbsTime_us)
         , duration_us(dDuration_us)
-        , samples(ushSamples)
+        , samples(lSamples)
         , dwell_ns(fDwell)
         , time(vecTime)
         , amplitude(vecAmplitude)
@@ -157,6 +207,19 @@ public:
     explicit PulseqLoader(QObject *parent = nullptr);
     inline void SetPulseqFile(const QString& filePath) { m_sFilePath = filePath; }
     inline void SetSequence(std::shared_ptr<ExternalSequence>& seq) { m_spPulseqSeq = seq; }
+    // Blocks and section hashes of the previous load of the same file. Only changed sections are
+    // parsed again and unchanged blocks are reused, ownership of the blocks stays with the caller.
+    inline void SetPreviousLoad(const QVector<SeqBlock*>& blocks, const std::shared_ptr<SectionIndex>& sections)
+    {
+        m_vecPreviousBlocks = blocks;
+        m_spPreviousSections = sections;
+    }
+    // The file parsed ahead of time, its sequence has to be the one set with SetSequence().
+    // Its decoded blocks are taken over and owned by the caller of the load from then on.
+    inline void SetParsed(const std::shared_ptr<ParsedSequence>& parsed) { m_spParsed = parsed; }
+    // Parser and decoder sizes are reported as the load goes, so peaks include the load itself.
+    // The ledger has to outlive the load.
+    inline void SetMemoryLedger(MemoryLedger* pLedger) { m_pMemoryLedger = pLedger; }
 
 public slots:
     void process();
@@ -166,6 +229,13 @@ signals:
     void errorOccurred(const QString& error);
     void progressUpdated(uint64_t progress);
     void versionLoaded(int version);
+    // status is a SignatureStatus
+    void signatureChecked(int status, const QString& type);
+    void sectionsIndexed(const std::shared_ptr<SectionIndex>& sections);
+    // Incremental reload only, no loadingCompleted follows if no section changed
+    void sectionsReloaded(const QStringList& sections, uint64_t decodedBlocks);
+    // Emitted right before loadingCompleted
+    void overviewReady(const std::shared_ptr<OverviewImage>& overview);
     void loadingCompleted(const SeqInfo& seqInfo,
                           const QVector<SeqBlock*>& blocks,
                           const QMap<int, QVector<float>>& shapeLib,
@@ -174,7 +244,9 @@ signals:
                           QVector<GradTrapInfo> gzLib,
                           QVector<GradTrapInfo> gyLib,
                           QVector<GradTrapInfo> gxLib,
-                          QVector<AdcInfo>      adcLib
+                          QVector<AdcInfo>      adcLib,
+                          const SequenceFingerprint& fingerprint,
+                          const std::shared_ptr<LabelTable>& labelTable
                           );
     void finished();
 
@@ -190,9 +262,22 @@ private:
     QVector<GradTrapInfo>                       m_vecGyLib;
     QVector<GradTrapInfo>                       m_vecGxLib;
     QVector<AdcInfo>                            m_vecAdcLib;
+    SequenceFingerprint                         m_stFingerprint;
+    std::shared_ptr<LabelTable>                 m_spLabelTable;
+    QVector<SeqBlock*>                          m_vecPreviousBlocks;
+    std::shared_ptr<SectionIndex>               m_spPreviousSections;
+    std::shared_ptr<ParsedSequence>             m_spParsed;
+    MemoryLedger*                               m_pMemoryLedger;
 
 private:
+    void Process();
     bool LoadPulseqEvents();
+    bool ReloadChangedSections(std::istream& file, EventChangeSet& changes, std::set<std::string>& setChanged);
+    std::shared_ptr<SectionIndex> IndexSections(std::istream& stream);
+    // Frees the blocks this load decoded or took over from the parse cache, if it fails
+    void ReleaseBlocks();
+    // Same components as MainWindow::UpdateMemoryUsage(), the blocks once they are decoded
+    void ReportMemory(const bool& bDecoded);
 };
 
 #endif // PULSEQ_LOADER_H
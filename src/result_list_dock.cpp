@@ -0,0 +1,62 @@
+#include "result_list_dock.h"
+
+#include <QVBoxLayout>
+#include <QHeaderView>
+
+ResultListDock::ResultListDock(const QString& title, QWidget *parent)
+    : QDockWidget(title, parent)
+{
+    setObjectName(title);
+    QWidget* pContent = new QWidget(this);
+    QVBoxLayout* pLayout = new QVBoxLayout(pContent);
+    pLayout->setContentsMargins(4, 4, 4, 4);
+
+    m_pSummaryLabel = new QLabel(pContent);
+    pLayout->addWidget(m_pSummaryLabel);
+
+    m_pTreeWidget = new QTreeWidget(pContent);
+    m_pTreeWidget->setRootIsDecorated(false);
+    m_pTreeWidget->setUniformRowHeights(true);
+    m_pTreeWidget->setAlternatingRowColors(true);
+    m_pTreeWidget->header()->setStretchLastSection(true);
+    pLayout->addWidget(m_pTreeWidget);
+
+    setWidget(pContent);
+
+    connect(m_pTreeWidget, &QTreeWidget::itemActivated, this, &ResultListDock::onItemActivated);
+}
+
+void ResultListDock::SetHeaders(const QStringList& headers)
+{
+    m_pTreeWidget->setColumnCount(headers.size());
+    m_pTreeWidget->setHeaderLabels(headers);
+}
+
+void ResultListDock::SetSummary(const QString& summary)
+{
+    m_pSummaryLabel->setText(summary);
+}
+
+void ResultListDock::Clear()
+{
+    m_pTreeWidget->clear();
+    m_pSummaryLabel->clear();
+}
+
+bool ResultListDock::AddItem(const QStringList& columns, const double& dStart_us, const double& dEnd_us)
+{
+    if (m_pTreeWidget->topLevelItemCount() >= MAX_LISTED_RESULTS) return false;
+
+    QTreeWidgetItem* pItem = new QTreeWidgetItem(columns);
+    pItem->setData(0, Qt::UserRole, dStart_us);
+    pItem->setData(0, Qt::UserRole + 1, dEnd_us);
+    m_pTreeWidget->addTopLevelItem(pItem);
+    return true;
+}
+
+void ResultListDock::onItemActivated(QTreeWidgetItem* item, int column)
+{
+    Q_UNUSED(column);
+    if (!item) return;
+    emit rangeRequested(item->data(0, Qt::UserRole).toDouble(), item->data(0, Qt::UserRole + 1).toDouble());
+}
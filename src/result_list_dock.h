@@ -0,0 +1,34 @@
+#ifndef RESULT_LIST_DOCK_H
+#define RESULT_LIST_DOCK_H
+
+#include <QDockWidget>
+#include <QLabel>
+#include <QTreeWidget>
+
+#define MAX_LISTED_RESULTS           (10000)
+
+// Dockable list of analysis results. Every row carries a time range; activating
+// a row asks the main window to show that range.
+class ResultListDock : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit ResultListDock(const QString& title, QWidget *parent = nullptr);
+
+    void SetHeaders(const QStringList& headers);
+    void SetSummary(const QString& summary);
+    void Clear();
+    bool AddItem(const QStringList& columns, const double& dStart_us, const double& dEnd_us);
+
+signals:
+    void rangeRequested(double start_us, double end_us);
+
+private slots:
+    void onItemActivated(QTreeWidgetItem* item, int column);
+
+private:
+    QLabel                               *m_pSummaryLabel;
+    QTreeWidget                          *m_pTreeWidget;
+};
+
+#endif // RESULT_LIST_DOCK_H
@@ -0,0 +1,93 @@
+#include "slice_profile_dialog.h"
+
+#include <QDialogButtonBox>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+#define SLICE_PROFILE_MAX_ISOCHROMATS    (1000000)
+
+void SliceProfileSettings::Isochromats(std::vector<double>& vecPosition_m, std::vector<double>& vecOffResonance_Hz, std::vector<double>& vecAxis) const
+{
+    const size_t count = static_cast<size_t>(std::max(1, isochromats));
+    vecPosition_m.assign(count, bSweepFrequency ? fixed * 1e-3 : 0.);
+    vecOffResonance_Hz.assign(count, bSweepFrequency ? 0. : fixed);
+    vecAxis.resize(count);
+    for (size_t index = 0; index < count; index++)
+    {
+        vecAxis[index] = count > 1 ? from + (to - from) * index / (count - 1) : 0.5 * (from + to);
+        if (bSweepFrequency)
+        {
+            vecOffResonance_Hz[index] = vecAxis[index];
+        }
+        else
+        {
+            vecPosition_m[index] = vecAxis[index] * 1e-3;
+        }
+    }
+}
+
+SliceProfileDialog::SliceProfileDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Slice Profile");
+    QVBoxLayout* pLayout = new QVBoxLayout(this);
+    m_pFormLayout = new QFormLayout;
+    pLayout->addLayout(m_pFormLayout);
+
+    m_pSweepComboBox = new QComboBox(this);
+    m_pSweepComboBox->addItems({"Position along GZ", "Off-resonance"});
+    m_pFormLayout->addRow("Sweep", m_pSweepComboBox);
+
+    for (QDoubleSpinBox** ppSpinBox : {&m_pFromSpinBox, &m_pToSpinBox, &m_pFixedSpinBox})
+    {
+        *ppSpinBox = new QDoubleSpinBox(this);
+        (*ppSpinBox)->setDecimals(2);
+        (*ppSpinBox)->setRange(-1e6, 1e6);
+    }
+    m_pCountSpinBox = new QSpinBox(this);
+    m_pCountSpinBox->setRange(1, SLICE_PROFILE_MAX_ISOCHROMATS);
+    m_pFormLayout->addRow("From", m_pFromSpinBox);
+    m_pFormLayout->addRow("To", m_pToSpinBox);
+    m_pFormLayout->addRow("Isochromats", m_pCountSpinBox);
+    m_pFixedLabel = new QLabel(this);
+    m_pFormLayout->addRow(m_pFixedLabel, m_pFixedSpinBox);
+    connect(m_pSweepComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &SliceProfileDialog::UpdateUnits);
+
+    QDialogButtonBox* pButtonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(pButtonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(pButtonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    pLayout->addWidget(pButtonBox);
+
+    SetSettings(SliceProfileSettings());
+}
+
+void SliceProfileDialog::SetSettings(const SliceProfileSettings& settings)
+{
+    m_pSweepComboBox->setCurrentIndex(settings.bSweepFrequency ? 1 : 0);
+    m_pFromSpinBox->setValue(settings.from);
+    m_pToSpinBox->setValue(settings.to);
+    m_pCountSpinBox->setValue(settings.isochromats);
+    m_pFixedSpinBox->setValue(settings.fixed);
+    UpdateUnits();
+}
+
+SliceProfileSettings SliceProfileDialog::GetSettings() const
+{
+    SliceProfileSettings settings;
+    settings.bSweepFrequency = m_pSweepComboBox->currentIndex() == 1;
+    settings.from = m_pFromSpinBox->value();
+    settings.to = m_pToSpinBox->value();
+    settings.isochromats = m_pCountSpinBox->value();
+    settings.fixed = m_pFixedSpinBox->value();
+    return settings;
+}
+
+void SliceProfileDialog::UpdateUnits()
+{
+    const bool bSweepFrequency = m_pSweepComboBox->currentIndex() == 1;
+    m_pFromSpinBox->setSuffix(bSweepFrequency ? " Hz" : " mm");
+    m_pToSpinBox->setSuffix(bSweepFrequency ? " Hz" : " mm");
+    m_pFixedSpinBox->setSuffix(bSweepFrequency ? " mm" : " Hz");
+    m_pFixedLabel->setText(bSweepFrequency ? "Position" : "Off-resonance");
+}
@@ -0,0 +1,57 @@
+#ifndef SLICE_PROFILE_DIALOG_H
+#define SLICE_PROFILE_DIALOG_H
+
+#include <QComboBox>
+#include <QDialog>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QLabel>
+#include <QSpinBox>
+
+#include <vector>
+
+// Isochromats of a slice profile, swept either along GZ or in off-resonance
+// with the other one held fixed
+struct SliceProfileSettings
+{
+    bool bSweepFrequency;
+    double from;                // mm or Hz
+    double to;
+    int isochromats;
+    double fixed;               // Hz or mm
+
+    SliceProfileSettings()
+        : bSweepFrequency(false)
+        , from(-20.)
+        , to(20.)
+        , isochromats(2000)
+        , fixed(0.)
+    {}
+
+    // Positions in m and off-resonances in Hz for BlochSimulator, plus the
+    // swept value of every isochromat for the plot axis
+    void Isochromats(std::vector<double>& vecPosition_m, std::vector<double>& vecOffResonance_Hz, std::vector<double>& vecAxis) const;
+};
+
+class SliceProfileDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit SliceProfileDialog(QWidget *parent = nullptr);
+
+    void SetSettings(const SliceProfileSettings& settings);
+    SliceProfileSettings GetSettings() const;
+
+private:
+    void UpdateUnits();
+
+    QFormLayout                          *m_pFormLayout;
+    QComboBox                            *m_pSweepComboBox;
+    QDoubleSpinBox                       *m_pFromSpinBox;
+    QDoubleSpinBox                       *m_pToSpinBox;
+    QSpinBox                             *m_pCountSpinBox;
+    QLabel                               *m_pFixedLabel;
+    QDoubleSpinBox                       *m_pFixedSpinBox;
+};
+
+#endif // SLICE_PROFILE_DIALOG_H
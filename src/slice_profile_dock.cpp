@@ -0,0 +1,53 @@
+#include "slice_profile_dock.h"
+
+#include <cmath>
+
+SliceProfileDock::SliceProfileDock(const QString& title, QWidget *parent)
+    : QDockWidget(title, parent)
+{
+    setObjectName(title);
+    m_pPlot = new QCustomPlot(this);
+    m_pPlot->setMinimumHeight(200);
+    m_pPlot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+    m_pPlot->axisRect()->setRangeDrag(Qt::Horizontal);
+    m_pPlot->axisRect()->setRangeZoom(Qt::Horizontal);
+    m_pPlot->yAxis->setLabel("Magnetization (M0)");
+    m_pPlot->legend->setVisible(true);
+    setWidget(m_pPlot);
+}
+
+void SliceProfileDock::SetProfile(const BlochProfile& profile, const std::vector<double>& vecAxis, const QString& sAxisLabel)
+{
+    Clear();
+    const size_t count = std::min(vecAxis.size(), profile.mz.size());
+    QVector<double> vecKeys(count), vecMz(count), vecMxy(count);
+    for (size_t index = 0; index < count; index++)
+    {
+        vecKeys[index] = vecAxis[index];
+        vecMz[index] = profile.mz[index];
+        vecMxy[index] = std::hypot(profile.mx[index], profile.my[index]);
+    }
+
+    QCPGraph* pMzGraph = m_pPlot->addGraph();
+    pMzGraph->setName("Mz");
+    pMzGraph->setPen(QPen(QColor(40, 80, 200), 1));
+    pMzGraph->setData(vecKeys, vecMz, true);
+    QCPGraph* pMxyGraph = m_pPlot->addGraph();
+    pMxyGraph->setName("|Mxy|");
+    pMxyGraph->setPen(QPen(QColor(200, 40, 40), 1));
+    pMxyGraph->setData(vecKeys, vecMxy, true);
+
+    m_pPlot->xAxis->setLabel(sAxisLabel);
+    if (count > 0)
+    {
+        m_pPlot->xAxis->setRange(vecKeys.first(), vecKeys.last());
+    }
+    m_pPlot->yAxis->setRange(-1.05, 1.05);
+    m_pPlot->replot();
+}
+
+void SliceProfileDock::Clear()
+{
+    m_pPlot->clearGraphs();
+    m_pPlot->replot();
+}
@@ -0,0 +1,24 @@
+#ifndef SLICE_PROFILE_DOCK_H
+#define SLICE_PROFILE_DOCK_H
+
+#include <QDockWidget>
+#include <qcustomplot.h>
+
+#include "bloch_simulator.h"
+
+// Dockable plot of a simulated slice profile, Mz and |Mxy| over the swept
+// position or off-resonance.
+class SliceProfileDock : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit SliceProfileDock(const QString& title, QWidget *parent = nullptr);
+
+    void SetProfile(const BlochProfile& profile, const std::vector<double>& vecAxis, const QString& sAxisLabel);
+    void Clear();
+
+private:
+    QCustomPlot                          *m_pPlot;
+};
+
+#endif // SLICE_PROFILE_DOCK_H
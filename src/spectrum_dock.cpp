@@ -0,0 +1,88 @@
+#include "spectrum_dock.h"
+#include "mr_constants.h"
+
+#include <cmath>
+#include <limits>
+
+SpectrumDock::SpectrumDock(const QString& title, QWidget *parent)
+    : QDockWidget(title, parent)
+{
+    setObjectName(title);
+    m_pPlot = new QCustomPlot(this);
+    m_pPlot->setMinimumHeight(200);
+    m_pPlot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+    m_pPlot->axisRect()->setRangeDrag(Qt::Horizontal);
+    m_pPlot->axisRect()->setRangeZoom(Qt::Horizontal);
+    m_pPlot->xAxis->setLabel("Frequency (Hz)");
+    m_pPlot->yAxis->setLabel("PSD ((mT/m)^2/Hz)");
+    m_pPlot->yAxis->setScaleType(QCPAxis::stLogarithmic);
+    m_pPlot->yAxis->setTicker(QSharedPointer<QCPAxisTickerLog>(new QCPAxisTickerLog));
+    m_pPlot->yAxis->setNumberFormat("eb");
+    m_pPlot->yAxis->setNumberPrecision(0);
+    m_pPlot->legend->setVisible(true);
+    setWidget(m_pPlot);
+}
+
+void SpectrumDock::SetSpectrum(const GradientSpectrum& spectrum, const std::vector<ForbiddenBand>& bands)
+{
+    static const QList<QColor> listAxisColors{QColor(200, 40, 40), QColor(30, 150, 90), QColor(40, 80, 200)};
+    static const QStringList listAxisNames{"GX", "GY", "GZ"};
+
+    Clear();
+    // Hz/m to mT/m, squared for the power density
+    const double scale = std::pow(1e3 / GAMMA_HZ_T, 2);
+    double maxPsd(0.);
+    double minPsd(std::numeric_limits<double>::max());
+    for (int channel = 0; channel < NUM_GRADS; channel++)
+    {
+        const std::vector<double>& vecPsd = spectrum.psd[channel];
+        QVector<double> vecFrequency, vecPower;
+        vecFrequency.reserve(vecPsd.size());
+        vecPower.reserve(vecPsd.size());
+        // The DC bin is left out, the segments are detrended
+        for (size_t k = 1; k < vecPsd.size(); k++)
+        {
+            const double power = vecPsd[k] * scale;
+            if (power <= 0.) continue;
+            vecFrequency.append(k * spectrum.frequencyStep_Hz);
+            vecPower.append(power);
+            maxPsd = std::max(maxPsd, power);
+            minPsd = std::min(minPsd, power);
+        }
+        QCPGraph* pGraph = m_pPlot->addGraph();
+        pGraph->setName(listAxisNames[channel]);
+        pGraph->setPen(QPen(listAxisColors[channel], 1));
+        pGraph->setData(vecFrequency, vecPower, true);
+    }
+
+    for (const ForbiddenBand& band : bands)
+    {
+        QCPItemRect* pBandRect = new QCPItemRect(m_pPlot);
+        for (QCPItemPosition* pPosition : {pBandRect->topLeft, pBandRect->bottomRight})
+        {
+            pPosition->setTypeX(QCPItemPosition::ptPlotCoords);
+            pPosition->setTypeY(QCPItemPosition::ptAxisRectRatio);
+        }
+        pBandRect->topLeft->setCoords(band.low_Hz, 0.);
+        pBandRect->bottomRight->setCoords(band.high_Hz, 1.);
+        pBandRect->setPen(Qt::NoPen);
+        pBandRect->setBrush(QColor(230, 120, 30, 60));
+        pBandRect->setSelectable(false);
+    }
+
+    const double maxFrequency_Hz = spectrum.frequencyStep_Hz * (spectrum.psd[0].size() - 1);
+    m_pPlot->xAxis->setRange(0., maxFrequency_Hz);
+    if (maxPsd > 0.)
+    {
+        // Eight decades below the peak are plenty, the rest is rounding noise
+        m_pPlot->yAxis->setRange(std::max(minPsd, maxPsd * 1e-8), maxPsd * 2.);
+    }
+    m_pPlot->replot();
+}
+
+void SpectrumDock::Clear()
+{
+    m_pPlot->clearGraphs();
+    m_pPlot->clearItems();
+    m_pPlot->replot();
+}
@@ -0,0 +1,24 @@
+#ifndef SPECTRUM_DOCK_H
+#define SPECTRUM_DOCK_H
+
+#include <QDockWidget>
+#include <qcustomplot.h>
+
+#include "gradient_spectrum.h"
+
+// Dockable plot of the gradient power spectra, one graph per axis on a
+// logarithmic scale with the forbidden bands shaded.
+class SpectrumDock : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit SpectrumDock(const QString& title, QWidget *parent = nullptr);
+
+    void SetSpectrum(const GradientSpectrum& spectrum, const std::vector<ForbiddenBand>& bands);
+    void Clear();
+
+private:
+    QCustomPlot                          *m_pPlot;
+};
+
+#endif // SPECTRUM_DOCK_H
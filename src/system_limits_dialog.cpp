@@ -0,0 +1,62 @@
+#include "system_limits_dialog.h"
+
+#include <QDialogButtonBox>
+#include <QVBoxLayout>
+
+SystemLimitsDialog::SystemLimitsDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("System Limits");
+    QVBoxLayout* pLayout = new QVBoxLayout(this);
+    m_pFormLayout = new QFormLayout;
+    pLayout->addLayout(m_pFormLayout);
+
+    m_pMaxGradSpinBox = AddSpinBox("Max gradient", " mT/m", 2, 1000.);
+    m_pMaxSlewSpinBox = AddSpinBox("Max slew rate", " T/m/s", 2, 10000.);
+    m_pMaxB1SpinBox = AddSpinBox("Max B1", " uT", 3, 1000.);
+    m_pRfRasterSpinBox = AddSpinBox("RF raster", " us", 3, 1000.);
+    m_pGradRasterSpinBox = AddSpinBox("Gradient raster", " us", 3, 1000.);
+    m_pAdcRasterSpinBox = AddSpinBox("ADC raster", " us", 4, 1000.);
+    m_pBlockRasterSpinBox = AddSpinBox("Block duration raster", " us", 3, 1000.);
+
+    QDialogButtonBox* pButtonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(pButtonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(pButtonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    pLayout->addWidget(pButtonBox);
+
+    SetLimits(SystemLimits());
+}
+
+QDoubleSpinBox* SystemLimitsDialog::AddSpinBox(const QString& label, const QString& suffix, const int& decimals, const double& max)
+{
+    QDoubleSpinBox* pSpinBox = new QDoubleSpinBox(this);
+    pSpinBox->setDecimals(decimals);
+    pSpinBox->setRange(0., max);
+    pSpinBox->setSuffix(suffix);
+    m_pFormLayout->addRow(label, pSpinBox);
+    return pSpinBox;
+}
+
+void SystemLimitsDialog::SetLimits(const SystemLimits& limits)
+{
+    m_pMaxGradSpinBox->setValue(limits.maxGrad_Hz_m / GAMMA_HZ_T * 1e3);
+    m_pMaxSlewSpinBox->setValue(limits.maxSlew_Hz_m_s / GAMMA_HZ_T);
+    m_pMaxB1SpinBox->setValue(limits.maxB1_Hz / GAMMA_HZ_T * 1e6);
+    m_pRfRasterSpinBox->setValue(limits.rfRasterTime_us);
+    m_pGradRasterSpinBox->setValue(limits.gradRasterTime_us);
+    m_pAdcRasterSpinBox->setValue(limits.adcRasterTime_us);
+    m_pBlockRasterSpinBox->setValue(limits.blockDurationRaster_us);
+}
+
+SystemLimits SystemLimitsDialog::GetLimits() const
+{
+    SystemLimits limits;
+    limits.maxGrad_Hz_m = m_pMaxGradSpinBox->value() * 1e-3 * GAMMA_HZ_T;
+    limits.maxSlew_Hz_m_s = m_pMaxSlewSpinBox->value() * GAMMA_HZ_T;
+    limits.maxB1_Hz = m_pMaxB1SpinBox->value() * 1e-6 * GAMMA_HZ_T;
+    limits.rfRasterTime_us = m_pRfRasterSpinBox->value();
+    limits.gradRasterTime_us = m_pGradRasterSpinBox->value();
+    limits.adcRasterTime_us = m_pAdcRasterSpinBox->value();
+    limits.blockDurationRaster_us = m_pBlockRasterSpinBox->value();
+    return limits;
+}
@@ -0,0 +1,34 @@
+#ifndef SYSTEM_LIMITS_DIALOG_H
+#define SYSTEM_LIMITS_DIALOG_H
+
+#include <QDialog>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+
+#include "sequence_checker.h"
+
+// Edits the hardware limits in scanner units (mT/m, T/m/s, uT) and converts
+// them to the Pulseq units (Hz/m, Hz/m/s, Hz) used by SequenceChecker.
+class SystemLimitsDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit SystemLimitsDialog(QWidget *parent = nullptr);
+
+    void SetLimits(const SystemLimits& limits);
+    SystemLimits GetLimits() const;
+
+private:
+    QDoubleSpinBox* AddSpinBox(const QString& label, const QString& suffix, const int& decimals, const double& max);
+
+    QFormLayout                          *m_pFormLayout;
+    QDoubleSpinBox                       *m_pMaxGradSpinBox;
+    QDoubleSpinBox                       *m_pMaxSlewSpinBox;
+    QDoubleSpinBox                       *m_pMaxB1SpinBox;
+    QDoubleSpinBox                       *m_pRfRasterSpinBox;
+    QDoubleSpinBox                       *m_pGradRasterSpinBox;
+    QDoubleSpinBox                       *m_pAdcRasterSpinBox;
+    QDoubleSpinBox                       *m_pBlockRasterSpinBox;
+};
+
+#endif // SYSTEM_LIMITS_DIALOG_H
@@ -0,0 +1,138 @@
+#include "time_axis_controller.h"
+
+#include <algorithm>
+
+TimeAxisController::TimeAxisController(QCustomPlot* pPlot, QObject *parent)
+    : QObject(parent)
+    , m_pPlot(pPlot)
+    , m_stRange(0., 100.)
+    , m_stBounds(0., 0.)
+    , m_bApplying(false)
+    , m_bReplotPending(false)
+{
+    m_pFrameTimer = new QTimer(this);
+    m_pFrameTimer->setSingleShot(true);
+    connect(m_pFrameTimer, &QTimer::timeout, this, &TimeAxisController::OnFrameTimeout);
+    connect(m_pPlot, &QCustomPlot::beforeReplot, this, &TimeAxisController::OnBeforeReplot);
+    connect(m_pPlot, &QCustomPlot::afterReplot, this, &TimeAxisController::OnAfterReplot);
+}
+
+void TimeAxisController::SetLanes(const QList<QCPAxisRect*>& lanes)
+{
+    for (QCPAxisRect* pLane : m_listLanes)
+    {
+        disconnect(pLane->axis(QCPAxis::atBottom), nullptr, this, nullptr);
+    }
+    m_listLanes = lanes;
+    for (QCPAxisRect* pLane : m_listLanes)
+    {
+        connect(pLane->axis(QCPAxis::atBottom), QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged),
+                this, &TimeAxisController::OnAxisRangeChanged);
+    }
+    Apply(m_stRange);
+}
+
+void TimeAxisController::SetBounds(const double& lower, const double& upper)
+{
+    m_stBounds = QCPRange(lower, upper);
+    Apply(Clamp(m_stRange));
+}
+
+void TimeAxisController::SetRange(const double& lower, const double& upper)
+{
+    Apply(Clamp(QCPRange(lower, upper)));
+    RequestReplot();
+}
+
+void TimeAxisController::RequestReplot()
+{
+    if (m_bReplotPending) return;
+    m_bReplotPending = true;
+    m_stSinceRequest.start();
+    const qint64 elapsed_ms = m_stSinceFrame.isValid() ? m_stSinceFrame.elapsed() : FRAME_INTERVAL_MS;
+    m_pFrameTimer->start(std::max<qint64>(0, FRAME_INTERVAL_MS - elapsed_ms));
+}
+
+QCPAxis* TimeAxisController::ReferenceAxis() const
+{
+    for (QCPAxisRect* pLane : m_listLanes)
+    {
+        if (nullptr != pLane->layout()) return pLane->axis(QCPAxis::atBottom);
+    }
+    return m_listLanes.isEmpty() ? nullptr : m_listLanes.first()->axis(QCPAxis::atBottom);
+}
+
+void TimeAxisController::ResetStats()
+{
+    m_stFrameStats = FrameStats();
+}
+
+void TimeAxisController::OnAxisRangeChanged(const QCPRange& newRange)
+{
+    // Ranges pushed by Apply() come back here, the lane that changed first wins
+    if (m_bApplying) return;
+    Apply(Clamp(newRange));
+    RequestReplot();
+}
+
+void TimeAxisController::OnFrameTimeout()
+{
+    m_pPlot->replot(QCustomPlot::rpImmediateRefresh);
+}
+
+void TimeAxisController::OnBeforeReplot()
+{
+    m_stReplotTimer.start();
+}
+
+void TimeAxisController::OnAfterReplot()
+{
+    // Any replot shows the current range, also the ones QCustomPlot queues
+    // itself while dragging, so a pending frame is no longer needed
+    const double frame_ms = m_stReplotTimer.nsecsElapsed() * 1e-6;
+    m_stFrameStats.frames++;
+    m_stFrameStats.last_ms = frame_ms;
+    m_stFrameStats.average_ms += (frame_ms - m_stFrameStats.average_ms) / m_stFrameStats.frames;
+    m_stFrameStats.max_ms = std::max(m_stFrameStats.max_ms, frame_ms);
+    if (m_bReplotPending)
+    {
+        m_stFrameStats.latency_ms = m_stSinceRequest.nsecsElapsed() * 1e-6;
+        m_pFrameTimer->stop();
+        m_bReplotPending = false;
+    }
+    m_stSinceFrame.start();
+    emit frameTimed(m_stFrameStats);
+}
+
+QCPRange TimeAxisController::Clamp(const QCPRange& range) const
+{
+    if (m_stBounds.upper <= m_stBounds.lower) return range;
+
+    // Keep the span while shifting back inside, shrink it only if it is wider than the bounds
+    QCPRange bounded = range;
+    if (bounded.lower < m_stBounds.lower)
+    {
+        bounded.lower = m_stBounds.lower;
+        bounded.upper = std::min(m_stBounds.lower + range.size(), m_stBounds.upper);
+    }
+    if (bounded.upper > m_stBounds.upper)
+    {
+        bounded.upper = m_stBounds.upper;
+        bounded.lower = std::max(m_stBounds.upper - range.size(), m_stBounds.lower);
+    }
+    return bounded;
+}
+
+void TimeAxisController::Apply(const QCPRange& range)
+{
+    const bool bChanged = range != m_stRange;
+    m_stRange = range;
+    m_bApplying = true;
+    for (QCPAxisRect* pLane : m_listLanes)
+    {
+        QCPAxis* pAxis = pLane->axis(QCPAxis::atBottom);
+        if (pAxis->range() != range) pAxis->setRange(range);
+    }
+    m_bApplying = false;
+    if (bChanged) emit rangeChanged(m_stRange);
+}
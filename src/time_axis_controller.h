@@ -0,0 +1,79 @@
+#ifndef TIME_AXIS_CONTROLLER_H
+#define TIME_AXIS_CONTROLLER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+#include <qcustomplot.h>
+
+#define FRAME_INTERVAL_MS            (16)
+
+struct FrameStats
+{
+    quint64 frames;
+    double  last_ms;         // replot of the last frame
+    double  average_ms;
+    double  max_ms;
+    double  latency_ms;      // first request of the last frame to the end of its replot
+
+    FrameStats()
+        : frames(0)
+        , last_ms(0.)
+        , average_ms(0.)
+        , max_ms(0.)
+        , latency_ms(0.)
+    {}
+};
+
+// Owns the time range shared by the bottom axes of all lanes. A range change
+// of any lane, from a drag, a wheel zoom or SetRange(), is clamped once and
+// pushed to every lane; hidden lanes are kept in step so they show the same
+// window when enabled again. Replot requests are coalesced to at most one
+// replot per FRAME_INTERVAL_MS, and every replot of the plot is timed.
+class TimeAxisController : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TimeAxisController(QCustomPlot* pPlot, QObject *parent = nullptr);
+
+    void SetLanes(const QList<QCPAxisRect*>& lanes);
+    // No clamping while upper <= lower
+    void SetBounds(const double& lower, const double& upper);
+    void SetRange(const double& lower, const double& upper);
+    void RequestReplot();
+
+    const QCPRange& Range() const { return m_stRange; }
+    // Bottom axis of the first lane in the layout, for pixel to time conversion
+    QCPAxis* ReferenceAxis() const;
+    const FrameStats& Stats() const { return m_stFrameStats; }
+    void ResetStats();
+
+signals:
+    void rangeChanged(const QCPRange& range);
+    void frameTimed(const FrameStats& stats);
+
+private slots:
+    void OnAxisRangeChanged(const QCPRange& newRange);
+    void OnFrameTimeout();
+    void OnBeforeReplot();
+    void OnAfterReplot();
+
+private:
+    QCPRange Clamp(const QCPRange& range) const;
+    void Apply(const QCPRange& range);
+
+    QCustomPlot                          *m_pPlot;
+    QList<QCPAxisRect*>                  m_listLanes;
+    QCPRange                             m_stRange;
+    QCPRange                             m_stBounds;
+    bool                                 m_bApplying;
+    bool                                 m_bReplotPending;
+    QTimer                               *m_pFrameTimer;
+    QElapsedTimer                        m_stSinceFrame;
+    QElapsedTimer                        m_stSinceRequest;
+    QElapsedTimer                        m_stReplotTimer;
+    FrameStats                           m_stFrameStats;
+};
+
+#endif // TIME_AXIS_CONTROLLER_H